@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2013 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+/* Registry of traffic categories.
+ *
+ * The category names given to model_net_event, lsm_io_event, etc. are
+ * interned into small integer ids. Events carry the id, and per-category
+ * statistics are arrays indexed by it.
+ *
+ * Ids are handed out in registration order, so they only agree between
+ * processes if every process registers the same names in the same order.
+ * Simulations register the categories they use before tw_run, e.g. right
+ * after configuration_load; models register the names they interpret while
+ * being configured. A name first seen while the simulation runs is
+ * registered then, which is only allowed on a single process. */
+
+#ifndef CODES_CATEGORY_H
+#define CODES_CATEGORY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CATEGORY_NAME_MAX 16
+#define CATEGORY_MAX 12
+
+/* returns the id of the category, registering it if it is new */
+int codes_category_register(char const * name);
+
+/* returns the id of the category of an event, see above for unknown names */
+int codes_category_id(char const * name);
+
+/* returns the id of a registered category, -1 for unknown names */
+int codes_category_lookup(char const * name);
+
+/* returns the name of a category id */
+char const * codes_category_name(int id);
+
+/* returns the number of registered categories */
+int codes_category_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CODES_CATEGORY_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ft=c ts=8 sts=4 sw=4 expandtab
+ */
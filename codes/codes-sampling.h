@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2014 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+/* In-situ time-series sampling with per-PE aggregation.
+ *
+ * A sampler is a named series shared by all LPs of a PE that take the same
+ * kind of sample. Each LP attaches a ring to it, tagged with a group (e.g.
+ * the LP's dragonfly group or job), and pushes one sample per interval: a
+ * fixed number of raw values, reduced to the sampler's metrics.
+ *
+ * Samples stay in the LP's ring only while they can still be rolled back.
+ * Once committed (older than GVT in optimistic mode, right away otherwise)
+ * they are moved into per-interval bins on the PE, and a bin is written out
+ * through LP-IO as soon as no more samples can arrive for it. Each bin
+ * becomes one row per (group, metric) with the count, sum, min, max and
+ * percentiles over the PE's samples, in the LP-IO table
+ * "<name>-samples" (see codes/lp-io-table.h). Memory therefore stays
+ * bounded by the ring size and the rollback window rather than growing with
+ * the run length.
+ *
+ * Samples pushed long after their interval ended (more than one interval
+ * after it, once it has been written) end up in an extra row for the same
+ * interval and group; counts, sums, min and max of such rows combine, their
+ * percentiles don't. */
+
+#ifndef CODES_SAMPLING_H
+#define CODES_SAMPLING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <ross.h>
+
+#define CODES_SAMPLE_METRIC_MAX 24
+/* default number of uncommitted samples an LP can hold before its ring
+ * grows */
+#define CODES_SAMPLE_RING_SIZE 16
+
+struct codes_sampler;
+struct codes_sample_ring;
+
+/* turn the raw values of one sample into num_metrics metrics */
+typedef void (*codes_sample_reduce_f)(
+        double const * values,
+        double * metrics,
+        void * arg);
+
+/* get the PE's sampler of the given name, creating it on first use.
+ * num_values raw values per sample are reduced to num_metrics metrics by
+ * reduce (NULL: the values are the metrics). interval maps sample times to
+ * intervals; groups are 0 .. num_groups-1 */
+struct codes_sampler * codes_sampler_get(
+        char const * name,
+        int num_values,
+        int num_metrics,
+        char const * const * metric_names,
+        codes_sample_reduce_f reduce,
+        void * reduce_arg,
+        int num_groups,
+        tw_stime interval);
+
+/* attach an LP to a sampler; ring_size samples are kept before growing */
+struct codes_sample_ring * codes_sample_ring_create(
+        struct codes_sampler * sampler,
+        int group,
+        int ring_size);
+
+/* record the sample for the interval ending at sample_time */
+void codes_sample_push(
+        struct codes_sample_ring * r,
+        tw_lp * lp,
+        tw_stime sample_time,
+        double const * values);
+
+/* reverse of codes_sample_push, optimistic mode only. Returns the values of
+ * the removed sample, valid until the ring is used again */
+double const * codes_sample_push_rc(struct codes_sample_ring * r);
+
+/* detach from lp's finalize function. Once every ring of the sampler is
+ * gone, all remaining bins are written out and the sampler is freed. A NULL
+ * ring is ignored */
+void codes_sample_ring_destroy(struct codes_sample_ring * r, tw_lp * lp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard: CODES_SAMPLING_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -34,6 +34,7 @@ typedef struct recorder_params recorder_params;
 typedef struct dumpi_trace_params dumpi_trace_params;
 typedef struct checkpoint_wrkld_params checkpoint_wrkld_params;
 typedef struct online_comm_params online_comm_params;
+typedef struct synthetic_params synthetic_params;
 
 struct iomock_params
 {
@@ -95,6 +96,53 @@ struct checkpoint_wrkld_params
     double mtti; /* mean time to interrupt, in hours */
 };
 
+/* destination patterns of the synthetic workload */
+enum codes_synthetic_pattern
+{
+    SYNTHETIC_UNIFORM,        /* any other rank, uniformly at random */
+    SYNTHETIC_PERMUTATION,    /* random derangement of the ranks */
+    SYNTHETIC_BIT_COMPLEMENT, /* rank nprocs-1-r */
+    SYNTHETIC_TRANSPOSE,      /* ranks as a square matrix, (x,y) -> (y,x) */
+    SYNTHETIC_TORNADO,        /* halfway round the ring of ranks, less one */
+    SYNTHETIC_HOTSPOT,        /* hotspot_rank with hotspot_fraction, else uniform */
+    SYNTHETIC_INCAST,         /* all to hotspot_rank */
+    SYNTHETIC_STENCIL,        /* grid neighbours, in turn */
+};
+
+/* message arrival processes of the synthetic workload */
+enum codes_synthetic_arrival
+{
+    SYNTHETIC_POISSON,        /* exponential gaps between messages */
+    SYNTHETIC_BURSTY,         /* back-to-back bursts, exponential gaps between */
+};
+
+#define SYNTHETIC_MAX_DIMS 4
+
+struct synthetic_params
+{
+    int nprocs; /* number of workload processes */
+    int pattern; /* enum codes_synthetic_pattern */
+    int arrival; /* enum codes_synthetic_arrival */
+    int64_t num_messages; /* messages sent by each rank */
+    int64_t payload_size; /* bytes per message */
+    double interval; /* mean time between messages, in ns */
+    int burst_length; /* messages per burst, bursty arrivals only */
+    int hotspot_rank; /* target of hotspot and incast traffic */
+    double hotspot_fraction; /* share of hotspot traffic sent to hotspot_rank */
+    int64_t perm_switch; /* messages between permutation changes, 0 = never */
+    int stencil_dims[SYNTHETIC_MAX_DIMS]; /* stencil grid, unused dims 0 */
+    uint64_t seed; /* seed of the destination and arrival draws */
+};
+
+/* destination of message msg of rank in the synthetic workload, -1 for a
+ * rank that the pattern gives no traffic to send. Random draws are a
+ * function of (seed, rank, msg) only, so callers can recompute a
+ * destination instead of saving it */
+int codes_workload_synthetic_dest(
+        synthetic_params const * p,
+        int rank,
+        int64_t msg);
+
 /* supported I/O operations */
 enum codes_workload_op_type
 {
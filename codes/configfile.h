@@ -45,6 +45,11 @@ struct ConfigVTable
     * of file fields */
     char * config_dir;
 
+   /* Hashed snapshot of the top-level sections and keys used by the
+    * configuration_get_value* lookups, NULL if not built (see
+    * configuration_build_index) */
+    struct config_index * index;
+
    /* Returns number of characters in key or < 0 if an error occured 
     * (such as key is missing) 
     *
@@ -81,6 +81,22 @@ typedef struct config_lpgroups_s
 
 typedef struct ConfigVTable * ConfigHandle;
 
+/*
+ * How configuration_load reads the configuration file:
+ * CONFIGURATION_LOAD_BCAST - rank 0 of the communicator parses the file and
+ *                            broadcasts the parsed tree to the other ranks,
+ *                            which never touch the file system (default)
+ * CONFIGURATION_LOAD_ALL   - every rank reads (collectively) and parses the
+ *                            file
+ */
+enum configuration_load_mode
+{
+    CONFIGURATION_LOAD_BCAST,
+    CONFIGURATION_LOAD_ALL
+};
+
+extern enum configuration_load_mode configuration_load_mode;
+
 /*
  * Load a configuration on the system (collectively)
  *
@@ -94,6 +110,20 @@ int configuration_load (const char * filepath,
                         MPI_Comm comm,
                         ConfigHandle *handle);
 
+/*
+ * Build (or rebuild) the lookup index of a configuration: a hash table of
+ * the keys of every top-level section (including annotated "key@anno"
+ * names), with their values parsed into the requested type on first use.
+ * configuration_load builds it; the index is a snapshot, so rebuild it
+ * after changing the configuration through the ConfigVTable interface.
+ * Without an index, lookups walk the configuration tree.
+ *
+ * handle - configuration handle
+ *
+ * return 0 on success
+ */
+int configuration_build_index (ConfigHandle *handle);
+
 /*
  * Free any resources allocated on load.
  *
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2013 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+/* Self-describing binary tables on top of LP-IO.
+ *
+ * A table is a file made of a schema header followed by fixed-width rows.
+ * Rows are plain C structs (or packed buffers) described by a list of
+ * columns; each column has a name, an element type, an element count (for
+ * per-port arrays) and its byte offset within the row. The header stores the
+ * column types as NumPy type codes so scripts/codes-stats.py can read a table
+ * straight into a structured array.
+ *
+ * Header layout (host byte order, all sizes in bytes):
+ *   char     magic[8]      "CODESTBL"
+ *   uint32_t byte_order    LP_IO_TABLE_BYTE_ORDER as written by the host
+ *   uint32_t version       LP_IO_TABLE_VERSION
+ *   uint32_t header_size   including the column entries, multiple of 8
+ *   uint32_t row_size
+ *   uint32_t num_columns
+ *   uint32_t reserved
+ *   num_columns times:
+ *     char     name[LP_IO_TABLE_NAME_MAX]   NUL padded
+ *     char     type[8]     NumPy code, e.g. "f8", "u8", "S2"
+ *     uint32_t offset
+ *     uint32_t count       1 for scalars and strings
+ */
+
+#ifndef LP_IO_TABLE_H
+#define LP_IO_TABLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdio.h>
+#include "codes/lp-io.h"
+
+#define LP_IO_TABLE_MAGIC "CODESTBL"
+#define LP_IO_TABLE_BYTE_ORDER 0x01020304
+#define LP_IO_TABLE_VERSION 1
+#define LP_IO_TABLE_NAME_MAX 40
+
+enum lp_io_col_type
+{
+    LP_IO_COL_INT32,
+    LP_IO_COL_UINT32,
+    LP_IO_COL_INT64,
+    LP_IO_COL_UINT64,
+    LP_IO_COL_DOUBLE,
+    /* fixed-length byte string, need not be NUL terminated */
+    LP_IO_COL_CHAR
+};
+
+#define LP_IO_COL_SIZE(_type) \
+    ((_type) == LP_IO_COL_CHAR ? 1 : \
+     ((_type) == LP_IO_COL_INT32 || (_type) == LP_IO_COL_UINT32) ? 4 : 8)
+
+struct lp_io_column
+{
+    char const * name;
+    enum lp_io_col_type type;
+    /* number of elements; for LP_IO_COL_CHAR the string length */
+    int count;
+    int offset;
+};
+
+/* describe field _field of row struct _row, named after the field */
+#define LP_IO_COLUMN(_row, _field, _type) \
+    { #_field, (_type), \
+      (int)(sizeof(((_row *)0)->_field) / LP_IO_COL_SIZE(_type)), \
+      (int)offsetof(_row, _field) }
+
+/* build the header for a table in a malloc'ed buffer; returns its size or
+ * -1 on error */
+int lp_io_table_header(
+        int row_size,
+        int num_columns,
+        struct lp_io_column const * columns,
+        void ** header);
+
+/* make identifier a table: its file starts with the header and every
+ * lp_io_write() to it must be a whole number of rows. Can be called by any
+ * number of LPs, see lp_io_write_header() */
+int lp_io_table_define(
+        char * identifier,
+        int row_size,
+        int num_columns,
+        struct lp_io_column const * columns);
+
+/* for tables written without LP-IO: write the header to fp if it is empty */
+int lp_io_table_fwrite_header(
+        FILE * fp,
+        int row_size,
+        int num_columns,
+        struct lp_io_column const * columns);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LP_IO_TABLE_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ft=c ts=8 sts=4 sw=4 expandtab
+ */
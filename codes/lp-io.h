@@ -16,6 +16,9 @@ extern "C" {
 typedef char* lp_io_handle;
 
 #define LP_IO_UNIQ_SUFFIX 1
+/* write data to disk during the simulation as soon as it can no longer be
+ * rolled back instead of holding everything in memory until lp_io_flush() */
+#define LP_IO_STREAM 2
 
 /* to be called (collectively) before running simulation to prepare the
  * output directory.
@@ -25,6 +28,13 @@ int lp_io_prepare(char *directory, int flags, lp_io_handle* handle, MPI_Comm com
 /* to be called within LPs to store a block of data */
 int lp_io_write(tw_lpid gid, char* identifier, int size, void* buffer);
 
+/* set data to be put at the start of the identifier's file, ahead of all
+ * records no matter which rank wrote them (e.g. a description of the
+ * records). Only the first call per identifier counts; if several ranks set
+ * one, the lowest rank's is used. This is not undone by rollback, so call it
+ * from LP init or finalize */
+int lp_io_write_header(char* identifier, int size, void* buffer);
+
 /* undo the immediately preceding write for the given LP */
 int lp_io_write_rev(tw_lpid gid, char* identifier);
 
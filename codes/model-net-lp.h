@@ -17,6 +17,7 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include <ross.h>
 #include "codes/lp-msg.h"
 #include "model-net.h"
@@ -75,7 +76,7 @@ void model_net_method_send_msg_recv_event(
         uint64_t pull_size, // the size of the message to pull if is_pull==1
         int remote_event_size,
         const mn_sched_params *sched_params,
-        const char * category,
+        int category,
         int net_id,
         void * msg,
         tw_stime offset,
@@ -107,12 +108,17 @@ void * model_net_method_get_edata(int net_id, void * msg);
 
 enum model_net_base_event_type {
     MN_BASE_NEW_MSG,
+    // several new messages from one sender (model_net_event_batch)
+    MN_BASE_NEW_BATCH,
     // schedule next packet
     MN_BASE_SCHED_NEXT,
     // gather a sample from the underlying model
     MN_BASE_SAMPLE,
     // message goes directly down to topology-specific event handler
-    MN_BASE_PASS
+    MN_BASE_PASS,
+    // one stripe of a message split across the injection queues arrived
+    // (PARAMS:rail_striping = split)
+    MN_BASE_STRIPE_DONE
 };
 
 typedef struct model_net_base_msg {
@@ -121,16 +127,50 @@ typedef struct model_net_base_msg {
     int is_from_remote;
     int isQueueReq;
     tw_stime save_ts;
+    // split messages: bit i set if we started the send loop of queue i
+    uint32_t stripe_kick;
     // parameters to pass to new messages (via model_net_set_msg_params)
     // TODO: make this a union for multiple types of parameters
     mn_sched_params sched_params;
     model_net_sched_rc rc; // rc for scheduling events
 } model_net_base_msg;
 
+// MN_BASE_NEW_BATCH payload: after the wrap message comes the entry count,
+// then each entry followed by its remote and self events, padded to 8 bytes.
+// m_base.req holds the fields common to all entries
+typedef struct model_net_batch_hdr {
+    int count;
+} model_net_batch_hdr;
+
+typedef struct model_net_batch_item {
+    tw_lpid final_dest_lp;
+    tw_lpid dest_mn_lp;
+    uint64_t msg_size;
+    mn_sched_params sched_params;
+    int remote_event_size;
+    int self_event_size;
+} model_net_batch_item;
+
+#define MN_BATCH_HDR_SIZE ((sizeof(model_net_batch_hdr) + 7) & ~(size_t)7)
+#define MN_BATCH_ITEM_SIZE(_remote, _self) \
+    ((sizeof(model_net_batch_item) + (_remote) + (_self) + 7) & ~(size_t)7)
+
+// MN_BASE_STRIPE_DONE payload: the remote event of every stripe of a split
+// message is the wrap header and this struct only (see MN_STRIPE_EVENT_SIZE),
+// the one of stripe 0 is followed by the original remote event
+typedef struct model_net_stripe_msg {
+    tw_lpid final_dest_lp; // where the original remote event goes
+    tw_lpid src_mn_lp;     // sending NIC, keys the message with parent_id
+    uint64_t parent_id;
+    int num_stripes;
+    int remote_event_size; // of the original remote event, stripe 0 only
+} model_net_stripe_msg;
+
 typedef struct model_net_wrap_msg {
     msg_header h;
     union {
         model_net_base_msg      m_base;  // base lp
+        model_net_stripe_msg    m_stripe; // base lp, stripe of a split message
         terminal_message        m_dfly;  // dragonfly
         terminal_custom_message        m_custom_dfly;  // dragonfly-custom
         terminal_plus_message        m_dfly_plus;  // dragonfly plus
@@ -146,6 +186,9 @@ typedef struct model_net_wrap_msg {
     } msg;
 } model_net_wrap_msg;
 
+#define MN_STRIPE_EVENT_SIZE \
+    (offsetof(model_net_wrap_msg, msg) + sizeof(model_net_stripe_msg))
+
 #ifdef __cplusplus
 }
 #endif
@@ -42,7 +42,7 @@ struct model_net_method
             int is_last_pckt);
     void (*model_net_method_packet_event_rc)(tw_lp *sender);
     tw_stime (*model_net_method_recv_msg_event)(
-            const char * category,
+            int category,
             tw_lpid final_dest_lp,
             tw_lpid src_mn_lp, // the modelnet LP this message came from
             uint64_t msg_size,
@@ -57,7 +57,7 @@ struct model_net_method
     const tw_lptype* (*mn_get_lp_type)();
     int (*mn_get_msg_sz)();
     void (*mn_report_stats)();
-    void (*mn_collective_call)(char const * category, int message_size, int remote_event_size, const void* remote_event, tw_lp* sender);
+    void (*mn_collective_call)(int category, int message_size, int remote_event_size, const void* remote_event, tw_lp* sender);
     void (*mn_collective_call_rc)(int message_size, tw_lp* sender);
     event_f mn_sample_fn;
     revent_f mn_sample_rc_fn;
@@ -65,6 +65,10 @@ struct model_net_method
     final_f mn_sample_fini_fn;
     void (*mn_model_stat_register)(st_model_types *base_type);
     const st_model_types* (*mn_get_model_stat_types)();
+    /* nonzero if model_net_method_packet_event accepts a packet train: a
+     * packet_size spanning several req->packet_size packets that the model
+     * queues in one event. Models leaving this 0 always get single packets */
+    int mn_packet_trains;
 };
 
 extern struct model_net_method * method_array[];
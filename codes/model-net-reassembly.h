@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2014 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+/* Packet reassembly table shared by the model-net terminal models.
+ *
+ * A terminal tracks every message it is receiving by (message id, sender
+ * lp) so it knows when the last chunk has arrived and which remote event to
+ * deliver. The table is open-addressed (linear probing, backward-shift
+ * deletion) and entries come from a per-table pool, so the receive path does
+ * not touch malloc unless a remote event is larger than
+ * MN_REASM_INLINE_SIZE.
+ *
+ * Rollback: an entry that completes is unlinked and pushed onto the caller's
+ * rc stack via mn_reasm_complete(); mn_reasm_complete_rc() pops and relinks
+ * it. The rc stack must therefore be destroyed before the table. */
+
+#ifndef MODEL_NET_REASSEMBLY_H
+#define MODEL_NET_REASSEMBLY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <ross.h>
+#include "codes/rc-stack.h"
+
+/* remote events up to this size are stored in the entry itself */
+#ifndef MN_REASM_INLINE_SIZE
+#define MN_REASM_INLINE_SIZE 128
+#endif
+
+/* default initial capacity; the table doubles as needed */
+#define MN_REASM_INITIAL_SIZE 64
+
+struct mn_reasm_table;
+
+struct mn_reasm_entry
+{
+    uint64_t message_id;
+    tw_lpid sender_id;
+    uint64_t num_chunks;
+    int remote_event_size;
+    /* points to inline_data or to a heap buffer, NULL if not yet set */
+    char * remote_event_data;
+    struct mn_reasm_table * owner;
+    struct mn_reasm_entry * next_free;
+    char inline_data[MN_REASM_INLINE_SIZE];
+};
+
+/* create a table able to hold initial_size messages before growing */
+struct mn_reasm_table * mn_reasm_create(int initial_size);
+void mn_reasm_destroy(struct mn_reasm_table * t);
+
+/* number of messages currently being reassembled */
+int mn_reasm_count(struct mn_reasm_table const * t);
+
+/* returns NULL if no entry exists for the message */
+struct mn_reasm_entry * mn_reasm_find(
+        struct mn_reasm_table * t,
+        uint64_t message_id,
+        tw_lpid sender_id);
+
+/* create and link a fresh entry (num_chunks = 0, no remote event). The
+ * message must not already be present */
+struct mn_reasm_entry * mn_reasm_insert(
+        struct mn_reasm_table * t,
+        uint64_t message_id,
+        tw_lpid sender_id);
+
+/* copy the remote event into the entry if it doesn't have one yet */
+void mn_reasm_set_remote_event(
+        struct mn_reasm_entry * e,
+        void const * data,
+        int size);
+
+/* reverse of mn_reasm_insert: unlink the entry and return it to the pool */
+void mn_reasm_discard(struct mn_reasm_table * t, struct mn_reasm_entry * e);
+
+/* the message is fully reassembled: unlink the entry and keep it on the rc
+ * stack until GVT passes */
+void mn_reasm_complete(
+        struct mn_reasm_table * t,
+        struct mn_reasm_entry * e,
+        tw_lp const * lp,
+        struct rc_stack * st);
+
+/* reverse of mn_reasm_complete: relink and return the most recently
+ * completed entry */
+struct mn_reasm_entry * mn_reasm_complete_rc(
+        struct mn_reasm_table * t,
+        struct rc_stack * st);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard: MODEL_NET_REASSEMBLY_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
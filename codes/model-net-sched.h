@@ -30,6 +30,8 @@ typedef struct mn_sched_params_s mn_sched_params;
     X(MN_SCHED_FCFS_FULL, "fcfs-full",   &fcfs_tab) \
     X(MN_SCHED_RR,        "round-robin", &rr_tab) \
     X(MN_SCHED_PRIO,      "priority",    &prio_tab) \
+    X(MN_SCHED_DRR,       "drr",         &drr_tab) \
+    X(MN_SCHED_WPRIO,     "weighted-priority", &wprio_tab) \
     X(MAX_SCHEDS,         NULL,          NULL)
 
 #define X(a,b,c) a,
@@ -50,13 +52,37 @@ typedef struct mn_prio_params_s {
     enum sched_type sub_stype;
 } mn_prio_params;
 
+// upper bound on traffic classes for the drr and weighted-priority
+// schedulers (one bit per class in their active-class bitmaps)
+#define MN_SCHED_MAX_CLASSES 32
+
+// drr and weighted-priority scheduler configuration parameters
+// - drr: deficit round robin over the classes, each visit credits a class
+//   weight * quantum bytes (weighted fair queueing when weights differ)
+// - weighted-priority: the lowest-numbered class with credit left goes
+//   first; once every backlogged class has spent its weight * quantum bytes
+//   all of them are credited again, so low classes are never starved
+typedef struct mn_class_params_s {
+    int num_classes;
+    // bytes credited per round to a class of weight 1
+    uint64_t quantum;
+    int weights[MN_SCHED_MAX_CLASSES];
+    // messages of category id categories[i] go to class i unless they set
+    // MN_SCHED_PARAM_PRIO themselves; -1 == no category
+    int categories[MN_SCHED_MAX_CLASSES];
+} mn_class_params;
+
 // TODO: other scheduler config params
 
 // initialization parameter set
 typedef struct model_net_sched_cfg_params_s {
     enum sched_type type;
+    // packets issued per sched_next on the send side (PARAMS:
+    // packet_train_length), only honored by methods with mn_packet_trains set
+    int train_len;
     union {
         mn_prio_params prio;
+        mn_class_params cls; // drr, weighted-priority
     } u;
 } model_net_sched_cfg_params;
 
@@ -66,7 +92,7 @@ typedef struct mn_sched_cfg_params {
 
 /// message-specific parameters
 enum sched_msg_param_type {
-    MN_SCHED_PARAM_PRIO, // currently, only the priority scheduler has params
+    MN_SCHED_PARAM_PRIO, // priority, or class for drr/weighted-priority
     MAX_SCHED_MSG_PARAM_TYPES
 };
 
@@ -141,7 +167,12 @@ struct model_net_sched_rc_s {
     model_net_request req; // request gets deleted...
     mn_sched_params sched_params; // along with msg params
     int rtn; // return code from a sched_next 
-    int prio; // prio when doing priority queue events
+    int prio; // prio when doing priority queue events (class for drr/wprio)
+    // drr/weighted-priority: credit of the served class before sched_next
+    // and what else sched_next changed (drr: rotated/fresh visit bits,
+    // weighted-priority: number of credit rounds started)
+    int64_t class_credit;
+    int class_flags;
 };
 
 // initialize the scheduler
@@ -16,6 +16,7 @@ extern "C" {
 #include <codes/configuration.h>
 #include <codes/lp-io.h>
 #include <codes/codes-mapping-context.h>
+#include <codes/codes-category.h>
 #include <stdint.h>
 
 #ifdef ENABLE_CORTEX
@@ -26,8 +27,6 @@ extern "C" {
 #define PULL_MSG_SIZE 128
 
 #define MAX_NAME_LENGTH 256
-#define CATEGORY_NAME_MAX 16
-#define CATEGORY_MAX 12
 
 // simple deprecation attribute hacking
 #if !defined(DEPRECATED)
@@ -44,6 +43,8 @@ extern "C" {
  * involves model-net LP-level scheduling of requests is ideal, but not
  * feasible for now (would basically have to redesign model-net), so expose
  * explicit start-sequence and stop-sequence markers as a workaround
+ *
+ * NOTE: model_net_event_batch also keeps the order of its messages at the NIC
  */
 extern int mn_in_sequence;
 extern tw_stime mn_msg_offset;
@@ -133,7 +134,7 @@ typedef struct model_net_request {
     int      queue_offset;
     int      remote_event_size;
     int      self_event_size;
-    char     category[CATEGORY_NAME_MAX];
+    int      category; // id from codes/codes-category.h
 
     //for counting msg app id
     int     app_id;
@@ -143,7 +144,9 @@ typedef struct model_net_request {
 /* data structure for tracking network statistics */
 struct mn_stats
 {
-    char category[CATEGORY_NAME_MAX];
+    // category id, -1 for the total over all categories
+    int category;
+    int used;
     long send_count;
     long send_bytes;
     tw_stime send_time;
@@ -174,6 +177,9 @@ void model_net_enable_sampling(tw_stime interval, tw_stime end);
 /* Returns 1 if modelnet is performing sampling, 0 otherwise */
 int model_net_sampling_enabled(void);
 
+/* Returns the interval passed to model_net_enable_sampling */
+tw_stime model_net_sampling_interval(void);
+
 /* Initialize/configure the network(s) based on the CODES configuration.
  * returns an array of the network ids, indexed in the order given by the
  * modelnet_order configuration parameter
@@ -289,6 +295,48 @@ model_net_event_return model_net_event_mctx(
         void const * self_event,
         tw_lp *sender);
 
+/* one destination of a model_net_event_batch call, see model_net_event for
+ * the fields. sched_params, if non-NULL, overrides the parameters set with
+ * model_net_set_msg_param for this entry */
+struct model_net_batch_entry {
+    tw_lpid final_dest_lp;
+    uint64_t message_size;
+    int remote_event_size;
+    void const * remote_event;
+    int self_event_size;
+    void const * self_event;
+    struct mn_sched_params_s const * sched_params;
+};
+
+/*
+ * See model_net_event for a general description.
+ *
+ * Sends one message per entry. Messages bound for a remote NIC reach the
+ * sender's NIC in a single event (more only if they don't fit in
+ * g_tw_msg_sz) instead of one event per destination. The NIC then sequences
+ * them one by one in array order, with the same per-message delay (PARAMS:
+ * nic_seq_delay) as for n model_net_event calls. Messages to the sender's
+ * own NIC take the model_net_event path. Parameters set with
+ * model_net_set_msg_param apply to every entry. The whole batch is reversed
+ * by one model_net_event_rc2 call on the returned value.
+ */
+model_net_event_return model_net_event_batch(
+        int net_id,
+        char const * category,
+        int n,
+        struct model_net_batch_entry const * entries,
+        tw_stime offset,
+        tw_lp *sender);
+/* same as ^, except use the supplied mapping contexts */
+model_net_event_return model_net_event_batch_mctx(
+        int net_id,
+        struct codes_mctx const * send_map_ctx,
+        struct codes_mctx const * recv_map_ctx,
+        char const * category,
+        int n,
+        struct model_net_batch_entry const * entries,
+        tw_stime offset,
+        tw_lp *sender);
 
 /* model_net_find_local_device()
  *
@@ -421,8 +469,9 @@ void model_net_write_stats(tw_lpid lpid, mn_stats* stat);
 /* printing model-net statistics on a per LP basis */
 void model_net_print_stats(tw_lpid lpid, mn_stats mn_stats_array[]);
 
-/* find model-net statistics */
-mn_stats* model_net_find_stats(char const * category, mn_stats mn_stats_array[]);
+/* find model-net statistics of a category id. mn_stats_array has
+ * CATEGORY_MAX entries, indexed by the id */
+mn_stats* model_net_find_stats(int category, mn_stats mn_stats_array[]);
 
 #ifdef ENABLE_CORTEX
 /* structure that gives access to the topology functions */
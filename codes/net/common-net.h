@@ -8,27 +8,6 @@ extern "C" {
 #endif
 
 
-struct mn_hash_key
-{
-  uint64_t message_id;
-  tw_lpid sender_id;
-};
-
-struct mn_qhash_entry
-{
-  struct mn_hash_key key;
-  char * remote_event_data;
-  int num_chunks;
-  int remote_event_size;
-  struct qhash_head hash_link;
-};
-
-extern int mn_rank_hash_compare(void *key, struct qhash_head *link);
-
-extern int mn_hash_func(void *k, int table_size);
-
-extern void free_tmp(void * ptr);
-
 typedef struct message_list message_list;
 
 struct message_list {
@@ -27,7 +27,7 @@ struct terminal_custom_message
   /* event type of the flit */
   short  type;
   /* category: comes from codes */
-  char category[CATEGORY_NAME_MAX];
+  int category;
   /* store category hash in the event */
   uint32_t category_hash;
   /* final destination LP ID, this comes from codes can be a server or any other LP type*/
@@ -27,7 +27,7 @@ struct terminal_dally_message
   /* event type of the flit */
   short  type;
   /* category: comes from codes */
-  char category[CATEGORY_NAME_MAX];
+  int category;
   /* store category hash in the event */
   uint32_t category_hash;
   /* final destination LP ID, this comes from codes can be a server or any other LP type*/
@@ -67,6 +67,9 @@ struct terminal_dally_message
    uint32_t packet_size;
    uint32_t message_id;
    uint32_t total_size;
+   /* T_GENERATE carrying a packet train: size of each packet in the train
+    * (packet_size is then the size of the whole train), 0 otherwise */
+   uint32_t train_packet_size;
 
    int remote_event_size_bytes;
    int local_event_size_bytes;
@@ -103,6 +106,12 @@ struct terminal_dally_message
    tw_stime msg_start_time;
    tw_stime saved_busy_time_ross;
    tw_stime saved_fin_chunks_ross;
+
+   /* fluid mode: solver epoch of a T_FLOW_DONE, and the number of chunks
+    * and packets a T_FLOW_ARRIVE stands for */
+   uint64_t flow_epoch;
+   uint32_t flow_chunks;
+   uint32_t flow_packets;
 };
 
 #ifdef __cplusplus
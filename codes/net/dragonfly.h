@@ -30,7 +30,7 @@ struct terminal_message
   /* event type of the flit */
   short  type;
   /* category: comes from codes */
-  char category[CATEGORY_NAME_MAX];
+  int category;
 
   /* store category hash in the event */
   uint32_t category_hash;
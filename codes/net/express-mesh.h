@@ -28,7 +28,7 @@ struct em_message
 
   tw_stime travel_start_time; /* flit travel start time*/
   unsigned long long packet_ID; /* packet ID of the flit  */
-  char category[CATEGORY_NAME_MAX]; /* category: comes from codes */
+  int category; /* category: comes from codes */
 
   tw_lpid final_dest_gid; /* final destination LP ID, this comes from codes can be a server or any other LP type*/
   tw_lpid sender_lp; /*sending LP ID from CODES, can be a server or any other LP type */
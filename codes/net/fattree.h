@@ -23,7 +23,7 @@ struct fattree_message
   /* event type of the flit */
   short  type;
   /* category: comes from codes */
-  char category[CATEGORY_NAME_MAX];
+  int category;
   /* final destination LP ID, this comes from codes can be a server or any other LP type*/
   tw_lpid final_dest_gid;
   /*sending LP ID from CODES, can be a server or any other LP type */
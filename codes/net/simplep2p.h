@@ -33,7 +33,7 @@ struct sp_message
     uint64_t net_msg_size_bytes;     /* size of modeled network message */
     int event_size_bytes;     /* size of simulator event message that will be tunnelled to destination */
     int local_event_size_bytes;     /* size of simulator event message that delivered locally upon local completion */
-    char category[CATEGORY_NAME_MAX]; /* category for communication */
+    int category; /* category for communication */
     
     model_net_event_return event_rc;
     int is_pull;
@@ -28,7 +28,7 @@ typedef enum nodes_event_t
 struct nodes_message
 {
   /* category: comes from codes message */
-  char category[CATEGORY_NAME_MAX];
+  int category;
   /* time the packet was generated */
   tw_stime travel_start_time;
   /* for reverse event computation*/
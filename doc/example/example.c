@@ -215,6 +215,10 @@ int main(
         return 1;
     }
 
+    /* register the traffic categories used with model-net, so that they get
+     * the same ids on every process */
+    codes_category_register("test");
+
     /* register model-net LPs with ROSS */
     model_net_register();
 
@@ -306,6 +306,7 @@ int main(int argc, char **argv)
     MPI_Comm_size(MPI_COMM_CODES, &nprocs);
 
     configuration_load(argv[2], MPI_COMM_CODES, &config);
+    codes_category_register("test");
 
     model_net_register();
     svr_add_lp_type();
@@ -413,6 +413,11 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    /* register the traffic categories used with model-net, so that they get
+     * the same ids on every process */
+    codes_category_register("ping");
+    codes_category_register("pong");
+
     /* register model-net LPs with ROSS */
     model_net_register();
 
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+# Reader for the binary tables written through LP-IO (codes/lp-io-table.h),
+# e.g. dragonfly-link-stats.bin and dragonfly-cn-stats.bin with
+# stats_format="binary", and the dragonfly-dally sampling files.
+#
+# As a module:
+#     import importlib; cs = importlib.import_module("codes-stats")
+#     links = cs.read_table("lp-io-dir/dragonfly-link-stats.bin")
+#     busy = links[links["link_type"] == b"G"]["busy_time"]
+#
+# From the command line, prints the schema and the rows as text:
+#     codes-stats.py [--schema] <file> [<file> ...]
+
+import struct
+import sys
+
+import numpy as np
+
+MAGIC = b"CODESTBL"
+BYTE_ORDER = 0x01020304
+NAME_MAX = 40
+HEADER = "8sIIIIII"
+COLUMN = "%ds8sII" % NAME_MAX
+
+
+def read_schema(buf):
+    """Parse a table header, returns (dtype, header_size)."""
+    if bytes(buf[:8]) != MAGIC:
+        raise ValueError("not a CODES table (bad magic)")
+    for order in "<>":
+        fields = struct.unpack_from(order + HEADER, buf)
+        if fields[1] == BYTE_ORDER:
+            break
+    else:
+        raise ValueError("unrecognized byte order")
+    _, _, version, header_size, row_size, num_columns, _ = fields
+    if version != 1:
+        raise ValueError("unsupported table version %d" % version)
+
+    names, formats, offsets = [], [], []
+    pos = struct.calcsize(HEADER)
+    for _ in range(num_columns):
+        name, code, offset, count = struct.unpack_from(order + COLUMN, buf, pos)
+        pos += struct.calcsize(COLUMN)
+        code = code.rstrip(b"\0").decode()
+        if not code.startswith("S"):
+            code = order + code
+        names.append(name.rstrip(b"\0").decode())
+        formats.append((code, (count,)) if count > 1 else code)
+        offsets.append(offset)
+    dtype = np.dtype({"names": names, "formats": formats,
+                      "offsets": offsets, "itemsize": row_size})
+    return dtype, header_size
+
+
+def read_table(path):
+    """Read a table file into a NumPy structured array."""
+    with open(path, "rb") as f:
+        buf = f.read()
+    dtype, header_size = read_schema(buf)
+    nrows = (len(buf) - header_size) // dtype.itemsize
+    return np.frombuffer(buf, dtype=dtype, count=nrows, offset=header_size)
+
+
+def main(argv):
+    schema_only = "--schema" in argv
+    paths = [a for a in argv if a != "--schema"]
+    if not paths:
+        sys.stderr.write("usage: codes-stats.py [--schema] <file> [<file> ...]\n")
+        return 1
+    for path in paths:
+        table = read_table(path)
+        names = table.dtype.names
+        if schema_only:
+            print("%s: %d rows" % (path, len(table)))
+            for n in names:
+                print("   %s %s" % (n, table.dtype.fields[n][0]))
+            continue
+        print("# " + " ".join(names))
+        for row in table:
+            cols = []
+            for n in names:
+                v = row[n]
+                if isinstance(v, bytes):
+                    cols.append(v.decode())
+                elif np.ndim(v):
+                    cols.append(" ".join(str(x) for x in v))
+                else:
+                    cols.append(str(v))
+            print(" ".join(cols))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -14,16 +14,8 @@ typedef struct CodesIOKernelContext
     void *lval;
     void *locval;
 
-    int64_t sym[26];
-    int64_t var[10];
-    int64_t next_var[10];
-
-    int inst_ready;
-
-    /* Ning's additions for the bgp storage model */
-    /* XXX Does this belong here? */
-    int GroupRank;
-    int GroupSize;
+    /* program the parsed statements are compiled into */
+    struct codes_kernel_prog * prog;
 
 } CodesIOKernelContext;
 
@@ -32,9 +24,6 @@ void CodesIOKernelScannerInit(
 void CodesIOKernelScannerDestroy(
     CodesIOKernelContext * context);
 
-void CodesIOKernelScannerSetSymTable(
-    CodesIOKernelContext * context);
-
 #endif
 
 /*
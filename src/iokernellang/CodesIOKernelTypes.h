@@ -65,13 +65,44 @@ typedef struct codesParserParam
 // the argument for the 'yylex' function
 //#define YYLEX_PARAM   ((codesParserParam *)data)->scanner
 
-extern int64_t * sym;
-extern int64_t * var;
-extern int * inst_ready;
-extern int * group_rank;
-extern int * group_size;
-extern int temp_group_rank;
-extern int temp_group_size;
+/* maximum number of arguments of an I/O statement */
+#define CODES_KERNEL_MAX_ARGS 3
+
+/* a kernel compiled to stack bytecode. The program is read-only once
+ * compiled, so all the ranks running the same kernel share it */
+typedef struct codes_kernel_prog
+{
+    int64_t * code;
+    int64_t len;
+    int64_t cap;
+} codes_kernel_prog;
+
+/* per-rank state of a running kernel */
+typedef struct codes_kernel_vm
+{
+    const codes_kernel_prog * prog;
+    int64_t pc;
+    int64_t sym[26];
+    int64_t group_rank;
+    int64_t group_size;
+    int done;
+} codes_kernel_vm;
+
+codes_kernel_prog * codes_kernel_prog_new(void);
+void codes_kernel_prog_free(codes_kernel_prog * prog);
+
+/* append the code of a parsed top-level statement */
+void codes_kernel_compile_stmt(codes_kernel_prog * prog, nodeType * p);
+
+void codes_kernel_vm_init(codes_kernel_vm * vm,
+        const codes_kernel_prog * prog, int64_t group_rank,
+        int64_t group_size);
+
+/* run until the next I/O statement and return its token (WRITEAT, OPEN,
+ * ...) with its evaluated arguments. Returns EXIT with the exit code once
+ * the kernel exits or runs off its end */
+int codes_kernel_vm_next(codes_kernel_vm * vm, int64_t * args,
+        int64_t * num_args);
 #endif
 
 /*
@@ -110,13 +110,48 @@ static int convertKLInstToEvent(int inst)
     return CL_UNKNOWN;
 }
 
-static void codes_kernel_helper_parse_cf(char * io_kernel_path,
-        char * io_kernel_meta_path, int task_rank, int max_ranks_default,
-        iolang_workload_info * task_info, int use_relpath)
+/* compiled kernels and parsed meta files, shared by the ranks of this PE */
+struct kernel_cache
+{
+    char * path;
+    codes_kernel_prog * prog;
+    struct kernel_cache * next;
+};
+
+struct meta_entry
+{
+    int gid;
+    int min;
+    int max;
+    char * kernel_path;
+};
+
+struct meta_cache
+{
+    char * path;
+    int use_relpath;
+    int num_entries;
+    struct meta_entry * entries;
+    struct meta_cache * next;
+};
+
+static struct kernel_cache * kernels = NULL;
+static struct meta_cache * metas = NULL;
+
+static struct meta_cache * codes_kernel_helper_load_cf(
+        char * io_kernel_meta_path, int use_relpath)
 {
-       int foundit = 0;
        char line[CK_LINE_LIMIT];
        FILE * ikmp = NULL;
+       struct meta_cache * m;
+       int cap = 0;
+
+       for(m = metas ; m ; m = m->next)
+       {
+           if(m->use_relpath == use_relpath &&
+                   strcmp(m->path, io_kernel_meta_path) == 0)
+               return m;
+       }
 
        /* open the config file */
        ikmp = fopen(io_kernel_meta_path, "r");
@@ -127,21 +162,33 @@ static void codes_kernel_helper_parse_cf(char * io_kernel_path,
            exit(1);
        }
 
+       m = calloc(1, sizeof(*m));
+       assert(m);
+       m->path = strdup(io_kernel_meta_path);
+       m->use_relpath = use_relpath;
+
        /* for each line in the config file */
        while(fgets(line, CK_LINE_LIMIT, ikmp) != NULL)
        {
                char * token = NULL;
-               int min = 0;
-               int max = 0;
-               int gid = 0;
                char * ctx = NULL;
+               struct meta_entry * e;
+
+               if(m->num_entries == cap)
+               {
+                   cap = cap ? 2 * cap : 8;
+                   m->entries = realloc(m->entries, cap * sizeof(*m->entries));
+                   assert(m->entries);
+               }
+               e = &m->entries[m->num_entries++];
+               memset(e, 0, sizeof(*e));
 
                /* parse the first element... the gid */
                token = strtok_r(line, " \n", &ctx);
                if(token)
-                   gid = atoi(token);
+                   e->gid = atoi(token);
 
-               if(gid == CL_DEFAULT_GID)
+               if(e->gid == CL_DEFAULT_GID)
                {
                    fprintf(stderr, "%s:%i incorrect GID detected in kernel meta\
                            file. Cannot use the reserved GID\
@@ -152,12 +199,12 @@ static void codes_kernel_helper_parse_cf(char * io_kernel_path,
                /* parse the second element... min rank */
                token = strtok_r(NULL, " \n", &ctx);
                if(token)
-                       min = atoi(token);
+                       e->min = atoi(token);
 
                /* parse the third element... max rank */
                token = strtok_r(NULL, " \n", &ctx);
                if(token)
-                       max = atoi(token);
+                       e->max = atoi(token);
 
                /* parse the last element... kernel path */
                token = strtok_r(NULL, " \n", &ctx);
@@ -166,153 +213,77 @@ static void codes_kernel_helper_parse_cf(char * io_kernel_path,
                            /* posix dirname overwrites argument :(, need to
                             * prevent that */
                            char *tmp_path = strdup(io_kernel_meta_path);
-                           sprintf(io_kernel_path, "%s/%s", dirname(tmp_path), token);
+                           e->kernel_path = malloc(strlen(tmp_path) +
+                                   strlen(token) + 2);
+                           sprintf(e->kernel_path, "%s/%s", dirname(tmp_path), token);
                            free(tmp_path);
                        }
                        else{
-                           strcpy(io_kernel_path, token);
+                           e->kernel_path = strdup(token);
                        }
                }
-
-               /* if our rank is on this range... end processing of the config
-                * file */
-               if(task_rank >= min && (max == -1 || task_rank <= max))
-               {
-                       task_info->group_id = gid;
-                       task_info->min_rank = min;
-                       task_info->max_rank = (max == -1) ? max_ranks_default : max;
-                       task_info->local_rank = task_rank - min;
-                       task_info->num_lrank = task_info->max_rank - min;
-
-                       foundit = 1;
-
-                       break;
-               }
        }
 
        /* close the config file */
        fclose(ikmp);
 
-       /* if we did not find the config file, set it to the default */
-       if(foundit == 0) {
-           fprintf(stderr,
-                   "ERROR: Unable to find iolang workload file "
-                   "from given metadata file %s... exiting\n",
-                   io_kernel_meta_path);
-           exit(1);
-       }
-
-       return;
+       m->next = metas;
+       metas = m;
+       return m;
 }
 
-int codes_kernel_helper_parse_input(CodesIOKernel_pstate * ps, CodesIOKernelContext * c,
-                          codeslang_inst * inst)
+static void codes_kernel_helper_parse_cf(char * io_kernel_path,
+        char * io_kernel_meta_path, int task_rank, int max_ranks_default,
+        iolang_workload_info * task_info, int use_relpath)
 {
-    int yychar;
-    int status;
-    int codes_inst = CL_NOOP;
+       struct meta_cache * m;
+       int i;
 
-    /* swap in the symbol table for the current LP context */
-    CodesIOKernelScannerSetSymTable(c);
+       m = codes_kernel_helper_load_cf(io_kernel_meta_path, use_relpath);
 
-    do
-    {
-        c->locval = CodesIOKernel_get_lloc(*((yyscan_t *)c->scanner_));
-        yychar = CodesIOKernel_lex((codesYYType*)c->lval, (YYLTYPE*)c->locval, c->scanner_);
-        c->locval = NULL;
-      
-        /* for each instructions */
-        switch(yychar)
-        {
-            /* for each instrunction that triggers a simulator event */
-            case WRITEAT:
-            case READAT:
-            case GETGROUPRANK:
-            case GETGROUPSIZE:
-            case CLOSE:
-            case OPEN:
-            case SYNC:
-            case SLEEP:
-            case EXIT:
-            case DELETE:
-            {
-                c->inst_ready = 0;
-                status = CodesIOKernel_push_parse(ps, yychar, (codesYYType*)c->lval, (YYLTYPE*)c->locval, c);
-                codes_inst = convertKLInstToEvent(yychar);
-		break;
-            }
-            /* not a simulator event */
-            default:
-            {
-                status = CodesIOKernel_push_parse(ps, yychar, (codesYYType*)c->lval, (YYLTYPE*)c->locval, c);
-		break;
-            }
-        };
-
-        /* if the instruction is ready (all preq data is ready ) */
-        if(c->inst_ready)
-        {
-            /* reset instruction ready state */
-            c->inst_ready = 0;
-
-            switch(codes_inst)
-            {
-                case CL_GETRANK:
-                case CL_GETSIZE:
-                case CL_WRITEAT:
-	        case CL_READAT:
-                case CL_OPEN:
-                case CL_CLOSE:
-                case CL_SYNC:
-                case CL_EXIT:
-                case CL_DELETE:
-                case CL_SLEEP:
-                {
-                    int i = 0;
-
-                    inst->event_type = codes_inst;
-                    inst->num_var = c->var[0];
-                    for(i = 0 ; i < inst->num_var ; i++)
-                    {
-                        inst->var[i] = c->var[i + 1];
-                    }
-
-		    break;
-                }
-                /* we don't need to store the instructions args */
-                default:
-                {
-                    continue;
-                }
-            };
-            
-	    /* we have all of the data for the instruction... bail */
-            break;
-        }
-    /* while there are more instructions to parse in the stream */
-    }while(status == YYPUSH_MORE);
+       /* the kernel path of the last line read so far sticks */
+       for(i = 0 ; i < m->num_entries ; i++)
+       {
+               struct meta_entry * e = &m->entries[i];
 
-    /* return the simulator instruction */
-    return codes_inst;
+               if(e->kernel_path)
+                   strcpy(io_kernel_path, e->kernel_path);
+
+               /* if our rank is on this range... end processing of the config
+                * file */
+               if(task_rank >= e->min && (e->max == -1 || task_rank <= e->max))
+               {
+                       task_info->group_id = e->gid;
+                       task_info->min_rank = e->min;
+                       task_info->max_rank = (e->max == -1) ? max_ranks_default : e->max;
+                       task_info->local_rank = task_rank - e->min;
+                       task_info->num_lrank = task_info->max_rank - e->min;
+
+                       return;
+               }
+       }
+
+       /* if we did not find the config file, set it to the default */
+       fprintf(stderr,
+               "ERROR: Unable to find iolang workload file "
+               "from given metadata file %s... exiting\n",
+               io_kernel_meta_path);
+       exit(1);
 }
 
-int codes_kernel_helper_bootstrap(char * io_kernel_path,
-        char * io_kernel_meta_path, int rank, int num_ranks, int use_relpath,
-        CodesIOKernelContext * c, CodesIOKernel_pstate ** ps,
-        iolang_workload_info * task_info, codeslang_inst * next_event)
+/* parse a kernel file, compiling its statements as they are reduced */
+static codes_kernel_prog * codes_kernel_helper_compile(char * io_kernel_path)
 {
-    int t = CL_NOOP;
     int ret = 0;
+    int yychar;
+    int status;
     char * kbuffer = NULL;
     int fd = 0;
     off_t ksize = 0;
     struct stat info;
+    CodesIOKernelContext c;
+    CodesIOKernel_pstate * ps;
 
-    temp_group_rank = rank;
-    /* get the kernel from the file */
-    codes_kernel_helper_parse_cf(io_kernel_path,
-            io_kernel_meta_path, rank, num_ranks, task_info, use_relpath);
-    temp_group_size = task_info->num_lrank;
     /* stat the kernel file */
     ret = stat(io_kernel_path, &info);
     if(ret != 0)
@@ -335,28 +306,93 @@ int codes_kernel_helper_bootstrap(char * io_kernel_path,
     ret = pread(fd, kbuffer, ksize, 0);
     close(fd);
 
+    if(ret != ksize)
+    {
+        fprintf(stderr, "%s:%i could not read kernel file (%s), exiting\n",
+                __func__, __LINE__, io_kernel_path);
+        exit(1);
+    }
+
     /* init the scanner */
-    CodesIOKernelScannerInit(c);
+    CodesIOKernelScannerInit(&c);
+    c.prog = codes_kernel_prog_new();
+    CodesIOKernel__scan_string(kbuffer, c.scanner_);
+    ps = CodesIOKernel_pstate_new();
 
-    if(ret <= ksize)
+    do
     {
-        CodesIOKernel__scan_string(kbuffer, c->scanner_);
-	
-	*ps = CodesIOKernel_pstate_new();
+        c.locval = CodesIOKernel_get_lloc(*((yyscan_t *)c.scanner_));
+        yychar = CodesIOKernel_lex((codesYYType*)c.lval, (YYLTYPE*)c.locval, c.scanner_);
+        c.locval = NULL;
+        status = CodesIOKernel_push_parse(ps, yychar, (codesYYType*)c.lval, (YYLTYPE*)c.locval, &c);
+    /* while there are more instructions to parse in the stream */
+    }while(status == YYPUSH_MORE);
 
-        /* get the first instruction */
-        t = codes_kernel_helper_parse_input(*ps, c, next_event);
-    }
-    else
+    if(status != 0)
     {
-        fprintf(stderr, "not enough buffer space... bail\n");
+        fprintf(stderr, "%s:%i could not parse kernel file (%s), exiting\n",
+                __func__, __LINE__, io_kernel_path);
         exit(1);
     }
 
     /* cleanup */
+    CodesIOKernel_pstate_delete(ps);
+    CodesIOKernelScannerDestroy(&c);
     free(kbuffer);
 
-    return t;
+    return c.prog;
+}
+
+int codes_kernel_helper_parse_input(codes_kernel_vm * vm, codeslang_inst * inst)
+{
+    int i;
+    int64_t args[CODES_KERNEL_MAX_ARGS];
+    int64_t num_args = 0;
+    int tok;
+
+    /* run the kernel up to its next I/O statement */
+    tok = codes_kernel_vm_next(vm, args, &num_args);
+
+    inst->event_type = convertKLInstToEvent(tok);
+    inst->num_var = num_args;
+    for(i = 0 ; i < num_args ; i++)
+    {
+        inst->var[i] = args[i];
+    }
+
+    /* return the simulator instruction */
+    return inst->event_type;
+}
+
+int codes_kernel_helper_bootstrap(char * io_kernel_path,
+        char * io_kernel_meta_path, int rank, int num_ranks, int use_relpath,
+        codes_kernel_vm * vm, iolang_workload_info * task_info)
+{
+    struct kernel_cache * k;
+
+    /* get the kernel from the file */
+    codes_kernel_helper_parse_cf(io_kernel_path,
+            io_kernel_meta_path, rank, num_ranks, task_info, use_relpath);
+
+    /* each kernel is compiled once and shared by the ranks running it */
+    for(k = kernels ; k ; k = k->next)
+    {
+        if(strcmp(k->path, io_kernel_path) == 0)
+            break;
+    }
+    if(!k)
+    {
+        k = malloc(sizeof(*k));
+        assert(k);
+        k->path = strdup(io_kernel_path);
+        k->prog = codes_kernel_helper_compile(io_kernel_path);
+        k->next = kernels;
+        kernels = k;
+    }
+
+    codes_kernel_vm_init(vm, k->prog, rank, task_info->num_lrank);
+
+    return 0;
 }
 
 /*
@@ -69,13 +69,15 @@ typedef struct codeslang_inst
   int64_t var[CL_INST_MAX_ARGS];
 } codeslang_inst;
 
-int codes_kernel_helper_parse_input(CodesIOKernel_pstate * ps,
-        CodesIOKernelContext * c, codeslang_inst * inst);
+/* run the rank's kernel up to its next simulator event */
+int codes_kernel_helper_parse_input(codes_kernel_vm * vm,
+        codeslang_inst * inst);
 
+/* look up the rank's kernel in the meta file and set up vm to run it. The
+ * meta file is read and each kernel compiled only once per process */
 int codes_kernel_helper_bootstrap(char * io_kernel_path,
-        char * io_kernel_meta_path, int rank, int num_ranks, int use_relpath, CodesIOKernelContext * c,
-        CodesIOKernel_pstate ** ps, iolang_workload_info * task_info,
-        codeslang_inst * next_event);
+        char * io_kernel_meta_path, int rank, int num_ranks, int use_relpath,
+        codes_kernel_vm * vm, iolang_workload_info * task_info);
 
 char * code_kernel_helpers_cleventToStr(int inst);
 char * code_kernel_helpers_kinstToStr(int inst);
@@ -7,360 +7,421 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "CodesIOKernelTypes.h"
 #include "CodesIOKernelParser.h"
 
-int64_t ex(
-    nodeType * p)
+/* deepest operand stack a statement may need */
+#define CODES_KERNEL_STACK_MAX 64
+
+/* bytecode instructions. Operands follow the opcode in the code array */
+enum codes_kernel_op
+{
+    OP_PUSH,    /* value */
+    OP_LOAD,    /* symbol */
+    OP_STORE,   /* symbol */
+    OP_NEG,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_LT,
+    OP_GT,
+    OP_GE,
+    OP_LE,
+    OP_NE,
+    OP_EQ,
+    OP_RANK,
+    OP_SIZE,
+    OP_JMP,     /* target */
+    OP_JZ,      /* target */
+    OP_PRINT,
+    OP_IO       /* token, number of arguments */
+};
+
+codes_kernel_prog * codes_kernel_prog_new(void)
+{
+    codes_kernel_prog * prog = calloc(1, sizeof(*prog));
+
+    if(!prog)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    return prog;
+}
+
+void codes_kernel_prog_free(codes_kernel_prog * prog)
 {
-    if(!p)
+    if(!prog)
     {
-        return 0;
+        return;
     }
+    free(prog->code);
+    free(prog);
+}
 
-    /* value or op switch */
-    switch (p->type)
+static int64_t emit(
+    codes_kernel_prog * prog,
+    int64_t v)
+{
+    if(prog->len == prog->cap)
+    {
+        prog->cap = prog->cap ? 2 * prog->cap : 64;
+        prog->code = realloc(prog->code, prog->cap * sizeof(*prog->code));
+        if(!prog->code)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    prog->code[prog->len] = v;
+    return prog->len++;
+}
+
+static int binary_op(
+    int oper)
+{
+    switch(oper)
+    {
+        case '+': return OP_ADD;
+        case '-': return OP_SUB;
+        case '*': return OP_MUL;
+        case '/': return OP_DIV;
+        case '%': return OP_MOD;
+        case '<': return OP_LT;
+        case '>': return OP_GT;
+        case GE: return OP_GE;
+        case LE: return OP_LE;
+        case NE: return OP_NE;
+        case EQ: return OP_EQ;
+        default: return -1;
+    }
+}
+
+/* compile an expression leaving its value on the stack, returns the stack
+ * depth it needs */
+static int compile_expr(
+    codes_kernel_prog * prog,
+    nodeType * p)
+{
+    int d0, d1;
+
+    switch(p->type)
     {
         case typeCon:
         {
-            return p->con.value;
+            emit(prog, OP_PUSH);
+            emit(prog, p->con.value);
+            return 1;
         }
         case typeId:
         {
-            return sym[p->id.i];
+            emit(prog, OP_LOAD);
+            emit(prog, p->id.i);
+            return 1;
         }
         case typeOpr:
         {
-            /* op switch */
-            switch (p->opr.oper)
+            switch(p->opr.oper)
             {
-                case WHILE:
-                {
-                    while(ex(p->opr.op[0]))
-                    {
-                        ex(p->opr.op[1]);
-                    }
-                    return 0;
-                }
-                case IF:
-                {
-                    if(ex(p->opr.op[0]))
-                    {
-                        ex(p->opr.op[1]);
-                    }
-                    else if(p->opr.nops > 2)
-                    {
-                        ex(p->opr.op[2]);
-                    }
-                    return 0;
-                }
-                case PRINT:
-                {
-                    printf("%"PRId64"\n", ex(p->opr.op[0]));
-                    fflush(stdout);
-                    return 0;
-                }
-                case WRITE_ALL:
-                {
-                    int64_t t1 = ex(p->opr.op[0]);
-                    int64_t t2 = ex(p->opr.op[1]);
-
-                    /* local storage of data used for the op */
-                    var[0] = 2;
-                    var[1] = t1;
-                    var[2] = t2;
-                    *inst_ready = 1;
-
-                    return 0;
-                }
-                case WRITEAT_ALL:
-                {
-                    int64_t t1 = ex(p->opr.op[0]);
-                    int64_t t2 = ex(p->opr.op[1]);
-                    int64_t t3 = ex(p->opr.op[2]);
-
-                    /* local storage of data used for the op */
-                    var[0] = 3;
-                    var[1] = t1;
-                    var[2] = t2;
-                    var[3] = t3;
-                    *inst_ready = 1;
-
-                    return 0;
-                }
-                case WRITE:
-                {
-                    int64_t t1 = ex(p->opr.op[0]);
-                    int64_t t2 = ex(p->opr.op[1]);
-
-                    /* local storage of data used for the op */
-                    var[0] = 2;
-                    var[1] = t1;
-                    var[2] = t2;
-                    *inst_ready = 1;
-
-                    return 0;
-                }
-                case WRITEAT:
+                case UMINUS:
                 {
-                    int64_t t1 = ex(p->opr.op[0]);
-                    int64_t t2 = ex(p->opr.op[1]);
-                    int64_t t3 = ex(p->opr.op[2]);
-
-                    /* local storage of data used for the op */
-                    var[0] = 3;
-                    var[1] = t1;
-                    var[2] = t2;
-                    var[3] = t3;
-                    *inst_ready = 1;
-
-                    return 0;
+                    d0 = compile_expr(prog, p->opr.op[0]);
+                    emit(prog, OP_NEG);
+                    return d0;
                 }
-                case READ_ALL:
+                /* the operand of getgrouprank/getgroupsize is ignored */
+                case GETGROUPRANK:
                 {
-                    int64_t t1 = ex(p->opr.op[0]);
-                    int64_t t2 = ex(p->opr.op[1]);
-
-                    /* local storage of data used for the op */
-                    var[0] = 2;
-                    var[1] = t1;
-                    var[2] = t2;
-                    *inst_ready = 1;
-
-                    return 0;
+                    emit(prog, OP_RANK);
+                    return 1;
                 }
-                case READAT_ALL:
-                {
-                    int64_t t1 = ex(p->opr.op[0]);
-                    int64_t t2 = ex(p->opr.op[1]);
-                    int64_t t3 = ex(p->opr.op[2]);
-
-                    /* local storage of data used for the op */
-                    var[0] = 3;
-                    var[1] = t1;
-                    var[2] = t2;
-                    var[3] = t3;
-                    *inst_ready = 1;
-
-                    return 0;
-                }
-                case READ:
+                case GETGROUPSIZE:
                 {
-                    int64_t t1 = ex(p->opr.op[0]);
-                    int64_t t2 = ex(p->opr.op[1]);
-
-                    /* local storage of data used for the op */
-                    var[0] = 2;
-                    var[1] = t1;
-                    var[2] = t2;
-                    *inst_ready = 1;
-
-                    return 0;
+                    emit(prog, OP_SIZE);
+                    return 1;
                 }
-                case READAT:
+                case GETCURTIME:
                 {
-                    int64_t t1 = ex(p->opr.op[0]);
-                    int64_t t2 = ex(p->opr.op[1]);
-                    int64_t t3 = ex(p->opr.op[2]);
-
-                    /* local storage of data used for the op */
-                    var[0] = 3;
-                    var[1] = t1;
-                    var[2] = t2;
-                    var[3] = t3;
-                    *inst_ready = 1;
-
-                    return 0;
+                    emit(prog, OP_PUSH);
+                    emit(prog, 0);
+                    return 1;
                 }
-                case SYNC:
-                {
-                    int64_t t1 = ex(p->opr.op[0]);
-
-                    /* local storage of data used for the op */
-                    var[0] = 1;
-                    var[1] = t1;
-                    *inst_ready = 1;
-
-                    return 0;
-                }
-                case SLEEP:
+                case GETGROUPID:
                 {
-                    int64_t t1 = ex(p->opr.op[0]);
-
-                    /* local storage of data used for the op */
-                    var[0] = 1;
-                    var[1] = t1;
-                    *inst_ready = 1;
-
-                    return 0;
+                    emit(prog, OP_PUSH);
+                    emit(prog, 8);
+                    return 1;
                 }
-                case OPEN:
+                case GETNUMGROUPS:
                 {
-                    int64_t t1 = ex(p->opr.op[0]);
-
-                    /* local storage of data used for the op */
-                    var[0] = 1;
-                    var[1] = t1;
-                    *inst_ready = 1;
-
-                    return 0;
+                    emit(prog, OP_PUSH);
+                    emit(prog, 32);
+                    return 1;
                 }
-                case CLOSE:
+                default:
                 {
-                    int64_t t1 = ex(p->opr.op[0]);
-
-                    /* local storage of data used for the op */
-                    var[0] = 1;
-                    var[1] = t1;
-                    *inst_ready = 1;
+                    int op = binary_op(p->opr.oper);
 
-                    return 0;
+                    if(op < 0)
+                    {
+                        fprintf(stderr, "%s:%i unknown operator %i\n",
+                                __func__, __LINE__, p->opr.oper);
+                        exit(1);
+                    }
+                    d0 = compile_expr(prog, p->opr.op[0]);
+                    d1 = compile_expr(prog, p->opr.op[1]) + 1;
+                    emit(prog, op);
+                    return d0 > d1 ? d0 : d1;
                 }
-                case DELETE:
-                {
-                    int64_t t1 = ex(p->opr.op[0]);
-
-                    /* local storage of data used for the op */
-                    var[0] = 1;
-                    var[1] = t1;
-                    *inst_ready = 1;
+            }
+        }
+    }
+    return 0;
+}
 
-                    return 0;
-                }
-                case FLUSH:
-                {
-                    int64_t t1 = ex(p->opr.op[0]);
+static void compile_top_expr(
+    codes_kernel_prog * prog,
+    nodeType * p)
+{
+    if(compile_expr(prog, p) > CODES_KERNEL_STACK_MAX)
+    {
+        fprintf(stderr, "%s:%i expression too deep\n", __func__, __LINE__);
+        exit(1);
+    }
+}
 
-                    /* local storage of data used for the op */
-                    var[0] = 1;
-                    var[1] = t1;
-                    *inst_ready = 1;
+static void compile_io(
+    codes_kernel_prog * prog,
+    nodeType * p)
+{
+    int i;
 
-                    return 0;
-                }
-                case SEEK:
-                {
-                    int64_t t1 = ex(p->opr.op[0]);
-                    int64_t t2 = ex(p->opr.op[0]);
+    /* arguments are evaluated one by one into the I/O call's argument
+     * slots, so each starts on an empty stack */
+    for(i = 0 ; i < p->opr.nops ; i++)
+    {
+        compile_top_expr(prog, p->opr.op[i]);
+        if(i < p->opr.nops - 1)
+        {
+            emit(prog, OP_STORE);
+            emit(prog, -(i + 1));
+        }
+    }
+    emit(prog, OP_IO);
+    emit(prog, p->opr.oper);
+    emit(prog, p->opr.nops);
+}
 
-                    /* local storage of data used for the op */
-                    var[0] = 1;
-                    var[1] = t1;
-                    var[2] = t2;
-                    *inst_ready = 1;
+void codes_kernel_compile_stmt(
+    codes_kernel_prog * prog,
+    nodeType * p)
+{
+    int64_t jz, jmp, top;
 
-                    return 0;
-                }
-                case GETNUMGROUPS:
-                {
-                    return 32;
-                }
-                case GETGROUPID:
-                {
-                    return 8;
-                }
-                case EXIT:
-                {
-                    int64_t t1 = ex(p->opr.op[0]);
-                    var[0] = 1;
-                    var[1] = t1;
-                    *inst_ready = 1;
+    if(!p || p->type != typeOpr)
+    {
+        /* expressions have no side effects */
+        return;
+    }
 
-                    return 4;
-                }
-                case GETGROUPRANK:
-                {
-                    int64_t t1 = ex(p->opr.op[0]);
-                    var[0] = 1;
-                    var[1] = t1;
-                    *inst_ready = 1;
+    switch(p->opr.oper)
+    {
+        case ';':
+        {
+            codes_kernel_compile_stmt(prog, p->opr.op[0]);
+            codes_kernel_compile_stmt(prog, p->opr.op[1]);
+            return;
+        }
+        case '=':
+        {
+            compile_top_expr(prog, p->opr.op[1]);
+            emit(prog, OP_STORE);
+            emit(prog, p->opr.op[0]->id.i);
+            return;
+        }
+        case WHILE:
+        {
+            top = prog->len;
+            compile_top_expr(prog, p->opr.op[0]);
+            emit(prog, OP_JZ);
+            jz = emit(prog, 0);
+            codes_kernel_compile_stmt(prog, p->opr.op[1]);
+            emit(prog, OP_JMP);
+            emit(prog, top);
+            prog->code[jz] = prog->len;
+            return;
+        }
+        case IF:
+        {
+            compile_top_expr(prog, p->opr.op[0]);
+            emit(prog, OP_JZ);
+            jz = emit(prog, 0);
+            codes_kernel_compile_stmt(prog, p->opr.op[1]);
+            if(p->opr.nops > 2)
+            {
+                emit(prog, OP_JMP);
+                jmp = emit(prog, 0);
+                prog->code[jz] = prog->len;
+                codes_kernel_compile_stmt(prog, p->opr.op[2]);
+                prog->code[jmp] = prog->len;
+            }
+            else
+            {
+                prog->code[jz] = prog->len;
+            }
+            return;
+        }
+        case PRINT:
+        {
+            compile_top_expr(prog, p->opr.op[0]);
+            emit(prog, OP_PRINT);
+            return;
+        }
+        /* statements producing simulator events */
+        case WRITEAT:
+        case READAT:
+        case OPEN:
+        case CLOSE:
+        case SYNC:
+        case SLEEP:
+        case DELETE:
+        case EXIT:
+        {
+            compile_io(prog, p);
+            return;
+        }
+        /* write, read, the collective variants, flush and seek have no
+         * simulator event */
+        default:
+        {
+            return;
+        }
+    }
+}
 
-		    *group_rank = temp_group_rank;
-		     //printf("\n group rank %d ", *group_rank);
-                    return *group_rank;
-                }
-                case GETGROUPSIZE:
-                {
-                    int64_t t1 = ex(p->opr.op[0]);
-                    var[0] = 1;
-                    var[1] = t1;
-                    *inst_ready = 1;
-                    /* JOHN - logic here is broken, using the same trick 
-                     * used to get the rank 
-                     * - should dynamically look up the group and rank, but
-                     *   sets it upon setting up the parser */ 
-		    /* *group_size = t1; */
-                    *group_size = temp_group_size;
+void codes_kernel_vm_init(
+    codes_kernel_vm * vm,
+    const codes_kernel_prog * prog,
+    int64_t group_rank,
+    int64_t group_size)
+{
+    memset(vm, 0, sizeof(*vm));
+    vm->prog = prog;
+    vm->group_rank = group_rank;
+    vm->group_size = group_size;
+}
 
+int codes_kernel_vm_next(
+    codes_kernel_vm * vm,
+    int64_t * args,
+    int64_t * num_args)
+{
+    const int64_t * code = vm->prog->code;
+    int64_t len = vm->prog->len;
+    int64_t pc = vm->pc;
+    int64_t stack[CODES_KERNEL_STACK_MAX];
+    int64_t pending[CODES_KERNEL_MAX_ARGS];
+    int sp = 0;
+    int64_t a, b;
+
+    while(!vm->done && pc < len)
+    {
+        switch(code[pc++])
+        {
+            case OP_PUSH:
+                stack[sp++] = code[pc++];
+                break;
+            case OP_LOAD:
+                stack[sp++] = vm->sym[code[pc++]];
+                break;
+            case OP_STORE:
+                /* negative symbols are pending I/O arguments */
+                a = code[pc++];
+                if(a < 0)
+                {
+                    pending[-a - 1] = stack[--sp];
+                }
+                else
+                {
+                    vm->sym[a] = stack[--sp];
+                }
+                break;
+            case OP_NEG:
+                stack[sp - 1] = -stack[sp - 1];
+                break;
+            case OP_RANK:
+                stack[sp++] = vm->group_rank;
+                break;
+            case OP_SIZE:
+                stack[sp++] = vm->group_size;
+                break;
+            case OP_JMP:
+                pc = code[pc];
+                break;
+            case OP_JZ:
+                pc = stack[--sp] ? pc + 1 : code[pc];
+                break;
+            case OP_PRINT:
+                printf("%"PRId64"\n", stack[--sp]);
+                fflush(stdout);
+                break;
+            case OP_IO:
+            {
+                int tok = code[pc++];
+                int64_t i, n = code[pc++];
 
-		    //printf("\n group size %d ", *group_size);
-                    return *group_size;
-                }
-                case GETCURTIME:
-                {
-                    return 0;
-                }
-                case ';':
-                {
-                    ex(p->opr.op[0]);
-                    return ex(p->opr.op[1]);
-                }
-                case '=':
-                {
-                    return sym[p->opr.op[0]->id.i] = ex(p->opr.op[1]);
-                }
-                case UMINUS:
-                {
-                    return -ex(p->opr.op[0]);
-                }
-                case '+':
+                for(i = 0 ; i < n - 1 ; i++)
                 {
-                    return ex(p->opr.op[0]) + ex(p->opr.op[1]);
+                    args[i] = pending[i];
                 }
-                case '-':
+                args[n - 1] = stack[--sp];
+                *num_args = n;
+                vm->pc = pc;
+                if(tok == EXIT)
                 {
-                    return ex(p->opr.op[0]) - ex(p->opr.op[1]);
-                }
-                case '*':
-                {
-                    return ex(p->opr.op[0]) * ex(p->opr.op[1]);
-                }
-                case '/':
-                {
-                    return ex(p->opr.op[0]) / ex(p->opr.op[1]);
-                }
-                case '%':
-                {
-                    return ex(p->opr.op[0]) % ex(p->opr.op[1]);
-                }
-                case '<':
-                {
-                    return ex(p->opr.op[0]) < ex(p->opr.op[1]);
-                }
-                case '>':
-                {
-                    return ex(p->opr.op[0]) > ex(p->opr.op[1]);
-                }
-                case GE:
-                {
-                    return ex(p->opr.op[0]) >= ex(p->opr.op[1]);
-                }
-                case LE:
-                {
-                    return ex(p->opr.op[0]) <= ex(p->opr.op[1]);
-                }
-                case NE:
-                {
-                    return ex(p->opr.op[0]) != ex(p->opr.op[1]);
-                }
-                case EQ:
-                {
-                    return ex(p->opr.op[0]) == ex(p->opr.op[1]);
+                    vm->done = 1;
                 }
+                return tok;
+            }
+            default:
+            {
+                b = stack[--sp];
+                a = stack[--sp];
+                if((code[pc - 1] == OP_DIV || code[pc - 1] == OP_MOD) && b == 0)
+                {
+                    fprintf(stderr, "%s:%i division by zero in I/O kernel\n",
+                            __func__, __LINE__);
+                    exit(1);
+                }
+                switch(code[pc - 1])
+                {
+                    case OP_ADD: a = a + b; break;
+                    case OP_SUB: a = a - b; break;
+                    case OP_MUL: a = a * b; break;
+                    case OP_DIV: a = a / b; break;
+                    case OP_MOD: a = a % b; break;
+                    case OP_LT: a = a < b; break;
+                    case OP_GT: a = a > b; break;
+                    case OP_GE: a = a >= b; break;
+                    case OP_LE: a = a <= b; break;
+                    case OP_NE: a = a != b; break;
+                    case OP_EQ: a = a == b; break;
+                }
+                stack[sp++] = a;
+                break;
             }
         }
     }
-    return 0;
+
+    /* a kernel running off its end exits */
+    vm->pc = pc;
+    vm->done = 1;
+    args[0] = 0;
+    *num_args = 1;
+    return EXIT;
 }
 
 /*
@@ -2274,40 +2274,16 @@ void CodesIOKernelScannerInit(CodesIOKernelContext * context)
 
         //((YYLTYPE *)context->locval)->first_line = 1;
 
-	int i = 0;
-	for(i = 0 ; i < 26 ; i++)
-	{
-	    context->sym[i] = 0;
-	}
-
-        for(i = 0 ; i < 10 ; i++)
-        {
-            context->next_var[i] = 0;
-        }
-
-        for(i = 0 ; i < 10 ; i++)
-        {
-            context->var[i] = 0;
-        }
-
-        context->inst_ready = 0;
+        context->prog = NULL;
 }
 
 void CodesIOKernelScannerDestroy(CodesIOKernelContext * context)
 {
 	CodesIOKernel_lex_destroy(context->scanner_);
 	free(context->text);
+	free(context->lval);
 	context->text = NULL;
 	context->locval = NULL;
 	context->lval = NULL;
 }
 
-void CodesIOKernelScannerSetSymTable(CodesIOKernelContext * context)
-{
-	sym = &(context->sym[0]);
-        var = &(context->var[0]);
-        inst_ready = &(context->inst_ready);
-        group_rank = &(context->GroupRank);
-        group_size = &(context->GroupSize);
-}
-
@@ -92,18 +92,9 @@ nodeType *opr(int64_t oper, int64_t nops, ...);
 nodeType *id(int64_t i);
 nodeType *con(int64_t value);
 void freeNode(nodeType *p);
-int64_t ex(nodeType *p);
-
-int64_t * sym = NULL; /* symbol table */
-int64_t * var = NULL;
-int * inst_ready = NULL;
-int * group_rank = NULL;
-int * group_size = NULL;
-int temp_group_rank = 0;
-int temp_group_size = 0;
 
 /* Line 268 of yacc.c  */
-#line 106 "codesparser.c"
+#line 98 "codesparser.c"
 
 /* Enabling traces.  */
 #ifndef YYDEBUG
@@ -217,7 +208,7 @@ typedef union YYSTYPE
 
 
 /* Line 293 of yacc.c  */
-#line 220 "codesparser.c"
+#line 212 "codesparser.c"
 } YYSTYPE;
 # define YYSTYPE_IS_TRIVIAL 1
 # define yystype YYSTYPE /* obsolescent; will be withdrawn */
@@ -280,7 +271,7 @@ void yypstate_delete ();
 
 
 /* Line 343 of yacc.c  */
-#line 283 "codesparser.c"
+#line 275 "codesparser.c"
 
 #ifdef short
 # undef short
@@ -1842,7 +1833,7 @@ yyreduce:
 
 /* Line 1806 of yacc.c  */
 #line 78 "codesparser.y"
-    { ex((yyvsp[(2) - (2)].nPtr)); freeNode((yyvsp[(2) - (2)].nPtr)); }
+    { codes_kernel_compile_stmt(context->prog, (yyvsp[(2) - (2)].nPtr)); freeNode((yyvsp[(2) - (2)].nPtr)); }
     break;
 
   case 5:
@@ -2170,7 +2161,7 @@ yyreduce:
 
 
 /* Line 1806 of yacc.c  */
-#line 2173 "codesparser.c"
+#line 2165 "codesparser.c"
       default: break;
     }
   /* User semantic actions sometimes alter yychar, and that requires
@@ -6,6 +6,7 @@
 
 #include "codes_config.h"
 #include <string.h>
+#include <stdint.h>
 #include <assert.h>
 #ifdef HAVE_MALLOC_H
 #include <malloc.h>
@@ -335,6 +336,167 @@ mcs_entry * mcs_findkey (const mcs_entry * e, const char * name)
    return ret;
 }
 
+/* ============= serialization ======================== */
+
+/* Each entry is packed as a flags byte, its name and value if present (as
+ * a 32 bit length followed by the characters), then its child count and
+ * children. Key values are the unnamed children of the key. */
+#define MCS_PACK_SECTION 0x1
+#define MCS_PACK_NAME    0x2
+#define MCS_PACK_VALUE   0x4
+
+typedef struct
+{
+   char * buf;
+   size_t size;
+   size_t cap;
+} mcs_packbuf;
+
+static void mcs_packbytes (mcs_packbuf * p, const void * data, size_t len)
+{
+   if (p->size + len > p->cap)
+   {
+      while (p->size + len > p->cap)
+         p->cap = (p->cap ? 2 * p->cap : 4096);
+      p->buf = (char *) realloc (p->buf, p->cap);
+      assert (p->buf);
+   }
+   memcpy (p->buf + p->size, data, len);
+   p->size += len;
+}
+
+static void mcs_packstring (mcs_packbuf * p, const char * s)
+{
+   uint32_t len = strlen (s);
+   mcs_packbytes (p, &len, sizeof(len));
+   mcs_packbytes (p, s, len);
+}
+
+static void mcs_packentry (mcs_packbuf * p, const mcs_entry * e)
+{
+   unsigned char flags = 0;
+   uint32_t count;
+   const mcs_entry * c;
+
+   if (e->is_section)
+      flags |= MCS_PACK_SECTION;
+   if (e->name)
+      flags |= MCS_PACK_NAME;
+   /* value entries are the only ones without name that aren't sections */
+   if (!e->is_section && !e->name && e->value)
+      flags |= MCS_PACK_VALUE;
+   mcs_packbytes (p, &flags, sizeof(flags));
+   if (e->name)
+      mcs_packstring (p, e->name);
+   if (flags & MCS_PACK_VALUE)
+   {
+      mcs_packstring (p, e->value);
+      return;
+   }
+   if (!e->is_section && !e->name)
+      return;
+
+   count = mcs_chaincount (e->child);
+   mcs_packbytes (p, &count, sizeof(count));
+   for (c = e->child; c; c = c->next)
+      mcs_packentry (p, c);
+}
+
+int mcs_pack (const mcs_entry * e, char ** buf)
+{
+   mcs_packbuf p = { 0, 0, 0 };
+
+   mcs_packentry (&p, e);
+   *buf = p.buf;
+   return (int) p.size;
+}
+
+typedef struct
+{
+   const char * buf;
+   size_t size;
+   size_t pos;
+} mcs_unpackbuf;
+
+static int mcs_unpackbytes (mcs_unpackbuf * u, void * data, size_t len)
+{
+   if (u->size - u->pos < len)
+      return 0;
+   memcpy (data, u->buf + u->pos, len);
+   u->pos += len;
+   return 1;
+}
+
+static char * mcs_unpackstring (mcs_unpackbuf * u)
+{
+   uint32_t len;
+   char * s;
+
+   if (!mcs_unpackbytes (u, &len, sizeof(len)) || u->size - u->pos < len)
+      return 0;
+   s = (char *) malloc (len + 1);
+   assert (s);
+   memcpy (s, u->buf + u->pos, len);
+   s[len] = 0;
+   u->pos += len;
+   return s;
+}
+
+static mcs_entry * mcs_unpackentry (mcs_unpackbuf * u)
+{
+   unsigned char flags;
+   uint32_t count, i;
+   mcs_entry * n;
+   mcs_entry * tail = 0;
+
+   if (!mcs_unpackbytes (u, &flags, sizeof(flags)))
+      return 0;
+   n = mcs_allocentry ();
+   n->is_section = (flags & MCS_PACK_SECTION) ? 1 : 0;
+   if ((flags & MCS_PACK_NAME) && !(n->name = mcs_unpackstring (u)))
+      goto error;
+   if (flags & MCS_PACK_VALUE)
+   {
+      if (!(n->value = mcs_unpackstring (u)))
+         goto error;
+      return n;
+   }
+   if (!n->is_section && !n->name)
+      return n;
+
+   if (!mcs_unpackbytes (u, &count, sizeof(count)))
+      goto error;
+   for (i = 0; i < count; ++i)
+   {
+      mcs_entry * c = mcs_unpackentry (u);
+      if (!c)
+         goto error;
+      if (tail)
+         tail->next = c;
+      else
+         n->child = c;
+      tail = c;
+   }
+   return n;
+
+error:
+   mcs_freechain (n);
+   return 0;
+}
+
+mcs_entry * mcs_unpack (const char * buf, int size)
+{
+   mcs_unpackbuf u = { buf, (size_t) size, 0 };
+   mcs_entry * e = mcs_unpackentry (&u);
+
+   if (e && u.pos != u.size)
+   {
+      mcs_freechain (e);
+      return 0;
+   }
+   return e;
+}
+
 int mcs_listsection (const mcs_entry * e, mcs_section_entry * out, unsigned int maxcount)
 {
    const mcs_entry * cur;
@@ -85,6 +85,16 @@ typedef struct
 int mcs_listsection (const mcs_entry * a, mcs_section_entry * e, unsigned int
       entries);
 
+/* === serialization === */
+
+/* Pack the tree into a single malloc'ed buffer (returned in buf);
+ * returns its size */
+int mcs_pack (const mcs_entry * e, char ** buf);
+
+/* Rebuild a tree from mcs_pack output; returns 0 if the buffer is
+ * malformed */
+mcs_entry * mcs_unpack (const char * buf, int size);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
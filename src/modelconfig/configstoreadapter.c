@@ -237,6 +237,17 @@ struct ConfigVTable * cfsa_create_empty ()
    return cfsa_create (mcs_initroot ());
 }
 
+int cfsa_pack (struct ConfigVTable * cf, char ** buf)
+{
+   return mcs_pack ((mcs_entry *) cf->data, buf);
+}
+
+struct ConfigVTable * cfsa_unpack (const char * buf, int size)
+{
+   mcs_entry * e = mcs_unpack (buf, size);
+   return (e ? cfsa_create (e) : 0);
+}
+
 /*
  * Local variables:
  *  c-indent-level: 4
@@ -19,6 +19,14 @@ struct ConfigVTable * cfsa_create (mcs_entry * e);
 
 struct ConfigVTable * cfsa_create_empty ();
 
+/* Pack the configuration into a malloc'ed buffer (see mcs_pack); returns
+ * its size */
+int cfsa_pack (struct ConfigVTable * cf, char ** buf);
+
+/* Create a configfile interface from cfsa_pack output; returns 0 if the
+ * buffer is malformed */
+struct ConfigVTable * cfsa_unpack (const char * buf, int size);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -14,7 +14,10 @@
 #include <ross.h>
 
 #include <codes/configfile.h>
+#include <codes/quickhash.h>
+#include <codes/jenkins-hash.h>
 #include "txt_configfile.h"
+#include "configstoreadapter.h"
 
 /*
  * Global to hold configuration in memory
@@ -24,18 +27,256 @@ ConfigHandle config;
 /* Global to hold LP configuration */
 config_lpgroups_t lpconf;
 
-int configuration_load (const char *filepath,
-                        MPI_Comm comm,
-                        ConfigHandle *handle)
+enum configuration_load_mode configuration_load_mode = CONFIGURATION_LOAD_BCAST;
+
+/* bits of config_index_entry::parsed */
+#define CONFIG_PARSED_INT     0x1
+#define CONFIG_PARSED_LONGINT 0x2
+#define CONFIG_PARSED_DOUBLE  0x4
+
+/* a top-level section (key == NULL) or a key in one */
+struct config_index_entry
+{
+    struct qhash_head hash_link;
+    char * section;
+    char * key;
+    // result of cf_getKey and the value (NULL if rc < 0)
+    int rc;
+    char * value;
+    // typed values, converted on first use
+    int parsed;
+    int int_value;
+    long int longint_value;
+    int longint_rc;
+    double double_value;
+    int double_rc;
+};
+
+struct config_index
+{
+    struct qhash_table * table;
+};
+
+struct config_index_key
 {
-    MPI_File   fh;
+    const char * section;
+    const char * key;
+};
+
+static int config_index_hash(void *k, int table_size)
+{
+    struct config_index_key *key = (struct config_index_key*) k;
+    uint32_t h1 = 0, h2 = 0;
+
+    bj_hashlittle2(key->section, strlen(key->section), &h1, &h2);
+    if (key->key)
+        bj_hashlittle2(key->key, strlen(key->key), &h1, &h2);
+    return (int) (h1 & (table_size - 1));
+}
+
+static int config_index_compare(void *k, struct qhash_head *link)
+{
+    struct config_index_key *key = (struct config_index_key*) k;
+    struct config_index_entry *e =
+        qhash_entry(link, struct config_index_entry, hash_link);
+
+    if (strcmp(key->section, e->section))
+        return 0;
+    if (!key->key || !e->key)
+        return key->key == e->key;
+    return !strcmp(key->key, e->key);
+}
+
+static struct config_index_entry * config_index_find(
+        struct config_index *index,
+        const char *section_name,
+        const char *key_name)
+{
+    struct config_index_key key = { section_name, key_name };
+    struct qhash_head *link = qhash_search(index->table, &key);
+
+    return link ? qhash_entry(link, struct config_index_entry, hash_link)
+                : NULL;
+}
+
+/* takes ownership of key, and of section if key is NULL */
+static struct config_index_entry * config_index_add(
+        struct config_index *index,
+        char *section,
+        char *key)
+{
+    struct config_index_key k = { section, key };
+    struct config_index_entry *e = calloc(1, sizeof(*e));
+    assert(e);
+
+    e->section = section;
+    e->key = key;
+    qhash_add(index->table, &k, &e->hash_link);
+    return e;
+}
+
+static void config_index_free(struct config_index *index)
+{
+    struct qhash_head *link, *tmp;
+
+    if (!index)
+        return;
+    for (int i = 0; i < index->table->table_size; i++) {
+        qhash_for_each_safe(link, tmp, &index->table->array[i]) {
+            struct config_index_entry *e =
+                qhash_entry(link, struct config_index_entry, hash_link);
+            // keys share the name of their section's entry
+            if (e->key)
+                free(e->key);
+            else
+                free(e->section);
+            free(e->value);
+            free(e);
+        }
+    }
+    qhash_finalize(index->table);
+    free(index);
+}
+
+/* builds "key_name@annotation" in buf if needed. Returns NULL if too long */
+static const char * config_key_name(
+        const char *key_name,
+        const char *annotation,
+        char *buf)
+{
+    if (annotation == NULL)
+        return key_name;
+    if (snprintf(buf, CONFIGURATION_MAX_NAME, "%s@%s", key_name,
+                annotation) >= CONFIGURATION_MAX_NAME) {
+        fprintf(stderr,
+                "config error: name@annotation pair too long: %s@%s\n",
+                key_name, annotation);
+        return NULL;
+    }
+    return buf;
+}
+
+/* the indexed entry of a key with a non-empty single value; NULL otherwise
+ * or without an index */
+static struct config_index_entry * config_index_value(
+        ConfigHandle *handle,
+        const char *section_name,
+        const char *key_name,
+        const char *annotation)
+{
+    char key_name_tmp[CONFIGURATION_MAX_NAME];
+    const char *key_name_full;
+    struct config_index_entry *e;
+
+    if (!(*handle)->index)
+        return NULL;
+    key_name_full = config_key_name(key_name, annotation, key_name_tmp);
+    if (!key_name_full)
+        return NULL;
+    e = config_index_find((*handle)->index, section_name, key_name_full);
+    return (e && e->rc > 0) ? e : NULL;
+}
+
+int configuration_build_index (ConfigHandle *handle)
+{
+    struct config_index *index;
+    SectionEntry *se;
+    size_t se_count;
+    unsigned int count, total;
+    int table_size = 1;
+
+    config_index_free((*handle)->index);
+    (*handle)->index = NULL;
+
+    if (cf_getSectionSize(*handle, ROOT_SECTION, &count) < 0)
+        return -1;
+    se = malloc((count ? count : 1) * sizeof(*se));
+    assert(se);
+    se_count = count;
+    cf_listSection(*handle, ROOT_SECTION, se, &se_count);
+
+    // size the table for all sections and their keys
+    total = se_count;
+    for (size_t i = 0; i < se_count; i++) {
+        SectionHandle sh;
+        if (se[i].type == SE_SECTION &&
+                cf_openSection(*handle, ROOT_SECTION, se[i].name, &sh) == 1) {
+            if (cf_getSectionSize(*handle, sh, &count) >= 0)
+                total += count;
+            cf_closeSection(*handle, sh);
+        }
+    }
+    while (table_size < 2 * (int)total)
+        table_size *= 2;
+
+    index = malloc(sizeof(*index));
+    assert(index);
+    index->table = qhash_init(config_index_compare, config_index_hash,
+            table_size);
+    assert(index->table);
+
+    for (size_t i = 0; i < se_count; i++) {
+        SectionHandle sh;
+        SectionEntry *keys;
+        size_t key_count;
+
+        // lookups only ever find the first of duplicate names
+        if (se[i].type != SE_SECTION ||
+                config_index_find(index, se[i].name, NULL) ||
+                cf_openSection(*handle, ROOT_SECTION, se[i].name, &sh) != 1) {
+            free(se[i].name);
+            continue;
+        }
+        config_index_add(index, se[i].name, NULL);
+
+        count = 0;
+        cf_getSectionSize(*handle, sh, &count);
+        keys = malloc((count ? count : 1) * sizeof(*keys));
+        assert(keys);
+        key_count = count;
+        cf_listSection(*handle, sh, keys, &key_count);
+        for (size_t j = 0; j < key_count; j++) {
+            struct config_index_entry *e;
+            int len;
+
+            if (keys[j].type == SE_SECTION ||
+                    config_index_find(index, se[i].name, keys[j].name)) {
+                free(keys[j].name);
+                continue;
+            }
+            e = config_index_add(index, se[i].name, keys[j].name);
+            // same result as a lookup with a large enough buffer
+            len = cf_getKey(*handle, sh, e->key, NULL, 0);
+            len = (len > 0 ? len : 0) + 1;
+            e->value = malloc(len);
+            assert(e->value);
+            e->rc = cf_getKey(*handle, sh, e->key, e->value, len);
+            if (e->rc < 0) {
+                free(e->value);
+                e->value = NULL;
+            }
+        }
+        free(keys);
+        cf_closeSection(*handle, sh);
+    }
+    free(se);
+
+    (*handle)->index = index;
+    return 0;
+}
+
+/* every rank reads (collectively) and parses the file */
+static int configuration_load_all (const char *filepath,
+                                   MPI_Comm comm,
+                                   ConfigHandle *handle)
+{
+    MPI_File   fh = MPI_FILE_NULL;
     MPI_Status status;
     MPI_Offset txtsize;
     FILE      *f = NULL;
     char      *txtdata = NULL;
     char      *error = NULL;
     int        rc = 0;
-    char      *tmp_path = NULL;
 
     rc = MPI_File_open(comm, (char*)filepath, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh);
     if (rc != MPI_SUCCESS) goto finalize;
@@ -59,19 +300,10 @@ int configuration_load (const char *filepath,
     *handle = txtfile_openStream(f, &error);
     if (error) { rc = 1; goto finalize; }
 
-    /* NOTE: posix version overwrites argument :(. */
-    tmp_path = strdup(filepath);
-    assert(tmp_path);
-    (*handle)->config_dir = strdup(dirname(tmp_path));
-    assert((*handle)->config_dir);
-
-    rc = configuration_get_lpgroups(handle, "LPGROUPS", &lpconf);
-
 finalize:
     if (fh != MPI_FILE_NULL) MPI_File_close(&fh);
     if (f) fclose(f);
     free(txtdata);
-    free(tmp_path);
     if (error) {
         fprintf(stderr, "config error: %s\n", error);
         free(error);
@@ -80,6 +312,83 @@ finalize:
     return rc;
 }
 
+/* rank 0 of comm parses the file and broadcasts the packed tree */
+static int configuration_load_bcast (const char *filepath,
+                                     MPI_Comm comm,
+                                     ConfigHandle *handle)
+{
+    char *buf = NULL;
+    char *error = NULL;
+    int   size = -1;
+    int   rank;
+
+    MPI_Comm_rank(comm, &rank);
+    if (rank == 0) {
+        *handle = txtfile_openConfig(filepath, &error);
+        if (error) {
+            fprintf(stderr, "config error: %s\n", error);
+            free(error);
+        }
+        else
+            size = cfsa_pack(*handle, &buf);
+    }
+
+    MPI_Bcast(&size, 1, MPI_INT, 0, comm);
+    if (size < 0)
+        return 1;
+    if (rank != 0) {
+        buf = malloc(size);
+        assert(buf);
+    }
+    MPI_Bcast(buf, size, MPI_BYTE, 0, comm);
+    if (rank != 0) {
+        *handle = cfsa_unpack(buf, size);
+        if (!*handle)
+            tw_error(TW_LOC, "config error: bad configuration image\n");
+    }
+    free(buf);
+
+    return 0;
+}
+
+int configuration_load (const char *filepath,
+                        MPI_Comm comm,
+                        ConfigHandle *handle)
+{
+    char *tmp_path = NULL;
+    int   rc;
+
+    if (configuration_load_mode == CONFIGURATION_LOAD_ALL)
+        rc = configuration_load_all(filepath, comm, handle);
+    else
+        rc = configuration_load_bcast(filepath, comm, handle);
+    if (rc) return rc;
+
+    /* NOTE: posix version overwrites argument :(. */
+    tmp_path = strdup(filepath);
+    assert(tmp_path);
+    (*handle)->config_dir = strdup(dirname(tmp_path));
+    assert((*handle)->config_dir);
+    free(tmp_path);
+
+    rc = configuration_build_index(handle);
+    if (rc) return rc;
+
+    // built from the in-memory tree, so no rank needs the file for this
+    return configuration_get_lpgroups(handle, "LPGROUPS", &lpconf);
+}
+
+int configuration_free (ConfigHandle *handle)
+{
+    if (!*handle)
+        return 0;
+    config_index_free((*handle)->index);
+    free((*handle)->config_dir);
+    cf_free(*handle);
+    *handle = NULL;
+    return 0;
+}
+
 int configuration_get_value(ConfigHandle *handle,
                             const char *section_name,
                             const char *key_name,
@@ -92,21 +401,22 @@ int configuration_get_value(ConfigHandle *handle,
     // reading directly from the config, so need to inject the annotation
     // directly into the search string
     char key_name_tmp[CONFIGURATION_MAX_NAME];
-    char *key_name_full;
-    if (annotation==NULL){
-        // sorry const type... we promise we won't change you
-        key_name_full = (char*) key_name;
-    }
-    else{
-        if (snprintf(key_name_tmp, CONFIGURATION_MAX_NAME, "%s@%s",
-                    key_name, annotation) >= CONFIGURATION_MAX_NAME) {
-            fprintf(stderr,
-                    "config error: name@annotation pair too long: %s@%s\n",
-                    key_name, annotation);
-            return 1;
+    const char *key_name_full =
+        config_key_name(key_name, annotation, key_name_tmp);
+    if (!key_name_full)
+        return 1;
+
+    if ((*handle)->index) {
+        struct config_index_entry *e =
+            config_index_find((*handle)->index, section_name, key_name_full);
+        if (!e)
+            return config_index_find((*handle)->index, section_name, NULL)
+                ? -1 : 0;
+        if (e->rc >= 0 && len > 0) {
+            strncpy(value, e->value, len);
+            value[len-1] = 0;
         }
-        else
-            key_name_full = key_name_tmp;
+        return e->rc;
     }
 
     rc = cf_openSection(*handle, ROOT_SECTION, section_name, &section_handle);
@@ -151,22 +461,10 @@ int configuration_get_multivalue(ConfigHandle *handle,
     // reading directly from the config, so need to inject the annotation
     // directly into the search string
     char key_name_tmp[CONFIGURATION_MAX_NAME];
-    char *key_name_full;
-    if (annotation==NULL){
-        // sorry const type... we promise we won't change you
-        key_name_full = (char*) key_name;
-    }
-    else{
-        if (snprintf(key_name_tmp, CONFIGURATION_MAX_NAME, "%s@%s",
-                    key_name, annotation) >= CONFIGURATION_MAX_NAME) {
-            fprintf(stderr,
-                    "config error: name@annotation pair too long: %s@%s\n",
-                    key_name, annotation);
-            return 1;
-        }
-        else
-            key_name_full = key_name_tmp;
-    }
+    const char *key_name_full =
+        config_key_name(key_name, annotation, key_name_tmp);
+    if (!key_name_full)
+        return 1;
 
     rc = cf_openSection(*handle, ROOT_SECTION, section_name, &section_handle);
     if (rc != 1) return rc;
@@ -186,6 +484,19 @@ int configuration_get_value_int (ConfigHandle *handle,
     char valuestr[256];
     int rc = 1;
     int r;
+    struct config_index_entry *e = config_index_value(handle, section_name,
+            key_name, annotation);
+
+    if (e)
+    {
+        if (!(e->parsed & CONFIG_PARSED_INT))
+        {
+            e->int_value = atoi(e->value);
+            e->parsed |= CONFIG_PARSED_INT;
+        }
+        *value = e->int_value;
+        return 0;
+    }
 
     r = configuration_get_value(handle,
                                 section_name,
@@ -211,6 +522,19 @@ int configuration_get_value_uint (ConfigHandle *handle,
     char valuestr[256];
     int rc = 1;
     int r;
+    struct config_index_entry *e = config_index_value(handle, section_name,
+            key_name, annotation);
+
+    if (e)
+    {
+        if (!(e->parsed & CONFIG_PARSED_INT))
+        {
+            e->int_value = atoi(e->value);
+            e->parsed |= CONFIG_PARSED_INT;
+        }
+        *value = (unsigned int) e->int_value;
+        return 0;
+    }
 
     r = configuration_get_value(handle,
                                 section_name,
@@ -236,6 +560,21 @@ int configuration_get_value_longint (ConfigHandle *handle,
     char valuestr[256];
     int rc = 1;
     int r;
+    struct config_index_entry *e = config_index_value(handle, section_name,
+            key_name, annotation);
+
+    if (e)
+    {
+        if (!(e->parsed & CONFIG_PARSED_LONGINT))
+        {
+            errno = 0;
+            e->longint_value = strtol(e->value, NULL, 10);
+            e->longint_rc = errno;
+            e->parsed |= CONFIG_PARSED_LONGINT;
+        }
+        *value = e->longint_value;
+        return e->longint_rc;
+    }
 
     r = configuration_get_value(handle,
                                 section_name,
@@ -262,6 +601,21 @@ int configuration_get_value_double (ConfigHandle *handle,
     char valuestr[256];
     int rc = 1;
     int r;
+    struct config_index_entry *e = config_index_value(handle, section_name,
+            key_name, annotation);
+
+    if (e)
+    {
+        if (!(e->parsed & CONFIG_PARSED_DOUBLE))
+        {
+            errno = 0;
+            e->double_value = strtod(e->value, NULL);
+            e->double_rc = errno;
+            e->parsed |= CONFIG_PARSED_DOUBLE;
+        }
+        *value = e->double_value;
+        return e->double_rc;
+    }
 
     r = configuration_get_value(handle,
                                 section_name,
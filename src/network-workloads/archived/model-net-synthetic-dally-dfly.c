@@ -172,7 +172,7 @@ const tw_optdef app_opt [] =
     	TWOPT_UINT("traffic", traffic, "UNIFORM RANDOM=1, NEAREST NEIGHBOR=2 "),
     	TWOPT_UINT("num_messages", num_msgs, "Number of messages to be generated per terminal "),
     	TWOPT_UINT("payload_sz",PAYLOAD_SZ, "size of the message being sent "),
-    	TWOPT_STIME("sampling-interval", sampling_interval, "the sampling interval "),
+    	TWOPT_STIME("sampling-interval", sampling_interval, "the sampling interval, 0 to disable sampling "),
     	TWOPT_STIME("sampling-end-time", sampling_end_time, "sampling end time "),
 	    TWOPT_STIME("arrival_time", arrival_time, "INTER-ARRIVAL TIME"),
         TWOPT_CHAR("lp-io-dir", lp_io_dir, "Where to place io output (unspecified -> no output"),
@@ -522,6 +522,7 @@ int main(
     MPI_Comm_size(MPI_COMM_CODES, &nprocs);
 
     configuration_load(argv[2], MPI_COMM_CODES, &config);
+    codes_category_register("test");
 
     model_net_register();
     svr_add_lp_type();
@@ -538,7 +539,8 @@ int main(
 
     /* 5 days of simulation time */
     g_tw_ts_end = s_to_ns(5 * 24 * 60 * 60);
-    model_net_enable_sampling(sampling_interval, sampling_end_time);
+    if(sampling_interval > 0)
+        model_net_enable_sampling(sampling_interval, sampling_end_time);
 
     if(net_id != DRAGONFLY && net_id != DRAGONFLY_DALLY)
     {
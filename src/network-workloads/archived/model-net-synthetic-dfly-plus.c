@@ -820,6 +820,7 @@ int main(
     MPI_Comm_size(MPI_COMM_CODES, &nprocs);
 
     configuration_load(argv[2], MPI_COMM_CODES, &config);
+    codes_category_register("test");
 
     model_net_register();
     svr_add_lp_type();
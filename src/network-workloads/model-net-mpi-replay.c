@@ -16,6 +16,7 @@
 #include "codes/quicklist.h"
 #include "codes/quickhash.h"
 #include "codes/codes-jobmap.h"
+#include "codes/codes-sampling.h"
 
 /* turning on track lp will generate a lot of output messages */
 #define MN_LP_NM "modelnet_dragonfly_custom"
@@ -27,7 +28,6 @@
 #define NW_LP_NM "nw-lp"
 #define lprintf(_fmt, ...) \
         do {if (CS_LP_DBG) printf(_fmt, __VA_ARGS__);} while (0)
-#define MAX_STATS 65536
 #define COL_TAG 1235
 #define BAR_TAG 1234
 #define PRINT_SYNTH_TRAFFIC 1
@@ -71,7 +71,6 @@ static int payload_sz = 1024;
 /* Doing LP IO*/
 static char * params = NULL;
 static char lp_io_dir[256] = {'\0'};
-static char sampling_dir[32] = {'\0'};
 static char mpi_msg_dir[32] = {'\0'};
 static lp_io_handle io_handle;
 static unsigned int lp_io_use_suffix = 0;
@@ -111,10 +110,6 @@ static int syn_type = 0;
 
 FILE * workload_log = NULL;
 FILE * msg_size_log = NULL;
-FILE * workload_agg_log = NULL;
-FILE * workload_meta_log = NULL;
-
-static uint64_t sample_bytes_written = 0;
 
 unsigned long long num_bytes_sent=0;
 unsigned long long num_bytes_recvd=0;
@@ -172,15 +167,16 @@ enum TRAFFIC
     STENCIL = 4, /* sends message to 4 nearby neighbors */
     PERMUTATION = 5
 };
-struct mpi_workload_sample
+/* per-interval counters, pushed to the "mpi-replay" sampler */
+enum mpi_workload_sample_value
 {
-    /* Sampling data */
-    int nw_id;
-    int app_id;
-    unsigned long num_sends_sample;
-    unsigned long num_bytes_sample;
-    unsigned long num_waits_sample;
-    double sample_end_time;
+    SAMPLE_NUM_SENDS,
+    SAMPLE_NUM_BYTES,
+    SAMPLE_NUM_WAITS,
+    NUM_SAMPLE_VALUES
+};
+static char const * const mpi_workload_sample_names[NUM_SAMPLE_VALUES] = {
+    "num_sends", "num_bytes_sent", "num_waits"
 };
 /* stores pointers of pending MPI operations to be matched with their respective sends/receives. */
 struct mpi_msgs_queue
@@ -326,9 +322,8 @@ struct nw_state
     unsigned long rc_perm;
 
     /* For sampling data */
-    int sampling_indx;
-    int max_arr_size;
-    struct mpi_workload_sample * mpi_wkld_samples;
+    struct codes_sample_ring * sample_ring;
+    double sample_values[NUM_SAMPLE_VALUES];
     char output_buf[512];
     char col_stats[64];
     struct ross_model_sample ross_sample;
@@ -379,6 +374,7 @@ struct nw_message
        int saved_syn_length;
        unsigned long saved_prev_switch;
        double saved_prev_max_time;
+       tw_stime saved_interval_end;
    } rc;
 };
 
@@ -1160,6 +1156,25 @@ static void codes_exec_mpi_wait(nw_state* s, tw_bf * bf, nw_message * m, tw_lp*
     return;
 }
 
+/* close the current sampling interval and move on to the one holding now */
+static void mpi_workload_sample(nw_state * s, nw_message * m, tw_lp * lp)
+{
+    codes_sample_push(s->sample_ring, lp, s->cur_interval_end, s->sample_values);
+    memset(s->sample_values, 0, sizeof(s->sample_values));
+
+    m->rc.saved_interval_end = s->cur_interval_end;
+    s->cur_interval_end = (floor(tw_now(lp) / sampling_interval) + 1) *
+        sampling_interval;
+}
+
+static void mpi_workload_sample_rc(nw_state * s, nw_message * m)
+{
+    double const * values = codes_sample_push_rc(s->sample_ring);
+
+    memcpy(s->sample_values, values, sizeof(s->sample_values));
+    s->cur_interval_end = m->rc.saved_interval_end;
+}
+
 static void codes_exec_mpi_wait_all_rc(
         nw_state* s,
         tw_bf * bf,
@@ -1168,14 +1183,9 @@ static void codes_exec_mpi_wait_all_rc(
 {
   if(bf->c1)
   {
-    int sampling_indx = s->sampling_indx;
-    s->mpi_wkld_samples[sampling_indx].num_waits_sample--;
-
+    s->sample_values[SAMPLE_NUM_WAITS]--;
     if(bf->c2)
-    {
-        s->cur_interval_end -= sampling_interval;
-        s->sampling_indx--;
-    }
+        mpi_workload_sample_rc(s, m);
   }
   if(s->wait_op)
   {
@@ -1201,29 +1211,15 @@ static void codes_exec_mpi_wait_all(
   if(enable_debug)
     fprintf(workload_log, "\n MPI WAITALL POSTED AT %llu ", LLU(s->nw_id));
 
-  if(enable_sampling)
+  if(s->sample_ring)
   {
     bf->c1 = 1;
     if(tw_now(lp) >= s->cur_interval_end)
     {
         bf->c2 = 1;
-        int indx = s->sampling_indx;
-        s->mpi_wkld_samples[indx].nw_id = s->nw_id;
-        s->mpi_wkld_samples[indx].app_id = s->app_id;
-        s->mpi_wkld_samples[indx].sample_end_time = s->cur_interval_end;
-        s->cur_interval_end += sampling_interval;
-        s->sampling_indx++;
-    }
-    if(s->sampling_indx >= MAX_STATS)
-    {
-        struct mpi_workload_sample * tmp = (struct mpi_workload_sample*)calloc((MAX_STATS + s->max_arr_size), sizeof(struct mpi_workload_sample));
-        memcpy(tmp, s->mpi_wkld_samples, s->sampling_indx);
-        free(s->mpi_wkld_samples);
-        s->mpi_wkld_samples = tmp;
-        s->max_arr_size += MAX_STATS;
+        mpi_workload_sample(s, m, lp);
     }
-    int indx = s->sampling_indx;
-    s->mpi_wkld_samples[indx].num_waits_sample++;
+    s->sample_values[SAMPLE_NUM_WAITS]++;
   }
   int count = mpi_op->u.waits.count;
   /* If the count is not less than max wait reqs then stop */
@@ -1597,18 +1593,13 @@ int get_global_id_of_job_rank(tw_lpid job_rank, int app_id)
 }
 static void codes_exec_mpi_send_rc(nw_state * s, tw_bf * bf, nw_message * m, tw_lp * lp)
 {
-        if(enable_sampling)
+        if(s->sample_ring)
         {
-           int indx = s->sampling_indx;
-
-           s->mpi_wkld_samples[indx].num_sends_sample--;
-           s->mpi_wkld_samples[indx].num_bytes_sample -= m->rc.saved_num_bytes;
+           s->sample_values[SAMPLE_NUM_SENDS]--;
+           s->sample_values[SAMPLE_NUM_BYTES] -= m->rc.saved_num_bytes;
 
            if(bf->c1)
-           {
-               s->sampling_indx--;
-               s->cur_interval_end -= sampling_interval;
-           }
+               mpi_workload_sample_rc(s, m);
         }
         if(bf->c15 || bf->c16)
         {
@@ -1680,29 +1671,15 @@ static void codes_exec_mpi_send(nw_state* s,
 	/* model-net event */
 	tw_lpid dest_rank = codes_mapping_get_lpid_from_relative(global_dest_rank, NULL, "nw-lp", NULL, 0);
 
-    if(enable_sampling)
+    if(s->sample_ring)
     {
         if(tw_now(lp) >= s->cur_interval_end)
         {
             bf->c1 = 1;
-            int indx = s->sampling_indx;
-            s->mpi_wkld_samples[indx].nw_id = s->nw_id;
-            s->mpi_wkld_samples[indx].app_id = s->app_id;
-            s->mpi_wkld_samples[indx].sample_end_time = s->cur_interval_end;
-            s->sampling_indx++;
-            s->cur_interval_end += sampling_interval;
-        }
-        if(s->sampling_indx >= MAX_STATS)
-        {
-            struct mpi_workload_sample * tmp = (struct mpi_workload_sample*)calloc((MAX_STATS + s->max_arr_size), sizeof(struct mpi_workload_sample));
-            memcpy(tmp, s->mpi_wkld_samples, s->sampling_indx);
-            free(s->mpi_wkld_samples);
-            s->mpi_wkld_samples = tmp;
-            s->max_arr_size += MAX_STATS;
+            mpi_workload_sample(s, m, lp);
         }
-        int indx = s->sampling_indx;
-        s->mpi_wkld_samples[indx].num_sends_sample++;
-        s->mpi_wkld_samples[indx].num_bytes_sample += mpi_op->u.send.num_bytes;
+        s->sample_values[SAMPLE_NUM_SENDS]++;
+        s->sample_values[SAMPLE_NUM_BYTES] += mpi_op->u.send.num_bytes;
     }
 	nw_message local_m;
 	nw_message remote_m;
@@ -2087,8 +2064,6 @@ void nw_test_init(nw_state* s, tw_lp* lp)
 
    memset(s, 0, sizeof(*s));
    s->nw_id = codes_mapping_get_lp_relative_id(lp->gid, 0, 0);
-   s->mpi_wkld_samples = (struct mpi_workload_sample*)calloc(MAX_STATS, sizeof(struct mpi_workload_sample));
-   s->sampling_indx = 0;
    s->is_finished = 0;
    s->cur_interval_end = 0;
    s->col_time = 0;
@@ -2239,13 +2214,14 @@ void nw_test_init(nw_state* s, tw_lp* lp)
    }
    if(enable_sampling && sampling_interval > 0)
    {
-       s->max_arr_size = MAX_STATS;
+       /* one group per job */
+       int num_jobs = alloc_spec ? codes_jobmap_get_num_jobs(jobmap_ctx) : 1;
+       struct codes_sampler * sampler = codes_sampler_get("mpi-replay",
+               NUM_SAMPLE_VALUES, NUM_SAMPLE_VALUES, mpi_workload_sample_names,
+               NULL, NULL, num_jobs, sampling_interval);
+       s->sample_ring = codes_sample_ring_create(sampler, s->app_id,
+               CODES_SAMPLE_RING_SIZE);
        s->cur_interval_end = sampling_interval;
-       if(!g_tw_mynode && !s->nw_id)
-       {
-           fprintf(workload_meta_log, "\n mpi_proc_id app_id num_waits "
-                   " num_sends num_bytes_sent sample_end_time");
-       }
    }
    return;
 }
@@ -2700,12 +2676,14 @@ void nw_test_finalize(nw_state* s, tw_lp* lp)
             print_msgs_queue(&s->pending_recvs_queue, 0);
             print_msgs_queue(&s->arrival_queue, 1);
         }
-        if(enable_sampling)
+        if(s->sample_ring)
         {
-            fseek(workload_agg_log, sample_bytes_written, SEEK_SET);
-            fwrite(s->mpi_wkld_samples, sizeof(struct mpi_workload_sample), s->sampling_indx + 1, workload_agg_log);
+            /* the last, partial interval */
+            codes_sample_push(s->sample_ring, lp, s->cur_interval_end,
+                    s->sample_values);
+            codes_sample_ring_destroy(s->sample_ring, lp);
+            s->sample_ring = NULL;
         }
-        sample_bytes_written += (s->sampling_indx * sizeof(struct mpi_workload_sample));
 		if(s->wait_time > max_wait_time)
 			max_wait_time = s->wait_time;
         
@@ -2818,9 +2796,9 @@ const tw_optdef app_opt [] =
     TWOPT_UINT("preserve_wait_ordering", preserve_wait_ordering, "only enable when getting unmatched send/recv errors in optimistic mode (turning on slows down simulation)"),
     TWOPT_UINT("debug_cols", debug_cols, "completion time of collective operations (currently MPI_AllReduce)"),
     TWOPT_UINT("enable_mpi_debug", enable_debug, "enable debugging of MPI sim layer (works with sync=1 only)"),
-    TWOPT_UINT("sampling_interval", sampling_interval, "sampling interval for MPI operations"),
+    TWOPT_STIME("sampling_interval", sampling_interval, "sampling interval for MPI operations"),
     TWOPT_UINT("perm-thresh", perm_switch_thresh, "threshold for random permutation operations"),
-	TWOPT_UINT("enable_sampling", enable_sampling, "enable sampling (only works in sequential mode)"),
+	TWOPT_UINT("enable_sampling", enable_sampling, "enable per-job sampling of MPI operations (needs --lp-io-dir)"),
     TWOPT_STIME("mean_interval", mean_interval, "mean interval for generating background traffic"),
     TWOPT_STIME("sampling_end_time", sampling_end_time, "sampling_end_time"),
     TWOPT_CHAR("lp-io-dir", lp_io_dir, "Where to place io output (unspecified -> no output"),
@@ -2995,9 +2973,6 @@ int modelnet_mpi_replay(MPI_Comm comm, int* argc, char*** argv )
 
 	jobmap_ctx = NULL; // make sure it's NULL if it's not used
 
-    sprintf(sampling_dir, "sampling-dir");
-    mkdir(sampling_dir, S_IRUSR | S_IWUSR | S_IXUSR);
-
     sprintf(mpi_msg_dir, "synthetic%d", syn_type);
     mkdir(mpi_msg_dir, S_IRUSR | S_IWUSR | S_IXUSR);
     if(strlen(workloads_conf_file) > 0)
@@ -3055,6 +3030,8 @@ int modelnet_mpi_replay(MPI_Comm comm, int* argc, char*** argv )
     MPI_Comm_size(MPI_COMM_CODES, &nprocs);
 
    configuration_load((*argv)[2], MPI_COMM_CODES, &config);
+   codes_category_register("high");
+   codes_category_register("medium");
 
    nw_add_lp_type();
    model_net_register();
@@ -3098,18 +3075,6 @@ int modelnet_mpi_replay(MPI_Comm comm, int* argc, char*** argv )
             MPI_Finalize();
             return -1;
         }
-        char agg_log_name[512];
-        sprintf(agg_log_name, "%s/mpi-aggregate-logs-%d.bin", sampling_dir, rank);
-        workload_agg_log = fopen(agg_log_name, "w+");
-        workload_meta_log = fopen("mpi-workload-meta-log", "w+");
-   
-
-        if(!workload_agg_log || !workload_meta_log)
-        {
-            printf("\n Error logging MPI operations... quitting ");
-            MPI_Finalize();
-            return -1;
-        }
     }
 
     switch(map_ctxt)
@@ -3131,6 +3096,13 @@ int modelnet_mpi_replay(MPI_Comm comm, int* argc, char*** argv )
            break;
     }
 
+   if(enable_sampling && !lp_io_dir[0])
+   {
+       if(!g_tw_mynode)
+           fprintf(stderr, "WARNING, sampling is written through LP-IO, "
+                   "disabled without --lp-io-dir\n");
+       enable_sampling = 0;
+   }
    if(enable_sampling)
        model_net_enable_sampling(sampling_interval, sampling_end_time);
 
@@ -3155,8 +3127,6 @@ int modelnet_mpi_replay(MPI_Comm comm, int* argc, char*** argv )
 
     if(enable_msg_tracking) {
         fclose(msg_size_log);
-        fclose(workload_agg_log);
-        fclose(workload_meta_log);
     }
 
     long long total_bytes_sent, total_bytes_recvd;
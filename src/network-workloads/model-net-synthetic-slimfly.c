@@ -457,6 +457,8 @@ static void handle_kickoff_event(
         local_dest[0] = (server_id + (int)(num_nodes/3)) % num_nodes;
     }
 
+    struct model_net_batch_entry *ents =
+        malloc(num_transfers*sizeof(struct model_net_batch_entry));
     for(int i=0; i<num_transfers; i++){
         // Verify local/relative ID of the destination is a valid option
         assert(local_dest[i] < num_nodes);
@@ -466,11 +468,20 @@ static void handle_kickoff_event(
         // comm_map[server_id][local_dest[i]]++; //TODO: NM: This is broken in cons/opt
         // Increment send count
         ns->msg_sent_count++;
-        // Issue event //TODO: NM: This is broken in optimistic when num_transfers > 1
-        m->event_rc = model_net_event(net_id, "test", global_dest, payload_size, i*0.2, sizeof(svr_msg), (const void*)m_remote, sizeof(svr_msg), (const void*)m_local, lp);
-        
-        free(local_dest);
+        ents[i].final_dest_lp = global_dest;
+        ents[i].message_size = payload_size;
+        ents[i].remote_event_size = sizeof(svr_msg);
+        ents[i].remote_event = m_remote;
+        ents[i].self_event_size = sizeof(svr_msg);
+        ents[i].self_event = m_local;
+        ents[i].sched_params = NULL;
     }
+    // Issue events: the NIC sequences the transfers in order, a single
+    // model_net_event_rc2 call reverses them all
+    m->event_rc = model_net_event_batch(net_id, "test", num_transfers, ents, 0.0, lp);
+    free(ents);
+    if(num_transfers > 0)
+        free(local_dest);
     issue_event(ns, lp);
     return;
 }
@@ -651,6 +662,7 @@ int main(
     MPI_Comm_size(MPI_COMM_CODES, &nprocs);
 
     configuration_load(argv[2], MPI_COMM_CODES, &config);
+    codes_category_register("test");
     model_net_register();
     svr_add_lp_type();
 
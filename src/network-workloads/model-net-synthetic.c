@@ -7,6 +7,8 @@
 /*
 * The test program generates some synthetic traffic patterns for the model-net network models.
 * currently it only support the dragonfly network model uniform random and nearest neighbor traffic patterns.
+* Traffic 4 replays the synthetic_workload generator (see the WORKLOAD section
+* of the configuration file) instead.
 */
 
 #include "codes/model-net.h"
@@ -15,6 +17,7 @@
 #include "codes/codes_mapping.h"
 #include "codes/configuration.h"
 #include "codes/lp-type-lookup.h"
+#include "codes/codes-workload.h"
 #include "codes/net/dragonfly.h"
 
 #define PAYLOAD_SZ 2048
@@ -22,6 +25,10 @@
 static int net_id = 0;
 static int traffic = 1;
 static double arrival_time = 1000.0;
+static int64_t payload_sz = PAYLOAD_SZ;
+
+/* parameters of the synthetic_workload generator (traffic 4) */
+static codes_workload_config_return wrkld_cfg;
 
 /* whether to pull instead of push */
 static int num_servers_per_rep = 0;
@@ -59,7 +66,8 @@ enum TRAFFIC
 {
 	UNIFORM = 1, /* sends message to a randomly selected node */
 	NEAREST_GROUP = 2, /* sends message to the node connected to the neighboring router */
-	NEAREST_NEIGHBOR = 3 /* sends message to the next node (potentially connected to the same router) */
+	NEAREST_NEIGHBOR = 3, /* sends message to the next node (potentially connected to the same router) */
+	SYNTHETIC_WORKLOAD = 4 /* replays the ops of the synthetic_workload generator */
 };
 
 struct svr_state
@@ -69,6 +77,7 @@ struct svr_state
     int local_recvd_count; /* number of local messages received */
     tw_stime start_ts;    /* time that we started sending requests */
     tw_stime end_ts;      /* time that we ended sending requests */
+    int wrkld_id;         /* synthetic_workload handle (traffic 4) */
 };
 
 struct svr_msg
@@ -153,7 +162,7 @@ void svr_register_model_types()
 const tw_optdef app_opt [] =
 {
         TWOPT_GROUP("Model net synthetic traffic " ),
-    	TWOPT_UINT("traffic", traffic, "UNIFORM RANDOM=1, NEAREST NEIGHBOR=2 "),
+    	TWOPT_UINT("traffic", traffic, "UNIFORM RANDOM=1, NEAREST GROUP=2, NEAREST NEIGHBOR=3, SYNTHETIC WORKLOAD=4 "),
     	TWOPT_UINT("num_messages", num_msgs, "Number of messages to be generated per terminal "),
     	TWOPT_STIME("sampling-interval", sampling_interval, "the sampling interval "),
     	TWOPT_STIME("sampling-end-time", sampling_end_time, "sampling end time "),
@@ -202,10 +211,88 @@ static void svr_init(
 {
     ns->start_ts = 0.0;
 
+    if(traffic == SYNTHETIC_WORKLOAD)
+    {
+        int local_id = codes_mapping_get_lp_relative_id(lp->gid, 0, 0);
+        ns->wrkld_id = codes_workload_load(wrkld_cfg.type,
+                (const char*)wrkld_cfg.params, 0, local_id);
+        assert(ns->wrkld_id >= 0);
+    }
     issue_event(ns, lp);
     return;
 }
 
+static void handle_workload_kickoff_rev_event(
+            svr_state * ns,
+            tw_bf * b,
+            svr_msg * m,
+            tw_lp * lp)
+{
+    int local_id = codes_mapping_get_lp_relative_id(lp->gid, 0, 0);
+
+    if(b->c2)
+    {
+        model_net_event_rc2(lp, &m->event_rc);
+        ns->msg_sent_count--;
+    }
+    if(!b->c1)
+        codes_local_latency_reverse(lp);
+    codes_workload_get_next_rc2(ns->wrkld_id, 0, local_id);
+}
+
+/* one op of the synthetic workload per kickoff: a delay schedules the next
+ * kickoff after it, a send goes out right away, and the end stops the rank */
+static void handle_workload_kickoff_event(
+	    svr_state * ns,
+	    tw_bf * b,
+	    svr_msg * m,
+	    tw_lp * lp)
+{
+    struct codes_workload_op op;
+    int local_id = codes_mapping_get_lp_relative_id(lp->gid, 0, 0);
+
+    codes_workload_get_next(ns->wrkld_id, 0, local_id, &op);
+    if(op.op_type == CODES_WK_END)
+    {
+        b->c1 = 1;
+        return;
+    }
+
+    tw_stime next_time = codes_local_latency(lp);
+    if(op.op_type == CODES_WK_DELAY)
+        next_time += op.u.delay.nsecs;
+    else
+    {
+        assert(op.op_type == CODES_WK_ISEND);
+        b->c2 = 1;
+
+        svr_msg m_local, m_remote;
+        memset(&m_local, 0, sizeof(m_local));
+        m_local.svr_event_type = LOCAL;
+        m_local.src = lp->gid;
+        m_remote = m_local;
+        m_remote.svr_event_type = REMOTE;
+
+        if(ns->msg_sent_count == 0)
+            ns->start_ts = tw_now(lp);
+        char anno[MAX_NAME_LENGTH];
+        codes_mapping_get_lp_info(lp->gid, group_name, &group_index,
+                lp_type_name, &lp_type_index, anno, &rep_id, &offset);
+        assert(op.u.send.dest_rank < (int64_t)num_nodes);
+        tw_lpid global_dest = codes_mapping_get_lpid_from_relative(
+                op.u.send.dest_rank, group_name, lp_type_name, NULL, 0);
+        ns->msg_sent_count++;
+        m->event_rc = model_net_event(net_id, "test", global_dest,
+                op.u.send.num_bytes, 0.0, sizeof(svr_msg), &m_remote,
+                sizeof(svr_msg), &m_local, lp);
+    }
+
+    tw_event *e = tw_event_new(lp->gid, next_time, lp);
+    svr_msg *m_new = tw_event_data(e);
+    m_new->svr_event_type = KICKOFF;
+    tw_event_send(e);
+}
+
 static void handle_kickoff_rev_event(
             svr_state * ns,
             tw_bf * b,
@@ -344,8 +431,8 @@ static void svr_finalize(
 {
     ns->end_ts = tw_now(lp);
 
-    printf("server %llu recvd %d bytes in %f seconds, %f MiB/s sent_count %d recvd_count %d local_count %d \n", (unsigned long long)lp->gid, PAYLOAD_SZ*ns->msg_recvd_count, ns_to_s(ns->end_ts-ns->start_ts),
-        ((double)(PAYLOAD_SZ*ns->msg_sent_count)/(double)(1024*1024)/ns_to_s(ns->end_ts-ns->start_ts)), ns->msg_sent_count, ns->msg_recvd_count, ns->local_recvd_count);
+    printf("server %llu recvd %lld bytes in %f seconds, %f MiB/s sent_count %d recvd_count %d local_count %d \n", (unsigned long long)lp->gid, (long long)(payload_sz*ns->msg_recvd_count), ns_to_s(ns->end_ts-ns->start_ts),
+        ((double)(payload_sz*ns->msg_sent_count)/(double)(1024*1024)/ns_to_s(ns->end_ts-ns->start_ts)), ns->msg_sent_count, ns->msg_recvd_count, ns->local_recvd_count);
     return;
 }
 
@@ -364,7 +451,10 @@ static void svr_rev_event(
 		handle_local_rev_event(ns, b, m, lp);
 		break;
 	case KICKOFF:
-		handle_kickoff_rev_event(ns, b, m, lp);
+		if(traffic == SYNTHETIC_WORKLOAD)
+		    handle_workload_kickoff_rev_event(ns, b, m, lp);
+		else
+		    handle_kickoff_rev_event(ns, b, m, lp);
 		break;
 	default:
 		assert(0);
@@ -387,7 +477,10 @@ static void svr_event(
             handle_local_event(ns, b, m, lp);
             break;
 	case KICKOFF:
-	    handle_kickoff_event(ns, b, m, lp);
+	    if(traffic == SYNTHETIC_WORKLOAD)
+	        handle_workload_kickoff_event(ns, b, m, lp);
+	    else
+	        handle_kickoff_event(ns, b, m, lp);
 	    break;
         default:
             printf("\n Invalid message type %d ", m->svr_event_type);
@@ -424,6 +517,7 @@ int main(
     MPI_Comm_size(MPI_COMM_CODES, &nprocs);
 
     configuration_load(argv[2], MPI_COMM_CODES, &config);
+    codes_category_register("test");
 
     model_net_register();
     svr_add_lp_type();
@@ -458,6 +552,17 @@ int main(
 
     assert(num_nodes);
 
+    if(traffic == SYNTHETIC_WORKLOAD)
+    {
+        wrkld_cfg = codes_workload_read_config(&config, "WORKLOAD", NULL,
+                num_nodes);
+        if(wrkld_cfg.type == NULL ||
+                strcmp(wrkld_cfg.type, "synthetic_workload") != 0)
+            tw_error(TW_LOC, "traffic %d expects workload_type=\"synthetic_workload\" "
+                    "in the WORKLOAD section of the configuration", SYNTHETIC_WORKLOAD);
+        payload_sz = ((synthetic_params*)wrkld_cfg.params)->payload_size;
+    }
+
     if(lp_io_dir[0])
     {
         do_lp_io = 1;
@@ -471,6 +576,8 @@ int main(
         assert(ret == 0 || !"lp_io_flush failure");
     }
     model_net_report_stats(net_id);
+    if(traffic == SYNTHETIC_WORKLOAD)
+        codes_workload_free_config_return(&wrkld_cfg);
 #ifdef USE_RDAMARIS
     } // end if(g_st_ross_rank)
 #endif
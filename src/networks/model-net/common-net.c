@@ -208,41 +208,6 @@ void delete_message_list(void *thisM) {
     free(thism);
 }
 
-int mn_rank_hash_compare(void *key, struct qhash_head *link)
-{
-  struct mn_hash_key *message_key = (struct mn_hash_key *)key;
-  struct mn_qhash_entry *tmp = NULL;
-
-  tmp = qhash_entry(link, struct mn_qhash_entry, hash_link);
-
-  if (tmp->key.message_id == message_key->message_id
-      && tmp->key.sender_id == message_key->sender_id)
-    return 1;
-
-  return 0;
-}
-
-int mn_hash_func(void *k, int table_size)
-{
-  struct mn_hash_key *tmp = (struct mn_hash_key *)k;
-  uint64_t key = (~tmp->message_id) + (tmp->message_id << 18);
-  key = key * 21;
-  key = ~key ^ (tmp->sender_id >> 4);
-  key = key * tmp->sender_id; 
-  return (int)(key & (table_size - 1));
-}
-
-void free_tmp(void * ptr)
-{
-  struct mn_qhash_entry * msg = ptr; 
-
-  if(msg->remote_event_data)
-    free(msg->remote_event_data);
-
-  if(msg)
-    free(msg);
-}
-
 /* convert GiB/s and bytes to ns */
 tw_stime bytes_to_ns(uint64_t bytes, double GB_p_s)
 {
@@ -12,6 +12,8 @@
 #include "codes/model-net-sched.h"
 #include "codes/codes_mapping.h"
 #include "codes/jenkins-hash.h"
+#include "codes/rc-stack.h"
+#include "codes/model-net-reassembly.h"
 
 #define MN_NAME "model_net_base"
 
@@ -25,6 +27,31 @@ int mn_sample_enabled = 0;
 // issues...
 static int msg_offsets[MAX_NETS];
 
+// how messages are spread over the injection queues (rails) of a NIC
+enum mn_rail_striping {
+    // queue derived from the sender's offset (the default)
+    MN_STRIPE_NONE,
+    // every message goes to the next queue in turn
+    MN_STRIPE_RR,
+    // messages of at least rail_split_threshold bytes are split across all
+    // queues, smaller ones behave as with none
+    MN_STRIPE_SPLIT,
+    // every message goes to the queue with the fewest queued bytes
+    MN_STRIPE_ADAPTIVE
+};
+
+static const char * const rail_striping_names[] = {
+    "none", "round-robin", "split", "adaptive"
+};
+
+// split messages: the stripes of parent message P get the ids below, which
+// never collide with the regular, counter-based ids
+#define MN_STRIPE_ID_BIT (1ull << 63)
+#define MN_STRIPE_ID(_parent, _i) (MN_STRIPE_ID_BIT | ((_parent) << 8) | (_i))
+#define MN_STRIPE_PARENT(_id) (((_id) & ~MN_STRIPE_ID_BIT) >> 8)
+// bounded by the stripe_kick bitmap
+#define MN_MAX_STRIPES 32
+
 typedef struct model_net_base_params_s {
     model_net_sched_cfg_params sched_params;
     uint64_t packet_size;
@@ -32,6 +59,8 @@ typedef struct model_net_base_params_s {
     int use_recv_queue;
     tw_stime nic_seq_delay;
     int node_copy_queues;
+    enum mn_rail_striping rail_striping;
+    uint64_t rail_split_threshold;
 } model_net_base_params;
 
 /* annotation-specific parameters (unannotated entry occurs at the
@@ -63,6 +92,15 @@ typedef struct model_net_base_state {
     void *sub_state;
     tw_stime next_available_time;
     tw_stime *node_copy_next_available_time;
+    // rail striping: next queue for round-robin, bytes of the messages
+    // waiting in each send queue for adaptive
+    int next_rail;
+    uint64_t *queued_bytes;
+    // split messages in flight: keyed by (parent id, our gid) on the sending
+    // NIC (stripes left, then the self event) and by (parent id, sending
+    // NIC) on the receiving one (stripes arrived, then the remote event)
+    struct mn_reasm_table *stripe_tbl;
+    struct rc_stack *stripe_st;
 } model_net_base_state;
 
 
@@ -99,6 +137,11 @@ static void handle_sched_next(
         tw_bf *b,
         model_net_wrap_msg * m,
         tw_lp * lp);
+static void handle_new_batch(
+        model_net_base_state * ns,
+        tw_bf *b,
+        model_net_wrap_msg * m,
+        tw_lp * lp);
 static void handle_new_msg_rc(
         model_net_base_state * ns,
         tw_bf *b,
@@ -109,6 +152,21 @@ static void handle_sched_next_rc(
         tw_bf *b,
         model_net_wrap_msg * m,
         tw_lp * lp);
+static void handle_new_batch_rc(
+        model_net_base_state * ns,
+        tw_bf *b,
+        model_net_wrap_msg * m,
+        tw_lp * lp);
+static void handle_stripe_done(
+        model_net_base_state * ns,
+        tw_bf *b,
+        model_net_wrap_msg * m,
+        tw_lp * lp);
+static void handle_stripe_done_rc(
+        model_net_base_state * ns,
+        tw_bf *b,
+        model_net_wrap_msg * m,
+        tw_lp * lp);
 static void model_net_commit_event(
         model_net_base_state * ns,
         tw_bf *b,
@@ -155,10 +213,18 @@ void mn_event_collect(model_net_wrap_msg *m, tw_lp *lp, char *buffer, int *colle
             type = 9001;
             memcpy(buffer, &type, sizeof(type));
             break;
+        case MN_BASE_NEW_BATCH:
+            type = 9003;
+            memcpy(buffer, &type, sizeof(type));
+            break;
         case MN_BASE_SAMPLE:
             type = 9002;
             memcpy(buffer, &type, sizeof(type));
             break;
+        case MN_BASE_STRIPE_DONE:
+            type = 9005;
+            memcpy(buffer, &type, sizeof(type));
+            break;
         case MN_BASE_PASS:
             sub_msg = ((char*)m)+msg_offsets[((model_net_base_state*)lp->cur_state)->net_id];
             if (((model_net_base_state*)lp->cur_state)->sub_model_type)
@@ -221,6 +287,11 @@ int model_net_sampling_enabled(void)
     return mn_sample_enabled;
 }
 
+tw_stime model_net_sampling_interval(void)
+{
+    return mn_sample_interval;
+}
+
 // schedule sample event - want to be precise, so no noise here
 static void issue_sample_event(tw_lp *lp)
 {
@@ -311,6 +382,12 @@ static void base_read_config(const char * anno, model_net_base_params *p){
                 "setting to %d\n", p->node_copy_queues);
     }
 
+    p->sched_params.train_len = 1;
+    configuration_get_value_int(&config, "PARAMS", "packet_train_length",
+            anno, &p->sched_params.train_len);
+    if (p->sched_params.train_len < 1)
+        tw_error(TW_LOC, "PARAMS:packet_train_length must be at least 1");
+
     // get scheduler-specific parameters
     if (p->sched_params.type == MN_SCHED_PRIO){
         // prio scheduler uses default parameters
@@ -338,13 +415,65 @@ static void base_read_config(const char * anno, model_net_base_params *p){
                 tw_error(TW_LOC, "Unknown value for "
                         "PARAMS:prio-sched-sub-sched %s", sched);
             }
-            else if (i == MN_SCHED_PRIO){
-                tw_error(TW_LOC, "priority scheduler cannot be used as a "
+            else if (i == MN_SCHED_PRIO || i == MN_SCHED_DRR ||
+                    i == MN_SCHED_WPRIO){
+                tw_error(TW_LOC, "%s scheduler cannot be used as a "
                         "priority scheduler's sub sched "
-                        "(PARAMS:prio-sched-sub-sched)");
+                        "(PARAMS:prio-sched-sub-sched)", sched_names[i]);
             }
         }
     }
+    else if (p->sched_params.type == MN_SCHED_DRR ||
+            p->sched_params.type == MN_SCHED_WPRIO){
+        mn_class_params *cls = &p->sched_params.u.cls;
+        char **values;
+        size_t length;
+
+        memset(cls, 0, sizeof(*cls));
+        for (int i = 0; i < MN_SCHED_MAX_CLASSES; i++)
+            cls->categories[i] = -1;
+        ret = configuration_get_multivalue(&config, "PARAMS",
+                "class-sched-weights", anno, &values, &length);
+        if (ret == 1){
+            if (length > MN_SCHED_MAX_CLASSES)
+                tw_error(TW_LOC, "PARAMS:class-sched-weights: at most %d "
+                        "classes are supported", MN_SCHED_MAX_CLASSES);
+            for (size_t i = 0; i < length; i++){
+                cls->weights[i] = atoi(values[i]);
+                free(values[i]);
+            }
+            free(values);
+            cls->num_classes = length;
+        }
+        ret = configuration_get_value_int(&config, "PARAMS",
+                "class-sched-num-classes", anno, &cls->num_classes);
+        if (ret != 0 && cls->num_classes == 0)
+            cls->num_classes = 2;
+        if (cls->num_classes < 1 || cls->num_classes > MN_SCHED_MAX_CLASSES)
+            tw_error(TW_LOC, "PARAMS:class-sched-num-classes must be in "
+                    "[1,%d]", MN_SCHED_MAX_CLASSES);
+        for (int i = 0; i < cls->num_classes; i++){
+            // classes without an explicit weight get weight 1
+            if (cls->weights[i] == 0)
+                cls->weights[i] = 1;
+            else if (cls->weights[i] < 0)
+                tw_error(TW_LOC, "PARAMS:class-sched-weights must be "
+                        "positive");
+        }
+
+        ret = configuration_get_multivalue(&config, "PARAMS",
+                "class-sched-categories", anno, &values, &length);
+        if (ret == 1){
+            if (length > (size_t)cls->num_classes)
+                tw_error(TW_LOC, "PARAMS:class-sched-categories lists more "
+                        "categories than there are classes");
+            for (size_t i = 0; i < length; i++){
+                cls->categories[i] = codes_category_register(values[i]);
+                free(values[i]);
+            }
+            free(values);
+        }
+    }
 
     if (p->sched_params.type == MN_SCHED_FCFS_FULL ||
             (p->sched_params.type == MN_SCHED_PRIO &&
@@ -364,6 +493,64 @@ static void base_read_config(const char * anno, model_net_base_params *p){
 
 
     p->packet_size = packet_size;
+
+    p->rail_striping = MN_STRIPE_NONE;
+    ret = configuration_get_value(&config, "PARAMS", "rail_striping", anno,
+            sched, MAX_NAME_LENGTH);
+    if (ret > 0){
+        int i;
+        for (i = 0; i <= MN_STRIPE_ADAPTIVE; i++){
+            if (strcmp(rail_striping_names[i], sched) == 0){
+                p->rail_striping = i;
+                break;
+            }
+        }
+        if (i > MN_STRIPE_ADAPTIVE)
+            tw_error(TW_LOC, "Unknown value for PARAMS:rail_striping : %s",
+                    sched);
+    }
+    // by default split once every rail gets at least a packet
+    long int threshold = 0;
+    configuration_get_value_longint(&config, "PARAMS", "rail_split_threshold",
+            anno, &threshold);
+    if (threshold < 0)
+        tw_error(TW_LOC, "PARAMS:rail_split_threshold must be positive");
+    p->rail_split_threshold = threshold ? (uint64_t)threshold :
+        packet_size * p->num_queues;
+    if (p->rail_striping == MN_STRIPE_SPLIT && p->num_queues > MN_MAX_STRIPES
+            && !g_tw_mynode)
+        fprintf(stderr, "WARNING, PARAMS:rail_striping = split uses at most "
+                "%d of the %d injection queues per message\n", MN_MAX_STRIPES,
+                p->num_queues);
+
+    if (p->sched_params.type == MN_SCHED_DRR ||
+            p->sched_params.type == MN_SCHED_WPRIO){
+        // default quantum: one packet (or train) per round for weight 1
+        mn_class_params *cls = &p->sched_params.u.cls;
+        uint64_t burst = packet_size * p->sched_params.train_len;
+        long int quantum = 0;
+        configuration_get_value_longint(&config, "PARAMS",
+                "class-sched-quantum", anno, &quantum);
+        if (quantum < 0)
+            tw_error(TW_LOC, "PARAMS:class-sched-quantum must be positive");
+        cls->quantum = quantum ? (uint64_t)quantum : burst;
+
+        // every class must be able to send a burst per round for the
+        // schedulers to stay O(1); scaling all quanta keeps the shares
+        int min_weight = cls->weights[0];
+        for (int i = 1; i < cls->num_classes; i++)
+            if (cls->weights[i] < min_weight)
+                min_weight = cls->weights[i];
+        if (cls->quantum * min_weight < burst){
+            cls->quantum = (burst + min_weight - 1) / min_weight;
+            if (!g_tw_mynode)
+                fprintf(stderr, "WARNING, PARAMS:class-sched-quantum is "
+                        "below one packet%s for the lightest class, raising "
+                        "it to %llu\n",
+                        p->sched_params.train_len > 1 ? " train" : "",
+                        LLU(cls->quantum));
+        }
+    }
 }
 
 void model_net_base_configure(){
@@ -492,6 +679,13 @@ void model_net_base_lp_init(
         ns->node_copy_next_available_time[i] = 0;
     }
 
+    ns->next_rail = 0;
+    ns->queued_bytes = (uint64_t *)calloc(ns->params->num_queues, sizeof(uint64_t));
+    // created on first use, the receiving side of a split message doesn't
+    // need to be configured for splitting
+    ns->stripe_tbl = NULL;
+    ns->stripe_st = NULL;
+
     ns->in_sched_send_loop = (int *)malloc(ns->params->num_queues * sizeof(int));
     ns->sched_send = (model_net_sched**)malloc(ns->params->num_queues * sizeof(model_net_sched*));
     for(int i = 0; i < ns->params->num_queues; i++) {
@@ -565,9 +759,15 @@ void model_net_base_event(
         case MN_BASE_NEW_MSG:
             handle_new_msg(ns, b, m, lp);
             break;
+        case MN_BASE_NEW_BATCH:
+            handle_new_batch(ns, b, m, lp);
+            break;
         case MN_BASE_SCHED_NEXT:
             handle_sched_next(ns, b, m, lp);
             break;
+        case MN_BASE_STRIPE_DONE:
+            handle_stripe_done(ns, b, m, lp);
+            break;
         case MN_BASE_SAMPLE: ;
             event_f sample = method_array[ns->net_id]->mn_sample_fn;
             assert(model_net_sampling_enabled() && sample != NULL);
@@ -598,9 +798,15 @@ void model_net_base_event_rc(
         case MN_BASE_NEW_MSG:
             handle_new_msg_rc(ns, b, m, lp);
             break;
+        case MN_BASE_NEW_BATCH:
+            handle_new_batch_rc(ns, b, m, lp);
+            break;
         case MN_BASE_SCHED_NEXT:
             handle_sched_next_rc(ns, b, m, lp);
             break;
+        case MN_BASE_STRIPE_DONE:
+            handle_stripe_done_rc(ns, b, m, lp);
+            break;
         case MN_BASE_SAMPLE: ;
             revent_f sample_rc = method_array[ns->net_id]->mn_sample_rc_fn;
             assert(model_net_sampling_enabled() && sample_rc != NULL);
@@ -626,10 +832,207 @@ void model_net_base_finalize(
         sfini(ns->sub_state, lp);
     ns->sub_type->final(ns->sub_state, lp);
     free(ns->sub_state);
+    if (ns->stripe_tbl){
+        rc_stack_destroy(ns->stripe_st);
+        mn_reasm_destroy(ns->stripe_tbl);
+    }
+    free(ns->queued_bytes);
+}
+
+static struct mn_reasm_table * stripe_table(model_net_base_state * ns)
+{
+    if (ns->stripe_tbl == NULL){
+        ns->stripe_tbl = mn_reasm_create(MN_REASM_INITIAL_SIZE);
+        rc_stack_create(&ns->stripe_st);
+    }
+    return ns->stripe_tbl;
+}
+
+/// bitfields used:
+/// c29 - round-robin rail counter advanced
+static int select_rail(
+        model_net_base_state * ns,
+        tw_bf *b,
+        int default_queue){
+    int num_queues = ns->params->num_queues;
+    switch (ns->params->rail_striping){
+        case MN_STRIPE_RR: ;
+            int q = ns->next_rail;
+            ns->next_rail = (q + 1) % num_queues;
+            b->c29 = 1;
+            return q;
+        case MN_STRIPE_ADAPTIVE: ;
+            // ties go to the queue the sender maps to
+            int best = default_queue;
+            for (int i = 0; i < num_queues; i++)
+                if (ns->queued_bytes[i] < ns->queued_bytes[best])
+                    best = i;
+            return best;
+        default:
+            return default_queue;
+    }
+}
+
+// stripe size (a multiple of the packet size) and number of stripes of a
+// split message
+static int stripe_layout(
+        model_net_base_state const * ns,
+        model_net_request const * r,
+        uint64_t *stripe_size){
+    int max_stripes = ns->params->num_queues < MN_MAX_STRIPES ?
+        ns->params->num_queues : MN_MAX_STRIPES;
+    uint64_t size = (r->msg_size + max_stripes - 1) / max_stripes;
+    size = (size + r->packet_size - 1) / r->packet_size * r->packet_size;
+    *stripe_size = size;
+    return (int)((r->msg_size + size - 1) / size);
+}
+
+static uint64_t stripe_msg_size(
+        model_net_request const * r,
+        uint64_t stripe_size,
+        int i){
+    uint64_t left = r->msg_size - i * stripe_size;
+    return left < stripe_size ? left : stripe_size;
+}
+
+/* Split a message into one stripe per send queue (PARAMS:rail_striping =
+ * split). Each stripe is delivered to the destination NIC, which counts them
+ * (handle_stripe_done) and issues the original remote event after the last
+ * one; the self event is issued once every stripe has been sent
+ * (stripe_sent). Returns 0, without doing anything, if the message is too
+ * small to be split */
+static int handle_split_msg(
+        model_net_base_state * ns,
+        model_net_wrap_msg * m,
+        void const * remote,
+        void const * local,
+        tw_lp * lp){
+    model_net_request *r = &m->msg.m_base.req;
+    uint64_t stripe_size;
+    int num_stripes = stripe_layout(ns, r, &stripe_size);
+    if (num_stripes < 2)
+        return 0;
+
+    uint64_t parent = r->msg_id;
+    if (r->self_event_size > 0){
+        struct mn_reasm_entry *e = mn_reasm_insert(stripe_table(ns), parent,
+                r->src_lp);
+        e->num_chunks = num_stripes;
+        mn_reasm_set_remote_event(e, local, r->self_event_size);
+    }
+
+    // remote event of the stripes, the original remote event rides along
+    // with stripe 0
+    char *ev = malloc(MN_STRIPE_EVENT_SIZE + r->remote_event_size);
+    model_net_wrap_msg *w = (model_net_wrap_msg*)ev;
+    msg_set_header(model_net_base_magic, MN_BASE_STRIPE_DONE, lp->gid, &w->h);
+    w->msg.m_stripe.final_dest_lp = r->final_dest_lp;
+    w->msg.m_stripe.src_mn_lp = lp->gid;
+    w->msg.m_stripe.parent_id = parent;
+    w->msg.m_stripe.num_stripes = num_stripes;
+    if (r->remote_event_size > 0)
+        memcpy(ev + MN_STRIPE_EVENT_SIZE, remote, r->remote_event_size);
+
+    model_net_request sr = *r;
+    sr.final_dest_lp = r->dest_mn_lp;
+    sr.self_event_size = 0;
+    m->msg.m_base.stripe_kick = 0;
+    for (int i = 0; i < num_stripes; i++){
+        sr.msg_id = MN_STRIPE_ID(parent, (uint64_t)i);
+        sr.msg_size = stripe_msg_size(r, stripe_size, i);
+        sr.queue_offset = i;
+        w->msg.m_stripe.remote_event_size = i ? 0 : r->remote_event_size;
+        sr.remote_event_size = MN_STRIPE_EVENT_SIZE +
+            w->msg.m_stripe.remote_event_size;
+        model_net_sched_add(&sr, &m->msg.m_base.sched_params,
+                sr.remote_event_size, ev, 0, NULL, ns->sched_send[i],
+                &m->msg.m_base.rc, lp);
+        ns->queued_bytes[i] += sr.msg_size;
+
+        if (!ns->in_sched_send_loop[i]){
+            ns->in_sched_send_loop[i] = 1;
+            m->msg.m_base.stripe_kick |= 1u << i;
+            tw_event *e = tw_event_new(lp->gid, codes_local_latency(lp), lp);
+            model_net_wrap_msg *m_wrap = tw_event_data(e);
+            msg_set_header(model_net_base_magic, MN_BASE_SCHED_NEXT, lp->gid,
+                    &m_wrap->h);
+            m_wrap->msg.m_base.is_from_remote = 0;
+            m_wrap->msg.m_base.req.queue_offset = i;
+            tw_event_send(e);
+        }
+    }
+    free(ev);
+    return 1;
+}
+
+static void handle_split_msg_rc(
+        model_net_base_state * ns,
+        model_net_wrap_msg * m,
+        tw_lp * lp){
+    model_net_request *r = &m->msg.m_base.req;
+    uint64_t stripe_size;
+    int num_stripes = stripe_layout(ns, r, &stripe_size);
+
+    for (int i = num_stripes; i-- > 0;){
+        if (m->msg.m_base.stripe_kick & (1u << i)){
+            ns->in_sched_send_loop[i] = 0;
+            codes_local_latency_reverse(lp);
+        }
+        ns->queued_bytes[i] -= stripe_msg_size(r, stripe_size, i);
+        model_net_sched_add_rc(ns->sched_send[i], &m->msg.m_base.rc, lp);
+    }
+    if (r->self_event_size > 0)
+        mn_reasm_discard(ns->stripe_tbl,
+                mn_reasm_find(ns->stripe_tbl, r->msg_id, r->src_lp));
+}
+
+/// bitfields used:
+/// c1 - the stripe belongs to a message with a self event
+/// c2 - it was the last stripe, self event issued
+static void stripe_sent(
+        model_net_base_state * ns,
+        tw_bf *b,
+        model_net_request const * req,
+        tw_lp * lp){
+    if (ns->stripe_tbl == NULL)
+        return;
+    struct mn_reasm_entry *e = mn_reasm_find(ns->stripe_tbl,
+            MN_STRIPE_PARENT(req->msg_id), req->src_lp);
+    if (e == NULL)
+        return;
+    b->c1 = 1;
+    rc_stack_gc(lp, ns->stripe_st);
+    if (--e->num_chunks == 0){
+        b->c2 = 1;
+        tw_event *ev = tw_event_new(req->src_lp, codes_local_latency(lp), lp);
+        memcpy(tw_event_data(ev), e->remote_event_data, e->remote_event_size);
+        tw_event_send(ev);
+        mn_reasm_complete(ns->stripe_tbl, e, lp, ns->stripe_st);
+    }
+}
+
+static void stripe_sent_rc(
+        model_net_base_state * ns,
+        tw_bf *b,
+        model_net_request const * req,
+        tw_lp * lp){
+    struct mn_reasm_entry *e;
+    if (b->c2){
+        codes_local_latency_reverse(lp);
+        e = mn_reasm_complete_rc(ns->stripe_tbl, ns->stripe_st);
+    }
+    else if (b->c1)
+        e = mn_reasm_find(ns->stripe_tbl, MN_STRIPE_PARENT(req->msg_id),
+                req->src_lp);
+    else
+        return;
+    e->num_chunks++;
 }
 
 /// bitfields used:
 /// c31 - we initiated a sched_next event
+/// c30 - the message was split across the send queues
+/// c29 - see select_rail
 void handle_new_msg(
         model_net_base_state * ns,
         tw_bf *b,
@@ -755,6 +1158,16 @@ void handle_new_msg(
         printf("r->src_lp:%llu, num_servers:%d num_queues:%d, offset:%d servers_per_node:%d\n",LLU(r->src_lp), num_servers, ns->params->num_queues, offset, servers_per_node);
 #endif
         queue_offset = (offset/servers_per_node) % ns->params->num_queues;
+
+        if (ns->params->rail_striping == MN_STRIPE_SPLIT && !r->is_pull &&
+                r->msg_size >= ns->params->rail_split_threshold &&
+                sizeof(model_net_wrap_msg) + MN_STRIPE_EVENT_SIZE +
+                r->remote_event_size <= g_tw_msg_sz &&
+                handle_split_msg(ns, m, remote, local, lp)){
+            b->c30 = 1;
+            return;
+        }
+        queue_offset = select_rail(ns, b, queue_offset);
     }
     r->queue_offset = queue_offset;
 #if DEBUG
@@ -772,6 +1185,8 @@ void handle_new_msg(
         &ns->in_sched_recv_loop : &ns->in_sched_send_loop[queue_offset];
     model_net_sched_add(r, &m->msg.m_base.sched_params, r->remote_event_size,
             remote, r->self_event_size, local, ss, &m->msg.m_base.rc, lp);
+    if (!is_from_remote)
+        ns->queued_bytes[queue_offset] += r->msg_size;
 
     if (*in_sched_loop == 0){
         b->c31 = 1;
@@ -807,6 +1222,10 @@ void handle_new_msg_rc(
         ns->next_available_time = m->msg.m_base.save_ts;
         return;
     }
+    if (b->c30) {
+        handle_split_msg_rc(ns, m, lp);
+        return;
+    }
     model_net_request *r = &m->msg.m_base.req;
     int is_from_remote = m->msg.m_base.is_from_remote;
     model_net_sched *ss = is_from_remote ? ns->sched_recv : ns->sched_send[r->queue_offset];
@@ -817,11 +1236,72 @@ void handle_new_msg_rc(
         handle_sched_next_rc(ns, b, m, lp);
         *in_sched_loop = 0;
     }
+    if (!is_from_remote)
+        ns->queued_bytes[r->queue_offset] -= r->msg_size;
     model_net_sched_add_rc(ss, &m->msg.m_base.rc, lp);
+    if (b->c29)
+        ns->next_rail = (ns->next_rail + ns->params->num_queues - 1) %
+            ns->params->num_queues;
+}
+
+/// A batch goes through the NIC sequencing of individual messages (the
+/// isQueueReq stage of handle_new_msg) entry by entry: entry i reaches the
+/// schedulers as a MN_BASE_NEW_MSG event at the time the i-th of as many
+/// model_net_event calls would, so only the events from the sender to the NIC
+/// are saved. Entry times strictly increase, hence the batch order is kept.
+void handle_new_batch(
+        model_net_base_state * ns,
+        tw_bf *b,
+        model_net_wrap_msg * m,
+        tw_lp * lp){
+    (void)b;
+    model_net_batch_hdr const *hdr = (model_net_batch_hdr const*)(m+1);
+    char const *p = (char const*)(m+1) + MN_BATCH_HDR_SIZE;
+
+    m->msg.m_base.save_ts = ns->next_available_time;
+    tw_stime exp_time = ns->next_available_time > tw_now(lp) ?
+        ns->next_available_time : tw_now(lp);
+    for (int i = 0; i < hdr->count; i++){
+        model_net_batch_item const *it = (model_net_batch_item const*)p;
+        p += MN_BATCH_ITEM_SIZE(it->remote_event_size, it->self_event_size);
+
+        exp_time += ns->params->nic_seq_delay + codes_local_latency(lp);
+        tw_event *e = tw_event_new(lp->gid, exp_time - tw_now(lp), lp);
+        model_net_wrap_msg *m_new = tw_event_data(e);
+        memcpy(m_new, m, sizeof(model_net_wrap_msg));
+        m_new->h.event_type = MN_BASE_NEW_MSG;
+        model_net_request *r = &m_new->msg.m_base.req;
+        r->final_dest_lp = it->final_dest_lp;
+        r->dest_mn_lp = it->dest_mn_lp;
+        r->msg_size = it->msg_size;
+        r->pull_size = 0;
+        r->is_pull = 0;
+        r->remote_event_size = it->remote_event_size;
+        r->self_event_size = it->self_event_size;
+        m_new->msg.m_base.sched_params = it->sched_params;
+        m_new->msg.m_base.isQueueReq = 0;
+        memcpy(m_new+1, it+1, it->remote_event_size + it->self_event_size);
+        tw_event_send(e);
+    }
+    ns->next_available_time = exp_time;
+}
+
+void handle_new_batch_rc(
+        model_net_base_state * ns,
+        tw_bf *b,
+        model_net_wrap_msg * m,
+        tw_lp * lp){
+    (void)b;
+    model_net_batch_hdr const *hdr = (model_net_batch_hdr const*)(m+1);
+    for (int i = 0; i < hdr->count; i++)
+        codes_local_latency_reverse(lp);
+    ns->next_available_time = m->msg.m_base.save_ts;
 }
 
 /// bitfields used
 /// c0 - scheduler loop is finished
+/// c3 - a message left a send queue
+/// c1, c2 - see stripe_sent
 void handle_sched_next(
         model_net_base_state * ns,
         tw_bf *b,
@@ -842,6 +1322,13 @@ void handle_sched_next(
 #if DEBUG
     printf("return value from model_net_sched_next(): %d in_sched_loop changing from %d to 0\n",ret,*in_sched_loop);
 #endif
+    if (ret == 1 && !is_from_remote){
+        model_net_request const *done = &m->msg.m_base.rc.req;
+        b->c3 = 1;
+        ns->queued_bytes[r->queue_offset] -= done->msg_size;
+        if (done->msg_id & MN_STRIPE_ID_BIT)
+            stripe_sent(ns, b, done, lp);
+    }
     if (ret == -1){
         b->c0 = 1;
         *in_sched_loop = 0;
@@ -875,13 +1362,68 @@ void handle_sched_next_rc(
     int *in_sched_loop = is_from_remote ?
         &ns->in_sched_recv_loop : &ns->in_sched_send_loop[r->queue_offset];
 
-    model_net_sched_next_rc(ss, m+1, &m->msg.m_base.rc, lp);
     if (b->c0){
         *in_sched_loop = 1;
     }
     else if (ns->net_id == SIMPLEP2P || ns->net_id == TORUS){
         codes_local_latency_reverse(lp);
     }
+    if (b->c3){
+        model_net_request const *done = &m->msg.m_base.rc.req;
+        if (done->msg_id & MN_STRIPE_ID_BIT)
+            stripe_sent_rc(ns, b, done, lp);
+        ns->queued_bytes[r->queue_offset] += done->msg_size;
+    }
+    model_net_sched_next_rc(ss, m+1, &m->msg.m_base.rc, lp);
+}
+
+/// bitfields used
+/// c0 - last stripe of the message, remote event issued
+void handle_stripe_done(
+        model_net_base_state * ns,
+        tw_bf *b,
+        model_net_wrap_msg * m,
+        tw_lp * lp){
+    model_net_stripe_msg const *s = &m->msg.m_stripe;
+    struct mn_reasm_table *t = stripe_table(ns);
+    rc_stack_gc(lp, ns->stripe_st);
+
+    struct mn_reasm_entry *e = mn_reasm_find(t, s->parent_id, s->src_mn_lp);
+    if (e == NULL)
+        e = mn_reasm_insert(t, s->parent_id, s->src_mn_lp);
+    e->num_chunks++;
+    if (s->remote_event_size > 0)
+        mn_reasm_set_remote_event(e, (char*)m + MN_STRIPE_EVENT_SIZE,
+                s->remote_event_size);
+    if (e->num_chunks == (uint64_t)s->num_stripes){
+        b->c0 = 1;
+        if (e->remote_event_size > 0){
+            tw_event *ev = tw_event_new(s->final_dest_lp,
+                    codes_local_latency(lp), lp);
+            memcpy(tw_event_data(ev), e->remote_event_data,
+                    e->remote_event_size);
+            tw_event_send(ev);
+        }
+        mn_reasm_complete(t, e, lp, ns->stripe_st);
+    }
+}
+
+void handle_stripe_done_rc(
+        model_net_base_state * ns,
+        tw_bf *b,
+        model_net_wrap_msg * m,
+        tw_lp * lp){
+    model_net_stripe_msg const *s = &m->msg.m_stripe;
+    struct mn_reasm_entry *e;
+    if (b->c0){
+        e = mn_reasm_complete_rc(ns->stripe_tbl, ns->stripe_st);
+        if (e->remote_event_size > 0)
+            codes_local_latency_reverse(lp);
+    }
+    else
+        e = mn_reasm_find(ns->stripe_tbl, s->parent_id, s->src_mn_lp);
+    if (--e->num_chunks == 0)
+        mn_reasm_discard(ns->stripe_tbl, e);
 }
 
 /**** END IMPLEMENTATIONS ****/
@@ -914,7 +1456,7 @@ void model_net_method_send_msg_recv_event(
         uint64_t pull_size,
         int remote_event_size,
         const mn_sched_params *sched_params,
-        const char * category,
+        int category,
         int net_id,
         void * msg,
         tw_stime offset,
@@ -944,8 +1486,7 @@ void model_net_method_send_msg_recv_event(
     r->self_event_size = 0;
     m->msg.m_base.is_from_remote = 1;
 
-    strncpy(r->category, category, CATEGORY_NAME_MAX-1);
-    r->category[CATEGORY_NAME_MAX-1] = '\0';
+    r->category = category;
 
     if (remote_event_size > 0){
         void * m_dat = model_net_method_get_edata(net_id, msg);
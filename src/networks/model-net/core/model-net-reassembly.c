@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2014 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <codes/model-net-reassembly.h>
+
+/* entries are carved out of slabs of this many entries */
+#define MN_REASM_SLAB_ENTRIES 64
+
+struct mn_reasm_slab
+{
+    struct mn_reasm_slab * next;
+    struct mn_reasm_entry entries[MN_REASM_SLAB_ENTRIES];
+};
+
+struct mn_reasm_table
+{
+    /* power-of-two array of entry pointers, NULL == empty slot */
+    struct mn_reasm_entry ** slots;
+    uint64_t mask;
+    int count;
+    struct mn_reasm_entry * free_list;
+    struct mn_reasm_slab * slabs;
+};
+
+static inline uint64_t reasm_hash(uint64_t message_id, tw_lpid sender_id)
+{
+    /* splitmix64 finalizer over both halves of the key */
+    uint64_t h = message_id * 0x9E3779B97F4A7C15ULL ^ (uint64_t)sender_id;
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h;
+}
+
+static inline uint64_t reasm_home(
+        struct mn_reasm_table const * t,
+        struct mn_reasm_entry const * e)
+{
+    return reasm_hash(e->message_id, e->sender_id) & t->mask;
+}
+
+static void reasm_link(struct mn_reasm_table * t, struct mn_reasm_entry * e);
+
+static void reasm_grow(struct mn_reasm_table * t)
+{
+    struct mn_reasm_entry ** old = t->slots;
+    uint64_t old_cap = t->mask + 1;
+
+    t->slots = calloc(old_cap * 2, sizeof(*t->slots));
+    assert(t->slots);
+    t->mask = old_cap * 2 - 1;
+    t->count = 0;
+    for (uint64_t i = 0; i < old_cap; i++) {
+        if (old[i])
+            reasm_link(t, old[i]);
+    }
+    free(old);
+}
+
+static void reasm_link(struct mn_reasm_table * t, struct mn_reasm_entry * e)
+{
+    /* keep the load factor at or below 1/2 so probe chains stay short */
+    if ((uint64_t)(t->count + 1) * 2 > t->mask + 1)
+        reasm_grow(t);
+
+    uint64_t i = reasm_home(t, e);
+    while (t->slots[i] != NULL)
+        i = (i + 1) & t->mask;
+    t->slots[i] = e;
+    t->count++;
+}
+
+static void reasm_unlink(struct mn_reasm_table * t, struct mn_reasm_entry * e)
+{
+    uint64_t i = reasm_home(t, e);
+    while (t->slots[i] != e) {
+        assert(t->slots[i] != NULL);
+        i = (i + 1) & t->mask;
+    }
+
+    /* backward-shift deletion: pull later members of the probe chain into
+     * the hole so lookups never need tombstones */
+    uint64_t j = i;
+    for (;;) {
+        j = (j + 1) & t->mask;
+        if (t->slots[j] == NULL)
+            break;
+        uint64_t k = reasm_home(t, t->slots[j]);
+        /* move slots[j] if its home position is not cyclically in (i, j] */
+        int stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+        if (!stays) {
+            t->slots[i] = t->slots[j];
+            i = j;
+        }
+    }
+    t->slots[i] = NULL;
+    t->count--;
+}
+
+static struct mn_reasm_entry * reasm_alloc(struct mn_reasm_table * t)
+{
+    if (t->free_list == NULL) {
+        struct mn_reasm_slab * slab = malloc(sizeof(*slab));
+        assert(slab);
+        slab->next = t->slabs;
+        t->slabs = slab;
+        for (int i = MN_REASM_SLAB_ENTRIES - 1; i >= 0; i--) {
+            slab->entries[i].next_free = t->free_list;
+            t->free_list = &slab->entries[i];
+        }
+    }
+    struct mn_reasm_entry * e = t->free_list;
+    t->free_list = e->next_free;
+    e->next_free = NULL;
+    return e;
+}
+
+static void reasm_release(void * ptr)
+{
+    struct mn_reasm_entry * e = ptr;
+    struct mn_reasm_table * t = e->owner;
+
+    if (e->remote_event_data && e->remote_event_data != e->inline_data)
+        free(e->remote_event_data);
+    e->remote_event_data = NULL;
+    e->next_free = t->free_list;
+    t->free_list = e;
+}
+
+struct mn_reasm_table * mn_reasm_create(int initial_size)
+{
+    struct mn_reasm_table * t = malloc(sizeof(*t));
+    assert(t);
+
+    uint64_t cap = 16;
+    while (cap < (uint64_t)initial_size * 2)
+        cap <<= 1;
+
+    t->slots = calloc(cap, sizeof(*t->slots));
+    assert(t->slots);
+    t->mask = cap - 1;
+    t->count = 0;
+    t->free_list = NULL;
+    t->slabs = NULL;
+    return t;
+}
+
+void mn_reasm_destroy(struct mn_reasm_table * t)
+{
+    if (!t)
+        return;
+
+    for (uint64_t i = 0; i <= t->mask; i++) {
+        struct mn_reasm_entry * e = t->slots[i];
+        if (e && e->remote_event_data && e->remote_event_data != e->inline_data)
+            free(e->remote_event_data);
+    }
+    while (t->slabs) {
+        struct mn_reasm_slab * next = t->slabs->next;
+        free(t->slabs);
+        t->slabs = next;
+    }
+    free(t->slots);
+    free(t);
+}
+
+int mn_reasm_count(struct mn_reasm_table const * t)
+{
+    return t->count;
+}
+
+struct mn_reasm_entry * mn_reasm_find(
+        struct mn_reasm_table * t,
+        uint64_t message_id,
+        tw_lpid sender_id)
+{
+    uint64_t i = reasm_hash(message_id, sender_id) & t->mask;
+    struct mn_reasm_entry * e;
+    while ((e = t->slots[i]) != NULL) {
+        if (e->message_id == message_id && e->sender_id == sender_id)
+            return e;
+        i = (i + 1) & t->mask;
+    }
+    return NULL;
+}
+
+struct mn_reasm_entry * mn_reasm_insert(
+        struct mn_reasm_table * t,
+        uint64_t message_id,
+        tw_lpid sender_id)
+{
+    assert(mn_reasm_find(t, message_id, sender_id) == NULL);
+
+    struct mn_reasm_entry * e = reasm_alloc(t);
+    e->message_id = message_id;
+    e->sender_id = sender_id;
+    e->num_chunks = 0;
+    e->remote_event_size = 0;
+    e->remote_event_data = NULL;
+    e->owner = t;
+    reasm_link(t, e);
+    return e;
+}
+
+void mn_reasm_set_remote_event(
+        struct mn_reasm_entry * e,
+        void const * data,
+        int size)
+{
+    if (size <= 0 || e->remote_event_data)
+        return;
+
+    if (size <= MN_REASM_INLINE_SIZE)
+        e->remote_event_data = e->inline_data;
+    else {
+        e->remote_event_data = malloc(size);
+        assert(e->remote_event_data);
+    }
+    memcpy(e->remote_event_data, data, size);
+    e->remote_event_size = size;
+}
+
+void mn_reasm_discard(struct mn_reasm_table * t, struct mn_reasm_entry * e)
+{
+    reasm_unlink(t, e);
+    reasm_release(e);
+}
+
+void mn_reasm_complete(
+        struct mn_reasm_table * t,
+        struct mn_reasm_entry * e,
+        tw_lp const * lp,
+        struct rc_stack * st)
+{
+    reasm_unlink(t, e);
+    rc_stack_push(lp, e, reasm_release, st);
+}
+
+struct mn_reasm_entry * mn_reasm_complete_rc(
+        struct mn_reasm_table * t,
+        struct rc_stack * st)
+{
+    struct mn_reasm_entry * e = rc_stack_pop(st);
+    assert(e->owner == t);
+    reasm_link(t, e);
+    return e;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
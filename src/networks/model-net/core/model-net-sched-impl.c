@@ -20,6 +20,15 @@
         if (MN_SCHED_DEBUG_VERBOSE) printf(_fmt, ##__VA_ARGS__); \
     } while(0)
 
+// remote + local events up to this size are stored in the queue item
+#ifndef MN_SCHED_INLINE_SIZE
+#define MN_SCHED_INLINE_SIZE 128
+#endif
+
+// item slabs start small (there is a pool per NIC queue) and double up to
+// this many items
+#define MN_SCHED_SLAB_MAX 256
+
 /// scheduler-specific data structures 
 
 typedef struct mn_sched_qitem {
@@ -32,16 +41,36 @@ typedef struct mn_sched_qitem {
     // sizes are given in the request struct
     void * remote_event;
     void * local_event;
-    struct qlist_head ql;
+    // backing store of both events: inline_data or a heap buffer
+    char * event_data;
+    struct qlist_head ql; // queue link, or free list link while pooled
+    char inline_data[MN_SCHED_INLINE_SIZE];
 } mn_sched_qitem;
 
+typedef struct mn_sched_slab {
+    struct mn_sched_slab *next;
+    mn_sched_qitem items[];
+} mn_sched_slab;
+
+// queue items are recycled through a pool, so add, next and their rc don't
+// touch malloc unless the events exceed MN_SCHED_INLINE_SIZE
+typedef struct mn_sched_pool {
+    struct qlist_head free_items;
+    mn_sched_slab *slabs;
+    int slab_items; // size of the next slab
+} mn_sched_pool;
+
 // fcfs and round-robin each use a single queue
 typedef struct mn_sched_queue {
     // method containing packet event to call
     const struct model_net_method *method;
     int is_recv_queue;
     int queue_len;
+    // packets issued per sched_next (1 unless packet trains are enabled)
+    int train_len;
     struct qlist_head reqs; // of type mn_sched_qitem
+    mn_sched_pool *pool;
+    int owns_pool;
 } mn_sched_queue;
 
 // priority scheduler consists of a bunch of rr/fcfs queues
@@ -51,6 +80,28 @@ typedef struct mn_sched_prio {
     mn_sched_queue ** sub_scheds; // one for each params.num_prios
 } mn_sched_prio;
 
+// drr and weighted-priority keep one fcfs queue per traffic class. Class
+// membership is tracked in bitmaps so picking the next class never scans
+// the (possibly many) idle classes
+typedef struct mn_sched_class {
+    const mn_class_params *params;
+    mn_sched_queue *queues;   // one for each params->num_classes
+    // drr: deficit, weighted-priority: remaining credit (bytes, may be
+    // negative when the last burst overshot)
+    int64_t *credit;
+    int64_t *quantum;         // weight * quantum per class
+    uint32_t active;          // bit i set when class i has requests queued
+    uint32_t eligible;        // weighted-priority: bit i set when credit[i] > 0
+    // drr: circular list of the active classes, head is being served
+    int *next, *prev;
+    int head;
+    int head_visited;         // head has received its quantum this round
+} mn_sched_class;
+
+// drr class_flags bits
+#define DRR_ROTATED 0x1
+#define DRR_FRESH   0x2
+
 /// scheduler-specific function decls and tables
 
 /// FCFS
@@ -142,6 +193,48 @@ static void prio_next_rc (
         const model_net_sched_rc * rc,
         tw_lp                    * lp);
 
+// DRR / WEIGHTED PRIORITY (shared init, destroy and add)
+static void class_init (
+        const struct model_net_method     * method,
+        const model_net_sched_cfg_params  * params,
+        int                                 is_recv_queue,
+        void                             ** sched);
+static void class_destroy (void *sched);
+static void class_add (
+        const model_net_request * req,
+        const mn_sched_params   * sched_params,
+        int                       remote_event_size,
+        void                    * remote_event,
+        int                       local_event_size,
+        void                    * local_event,
+        void                    * sched,
+        model_net_sched_rc      * rc,
+        tw_lp                   * lp);
+static void drr_add_rc(void *sched, const model_net_sched_rc *rc, tw_lp *lp);
+static int  drr_next(
+        tw_stime              * poffset,
+        void                  * sched,
+        void                  * rc_event_save,
+        model_net_sched_rc    * rc,
+        tw_lp                 * lp);
+static void drr_next_rc (
+        void                     * sched,
+        const void               * rc_event_save,
+        const model_net_sched_rc * rc,
+        tw_lp                    * lp);
+static void wprio_add_rc(void *sched, const model_net_sched_rc *rc, tw_lp *lp);
+static int  wprio_next(
+        tw_stime              * poffset,
+        void                  * sched,
+        void                  * rc_event_save,
+        model_net_sched_rc    * rc,
+        tw_lp                 * lp);
+static void wprio_next_rc (
+        void                     * sched,
+        const void               * rc_event_save,
+        const model_net_sched_rc * rc,
+        tw_lp                    * lp);
+
 /// function tables (names defined by X macro in model-net-sched.h)
 static const model_net_sched_interface fcfs_tab = 
 { &fcfs_init, &fcfs_destroy, &fcfs_add, &fcfs_add_rc, &fcfs_next, &fcfs_next_rc};
@@ -149,6 +242,10 @@ static const model_net_sched_interface rr_tab =
 { &rr_init, &rr_destroy, &rr_add, &rr_add_rc, &rr_next, &rr_next_rc};
 static const model_net_sched_interface prio_tab =
 { &prio_init, &prio_destroy, &prio_add, &prio_add_rc, &prio_next, &prio_next_rc};
+static const model_net_sched_interface drr_tab =
+{ &class_init, &class_destroy, &class_add, &drr_add_rc, &drr_next, &drr_next_rc};
+static const model_net_sched_interface wprio_tab =
+{ &class_init, &class_destroy, &class_add, &wprio_add_rc, &wprio_next, &wprio_next_rc};
 
 #define X(a,b,c) c,
 const model_net_sched_interface * sched_interfaces[] = {
@@ -158,22 +255,126 @@ const model_net_sched_interface * sched_interfaces[] = {
 
 /// FCFS implementation 
 
+// bytes issued per sched_next for a request: one packet, or a whole train
+static inline uint64_t fcfs_burst_size(
+        const mn_sched_queue    * s,
+        const model_net_request * req){
+    if (s->train_len > 1 && req->packet_size <= UINT64_MAX / s->train_len)
+        return req->packet_size * s->train_len;
+    return req->packet_size;
+}
+
+// bytes the next sched_next on a non-empty queue will issue
+static inline uint64_t fcfs_peek_size(const mn_sched_queue *s){
+    mn_sched_qitem *q = qlist_entry(s->reqs.next, mn_sched_qitem, ql);
+    uint64_t burst = fcfs_burst_size(s, &q->req);
+    return burst < q->rem ? burst : q->rem;
+}
+
+static mn_sched_pool * pool_create(void){
+    mn_sched_pool *p = malloc(sizeof(*p));
+    assert(p);
+    INIT_QLIST_HEAD(&p->free_items);
+    p->slabs = NULL;
+    p->slab_items = 4;
+    return p;
+}
+
+static void pool_destroy(mn_sched_pool *p){
+    while (p->slabs){
+        mn_sched_slab *next = p->slabs->next;
+        free(p->slabs);
+        p->slabs = next;
+    }
+    free(p);
+}
+
+// get an item with room for the given events (event pointers are NULL for
+// empty events)
+static mn_sched_qitem * qitem_alloc(
+        mn_sched_pool * p,
+        int             remote_event_size,
+        int             local_event_size){
+    if (qlist_empty(&p->free_items)){
+        mn_sched_slab *slab = malloc(sizeof(*slab) +
+                p->slab_items * sizeof(mn_sched_qitem));
+        assert(slab);
+        slab->next = p->slabs;
+        p->slabs = slab;
+        for (int i = 0; i < p->slab_items; i++)
+            qlist_add_tail(&slab->items[i].ql, &p->free_items);
+        if (p->slab_items < MN_SCHED_SLAB_MAX)
+            p->slab_items *= 2;
+    }
+    mn_sched_qitem *q = qlist_entry(qlist_pop(&p->free_items),
+            mn_sched_qitem, ql);
+
+    int size = remote_event_size + local_event_size;
+    if (size <= MN_SCHED_INLINE_SIZE)
+        q->event_data = q->inline_data;
+    else {
+        q->event_data = malloc(size);
+        assert(q->event_data);
+    }
+    q->remote_event = remote_event_size > 0 ? q->event_data : NULL;
+    q->local_event = local_event_size > 0 ?
+        q->event_data + remote_event_size : NULL;
+    return q;
+}
+
+static void qitem_release(mn_sched_pool *p, mn_sched_qitem *q){
+    if (q->event_data != q->inline_data)
+        free(q->event_data);
+    qlist_add(&q->ql, &p->free_items);
+}
+
+// set up a queue in place, drawing items from pool
+static void fcfs_queue_init(
+        mn_sched_queue                    * ss,
+        const struct model_net_method     * method,
+        const model_net_sched_cfg_params  * params,
+        int                                 is_recv_queue,
+        mn_sched_pool                     * pool){
+    ss->method = method;
+    ss->is_recv_queue = is_recv_queue;
+    ss->queue_len = 0;
+    // trains only make sense when packetizing sends to a model that accepts
+    // them
+    if (!is_recv_queue && method->mn_packet_trains &&
+            params->type != MN_SCHED_FCFS_FULL && params->train_len > 1)
+        ss->train_len = params->train_len;
+    else
+        ss->train_len = 1;
+    INIT_QLIST_HEAD(&ss->reqs);
+    ss->pool = pool;
+    ss->owns_pool = 0;
+}
+
+// release the queued items (the pool keeps their memory)
+static void fcfs_queue_clear(mn_sched_queue *ss){
+    while (!qlist_empty(&ss->reqs))
+        qitem_release(ss->pool, qlist_entry(qlist_pop(&ss->reqs),
+                    mn_sched_qitem, ql));
+    ss->queue_len = 0;
+}
+
 void fcfs_init(
         const struct model_net_method     * method, 
         const model_net_sched_cfg_params  * params,
         int                                 is_recv_queue,
         void                             ** sched){
-    (void)params; // unused for fcfs
     *sched = malloc(sizeof(mn_sched_queue));
     mn_sched_queue *ss = *sched;
-    ss->method = method;
-    ss->is_recv_queue = is_recv_queue;
-    ss->queue_len = 0;
-    INIT_QLIST_HEAD(&ss->reqs);
+    fcfs_queue_init(ss, method, params, is_recv_queue, pool_create());
+    ss->owns_pool = 1;
 }
 
 void fcfs_destroy(void *sched){
-    free(sched);
+    mn_sched_queue *ss = sched;
+    fcfs_queue_clear(ss);
+    if (ss->owns_pool)
+        pool_destroy(ss->pool);
+    free(ss);
 }
 
 void fcfs_add (
@@ -187,22 +388,18 @@ void fcfs_add (
         model_net_sched_rc      * rc,
         tw_lp                   * lp){
     (void)rc; // unneeded for fcfs
-    mn_sched_qitem *q = malloc(sizeof(mn_sched_qitem));
+    mn_sched_queue *s = sched;
+    mn_sched_qitem *q = qitem_alloc(s->pool,
+            remote_event_size > 0 ? remote_event_size : 0,
+            local_event_size > 0 ? local_event_size : 0);
     q->entry_time = tw_now(lp);
     q->req = *req;
     q->sched_params = *sched_params;
     q->rem = req->msg_size;
-    if (remote_event_size > 0){
-        q->remote_event = malloc(remote_event_size);
+    if (remote_event_size > 0)
         memcpy(q->remote_event, remote_event, remote_event_size);
-    }
-    else { q->remote_event = NULL; }
-    if (local_event_size > 0){
-        q->local_event = malloc(local_event_size);
+    if (local_event_size > 0)
         memcpy(q->local_event, local_event, local_event_size);
-    }
-    else { q->local_event = NULL; }
-    mn_sched_queue *s = sched;
     s->queue_len++;
     qlist_add_tail(&q->ql, &s->reqs);
     dprintf("%llu (mn):    adding %srequest from %llu to %llu, size %llu, at %lf\n",
@@ -219,10 +416,7 @@ void fcfs_add_rc(void *sched, const model_net_sched_rc *rc, tw_lp *lp){
     mn_sched_qitem *q = qlist_entry(ent, mn_sched_qitem, ql);
     dprintf("%llu (mn): rc adding request from %llu to %llu\n", LLU(lp->gid),
             LLU(q->req.src_lp), LLU(q->req.final_dest_lp));
-    // free'ing NULLs is a no-op 
-    free(q->remote_event);
-    free(q->local_event);
-    free(q);
+    qitem_release(s->pool, q);
 }
 
 int fcfs_next(
@@ -239,15 +433,16 @@ int fcfs_next(
     }
     mn_sched_qitem *q = qlist_entry(ent, mn_sched_qitem, ql);
 
-    // issue the next packet
+    // issue the next packet (or train of packets)
     int is_last_packet;
     uint64_t psize;
-    if (q->req.packet_size >= q->rem) {
+    uint64_t burst = fcfs_burst_size(s, &q->req);
+    if (burst >= q->rem) {
         psize = q->rem;
         is_last_packet = 1;
     }
     else{
-        psize = q->req.packet_size;
+        psize = burst;
         is_last_packet = 0;
     }
 
@@ -288,13 +483,11 @@ int fcfs_next(
         if (q->req.remote_event_size > 0){
             memcpy(e_dat, q->remote_event, q->req.remote_event_size);
             e_dat = (char*) e_dat + q->req.remote_event_size;
-            free(q->remote_event);
         }
         if (q->req.self_event_size > 0){
             memcpy(e_dat, q->local_event, q->req.self_event_size);
-            free(q->local_event);
         }
-        free(q);
+        qitem_release(s->pool, q);
         rc->rtn = 1;
     }
     else{
@@ -326,31 +519,26 @@ void fcfs_next_rc(
             // just get the front and increment rem
             mn_sched_qitem *q = qlist_entry(s->reqs.next, mn_sched_qitem, ql);
             // just increment rem
-            q->rem += q->req.packet_size;
+            q->rem += fcfs_burst_size(s, &q->req);
         }
         else if (rc->rtn == 1){
             // re-create the q item
-            mn_sched_qitem *q = malloc(sizeof(mn_sched_qitem));
-            assert(q);
+            mn_sched_qitem *q = qitem_alloc(s->pool,
+                    rc->req.remote_event_size > 0 ? rc->req.remote_event_size : 0,
+                    rc->req.self_event_size > 0 ? rc->req.self_event_size : 0);
             q->req = rc->req;
             q->sched_params = rc->sched_params;
-            q->rem = q->req.msg_size % q->req.packet_size;
-            // processed exactly a packet's worth of data
+            uint64_t burst = fcfs_burst_size(s, &q->req);
+            q->rem = q->req.msg_size % burst;
+            // processed exactly a packet's (or train's) worth of data
             if (q->rem == 0 && q->req.msg_size != 0){
-                q->rem = q->req.packet_size;
-            }
-            const void * e_dat = rc_event_save;
-            if (q->req.remote_event_size > 0){
-                q->remote_event = malloc(q->req.remote_event_size);
-                memcpy(q->remote_event, e_dat, q->req.remote_event_size);
-                e_dat = (const char*) e_dat + q->req.remote_event_size;
+                q->rem = burst;
             }
-            else { q->remote_event = NULL; }
-            if (q->req.self_event_size > 0) {
-                q->local_event = malloc(q->req.self_event_size);
-                memcpy(q->local_event, e_dat, q->req.self_event_size);
-            }
-            else { q->local_event = NULL; }
+            // events were saved back to back, as they are stored
+            int e_size = (q->remote_event ? q->req.remote_event_size : 0) +
+                (q->local_event ? q->req.self_event_size : 0);
+            if (e_size > 0)
+                memcpy(q->event_data, rc_event_save, e_size);
             // add back to front of list
             qlist_add(&q->ql, &s->reqs);
             s->queue_len++;
@@ -444,11 +632,10 @@ void prio_init (
 
 void prio_destroy (void *sched){
     mn_sched_prio *ss = sched;
-    for (int i = 0; i < ss->params.num_prios; i++){
+    for (int i = 0; i < ss->params.num_prios; i++)
         ss->sub_sched_iface->destroy(ss->sub_scheds[i]);
-        free(ss->sub_scheds);
-        free(ss);
-    }
+    free(ss->sub_scheds);
+    free(ss);
 }
 
 void prio_add (
@@ -521,6 +708,283 @@ void prio_next_rc (
     // else, no-op
 }
 
+/// DRR / WEIGHTED PRIORITY implementation
+
+void class_init (
+        const struct model_net_method     * method,
+        const model_net_sched_cfg_params  * params,
+        int                                 is_recv_queue,
+        void                             ** sched){
+    *sched = malloc(sizeof(mn_sched_class));
+    mn_sched_class *ss = *sched;
+    ss->params = &params->u.cls;
+    int n = ss->params->num_classes;
+    assert(n > 0 && n <= MN_SCHED_MAX_CLASSES);
+    ss->queues = malloc(n * sizeof(*ss->queues));
+    ss->credit = calloc(n, sizeof(*ss->credit));
+    ss->quantum = malloc(n * sizeof(*ss->quantum));
+    ss->next = malloc(n * sizeof(*ss->next));
+    ss->prev = malloc(n * sizeof(*ss->prev));
+    assert(ss->queues && ss->credit && ss->quantum && ss->next && ss->prev);
+    // all classes draw their items from one pool
+    mn_sched_pool *pool = pool_create();
+    for (int i = 0; i < n; i++){
+        fcfs_queue_init(&ss->queues[i], method, params, is_recv_queue, pool);
+        ss->quantum[i] = (int64_t)ss->params->quantum * ss->params->weights[i];
+        ss->next[i] = ss->prev[i] = -1;
+    }
+    ss->active = ss->eligible = 0;
+    ss->head = -1;
+    ss->head_visited = 0;
+}
+
+void class_destroy (void *sched){
+    mn_sched_class *ss = sched;
+    for (int i = 0; i < ss->params->num_classes; i++)
+        fcfs_queue_clear(&ss->queues[i]);
+    pool_destroy(ss->queues[0].pool);
+    free(ss->queues);
+    free(ss->credit);
+    free(ss->quantum);
+    free(ss->next);
+    free(ss->prev);
+    free(ss);
+}
+
+// class of a new request: explicit MN_SCHED_PARAM_PRIO, then the category
+// mapping, then the lowest class
+static int class_of(
+        const mn_sched_class    * ss,
+        const model_net_request * req,
+        const mn_sched_params   * sched_params,
+        tw_lp                   * lp){
+    int n = ss->params->num_classes;
+    int c = sched_params->prio;
+    if (c >= n)
+        tw_error(TW_LOC, "sched for lp %llu: invalid class (%d vs [%d,%d))",
+                LLU(lp->gid), c, 0, n);
+    if (c >= 0)
+        return c;
+    for (c = 0; c < n; c++){
+        if (ss->params->categories[c] == req->category)
+            return c;
+    }
+    return n-1;
+}
+
+// drr active list: a class joins at the tail (just before head)
+static void drr_link(mn_sched_class *ss, int c, int as_head){
+    if (ss->head == -1){
+        ss->next[c] = ss->prev[c] = c;
+        ss->head = c;
+    }
+    else {
+        int h = ss->head, t = ss->prev[h];
+        ss->next[c] = h;
+        ss->prev[c] = t;
+        ss->next[t] = c;
+        ss->prev[h] = c;
+        if (as_head)
+            ss->head = c;
+    }
+}
+
+static void drr_unlink(mn_sched_class *ss, int c){
+    if (ss->next[c] == c)
+        ss->head = -1;
+    else {
+        ss->next[ss->prev[c]] = ss->next[c];
+        ss->prev[ss->next[c]] = ss->prev[c];
+        if (ss->head == c)
+            ss->head = ss->next[c];
+    }
+    ss->next[c] = ss->prev[c] = -1;
+}
+
+static inline void wprio_set_credit(mn_sched_class *ss, int c, int64_t credit){
+    ss->credit[c] = credit;
+    if (credit > 0)
+        ss->eligible |= 1u << c;
+    else
+        ss->eligible &= ~(1u << c);
+}
+
+void class_add (
+        const model_net_request * req,
+        const mn_sched_params   * sched_params,
+        int                       remote_event_size,
+        void                    * remote_event,
+        int                       local_event_size,
+        void                    * local_event,
+        void                    * sched,
+        model_net_sched_rc      * rc,
+        tw_lp                   * lp){
+    mn_sched_class *ss = sched;
+    int c = class_of(ss, req, sched_params, lp);
+    dprintf("%llu (mn):    adding with class %d\n", LLU(lp->gid), c);
+    fcfs_add(req, sched_params, remote_event_size, remote_event,
+            local_event_size, local_event, &ss->queues[c], rc, lp);
+    if (!(ss->active & (1u << c))){
+        ss->active |= 1u << c;
+        // the list is only consulted by drr
+        drr_link(ss, c, 0);
+    }
+    rc->prio = c;
+}
+
+// a class that drains loses whatever credit it had left
+static void class_drained(mn_sched_class *ss, int c){
+    ss->active &= ~(1u << c);
+    drr_unlink(ss, c);
+    wprio_set_credit(ss, c, 0);
+}
+
+static void class_add_rc(void *sched, const model_net_sched_rc *rc, tw_lp *lp){
+    mn_sched_class *ss = sched;
+    int c = rc->prio;
+    dprintf("%llu (mn): rc adding with class %d\n", LLU(lp->gid), c);
+    fcfs_add_rc(&ss->queues[c], rc, lp);
+    // credit of an idle class is always 0, nothing else to restore
+    if (ss->queues[c].queue_len == 0)
+        class_drained(ss, c);
+}
+
+void drr_add_rc(void *sched, const model_net_sched_rc *rc, tw_lp *lp){
+    class_add_rc(sched, rc, lp);
+}
+
+void wprio_add_rc(void *sched, const model_net_sched_rc *rc, tw_lp *lp){
+    class_add_rc(sched, rc, lp);
+}
+
+int drr_next(
+        tw_stime              * poffset,
+        void                  * sched,
+        void                  * rc_event_save,
+        model_net_sched_rc    * rc,
+        tw_lp                 * lp){
+    mn_sched_class *ss = sched;
+    rc->class_flags = 0;
+    if (ss->head == -1){
+        rc->prio = -1;
+        rc->rtn = -1;
+        return -1;
+    }
+
+    // the head keeps the link while its deficit covers the next burst,
+    // otherwise the next class gets its turn
+    int c = ss->head;
+    uint64_t psize = fcfs_peek_size(&ss->queues[c]);
+    if (ss->head_visited && ss->credit[c] < (int64_t)psize){
+        ss->head = ss->next[c];
+        ss->head_visited = 0;
+        rc->class_flags |= DRR_ROTATED;
+        c = ss->head;
+        psize = fcfs_peek_size(&ss->queues[c]);
+    }
+    rc->class_credit = ss->credit[c];
+    if (!ss->head_visited){
+        // a quantum smaller than one burst is topped up, so a fresh visit
+        // always sends and next stays O(1)
+        ss->credit[c] += ss->quantum[c];
+        if (ss->credit[c] < (int64_t)psize)
+            ss->credit[c] = psize;
+        ss->head_visited = 1;
+        rc->class_flags |= DRR_FRESH;
+    }
+
+    int ret = fcfs_next(poffset, &ss->queues[c], rc_event_save, rc, lp);
+    ss->credit[c] -= psize;
+    if (ss->queues[c].queue_len == 0){
+        class_drained(ss, c);
+        ss->head_visited = 0;
+    }
+    rc->prio = c;
+    return ret;
+}
+
+void drr_next_rc (
+        void                     * sched,
+        const void               * rc_event_save,
+        const model_net_sched_rc * rc,
+        tw_lp                    * lp){
+    if (rc->prio == -1)
+        return;
+    mn_sched_class *ss = sched;
+    int c = rc->prio;
+    fcfs_next_rc(&ss->queues[c], rc_event_save, rc, lp);
+    if (!(ss->active & (1u << c))){
+        // drained by the call, was the head
+        ss->active |= 1u << c;
+        drr_link(ss, c, 1);
+    }
+    ss->credit[c] = rc->class_credit;
+    ss->head_visited = !(rc->class_flags & DRR_FRESH);
+    if (rc->class_flags & DRR_ROTATED){
+        ss->head = ss->prev[ss->head];
+        ss->head_visited = 1;
+    }
+}
+
+int wprio_next(
+        tw_stime              * poffset,
+        void                  * sched,
+        void                  * rc_event_save,
+        model_net_sched_rc    * rc,
+        tw_lp                 * lp){
+    mn_sched_class *ss = sched;
+    rc->class_flags = 0;
+    if (ss->active == 0){
+        rc->prio = -1;
+        rc->rtn = -1;
+        return -1;
+    }
+
+    // every backlogged class has spent its credit: start a new round. Credit
+    // never drops below minus one burst, so with the default quantum a
+    // single round suffices
+    while ((ss->active & ss->eligible) == 0){
+        for (uint32_t m = ss->active; m; m &= m - 1){
+            int i = __builtin_ctz(m);
+            wprio_set_credit(ss, i, ss->credit[i] + ss->quantum[i]);
+        }
+        rc->class_flags++;
+    }
+
+    int c = __builtin_ctz(ss->active & ss->eligible);
+    uint64_t psize = fcfs_peek_size(&ss->queues[c]);
+    rc->class_credit = ss->credit[c];
+    int ret = fcfs_next(poffset, &ss->queues[c], rc_event_save, rc, lp);
+    wprio_set_credit(ss, c, ss->credit[c] - (int64_t)psize);
+    if (ss->queues[c].queue_len == 0)
+        class_drained(ss, c);
+    rc->prio = c;
+    return ret;
+}
+
+void wprio_next_rc (
+        void                     * sched,
+        const void               * rc_event_save,
+        const model_net_sched_rc * rc,
+        tw_lp                    * lp){
+    if (rc->prio == -1)
+        return;
+    mn_sched_class *ss = sched;
+    int c = rc->prio;
+    fcfs_next_rc(&ss->queues[c], rc_event_save, rc, lp);
+    if (!(ss->active & (1u << c))){
+        ss->active |= 1u << c;
+        drr_link(ss, c, 0);
+    }
+    wprio_set_credit(ss, c, rc->class_credit);
+    for (int r = 0; r < rc->class_flags; r++){
+        for (uint32_t m = ss->active; m; m &= m - 1){
+            int i = __builtin_ctz(m);
+            wprio_set_credit(ss, i, ss->credit[i] - ss->quantum[i]);
+        }
+    }
+}
+
 /*
  * Local variables:
  *  c-indent-level: 4
@@ -184,7 +184,8 @@ void model_net_write_stats(tw_lpid lpid, struct mn_stats* stat)
     char id[19+CATEGORY_NAME_MAX+1];
     char data[1024];
 
-    sprintf(id, "model-net-category-%s", stat->category);
+    sprintf(id, "model-net-category-%s",
+            stat->category < 0 ? "all" : codes_category_name(stat->category));
     sprintf(data, "lp:%ld\tsend_count:%ld\tsend_bytes:%ld\tsend_time:%f\t"
         "recv_count:%ld\trecv_bytes:%ld\trecv_time:%f\tmax_event_size:%ld\n",
         (long)lpid,
@@ -209,11 +210,11 @@ void model_net_print_stats(tw_lpid lpid, mn_stats mn_stats_array[])
     struct mn_stats all;
 
     memset(&all, 0, sizeof(all));
-    sprintf(all.category, "all");
+    all.category = -1;
 
     for(i=0; i<CATEGORY_MAX; i++)
     {
-        if(strlen(mn_stats_array[i].category) > 0)
+        if(mn_stats_array[i].used)
         {
             all.send_count += mn_stats_array[i].send_count;
             all.send_bytes += mn_stats_array[i].send_bytes;
@@ -230,34 +231,12 @@ void model_net_print_stats(tw_lpid lpid, mn_stats mn_stats_array[])
     model_net_write_stats(lpid, &all);
 }
 
-struct mn_stats* model_net_find_stats(char const * category, mn_stats mn_stats_array[])
+struct mn_stats* model_net_find_stats(int category, mn_stats mn_stats_array[])
 {
-    int i;
-    int new_flag = 0;
-    int found_flag = 0;
-
-    for(i=0; i<CATEGORY_MAX; i++)
-    {
-        if(strlen(mn_stats_array[i].category) == 0)
-        {
-            found_flag = 1;
-            new_flag = 1;
-            break;
-        }
-        if(strcmp(category, mn_stats_array[i].category) == 0)
-        {
-            found_flag = 1;
-            new_flag = 0;
-            break;
-        }
-    }
-    assert(found_flag);
-
-    if(new_flag)
-    {
-        strcpy(mn_stats_array[i].category, category);
-    }
-    return(&mn_stats_array[i]);
+    assert(category >= 0 && category < CATEGORY_MAX);
+    mn_stats_array[category].category = category;
+    mn_stats_array[category].used = 1;
+    return(&mn_stats_array[category]);
 }
 
 static model_net_event_return model_net_noop_event(
@@ -366,8 +345,7 @@ static model_net_event_return model_net_event_impl_base(
     r->net_id = net_id;
     r->remote_event_size = remote_event_size;
     r->self_event_size = self_event_size;
-    strncpy(r->category, category, CATEGORY_NAME_MAX-1);
-    r->category[CATEGORY_NAME_MAX-1]='\0';
+    r->category = codes_category_id(category);
 
     if (is_msg_params_set[MN_MSG_PARAM_START_TIME])
         r->msg_start_time = start_time_param;
@@ -460,6 +438,170 @@ model_net_event_return model_net_event_mctx(
             sender);
 }
 
+// send the batch event holding entries [first, first+count) to src_mn_lp
+static void model_net_batch_flush(
+        int net_id,
+        char const * category,
+        struct model_net_batch_entry const * entries,
+        tw_lpid const * dest_mn_lps,
+        int first,
+        int count,
+        tw_lpid src_mn_lp,
+        tw_stime offset,
+        tw_lp *sender)
+{
+    tw_stime poffset = codes_local_latency(sender);
+    if (mn_in_sequence){
+        tw_stime tmp = mn_msg_offset;
+        mn_msg_offset += poffset;
+        poffset += tmp;
+    }
+
+    tw_event *e = tw_event_new(src_mn_lp, poffset+offset, sender);
+    model_net_wrap_msg *m = tw_event_data(e);
+    msg_set_header(model_net_base_magic, MN_BASE_NEW_BATCH, sender->gid, &m->h);
+
+    // fields shared by all entries
+    model_net_request *r = &m->msg.m_base.req;
+    memset(r, 0, sizeof(*r));
+    r->src_lp = sender->gid;
+    r->net_id = net_id;
+    r->category = codes_category_id(category);
+    if (is_msg_params_set[MN_MSG_PARAM_START_TIME])
+        r->msg_start_time = start_time_param;
+    else
+        r->msg_start_time = tw_now(sender);
+    m->msg.m_base.is_from_remote = 0;
+    m->msg.m_base.isQueueReq = 1;
+
+    model_net_batch_hdr *hdr = (model_net_batch_hdr*)(m+1);
+    char *p = (char*)(m+1) + MN_BATCH_HDR_SIZE;
+    hdr->count = 0;
+    for (int i = first; i < first+count; i++){
+        struct model_net_batch_entry const *ent = &entries[i];
+        // node-local entries were sent on their own
+        if (dest_mn_lps[i] == src_mn_lp)
+            continue;
+        model_net_batch_item *it = (model_net_batch_item*)p;
+        it->final_dest_lp = ent->final_dest_lp;
+        it->dest_mn_lp = dest_mn_lps[i];
+        it->msg_size = ent->message_size;
+        if (ent->sched_params)
+            it->sched_params = *ent->sched_params;
+        else if (is_msg_params_set[MN_MSG_PARAM_SCHED])
+            it->sched_params = sched_params;
+        else
+            model_net_sched_set_default_params(&it->sched_params);
+        it->remote_event_size = ent->remote_event_size;
+        it->self_event_size = ent->self_event_size;
+        char *e_msg = (char*)(it+1);
+        if (ent->remote_event_size > 0){
+            memcpy(e_msg, ent->remote_event, ent->remote_event_size);
+            e_msg += ent->remote_event_size;
+        }
+        if (ent->self_event_size > 0)
+            memcpy(e_msg, ent->self_event, ent->self_event_size);
+        p += MN_BATCH_ITEM_SIZE(ent->remote_event_size, ent->self_event_size);
+        hdr->count++;
+    }
+    tw_event_send(e);
+}
+
+model_net_event_return model_net_event_batch_mctx(
+        int net_id,
+        struct codes_mctx const * send_map_ctx,
+        struct codes_mctx const * recv_map_ctx,
+        char const * category,
+        int n,
+        struct model_net_batch_entry const * entries,
+        tw_stime offset,
+        tw_lp *sender)
+{
+    model_net_event_return num_rng_calls = 0;
+    tw_lpid src_mn_lp = model_net_find_local_device_mctx(net_id, send_map_ctx,
+            sender->gid);
+
+    // message params apply to every entry: keep them across the
+    // model_net_event calls below, which clear them
+    int params_set[MAX_MN_MSG_PARAM_TYPES];
+    mn_sched_params sp_saved = sched_params;
+    memcpy(params_set, is_msg_params_set, sizeof(params_set));
+
+    tw_lpid *dest_mn_lps = malloc(n * sizeof(*dest_mn_lps));
+    assert(n == 0 || dest_mn_lps);
+
+    size_t base_sz = sizeof(model_net_wrap_msg) + MN_BATCH_HDR_SIZE;
+    size_t batch_sz = base_sz;
+    int first = 0, pending = 0;
+    for (int i = 0; i < n; i++){
+        struct model_net_batch_entry const *ent = &entries[i];
+        dest_mn_lps[i] = model_net_find_local_device_mctx(net_id,
+                recv_map_ctx, ent->final_dest_lp);
+        if (dest_mn_lps[i] == src_mn_lp){
+            // node-local message: take the regular path
+            memcpy(is_msg_params_set, params_set, sizeof(params_set));
+            sched_params = sp_saved;
+            if (ent->sched_params){
+                is_msg_params_set[MN_MSG_PARAM_SCHED] = 1;
+                sched_params = *ent->sched_params;
+            }
+            num_rng_calls += model_net_event_impl_base(net_id, send_map_ctx,
+                    recv_map_ctx, category, ent->final_dest_lp,
+                    ent->message_size, 0, offset, ent->remote_event_size,
+                    ent->remote_event, ent->self_event_size, ent->self_event,
+                    sender);
+            continue;
+        }
+
+        size_t item_sz = MN_BATCH_ITEM_SIZE(ent->remote_event_size,
+                ent->self_event_size);
+        if (base_sz + item_sz > g_tw_msg_sz ||
+                ent->remote_event_size + ent->self_event_size +
+                sizeof(model_net_wrap_msg) > g_tw_msg_sz){
+            tw_error(TW_LOC, "Error: model_net batch entry of size %zd "
+                    "doesn't fit ROSS events of size %zd\n",
+                    base_sz + item_sz, g_tw_msg_sz);
+        }
+        if (batch_sz + item_sz > g_tw_msg_sz){
+            memcpy(is_msg_params_set, params_set, sizeof(params_set));
+            sched_params = sp_saved;
+            model_net_batch_flush(net_id, category, entries, dest_mn_lps,
+                    first, i - first, src_mn_lp, offset, sender);
+            num_rng_calls++;
+            first = i;
+            pending = 0;
+            batch_sz = base_sz;
+        }
+        batch_sz += item_sz;
+        pending++;
+    }
+    if (pending){
+        memcpy(is_msg_params_set, params_set, sizeof(params_set));
+        sched_params = sp_saved;
+        model_net_batch_flush(net_id, category, entries, dest_mn_lps,
+                first, n - first, src_mn_lp, offset, sender);
+        num_rng_calls++;
+    }
+    free(dest_mn_lps);
+
+    // once params are set, clear the flags
+    memset(is_msg_params_set, 0,
+            MAX_MN_MSG_PARAM_TYPES*sizeof(*is_msg_params_set));
+    return num_rng_calls;
+}
+
+model_net_event_return model_net_event_batch(
+        int net_id,
+        char const * category,
+        int n,
+        struct model_net_batch_entry const * entries,
+        tw_stime offset,
+        tw_lp *sender)
+{
+    return model_net_event_batch_mctx(net_id, CODES_MCTX_DEFAULT,
+            CODES_MCTX_DEFAULT, category, n, entries, offset, sender);
+}
+
 model_net_event_return model_net_pull_event(
         int net_id,
         char const *category,
@@ -605,7 +747,7 @@ void model_net_event_collective(int net_id, char const * category, int message_s
        fprintf(stderr, "%s Error: Uninitializied modelnet network, call modelnet_init first\n", __FUNCTION__);
        exit(-1);
      }
-  return method_array[net_id]->mn_collective_call(category, message_size, remote_event_size, remote_event, sender);
+  return method_array[net_id]->mn_collective_call(codes_category_id(category), message_size, remote_event_size, remote_event, sender);
 }
 
 /* reverse event of the collective operation call */
@@ -19,8 +19,8 @@
 #include "codes/model-net-lp.h"
 #include "codes/net/dragonfly.h"
 #include "sys/file.h"
-#include "codes/quickhash.h"
 #include "codes/rc-stack.h"
+#include "codes/model-net-reassembly.h"
 
 #ifdef ENABLE_CORTEX
 #include <cortex/cortex.h>
@@ -37,7 +37,6 @@
 #define COLLECTIVE_COMPUTATION_DELAY 5700
 #define DRAGONFLY_FAN_OUT_DELAY 20.0
 #define WINDOW_LENGTH 0
-#define DFLY_HASH_TABLE_SIZE 4999
 
 // debugging parameters
 #define TRACK -1
@@ -144,12 +143,6 @@ struct dragonfly_param
     double router_delay;
 };
 
-struct dfly_hash_key
-{
-    uint64_t message_id;
-    tw_lpid sender_id;
-};
-
 struct dfly_router_sample
 {
     tw_lpid router_id;
@@ -173,15 +166,6 @@ struct dfly_cn_sample
    long rev_events;
 };
 
-struct dfly_qhash_entry
-{
-   struct dfly_hash_key key;
-   char * remote_event_data;
-   uint64_t num_chunks;
-   int remote_event_size;
-   struct qhash_head hash_link;
-};
-
 /* handles terminal and router events like packet generate/send/receive/buffer */
 typedef enum event_t event_t;
 typedef struct terminal_state terminal_state;
@@ -242,8 +226,7 @@ struct terminal_state
    const char * anno;
    dragonfly_param *params;
 
-   struct qhash_table *rank_tbl;
-   uint64_t rank_tbl_pop;
+   struct mn_reasm_table *rank_tbl;
 
    tw_stime   total_time;
    uint64_t total_msg_size;
@@ -414,33 +397,6 @@ static long long       total_msg_sz = 0;
 static long long       N_finished_msgs = 0;
 static long long       N_finished_chunks = 0;
 
-static int dragonfly_rank_hash_compare(
-        void *key, struct qhash_head *link)
-{
-    struct dfly_hash_key *message_key = (struct dfly_hash_key *)key;
-    struct dfly_qhash_entry *tmp = NULL;
-
-    tmp = qhash_entry(link, struct dfly_qhash_entry, hash_link);
-    
-    if (tmp->key.message_id == message_key->message_id
-            && tmp->key.sender_id == message_key->sender_id)
-        return 1;
-
-    return 0;
-}
-static int dragonfly_hash_func(void *k, int table_size)
-{
-    struct dfly_hash_key *tmp = (struct dfly_hash_key *)k;
-    //uint32_t pc = 0, pb = 0;	
-    //bj_hashlittle2(tmp, sizeof(*tmp), &pc, &pb);
-    uint64_t key = (~tmp->message_id) + (tmp->message_id << 18);
-    key = key * 21;
-    key = ~key ^ (tmp->sender_id >> 4);
-    key = key * tmp->sender_id; 
-    return (int)(key & (table_size - 1));
-    //return (int)(pc % (table_size - 1));
-}
-
 /* convert GiB/s and bytes to ns */
 static tw_stime bytes_to_ns(uint64_t bytes, double GB_p_s)
 {
@@ -462,16 +418,6 @@ static int dragonfly_get_msg_sz(void)
 	   return sizeof(terminal_message);
 }
 
-static void free_tmp(void * ptr)
-{
-    struct dfly_qhash_entry * dfly = ptr; 
-    
-    if(dfly->remote_event_data)
-        free(dfly->remote_event_data);
-   
-    if(dfly)
-        free(dfly);
-}
 static void append_to_terminal_message_list(  
         terminal_message_list ** thisq,
         terminal_message_list ** thistail,
@@ -1101,7 +1047,7 @@ static tw_stime dragonfly_packet_event(
     //msg = tw_event_data(e_new);
     e_new = model_net_method_event_new(sender->gid, xfer_to_nic_time+offset,
             sender, DRAGONFLY, (void**)&msg, (void**)&tmp_ptr);
-    strcpy(msg->category, req->category);
+    msg->category = req->category;
     msg->final_dest_gid = req->final_dest_lp;
     msg->total_size = req->msg_size;
     msg->sender_lp=req->src_lp;
@@ -1581,15 +1527,8 @@ static void packet_arrive_rc(terminal_state * s, tw_bf * bf, terminal_message *
        s->fin_chunks_time_ross_sample = msg->saved_fin_chunks_ross;
        s->total_time = msg->saved_avg_time;
       
-      struct qhash_head * hash_link = NULL;
-      struct dfly_qhash_entry * tmp = NULL; 
-      
-      struct dfly_hash_key key;
-      key.message_id = msg->message_id;
-      key.sender_id = msg->sender_lp;
-      
-      hash_link = qhash_search(s->rank_tbl, &key);
-      tmp = qhash_entry(hash_link, struct dfly_qhash_entry, hash_link);
+      struct mn_reasm_entry * tmp =
+          mn_reasm_find(s->rank_tbl, msg->message_id, msg->sender_lp);
       
       mn_stats* stat;
       stat = model_net_find_stats(msg->category, s->dragonfly_stats_array);
@@ -1607,7 +1546,6 @@ static void packet_arrive_rc(terminal_state * s, tw_bf * bf, terminal_message *
        
        if(bf->c7)
         {
-            //assert(!hash_link);
             if(bf->c8) 
               tw_rand_reverse_unif(lp->rng);
             N_finished_msgs--;
@@ -1618,15 +1556,7 @@ static void packet_arrive_rc(terminal_state * s, tw_bf * bf, terminal_message *
             s->ross_sample.data_size_sample -= msg->total_size;
             s->data_size_ross_sample -= msg->total_size;
 
-	        struct dfly_qhash_entry * d_entry_pop = rc_stack_pop(s->st);
-            qhash_add(s->rank_tbl, &key, &(d_entry_pop->hash_link));
-            s->rank_tbl_pop++; 
-
-            if(s->rank_tbl_pop >= DFLY_HASH_TABLE_SIZE)
-                tw_error(TW_LOC, "\n Exceeded allocated qhash size, increase hash size in dragonfly model");
-
-            hash_link = &(d_entry_pop->hash_link);
-            tmp = d_entry_pop; 
+            tmp = mn_reasm_complete_rc(s->rank_tbl, s->st);
 
             if(bf->c4)
                 model_net_event_rc2(lp, &msg->event_rc);
@@ -1636,12 +1566,8 @@ static void packet_arrive_rc(terminal_state * s, tw_bf * bf, terminal_message *
        tmp->num_chunks--;
 
    if(bf->c5)
-	{
-	   qhash_del(hash_link);
-	   free_tmp(tmp);	
-       s->rank_tbl_pop--;
-	}
-       return;
+       mn_reasm_discard(s->rank_tbl, tmp);
+   return;
 }
 static void send_remote_event(terminal_state * s, terminal_message * msg, tw_lp * lp, tw_bf * bf, char * event_data, int remote_event_size)
 {
@@ -1659,7 +1585,7 @@ static void send_remote_event(terminal_state * s, terminal_message * msg, tw_lp
 
             model_net_set_msg_param(MN_MSG_PARAM_START_TIME, MN_MSG_PARAM_START_TIME_VAL, &(msg->msg_start_time));
             
-            msg->event_rc = model_net_event_mctx(net_id, &mc_src, &mc_dst, msg->category,
+            msg->event_rc = model_net_event_mctx(net_id, &mc_src, &mc_dst, codes_category_name(msg->category),
                     msg->sender_lp, msg->pull_size, ts,
                     remote_event_size, tmp_ptr, 0, NULL, lp);
         }
@@ -1679,19 +1605,10 @@ static void packet_arrive(terminal_state * s, tw_bf * bf, terminal_message * msg
     // Trigger an event on receiving server
 
     if(!s->rank_tbl)
-        s->rank_tbl = qhash_init(dragonfly_rank_hash_compare, dragonfly_hash_func, DFLY_HASH_TABLE_SIZE);
+        s->rank_tbl = mn_reasm_create(MN_REASM_INITIAL_SIZE);
     
-    struct dfly_hash_key key;
-    key.message_id = msg->message_id; 
-    key.sender_id = msg->sender_lp;
-    
-    struct qhash_head *hash_link = NULL;
-    struct dfly_qhash_entry * tmp = NULL;
-      
-    hash_link = qhash_search(s->rank_tbl, &key);
-    
-    if(hash_link)
-        tmp = qhash_entry(hash_link, struct dfly_qhash_entry, hash_link);
+    struct mn_reasm_entry * tmp =
+        mn_reasm_find(s->rank_tbl, msg->message_id, msg->sender_lp);
 
     uint64_t total_chunks = msg->total_size / s->params->chunk_size;
 
@@ -1813,19 +1730,7 @@ static void packet_arrive(terminal_state * s, tw_bf * bf, terminal_message * msg
    if(!tmp)
    {
         bf->c5 = 1;
-       struct dfly_qhash_entry * d_entry = malloc(sizeof (struct dfly_qhash_entry));
-       d_entry->num_chunks = 0;
-       d_entry->key = key;
-       d_entry->remote_event_data = NULL;
-       d_entry->remote_event_size = 0;
-       qhash_add(s->rank_tbl, &key, &(d_entry->hash_link));
-       s->rank_tbl_pop++;
-            
-       if(s->rank_tbl_pop >= DFLY_HASH_TABLE_SIZE)
-            tw_error(TW_LOC, "\n Exceeded allocated qhash size, increase hash size in dragonfly model");
-      
-       hash_link = &(d_entry->hash_link);
-       tmp = d_entry;
+       tmp = mn_reasm_insert(s->rank_tbl, msg->message_id, msg->sender_lp);
    }
     
     assert(tmp);
@@ -1841,14 +1746,7 @@ static void packet_arrive(terminal_state * s, tw_bf * bf, terminal_message * msg
         s->finished_packets++;
     }
     /* if its the last chunk of the packet then handle the remote event data */
-    if(msg->remote_event_size_bytes > 0 && !tmp->remote_event_data)
-    {
-        /* Retreive the remote event entry */
-         tmp->remote_event_data = (void*)malloc(msg->remote_event_size_bytes);
-         assert(tmp->remote_event_data);
-         tmp->remote_event_size = msg->remote_event_size_bytes; 
-         memcpy(tmp->remote_event_data, m_data_src, msg->remote_event_size_bytes);
-    }
+    mn_reasm_set_remote_event(tmp, m_data_src, msg->remote_event_size_bytes);
         if (dragonfly_max_latency < tw_now( lp ) - msg->travel_start_time) {
           bf->c3 = 1;
           msg->saved_available_time = dragonfly_max_latency;
@@ -1876,15 +1774,13 @@ static void packet_arrive(terminal_state * s, tw_bf * bf, terminal_message * msg
         }
         
         /* Remove the hash entry */
-        qhash_del(hash_link);
-        rc_stack_push(lp, tmp, free_tmp, s->st);
-        s->rank_tbl_pop--;
+        mn_reasm_complete(s->rank_tbl, tmp, lp, s->st);
    }
   return;
 }
 
 /* collective operation for the torus network */
-static void dragonfly_collective(char const * category, int message_size, int remote_event_size, const void* remote_event, tw_lp* sender)
+static void dragonfly_collective(int category, int message_size, int remote_event_size, const void* remote_event, tw_lp* sender)
 {
     tw_event * e_new;
     tw_stime xfer_to_nic_time;
@@ -1902,7 +1798,7 @@ static void dragonfly_collective(char const * category, int message_size, int re
             sender, DRAGONFLY, (void**)&msg, (void**)&tmp_ptr);
 
     msg->remote_event_size_bytes = message_size;
-    strcpy(msg->category, category);
+    msg->category = category;
     msg->sender_svr=sender->gid;
     msg->type = D_COLLECTIVE_INIT;
 
@@ -2658,10 +2554,9 @@ dragonfly_terminal_final( terminal_state * s,
     //if(s->packet_gen != s->packet_fin)
     //    printf("\n generated %d finished %d ", s->packet_gen, s->packet_fin);
    
-    if(s->rank_tbl)
-        qhash_finalize(s->rank_tbl);
-    
+    /* completed entries on the rc stack belong to the table's pool */
     rc_stack_destroy(s->st);
+    mn_reasm_destroy(s->rank_tbl);
     free(s->vc_occupancy);
     free(s->terminal_msgs);
     free(s->terminal_msgs_tail);
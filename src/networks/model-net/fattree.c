@@ -8,8 +8,8 @@
 #include "codes/model-net-lp.h"
 #include "codes/net/fattree.h"
 #include "sys/file.h"
-#include "codes/quickhash.h"
 #include "codes/rc-stack.h"
+#include "codes/model-net-reassembly.h"
 #include <ctype.h>
 #include <search.h>
 
@@ -22,7 +22,6 @@
 #define MEAN_PROCESS 1.0
 
 #define TERMINAL_GUID_PREFIX ((uint64_t)(64) << 32)
-#define FTREE_HASH_TABLE_SIZE 4999
 
 // debugging parameters
 #define TRACK_PKT -1
@@ -163,21 +162,6 @@ struct fattree_param
   int ports_per_nic;
 };
 
-struct ftree_hash_key
-{
-    uint64_t message_id;
-    tw_lpid sender_id;
-};
-
-struct ftree_qhash_entry
-{
-   struct ftree_hash_key key;
-   char * remote_event_data;
-   int num_chunks;
-   int remote_event_size;
-   struct qhash_head hash_link;
-};
-
 /* handles terminal and switch events like packet generate/send/receive/buffer */
 typedef enum event_t event_t;
 typedef struct ft_terminal_state ft_terminal_state;
@@ -212,8 +196,7 @@ struct ft_terminal_state
   char * anno;
   fattree_param *params;
 
-  struct qhash_table *rank_tbl;
-  uint64_t rank_tbl_pop;
+  struct mn_reasm_table *rank_tbl;
 
   tw_stime   total_time;
   uint64_t total_msg_size;
@@ -348,37 +331,6 @@ static long long       total_msg_sz = 0;
 static long long       N_finished_msgs = 0;
 static long long       N_finished_chunks = 0;
 
-static int fattree_rank_hash_compare(
-void *key, struct qhash_head *link)
-{
-    struct ftree_hash_key *message_key = (struct ftree_hash_key *)key;
-    struct ftree_qhash_entry *tmp = NULL;
-
-    tmp = qhash_entry(link, struct ftree_qhash_entry, hash_link);
-
-    if (tmp->key.message_id == message_key->message_id
-            && tmp->key.sender_id == message_key->sender_id)
-        return 1;
-
-    return 0;
-}
-static int fattree_hash_func(void *k, int table_size)
-{
-    struct ftree_hash_key *tmp = (struct ftree_hash_key *)k;
-    uint64_t key = (~tmp->message_id) + (tmp->message_id << 18);
-    key = key * 21;
-    key = ~key ^ (tmp->sender_id >> 4);
-    key = key * tmp->sender_id;
-    return (int)(key & (table_size - 1));
-}
-
-static void free_tmp(void * ptr)
-{
-    struct ftree_qhash_entry * ftree = ptr;
-    free(ftree->remote_event_data);
-    free(ftree);
-}
-
 static void append_to_fattree_message_list(
         fattree_message_list ** thisq,
         fattree_message_list ** thistail,
@@ -1543,7 +1495,7 @@ static tw_stime fattree_packet_event(
   xfer_to_nic_time = codes_local_latency(sender);
   e_new = model_net_method_event_new(sender->gid, xfer_to_nic_time + offset,
       sender, FATTREE, (void**)&msg, (void**)&tmp_ptr);
-  strcpy(msg->category, req->category);
+  msg->category = req->category;
   msg->final_dest_gid = req->final_dest_lp;
   msg->total_size = req->msg_size;
   msg->sender_lp = req->src_lp;
@@ -2370,7 +2322,7 @@ void ft_send_remote_event(ft_terminal_state * s, fattree_message * msg, tw_lp *
 
             model_net_set_msg_param(MN_MSG_PARAM_START_TIME, MN_MSG_PARAM_START_TIME_VAL, &(msg->msg_start_time));
 
-            msg->event_rc = model_net_event_mctx(net_id, &mc_src, &mc_dst, msg->category,
+            msg->event_rc = model_net_event_mctx(net_id, &mc_src, &mc_dst, codes_category_name(msg->category),
                     msg->sender_lp, msg->pull_size, ts,
                     remote_event_size, tmp_ptr, 0, NULL, lp);
         }
@@ -2409,15 +2361,8 @@ void ft_packet_arrive_rc(ft_terminal_state * s, tw_bf * bf, fattree_message * ms
     s->total_hops -= msg->my_N_hop;
     s->fin_hops_sample -= msg->my_N_hop;
 
-    struct qhash_head * hash_link = NULL;
-    struct ftree_qhash_entry * tmp = NULL;
-
-    struct ftree_hash_key key;
-    key.message_id = msg->message_id;
-    key.sender_id = msg->sender_lp;
-
-    hash_link = qhash_search(s->rank_tbl, &key);
-    tmp = qhash_entry(hash_link, struct ftree_qhash_entry, hash_link);
+    struct mn_reasm_entry * tmp =
+        mn_reasm_find(s->rank_tbl, msg->message_id, msg->sender_lp);
 
     mn_stats* stat;
     stat = model_net_find_stats(msg->category, s->fattree_stats_array);
@@ -2445,26 +2390,15 @@ void ft_packet_arrive_rc(ft_terminal_state * s, tw_bf * bf, fattree_message * ms
       total_msg_sz -= msg->total_size;
       s->total_msg_size -= msg->total_size;
 
-      struct ftree_qhash_entry * d_entry_pop = rc_stack_pop(s->st);
-      qhash_add(s->rank_tbl, &key, &(d_entry_pop->hash_link));
-      s->rank_tbl_pop++;
-            
-      if(s->rank_tbl_pop >= FTREE_HASH_TABLE_SIZE)
-         tw_error(TW_LOC, "\n Exceeded allocated qhash size, increase hash size in fattree model");
-
-      hash_link = &(d_entry_pop->hash_link);
-      tmp = d_entry_pop;
+      tmp = mn_reasm_complete_rc(s->rank_tbl, s->st);
 
       //            if(bf->c4)
       //                model_net_event_rc2(lp, &msg->event_rc);
     }
     assert(tmp);
     tmp->num_chunks--;
-    if(tmp->num_chunks == 0) {
-      qhash_del(hash_link);
-      s->rank_tbl_pop--;
-      free_tmp(tmp);
-    }
+    if(tmp->num_chunks == 0)
+      mn_reasm_discard(s->rank_tbl, tmp);
 }
 
 /* packet arrives at the destination terminal */
@@ -2472,11 +2406,7 @@ void ft_packet_arrive(ft_terminal_state * s, tw_bf * bf, fattree_message * msg,
     tw_lp * lp) {
 
   if(!s->rank_tbl)  
-    s->rank_tbl = qhash_init(fattree_rank_hash_compare, fattree_hash_func, FTREE_HASH_TABLE_SIZE);
-  //Establish msg hash keys
-  struct ftree_hash_key key;
-  key.message_id = msg->message_id;
-  key.sender_id = msg->sender_lp;
+    s->rank_tbl = mn_reasm_create(MN_REASM_INITIAL_SIZE);
   //Compute total number of chuncks to expect for the message
   uint64_t total_chunks = msg->total_size / s->params->chunk_size;
   //If total chunks doesn't divid evenly then add one extra for left over
@@ -2574,32 +2504,16 @@ void ft_packet_arrive(ft_terminal_state * s, tw_bf * bf, fattree_message * msg,
 /* Now retrieve the number of chunks completed from the hash and update them */
    void *m_data_src = model_net_method_get_edata(FATTREE, msg);
 
-   struct qhash_head *hash_link = NULL;
-   struct ftree_qhash_entry * tmp = NULL;
-
-   hash_link = qhash_search(s->rank_tbl, &key);
+   struct mn_reasm_entry * tmp =
+       mn_reasm_find(s->rank_tbl, msg->message_id, msg->sender_lp);
 
    /* If an entry does not exist then create one */
-   if(!hash_link)
+   if(!tmp)
    {
        bf->c5 = 1;
-       struct ftree_qhash_entry * d_entry = malloc(sizeof (struct ftree_qhash_entry));
-       d_entry->num_chunks = 0;
-       d_entry->key = key;
-       d_entry->remote_event_data = NULL;
-       d_entry->remote_event_size = 0;
-       qhash_add(s->rank_tbl, &key, &(d_entry->hash_link));
-       s->rank_tbl_pop++;
-            
-       if(s->rank_tbl_pop >= FTREE_HASH_TABLE_SIZE)
-           tw_error(TW_LOC, "\n Exceeded allocated qhash size, increase hash size in fattree model");
-
-       hash_link = &(d_entry->hash_link);
+       tmp = mn_reasm_insert(s->rank_tbl, msg->message_id, msg->sender_lp);
    }
 
-    if(hash_link)
-        tmp = qhash_entry(hash_link, struct ftree_qhash_entry, hash_link);
-
     assert(tmp);
     tmp->num_chunks++;
 
@@ -2614,14 +2528,7 @@ void ft_packet_arrive(ft_terminal_state * s, tw_bf * bf, fattree_message * msg,
         s->finished_packets++;
     }
     // If it's the main chunk of the packet then handle the remote event data
-    if(msg->remote_event_size_bytes > 0 && !tmp->remote_event_data)
-    {
-        /* Retreive the remote event entry */
-         tmp->remote_event_data = (void*)malloc(msg->remote_event_size_bytes);
-         assert(tmp->remote_event_data);
-         tmp->remote_event_size = msg->remote_event_size_bytes;
-         memcpy(tmp->remote_event_data, m_data_src, msg->remote_event_size_bytes);
-    }
+    mn_reasm_set_remote_event(tmp, m_data_src, msg->remote_event_size_bytes);
     if (fattree_max_latency < tw_now( lp ) - msg->travel_start_time)
     {
          bf->c3 = 1;
@@ -2637,7 +2544,7 @@ void ft_packet_arrive(ft_terminal_state * s, tw_bf * bf, fattree_message * msg,
            return;
         }*/
 
-    if(tmp->num_chunks >= (int)total_chunks)
+    if(tmp->num_chunks >= total_chunks)
     {
         bf->c7 = 1;
 
@@ -2655,9 +2562,7 @@ void ft_packet_arrive(ft_terminal_state * s, tw_bf * bf, fattree_message * msg,
           ft_send_remote_event(s, msg, lp, bf, tmp->remote_event_data, tmp->remote_event_size);
         }
         /* Remove the hash entry */
-        qhash_del(hash_link);
-        rc_stack_push(lp, tmp, free_tmp, s->st);
-        s->rank_tbl_pop--;
+        mn_reasm_complete(s->rank_tbl, tmp, lp, s->st);
    }
 
   return;
@@ -2845,10 +2750,9 @@ void fattree_terminal_final( ft_terminal_state * s, tw_lp * lp )
 #endif
 	}
 
-    if(s->rank_tbl)
-        qhash_finalize(s->rank_tbl);
-
+    /* completed entries on the rc stack belong to the table's pool */
     rc_stack_destroy(s->st);
+    mn_reasm_destroy(s->rank_tbl);
 //    free(s->vc_occupancy);
     free(s->terminal_msgs);
     free(s->terminal_msgs_tail);
@@ -19,9 +19,6 @@
 #include "codes/codes.h"
 #include "codes/net/loggp.h"
 
-#define CATEGORY_NAME_MAX 16
-#define CATEGORY_MAX 12
-
 #define LP_CONFIG_NM (model_net_lp_config_names[LOGGP])
 #define LP_METHOD_NM (model_net_method_names[LOGGP])
 
@@ -123,7 +120,7 @@ static tw_stime loggp_packet_event(
 static void loggp_packet_event_rc(tw_lp *sender);
 
 tw_stime loggp_recv_msg_event(
-        const char * category,
+        int category,
         tw_lpid final_dest_lp,
         tw_lpid src_mn_lp,
         uint64_t msg_size,
@@ -437,7 +434,8 @@ static void handle_msg_ready_event(
                 codes_mctx_set_global_direct(lp->gid);
             int net_id = model_net_get_id(LP_METHOD_NM);
             m->event_rc = model_net_event_mctx(net_id, &mc_src, &mc_dst,
-                    m->category, m->src_gid, m->pull_size, recv_queue_time,
+                    codes_category_name(m->category), m->src_gid,
+                    m->pull_size, recv_queue_time,
                     m->event_size_bytes, tmp_ptr, 0, NULL, lp);
         }
         else{
@@ -624,7 +622,7 @@ static tw_stime loggp_packet_event(
              sender, LOGGP, (void**)&msg, (void**)&tmp_ptr);
      //e_new = tw_event_new(dest_id, xfer_to_nic_time+offset, sender);
      //msg = tw_event_data(e_new);
-     strcpy(msg->category, req->category);
+     msg->category = req->category;
      msg->final_dest_gid = req->final_dest_lp;
      msg->dest_mn_lp = req->dest_mn_lp;
      msg->src_gid = req->src_lp;
@@ -664,7 +662,7 @@ static tw_stime loggp_packet_event(
 }
 
 tw_stime loggp_recv_msg_event(
-        const char * category,
+        int category,
         tw_lpid final_dest_lp,
         tw_lpid src_mn_lp,
         uint64_t msg_size,
@@ -692,8 +690,7 @@ tw_stime loggp_recv_msg_event(
     m->net_msg_size_bytes = msg_size;
     m->event_size_bytes = remote_event_size;
     m->local_event_size_bytes = 0;
-    strncpy(m->category, category, CATEGORY_NAME_MAX-1);
-    m->category[CATEGORY_NAME_MAX-1]='\0';
+    m->category = category;
     m->is_pull = is_pull;
     m->pull_size = pull_size;
     // default sched params for just calling the receiver (for now...)
@@ -17,9 +17,6 @@
 #include "codes/codes.h"
 #include "codes/net/simplenet-upd.h"
 
-#define CATEGORY_NAME_MAX 16
-#define CATEGORY_MAX 12
-
 #define LP_CONFIG_NM (model_net_lp_config_names[SIMPLENET])
 #define LP_METHOD_NM (model_net_method_names[SIMPLENET])
 
@@ -383,7 +380,8 @@ static void handle_msg_ready_event(
                 codes_mctx_set_global_direct(lp->gid);
             int net_id = model_net_get_id(LP_METHOD_NM);
             m->event_rc = model_net_event_mctx(net_id, &mc_src, &mc_dst,
-                    m->category, m->src_gid, m->pull_size, recv_queue_time,
+                    codes_category_name(m->category), m->src_gid,
+                    m->pull_size, recv_queue_time,
                     m->event_size_bytes, tmp_ptr, 0, NULL, lp);
         }
         else{
@@ -537,7 +535,7 @@ static tw_stime simplenet_packet_event(
      // this is a self message
      e_new = model_net_method_event_new(sender->gid, xfer_to_nic_time+offset,
              sender, SIMPLENET, (void**)&msg, (void**)&tmp_ptr);
-     strcpy(msg->category, req->category);
+     msg->category = req->category;
      msg->src_gid = req->src_lp;
      msg->src_mn_lp = sender->gid;
      msg->final_dest_gid = req->final_dest_lp;
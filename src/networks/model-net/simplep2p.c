@@ -17,9 +17,6 @@
 #include "codes/codes.h"
 #include "codes/net/simplep2p.h"
 
-#define CATEGORY_NAME_MAX 16
-#define CATEGORY_MAX 12
-
 #define SIMPLEP2P_DEBUG 0
 
 #define LP_CONFIG_NM (model_net_lp_config_names[SIMPLEP2P])
@@ -48,7 +45,6 @@ struct category_idles_s{
     tw_stime send_prev_idle_all;
     tw_stime recv_next_idle_all;
     tw_stime recv_prev_idle_all;
-    char category[CATEGORY_NAME_MAX];
 };
 
 struct sp_state
@@ -65,7 +61,7 @@ struct sp_state
     /* Each simplep2p "NIC" actually has N connections, so we need to track
      * idle times across all of them to correctly do stats.
      * Additionally need to track different idle times across different
-     * categories */
+     * categories, indexed by category id */
     category_idles idle_times_cat[CATEGORY_MAX];
 
     struct mn_stats sp_stats_array[CATEGORY_MAX];
@@ -114,7 +110,7 @@ static double sp_get_table_ent(
 
 /* category lookup */
 static category_idles* sp_get_category_idles(
-        char * category, category_idles *idles);
+        int category, category_idles *idles);
 
 /* collective network calls */
 static void simple_wan_collective();
@@ -408,7 +404,6 @@ static void sp_init(
         ns->idle_times_cat[i].send_prev_idle_all = 0.0;
         ns->idle_times_cat[i].recv_next_idle_all = 0.0;
         ns->idle_times_cat[i].recv_prev_idle_all = 0.0;
-        ns->idle_times_cat[i].category[0] = '\0';
     }
 
     return;
@@ -469,11 +464,11 @@ static void sp_finalize(
     /* first need to add last known active-range times (they aren't added
      * until afterwards) */
     int i;
-    for (i = 0;
-            i < CATEGORY_MAX && strlen(ns->idle_times_cat[i].category) > 0;
-            i++){
+    for (i = 0; i < CATEGORY_MAX; i++){
         category_idles *id = ns->idle_times_cat + i;
         mn_stats       *st = ns->sp_stats_array + i;
+        if (!st->used)
+            continue;
         st->send_time += id->send_next_idle_all - id->send_prev_idle_all;
         st->recv_time += id->recv_next_idle_all - id->recv_prev_idle_all;
     }
@@ -621,7 +616,7 @@ static void handle_msg_ready_event(
             struct codes_mctx mc_src =
                 codes_mctx_set_global_direct(lp->gid);
             int net_id = model_net_get_id(LP_METHOD_NM);
-            m->event_rc = model_net_event_mctx(net_id, &mc_src, &mc_dst, m->category,
+            m->event_rc = model_net_event_mctx(net_id, &mc_src, &mc_dst, codes_category_name(m->category),
                     m->src_gid, m->pull_size, recv_queue_time,
                     m->event_size_bytes, tmp_ptr, 0, NULL, lp);
         }
@@ -827,7 +822,7 @@ static tw_stime simplep2p_packet_event(
 
      e_new = model_net_method_event_new(sender->gid, xfer_to_nic_time+offset,
              sender, SIMPLEP2P, (void**)&msg, (void**)&tmp_ptr);
-     strcpy(msg->category, req->category);
+     msg->category = req->category;
      msg->final_dest_gid = req->final_dest_lp;
      msg->dest_mn_lp = req->dest_mn_lp;
      msg->src_gid = req->src_lp;
@@ -929,29 +924,9 @@ static double sp_get_table_ent(
 
 /* category lookup (more or less copied from model_net_find_stats) */
 static category_idles* sp_get_category_idles(
-        char * category, category_idles *idles){
-    int i;
-    int new_flag = 0;
-    int found_flag = 0;
-
-    for(i=0; i<CATEGORY_MAX; i++) {
-        if(strlen(idles[i].category) == 0) {
-            found_flag = 1;
-            new_flag = 1;
-            break;
-        }
-        if(strcmp(category, idles[i].category) == 0) {
-            found_flag = 1;
-            new_flag = 0;
-            break;
-        }
-    }
-    assert(found_flag);
-
-    if(new_flag) {
-        strcpy(idles[i].category, category);
-    }
-    return &idles[i];
+        int category, category_idles *idles){
+    assert(category >= 0 && category < CATEGORY_MAX);
+    return &idles[category];
 }
 
 /*
@@ -18,15 +18,12 @@
 #include "codes/model-net-lp.h"
 #include "codes/net/slimfly.h"
 #include "sys/file.h"
-#include "codes/quickhash.h"
 #include "codes/rc-stack.h"
+#include "codes/model-net-reassembly.h"
 
 #define CREDIT_SIZE 8
 #define MEAN_PROCESS 1.0
 
-/* collective specific parameters */
-#define SLIMFLY_HASH_TABLE_SIZE 65536
-
 // debugging parameters
 #define TRACK -9
 //#define TRACK 100001
@@ -158,21 +155,6 @@ struct slimfly_param
     int num_local_channels;
 };
 
-struct sfly_hash_key
-{
-    uint64_t message_id;
-    tw_lpid sender_id;
-};
-
-struct sfly_qhash_entry
-{
-    struct sfly_hash_key key;
-    char * remote_event_data;
-    int num_chunks;
-    int remote_event_size;
-    struct qhash_head hash_link;
-};
-
 /* handles terminal and router events like packet generate/send/receive/buffer */
 typedef enum event_t event_t;
 typedef struct terminal_state terminal_state;
@@ -215,8 +197,7 @@ struct terminal_state
     const char * anno;
     const slimfly_param *params;
 
-    struct qhash_table *rank_tbl;
-    uint64_t rank_tbl_pop;
+    struct mn_reasm_table *rank_tbl;
 
     tw_stime   total_time;
     uint64_t total_msg_size;
@@ -294,13 +275,16 @@ struct router_state
     struct rc_stack * st;
 
     tw_stime** last_buf_full;
+    /* busy_time, busy_time_sample, link_traffic and vc_occupancy are carved
+     * out of port_stats */
+    void* port_stats;
     tw_stime* busy_time;
     tw_stime* busy_time_sample;
 
     char output_buf[4096];
     char output_buf2[4096];
 
-    int** vc_occupancy;
+    int* vc_occupancy; /* radix x num_vcs, one contiguous row per port */
     int64_t* link_traffic;	//Aren't used
 
     const char * anno;
@@ -310,6 +294,22 @@ struct router_state
     int* cur_hist_num;	//Aren't used
 };
 
+/* VC occupancy row of a router port */
+static inline int* router_vc_occupancy(const router_state *s, int port)
+{
+    return s->vc_occupancy + (size_t)port * s->params->num_vcs;
+}
+
+/* total occupancy over all VCs of a router port */
+static inline int router_port_occupancy(const router_state *s, int port)
+{
+    const int *row = router_vc_occupancy(s, port);
+    int sum = 0;
+    for(int k = 0; k < s->params->num_vcs; k++)
+        sum += row[k];
+    return sum;
+}
+
 /* ROSS Instrumentation Support */
 struct slimfly_cn_sample
 {
@@ -365,30 +365,6 @@ static long long       total_msg_sz = 0;
 static long long       N_finished_msgs = 0;
 static long long       N_finished_chunks = 0;
 
-static int slimfly_rank_hash_compare(
-        void *key, struct qhash_head *link)
-{
-    struct sfly_hash_key *message_key = (struct sfly_hash_key *)key;
-    struct sfly_qhash_entry *tmp = NULL;
-
-    tmp = qhash_entry(link, struct sfly_qhash_entry, hash_link);
-
-    if (tmp->key.message_id == message_key->message_id
-            && tmp->key.sender_id == message_key->sender_id)
-        return 1;
-
-    return 0;
-}
-static int slimfly_hash_func(void *k, int table_size)
-{
-    struct sfly_hash_key *tmp = (struct sfly_hash_key *)k;
-    uint64_t key = (~tmp->message_id) + (tmp->message_id << 18);
-    key = key * 21;
-    key = ~key ^ (tmp->sender_id >> 4);
-    key = key * tmp->sender_id;
-    return (int)(key & (table_size - 1));
-}
-
 /* convert GiB/s and bytes to ns */
 static tw_stime bytes_to_ns(uint64_t bytes, double GB_p_s)
 {
@@ -410,15 +386,6 @@ static int slimfly_get_msg_sz(void)
     return sizeof(slim_terminal_message);
 }
 
-static void free_tmp(void * ptr)
-{
-    struct sfly_qhash_entry * sfly = ptr;
-    if(sfly->remote_event_data)
-        free(sfly->remote_event_data);
-    if(sfly)
-        free(sfly);
-}
-
 static void append_to_terminal_message_list(
         slim_terminal_message_list ** thisq,
         slim_terminal_message_list ** thistail,
@@ -996,10 +963,7 @@ void slim_terminal_init( terminal_state * s,
 
     rc_stack_create(&s->st);
 
-    s->rank_tbl = qhash_init(slimfly_rank_hash_compare, slimfly_hash_func, SLIMFLY_HASH_TABLE_SIZE);
-
-    if(!s->rank_tbl)
-        tw_error(TW_LOC, "\n Hash table not initialized! ");
+    s->rank_tbl = mn_reasm_create(MN_REASM_INITIAL_SIZE);
 
     return;
 }
@@ -1031,11 +995,20 @@ void slim_router_setup(router_state * r, tw_lp * lp)
     r->global_channel = (int*)calloc(p->num_global_channels, sizeof(int));
     r->local_channel = (int*)calloc(p->num_local_channels, sizeof(int));
     r->next_output_available_time = (tw_stime*)calloc(p->radix, sizeof(tw_stime));
-    r->link_traffic = (int64_t*)calloc(p->radix, sizeof(int64_t));
+
+    /* one zeroed block: busy_time, busy_time_sample, link_traffic, then the
+     * radix x num_vcs occupancy table */
+    size_t port_stats_sz = p->radix * (2 * sizeof(tw_stime) + sizeof(int64_t))
+        + (size_t)p->radix * p->num_vcs * sizeof(int);
+    r->port_stats = calloc(1, port_stats_sz);
+    r->busy_time = (tw_stime*)r->port_stats;
+    r->busy_time_sample = r->busy_time + p->radix;
+    r->link_traffic = (int64_t*)(r->busy_time_sample + p->radix);
+    r->vc_occupancy = (int*)(r->link_traffic + p->radix);
+
     r->cur_hist_num = (int*)calloc(p->radix, sizeof(int));
     r->prev_hist_num = (int*)calloc(p->radix, sizeof(int));
 
-    r->vc_occupancy = (int**)calloc(p->radix, sizeof(int*));
     r->in_send_loop = (int*)calloc(p->radix, sizeof(int));
     r->pending_msgs =
         (slim_terminal_message_list***)calloc(p->radix, sizeof(slim_terminal_message_list**));
@@ -1047,7 +1020,6 @@ void slim_router_setup(router_state * r, tw_lp * lp)
         (slim_terminal_message_list***)calloc(p->radix, sizeof(slim_terminal_message_list**));
 
    r->last_buf_full = (tw_stime**)calloc(p->radix, sizeof(tw_stime*));
-    r->busy_time = (tw_stime*)calloc(p->radix, sizeof(tw_stime));
 
     // ROSS Instrumentation
     if (g_st_use_analysis_lps  && g_st_model_stats)
@@ -1059,14 +1031,10 @@ void slim_router_setup(router_state * r, tw_lp * lp)
     {
         // Set credit & router occupancy
         r->next_output_available_time[i]=0;
-        r->link_traffic[i]=0;
         r->cur_hist_num[i] = 0;
         r->prev_hist_num[i] = 0;
 
-        r->busy_time[i] = 0.0;
-
         r->in_send_loop[i] = 0;
-        r->vc_occupancy[i] = (int*)calloc(p->num_vcs, sizeof(int));
         r->pending_msgs[i] = (slim_terminal_message_list**)calloc(p->num_vcs, 
                 sizeof(slim_terminal_message_list*));
         r->last_buf_full[i] = (tw_stime*)calloc(p->num_vcs, sizeof(tw_stime));
@@ -1078,7 +1046,6 @@ void slim_router_setup(router_state * r, tw_lp * lp)
                 sizeof(slim_terminal_message_list*));
         for(int j = 0; j < p->num_vcs; j++) {
             r->last_buf_full[i][j] = 0.0;
-            r->vc_occupancy[i][j] = 0;
             r->pending_msgs[i][j] = NULL;
             r->pending_msgs_tail[i][j] = NULL;
             r->queued_msgs[i][j] = NULL;
@@ -1178,7 +1145,7 @@ static tw_stime slimfly_packet_event(
     //printf("%llu packet_event() xfer to nic time: %llu, offset: %llu\n",LLU(tw_now(sender)),LLU(xfer_to_nic_time),LLU(offset));
     e_new = model_net_method_event_new(sender->gid, xfer_to_nic_time+offset,
             sender, SLIMFLY, (void**)&msg, (void**)&tmp_ptr);
-    strcpy(msg->category, req->category);
+    msg->category = req->category;
     msg->final_dest_gid = req->final_dest_lp;
     msg->total_size = req->msg_size;
     msg->sender_lp=req->src_lp;
@@ -1787,15 +1754,8 @@ void slim_packet_arrive_rc(terminal_state * s, tw_bf * bf, slim_terminal_message
     slimfly_total_time -= (tw_now(lp) - msg->travel_start_time);
     s->total_time = msg->saved_avg_time;
 
-    struct qhash_head * hash_link = NULL;
-    struct sfly_qhash_entry * tmp = NULL;
-
-    struct sfly_hash_key key;
-    key.message_id = msg->message_id;
-    key.sender_id = msg->sender_lp;
-
-    hash_link = qhash_search(s->rank_tbl, &key);
-    tmp = qhash_entry(hash_link, struct sfly_qhash_entry, hash_link);
+    struct mn_reasm_entry * tmp =
+        mn_reasm_find(s->rank_tbl, msg->message_id, msg->sender_lp);
 
     mn_stats* stat;
     stat = model_net_find_stats(msg->category, s->slimfly_stats_array);
@@ -1821,13 +1781,7 @@ void slim_packet_arrive_rc(terminal_state * s, tw_bf * bf, slim_terminal_message
         N_finished_msgs--;
         s->total_msg_size -= msg->total_size;
 
-        struct sfly_qhash_entry * d_entry_pop = rc_stack_pop(s->st);
-        qhash_add(s->rank_tbl, &key, &(d_entry_pop->hash_link));
-        s->rank_tbl_pop++;
-
-        hash_link = &(d_entry_pop->hash_link);
-        tmp = d_entry_pop;
-
+        tmp = mn_reasm_complete_rc(s->rank_tbl, s->st);
 
         if(bf->c4)
             model_net_event_rc2(lp, &msg->event_rc);
@@ -1836,11 +1790,7 @@ void slim_packet_arrive_rc(terminal_state * s, tw_bf * bf, slim_terminal_message
     assert(tmp);
     tmp->num_chunks--;
     if(bf->c5)
-    {
-      qhash_del(hash_link);
-      free_tmp(tmp);	
-      s->rank_tbl_pop--;
-    }
+        mn_reasm_discard(s->rank_tbl, tmp);
 
     return;
 }
@@ -1863,7 +1813,7 @@ void slim_send_remote_event(terminal_state * s, slim_terminal_message * msg, tw_
 
         model_net_set_msg_param(MN_MSG_PARAM_START_TIME, MN_MSG_PARAM_START_TIME_VAL, &(msg->msg_start_time));
 
-        msg->event_rc = model_net_event_mctx(net_id, &mc_src, &mc_dst, msg->category,
+        msg->event_rc = model_net_event_mctx(net_id, &mc_src, &mc_dst, codes_category_name(msg->category),
                 msg->sender_lp, msg->pull_size, ts,
                 remote_event_size, tmp_ptr, 0, NULL, lp);
     }
@@ -1962,36 +1912,16 @@ void slim_packet_arrive(terminal_state * s, tw_bf * bf, slim_terminal_message *
     /* Now retreieve the number of chunks completed from the hash and update
      * them */
     void *m_data_src = model_net_method_get_edata(SLIMFLY, msg);
-    struct qhash_head *hash_link = NULL;
-    struct sfly_qhash_entry * tmp = NULL;
-    struct sfly_hash_key key;
-    key.message_id = msg->message_id;
-    key.sender_id = msg->sender_lp;
-
-    hash_link = qhash_search(s->rank_tbl, &key);
-
-    if(hash_link)
-        tmp = qhash_entry(hash_link, struct sfly_qhash_entry, hash_link);
+    struct mn_reasm_entry * tmp =
+        mn_reasm_find(s->rank_tbl, msg->message_id, msg->sender_lp);
 
     /* If an entry does not exist then create one */
-    if(!hash_link)
+    if(!tmp)
     {
         bf->c5 = 1;
-        struct sfly_qhash_entry * d_entry = calloc(1, sizeof(struct sfly_qhash_entry));
-        d_entry->num_chunks = 0;
-        d_entry->key = key;
-        d_entry->remote_event_data = NULL;
-        d_entry->remote_event_size = 0;
-        qhash_add(s->rank_tbl, &key, &(d_entry->hash_link));
-        s->rank_tbl_pop++;
-
-        hash_link = &(d_entry->hash_link);
-        // tmp = d_entry;
+        tmp = mn_reasm_insert(s->rank_tbl, msg->message_id, msg->sender_lp);
     }
 
-    if(hash_link)
-        tmp = qhash_entry(hash_link, struct sfly_qhash_entry, hash_link);
-
     assert(tmp);
     tmp->num_chunks++;
 
@@ -2005,14 +1935,7 @@ void slim_packet_arrive(terminal_state * s, tw_bf * bf, slim_terminal_message *
         N_finished_packets++;
         s->finished_packets++;
     }
-    if(msg->remote_event_size_bytes > 0 && !tmp->remote_event_data)
-    {
-        /* Retreive the remote event entry */
-        tmp->remote_event_data = (void*)calloc(1, msg->remote_event_size_bytes);
-        assert(tmp->remote_event_data);
-        tmp->remote_event_size = msg->remote_event_size_bytes;
-        memcpy(tmp->remote_event_data, m_data_src, msg->remote_event_size_bytes);
-    }
+    mn_reasm_set_remote_event(tmp, m_data_src, msg->remote_event_size_bytes);
     if (slimfly_max_latency < tw_now( lp ) - msg->travel_start_time) {
         bf->c3 = 1;
         msg->saved_available_time = slimfly_max_latency;
@@ -2034,9 +1957,7 @@ void slim_packet_arrive(terminal_state * s, tw_bf * bf, slim_terminal_message *
             slim_send_remote_event(s, msg, lp, bf, tmp->remote_event_data, tmp->remote_event_size);
         }
         /* Remove the hash entry */
-        qhash_del(hash_link);
-        rc_stack_push(lp, tmp, free_tmp, s->st);
-        s->rank_tbl_pop--;
+        mn_reasm_complete(s->rank_tbl, tmp, lp, s->st);
     }
 #if TERMINAL_SENDS_RECVS_LOG
     int index = floor(N_COLLECT_POINTS*(tw_now(lp)/g_tw_ts_end));
@@ -2162,8 +2083,9 @@ void slimfly_terminal_final( terminal_state * s,
     lp_io_write(lp->gid, "slimfly-msg-times",written2, s->output_buf2);
 #endif
 
-    qhash_finalize(s->rank_tbl);
+    /* completed entries on the rc stack belong to the table's pool */
     rc_stack_destroy(s->st);
+    mn_reasm_destroy(s->rank_tbl);
     free(s->vc_occupancy);
     free(s->terminal_msgs);
     free(s->terminal_msgs_tail);
@@ -2182,7 +2104,7 @@ void slimfly_router_final(router_state * s,
         for(j = 0; j < s->params->num_vcs; j++) {
             if(s->queued_msgs[i][j] != NULL) {
               printf("[%llu] leftover queued messages %d %d %d\n", LLU(lp->gid), i, j,
-                     s->vc_occupancy[i][j]);
+                     router_vc_occupancy(s, i)[j]);
             }
             if(s->pending_msgs[i][j] != NULL) {
              printf("[%llu] lefover pending messages %d %d\n", LLU(lp->gid), i, j);
@@ -2230,6 +2152,7 @@ void slimfly_router_final(router_state * s,
 
     assert(written < 4096);
     lp_io_write(lp->gid, "slimfly-router-traffic", written, s->output_buf2);
+    free(s->port_stats);
 }
 
 
@@ -3172,10 +3095,10 @@ static int do_adaptive_routing( router_state * s,
     int num_min_hops = get_path_length_local(s, dest_router_rel_id);
 
     //Determine port occupancy for all minimal and nonminimal paths
-    int min_port_count = s->vc_occupancy[minimal_out_port][min_vc];
+    int min_port_count = router_vc_occupancy(s, minimal_out_port)[min_vc];
     for(i=0;i<num_indirect_routes;i++)
     {
-        nonmin_port_count[i] = s->vc_occupancy[nonmin_out_port[i]][nomin_vc];
+        nonmin_port_count[i] = router_vc_occupancy(s, nonmin_out_port[i])[nomin_vc];
     }
 
     //Calculate cost of all paths/routes
@@ -3255,7 +3178,7 @@ void slim_router_packet_receive_rc(router_state * s,
         slim_terminal_message_list * tail = return_tail(s->pending_msgs[output_port],
                     s->pending_msgs_tail[output_port], output_chan);
         slim_delete_terminal_message_list(tail);
-        s->vc_occupancy[output_port][output_chan] -= s->params->chunk_size;
+        router_vc_occupancy(s, output_port)[output_chan] -= s->params->chunk_size;
         if(bf->c3) {
             codes_local_latency_reverse(lp);
             s->in_send_loop[output_port] = 0;
@@ -3444,7 +3367,7 @@ slim_router_packet_receive( router_state * s,
 
     assert(output_port < s->params->radix);
 
-    if(s->vc_occupancy[output_port][output_chan] + s->params->chunk_size <= max_vc_size)
+    if(router_vc_occupancy(s, output_port)[output_chan] + s->params->chunk_size <= max_vc_size)
     {
 #if TRACK_OUTPUT
         if( msg->packet_ID == TRACK )
@@ -3455,11 +3378,11 @@ slim_router_packet_receive( router_state * s,
         bf->c2 = 1;
         slim_router_credit_send(s, msg, lp, -1);
         append_to_terminal_message_list( s->pending_msgs[output_port], s->pending_msgs_tail[output_port], output_chan, cur_chunk);
-        s->vc_occupancy[output_port][output_chan] += s->params->chunk_size;
+        router_vc_occupancy(s, output_port)[output_chan] += s->params->chunk_size;
 
 #if ROUTER_OCCUPANCY_LOG
         int index = floor(N_COLLECT_POINTS*(tw_now(lp)/g_tw_ts_end));
-        vc_occupancy_storage_router[s->router_id][output_port][output_chan][index] = s->vc_occupancy[output_port][output_chan]/s->params->chunk_size;
+        vc_occupancy_storage_router[s->router_id][output_port][output_chan][index] = router_vc_occupancy(s, output_port)[output_chan]/s->params->chunk_size;
 #endif
 
         if(s->in_send_loop[output_port] == 0) {
@@ -3739,7 +3662,7 @@ void slim_router_buf_update_rc(router_state * s,
     int indx = msg->vc_index;
     int output_chan = msg->output_chan;
     // printf("index: %d  output chan: %d\n",indx, output_chan);
-    s->vc_occupancy[indx][output_chan] += s->params->chunk_size;
+    router_vc_occupancy(s, indx)[output_chan] += s->params->chunk_size;
     if(bf->c3)
     {
         s->busy_time[indx] = msg->saved_rcv_time;
@@ -3751,7 +3674,7 @@ void slim_router_buf_update_rc(router_state * s,
         // tw_rand_reverse_unif(lp->rng);
         prepend_to_terminal_message_list(s->queued_msgs[indx],
                 s->queued_msgs_tail[indx], output_chan, head);
-        s->vc_occupancy[indx][output_chan] -= s->params->chunk_size;
+        router_vc_occupancy(s, indx)[output_chan] -= s->params->chunk_size;
     }
     if(bf->c2) {
         codes_local_latency_reverse(lp);
@@ -3765,7 +3688,7 @@ void slim_router_buf_update(router_state * s, tw_bf * bf, slim_terminal_message
 
     int indx = msg->vc_index;
     int output_chan = msg->output_chan;
-    s->vc_occupancy[indx][output_chan] -= s->params->chunk_size;
+    router_vc_occupancy(s, indx)[output_chan] -= s->params->chunk_size;
 
     if(s->last_buf_full[indx][output_chan] > 0.0)
     {
@@ -3778,7 +3701,7 @@ void slim_router_buf_update(router_state * s, tw_bf * bf, slim_terminal_message
 
 #if ROUTER_OCCUPANCY_LOG
     int index = floor(N_COLLECT_POINTS*(tw_now(lp)/g_tw_ts_end));
-    vc_occupancy_storage_router[s->router_id][indx][output_chan][index] = s->vc_occupancy[indx][output_chan]/s->params->chunk_size;
+    vc_occupancy_storage_router[s->router_id][indx][output_chan][index] = router_vc_occupancy(s, indx)[output_chan]/s->params->chunk_size;
 #endif
     if(s->queued_msgs[indx][output_chan] != NULL) {
         bf->c1 = 1;
@@ -3787,9 +3710,9 @@ void slim_router_buf_update(router_state * s, tw_bf * bf, slim_terminal_message
         slim_router_credit_send(s, &head->msg, lp, 1);
         append_to_terminal_message_list(s->pending_msgs[indx],
                 s->pending_msgs_tail[indx], output_chan, head);
-        s->vc_occupancy[indx][output_chan] += s->params->chunk_size;
+        router_vc_occupancy(s, indx)[output_chan] += s->params->chunk_size;
 #if ROUTER_OCCUPANCY_LOG
-        vc_occupancy_storage_router[s->router_id][indx][output_chan][index] = s->vc_occupancy[indx][output_chan]/s->params->chunk_size;
+        vc_occupancy_storage_router[s->router_id][indx][output_chan][index] = router_vc_occupancy(s, indx)[output_chan]/s->params->chunk_size;
 #endif
     }
     if(s->in_send_loop[indx] == 0 && s->pending_msgs[indx][output_chan] != NULL) {
@@ -3951,8 +3874,8 @@ static void ross_slimfly_rsample_fn(router_state * s, tw_bf * bf, tw_lp * lp, st
 {
     (void)bf;
 
-    const slimfly_param * p = s->params; 
-    int i, j, total;
+    const slimfly_param * p = s->params;
+    int i;
 
     sample->router_id = s->router_id;
     sample->end_time = tw_now(lp);
@@ -3960,12 +3883,7 @@ static void ross_slimfly_rsample_fn(router_state * s, tw_bf * bf, tw_lp * lp, st
 
     // sum vc occupancy for each port
     for(i = 0; i < p->radix; i++)
-    {
-        total = 0;
-        for (j = 0; j < p->num_vcs; j++)
-            total += s->vc_occupancy[i][j];
-        sample->vc_occupancy[i] = total;
-    }
+        sample->vc_occupancy[i] = router_port_occupancy(s, i);
 
     return;
 }
@@ -4044,6 +3962,7 @@ struct model_net_method slimfly_method =
     NULL,
     slimfly_register_model_types,
     slimfly_get_cn_model_types,
+    0, /* single packets only */
 };
 
 struct model_net_method slimfly_router_method =
@@ -4066,6 +3985,7 @@ struct model_net_method slimfly_router_method =
     NULL,
     slimfly_router_register_model_types,
     slimfly_get_router_model_types,
+    0, /* single packets only */
 };
 
 
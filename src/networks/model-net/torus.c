@@ -512,7 +512,7 @@ static tw_stime torus_packet_event(
     //msg = tw_event_data(e_new);
     e_new = model_net_method_event_new(sender->gid, xfer_to_nic_time+offset,
             sender, TORUS, (void**)&msg, (void**)&tmp_ptr);
-    strcpy(msg->category, req->category);
+    msg->category = req->category;
     msg->final_dest_gid = req->final_dest_lp;
     msg->dest_lp = req->dest_mn_lp;
     msg->sender_svr= req->src_lp;
@@ -753,7 +753,7 @@ static void torus_init( nodes_state * s,
 
 
 /* collective operation for the torus network */
-void torus_collective(char const * category, int message_size, int remote_event_size, const void* remote_event, tw_lp* sender)
+void torus_collective(int category, int message_size, int remote_event_size, const void* remote_event, tw_lp* sender)
 {
     tw_event * e_new;
     tw_stime xfer_to_nic_time;
@@ -772,7 +772,7 @@ void torus_collective(char const * category, int message_size, int remote_event_
             sender, TORUS, (void**)&msg, (void**)&tmp_ptr);
 
     msg->remote_event_size_bytes = message_size;
-    strcpy(msg->category, category);
+    msg->category = category;
     msg->sender_svr=sender->gid;
     msg->type = T_COLLECTIVE_INIT;
 
@@ -1577,7 +1577,7 @@ static void packet_arrive( nodes_state * s,
                    struct codes_mctx mc_src =
                        codes_mctx_set_global_direct(lp->gid);
                    msg->event_rc = model_net_event_mctx(net_id, &mc_src, &mc_dst,
-                           msg->category, msg->sender_svr, msg->pull_size,
+                           codes_category_name(msg->category), msg->sender_svr, msg->pull_size,
                            0.0, msg->remote_event_size_bytes, tmp_ptr, 0,
                            NULL, lp);
                }
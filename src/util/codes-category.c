@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2013 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+#include <assert.h>
+#include <string.h>
+#include <ross.h>
+#include <codes/codes-category.h>
+
+static char category_names[CATEGORY_MAX][CATEGORY_NAME_MAX];
+static int num_categories = 0;
+
+int codes_category_lookup(char const * name)
+{
+    for (int i = 0; i < num_categories; i++) {
+        if (strncmp(category_names[i], name, CATEGORY_NAME_MAX-1) == 0)
+            return i;
+    }
+    return -1;
+}
+
+int codes_category_register(char const * name)
+{
+    int id = codes_category_lookup(name);
+
+    if (id >= 0)
+        return id;
+    if (num_categories == CATEGORY_MAX)
+        tw_error(TW_LOC, "can't register category \"%s\": all %d categories "
+                "are in use", name, CATEGORY_MAX);
+    // names are cut to the CATEGORY_NAME_MAX-1 characters events used to
+    // carry
+    strncpy(category_names[num_categories], name, CATEGORY_NAME_MAX-1);
+    return num_categories++;
+}
+
+int codes_category_id(char const * name)
+{
+    int id = codes_category_lookup(name);
+
+    if (id >= 0)
+        return id;
+    if (tw_nnodes() > 1)
+        tw_error(TW_LOC, "category \"%s\" wasn't registered: call "
+                "codes_category_register on every process before tw_run",
+                name);
+    return codes_category_register(name);
+}
+
+char const * codes_category_name(int id)
+{
+    assert(id >= 0 && id < num_categories);
+    return category_names[id];
+}
+
+int codes_category_count(void)
+{
+    return num_categories;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ft=c ts=8 sts=4 sw=4 expandtab
+ */
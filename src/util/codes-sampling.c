@@ -0,0 +1,459 @@
+/*
+ * Copyright (C) 2014 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <codes/codes-sampling.h>
+#include <codes/lp-io.h>
+#include <codes/lp-io-table.h>
+
+#define SAMPLER_NAME_MAX 48
+
+/* committed samples of one group in one interval, num_metrics each */
+struct sample_group
+{
+    int n, cap;
+    double *metrics;
+};
+
+struct sample_bin
+{
+    int64_t interval;
+    struct sample_group *groups;
+    struct sample_bin *next;
+};
+
+struct codes_sampler
+{
+    char name[SAMPLER_NAME_MAX];
+    char identifier[SAMPLER_NAME_MAX + 8];
+    int num_values;
+    int num_metrics;
+    char (*metric_names)[CODES_SAMPLE_METRIC_MAX];
+    codes_sample_reduce_f reduce;
+    void *reduce_arg;
+    int num_groups;
+    tw_stime interval;
+    /* attached rings, only linked in optimistic mode */
+    struct codes_sample_ring *rings;
+    int num_rings;
+    /* open bins in interval order, and emptied ones for reuse */
+    struct sample_bin *bins;
+    struct sample_bin *free_bins;
+    /* horizon of the last drain */
+    tw_stime drained;
+    int warned;
+    double *scratch;
+    struct codes_sampler *next;
+};
+
+/* ring slots: push time, sample time, then num_values values */
+struct codes_sample_ring
+{
+    struct codes_sampler *s;
+    int group;
+    int cap, head, count;
+    double *slots;
+    struct codes_sample_ring *next, *prev;
+};
+
+/* one output row per (bin, group, metric) */
+struct sample_row
+{
+    double time;
+    int32_t group;
+    int32_t pe;
+    char metric[CODES_SAMPLE_METRIC_MAX];
+    uint64_t count;
+    double sum;
+    double min;
+    double max;
+    double p50;
+    double p90;
+    double p99;
+};
+
+static const struct lp_io_column sample_columns[] = {
+    LP_IO_COLUMN(struct sample_row, time, LP_IO_COL_DOUBLE),
+    LP_IO_COLUMN(struct sample_row, group, LP_IO_COL_INT32),
+    LP_IO_COLUMN(struct sample_row, pe, LP_IO_COL_INT32),
+    LP_IO_COLUMN(struct sample_row, metric, LP_IO_COL_CHAR),
+    LP_IO_COLUMN(struct sample_row, count, LP_IO_COL_UINT64),
+    LP_IO_COLUMN(struct sample_row, sum, LP_IO_COL_DOUBLE),
+    LP_IO_COLUMN(struct sample_row, min, LP_IO_COL_DOUBLE),
+    LP_IO_COLUMN(struct sample_row, max, LP_IO_COL_DOUBLE),
+    LP_IO_COLUMN(struct sample_row, p50, LP_IO_COL_DOUBLE),
+    LP_IO_COLUMN(struct sample_row, p90, LP_IO_COL_DOUBLE),
+    LP_IO_COLUMN(struct sample_row, p99, LP_IO_COL_DOUBLE),
+};
+
+static struct codes_sampler *samplers = NULL;
+
+static int is_optimistic(void)
+{
+    return g_tw_synchronization_protocol == OPTIMISTIC ||
+        g_tw_synchronization_protocol == OPTIMISTIC_DEBUG ||
+        g_tw_synchronization_protocol == OPTIMISTIC_REALTIME;
+}
+
+/* samples pushed before the horizon can no longer be rolled back */
+static tw_stime horizon(tw_lp const * lp)
+{
+    switch(g_tw_synchronization_protocol)
+    {
+        case OPTIMISTIC:
+        case OPTIMISTIC_REALTIME:
+            return lp->pe->GVT;
+        case OPTIMISTIC_DEBUG:
+            return -1.0;
+        default:
+            return tw_now(lp);
+    }
+}
+
+static inline double * ring_slot(struct codes_sample_ring *r, int i)
+{
+    return r->slots + (size_t)((r->head + i) % r->cap) * (2 + r->s->num_values);
+}
+
+static struct sample_bin * bin_get(struct codes_sampler *s, int64_t interval)
+{
+    struct sample_bin **p = &s->bins;
+    struct sample_bin *b;
+
+    while(*p && (*p)->interval < interval)
+        p = &(*p)->next;
+    if(*p && (*p)->interval == interval)
+        return *p;
+
+    b = s->free_bins;
+    if(b)
+        s->free_bins = b->next;
+    else
+    {
+        b = (struct sample_bin*)malloc(sizeof(*b));
+        assert(b);
+        b->groups = (struct sample_group*)calloc(s->num_groups, sizeof(*b->groups));
+        assert(b->groups);
+    }
+    b->interval = interval;
+    b->next = *p;
+    *p = b;
+    return b;
+}
+
+static void bin_add(struct codes_sampler *s, int group, tw_stime sample_time,
+        double const *values)
+{
+    struct sample_bin *b = bin_get(s, llround(sample_time / s->interval));
+    struct sample_group *g = &b->groups[group];
+    double *m;
+
+    if(g->n == g->cap)
+    {
+        g->cap = g->cap ? 2 * g->cap : 8;
+        g->metrics = (double*)realloc(g->metrics,
+                (size_t)g->cap * s->num_metrics * sizeof(double));
+        assert(g->metrics);
+    }
+    m = g->metrics + (size_t)g->n * s->num_metrics;
+    if(s->reduce)
+        s->reduce(values, m, s->reduce_arg);
+    else
+        memcpy(m, values, s->num_metrics * sizeof(double));
+    g->n++;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* nearest-rank percentile of n sorted values */
+static double percentile(double const *v, int n, double p)
+{
+    int i = (int)ceil(p * n) - 1;
+    return v[i < 0 ? 0 : i];
+}
+
+/* write out a bin and put it on the free list */
+static void bin_emit(struct codes_sampler *s, struct sample_bin *b, tw_lp *lp)
+{
+    struct sample_row *rows;
+    int nrows = 0, max_n = 0;
+    int i, j, k;
+
+    for(i = 0; i < s->num_groups; i++)
+    {
+        if(b->groups[i].n > max_n)
+            max_n = b->groups[i].n;
+        if(b->groups[i].n)
+            nrows += s->num_metrics;
+    }
+    if(nrows)
+    {
+        rows = (struct sample_row*)calloc(nrows, sizeof(*rows));
+        s->scratch = (double*)realloc(s->scratch, max_n * sizeof(double));
+        assert(rows && s->scratch);
+        nrows = 0;
+        for(i = 0; i < s->num_groups; i++)
+        {
+            struct sample_group *g = &b->groups[i];
+            for(j = 0; g->n && j < s->num_metrics; j++)
+            {
+                struct sample_row *row = &rows[nrows++];
+                double *v = s->scratch;
+                for(k = 0; k < g->n; k++)
+                {
+                    v[k] = g->metrics[(size_t)k * s->num_metrics + j];
+                    row->sum += v[k];
+                }
+                qsort(v, g->n, sizeof(double), cmp_double);
+                row->time = b->interval * s->interval;
+                row->group = i;
+                row->pe = g_tw_mynode;
+                memcpy(row->metric, s->metric_names[j], sizeof(row->metric));
+                row->count = g->n;
+                row->min = v[0];
+                row->max = v[g->n - 1];
+                row->p50 = percentile(v, g->n, 0.5);
+                row->p90 = percentile(v, g->n, 0.9);
+                row->p99 = percentile(v, g->n, 0.99);
+            }
+            g->n = 0;
+        }
+        lp_io_table_define(s->identifier, sizeof(*rows),
+                sizeof(sample_columns) / sizeof(sample_columns[0]),
+                sample_columns);
+        lp_io_write(lp->gid, s->identifier, nrows * sizeof(*rows), rows);
+        free(rows);
+    }
+
+    assert(s->bins == b);
+    s->bins = b->next;
+    b->next = s->free_bins;
+    s->free_bins = b;
+}
+
+/* write out the bins no sample can arrive for anymore: a sample for an
+ * interval may be pushed up to one interval after it ended */
+static void emit_ready(struct codes_sampler *s, tw_stime h, tw_lp *lp)
+{
+    while(s->bins && (s->bins->interval + 1) * s->interval < h)
+        bin_emit(s, s->bins, lp);
+}
+
+/* move the samples of r pushed before h into the bins */
+static void ring_drain(struct codes_sample_ring *r, tw_stime h)
+{
+    while(r->count)
+    {
+        double *slot = ring_slot(r, 0);
+        if(slot[0] >= h)
+            break;
+        bin_add(r->s, r->group, slot[1], slot + 2);
+        r->head = (r->head + 1) % r->cap;
+        r->count--;
+    }
+}
+
+static void ring_grow(struct codes_sample_ring *r)
+{
+    int width = 2 + r->s->num_values;
+    double *slots = (double*)malloc((size_t)2 * r->cap * width * sizeof(double));
+    int i;
+
+    assert(slots);
+    for(i = 0; i < r->count; i++)
+        memcpy(slots + (size_t)i * width, ring_slot(r, i), width * sizeof(double));
+    free(r->slots);
+    r->slots = slots;
+    r->head = 0;
+    r->cap *= 2;
+}
+
+struct codes_sampler * codes_sampler_get(
+        char const * name,
+        int num_values,
+        int num_metrics,
+        char const * const * metric_names,
+        codes_sample_reduce_f reduce,
+        void * reduce_arg,
+        int num_groups,
+        tw_stime interval)
+{
+    struct codes_sampler *s;
+    int i;
+
+    assert(strlen(name) < SAMPLER_NAME_MAX);
+    for(s = samplers; s; s = s->next)
+        if(strcmp(s->name, name) == 0)
+            return s;
+
+    assert(num_metrics > 0 && num_groups > 0 && interval > 0);
+    assert(reduce || num_values == num_metrics);
+    s = (struct codes_sampler*)calloc(1, sizeof(*s));
+    assert(s);
+    strcpy(s->name, name);
+    sprintf(s->identifier, "%s-samples", name);
+    s->num_values = num_values;
+    s->num_metrics = num_metrics;
+    s->metric_names = (char (*)[CODES_SAMPLE_METRIC_MAX])calloc(num_metrics,
+            CODES_SAMPLE_METRIC_MAX);
+    assert(s->metric_names);
+    for(i = 0; i < num_metrics; i++)
+    {
+        assert(strlen(metric_names[i]) < CODES_SAMPLE_METRIC_MAX);
+        strcpy(s->metric_names[i], metric_names[i]);
+    }
+    s->reduce = reduce;
+    s->reduce_arg = reduce_arg;
+    s->num_groups = num_groups;
+    s->interval = interval;
+    s->drained = -1.0;
+    s->next = samplers;
+    samplers = s;
+    return s;
+}
+
+struct codes_sample_ring * codes_sample_ring_create(
+        struct codes_sampler * sampler,
+        int group,
+        int ring_size)
+{
+    struct codes_sample_ring *r;
+
+    assert(group >= 0 && group < sampler->num_groups);
+    r = (struct codes_sample_ring*)calloc(1, sizeof(*r));
+    assert(r);
+    r->s = sampler;
+    r->group = group;
+    sampler->num_rings++;
+
+    /* without rollback samples go straight into the bins */
+    if(is_optimistic())
+    {
+        r->cap = ring_size > 0 ? ring_size : CODES_SAMPLE_RING_SIZE;
+        r->slots = (double*)malloc((size_t)r->cap *
+                (2 + sampler->num_values) * sizeof(double));
+        assert(r->slots);
+        r->next = sampler->rings;
+        if(sampler->rings)
+            sampler->rings->prev = r;
+        sampler->rings = r;
+    }
+    return r;
+}
+
+void codes_sample_push(
+        struct codes_sample_ring * r,
+        tw_lp * lp,
+        tw_stime sample_time,
+        double const * values)
+{
+    struct codes_sampler *s = r->s;
+    tw_stime h = horizon(lp);
+    double *slot;
+
+    if(!r->slots)
+    {
+        bin_add(s, r->group, sample_time, values);
+        emit_ready(s, h, lp);
+        return;
+    }
+
+    /* GVT moved: everything before it is final, on every LP of this PE */
+    if(h > s->drained)
+    {
+        struct codes_sample_ring *it;
+        for(it = s->rings; it; it = it->next)
+            ring_drain(it, h);
+        s->drained = h;
+        emit_ready(s, h, lp);
+    }
+
+    if(r->count == r->cap)
+    {
+        if(!s->warned && !g_tw_mynode)
+        {
+            fprintf(stderr, "WARNING, %s: more than %d uncommitted samples "
+                    "per LP, growing the rings\n", s->identifier, r->cap);
+            s->warned = 1;
+        }
+        ring_grow(r);
+    }
+    slot = ring_slot(r, r->count++);
+    slot[0] = tw_now(lp);
+    slot[1] = sample_time;
+    memcpy(slot + 2, values, s->num_values * sizeof(double));
+}
+
+double const * codes_sample_push_rc(struct codes_sample_ring * r)
+{
+    assert(r->slots && r->count > 0);
+    r->count--;
+    return ring_slot(r, r->count) + 2;
+}
+
+void codes_sample_ring_destroy(struct codes_sample_ring * r, tw_lp * lp)
+{
+    struct codes_sampler *s;
+    struct codes_sampler **p;
+
+    /* sampling was never enabled for this lp */
+    if(!r)
+        return;
+    s = r->s;
+
+    /* the run is over, nothing can be rolled back */
+    if(r->slots)
+    {
+        ring_drain(r, HUGE_VAL);
+        if(r->prev)
+            r->prev->next = r->next;
+        else
+            s->rings = r->next;
+        if(r->next)
+            r->next->prev = r->prev;
+        free(r->slots);
+    }
+    free(r);
+    if(--s->num_rings)
+        return;
+
+    while(s->bins)
+        bin_emit(s, s->bins, lp);
+    while(s->free_bins)
+    {
+        struct sample_bin *b = s->free_bins;
+        int i;
+        s->free_bins = b->next;
+        for(i = 0; i < s->num_groups; i++)
+            free(b->groups[i].metrics);
+        free(b->groups);
+        free(b);
+    }
+    for(p = &samplers; *p != s; p = &(*p)->next)
+        ;
+    *p = s->next;
+    free(s->metric_names);
+    free(s->scratch);
+    free(s);
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
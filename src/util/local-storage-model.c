@@ -12,19 +12,17 @@
 #include <codes/codes_mapping.h>
 #include <codes/lp-type-lookup.h>
 #include <codes/local-storage-model.h>
+#include <codes/codes-category.h>
 #include <codes/quicklist.h>
 #include <codes/rc-stack.h>
 
-#define CATEGORY_NAME_MAX 16
-#define CATEGORY_MAX 12
-
 int lsm_in_sequence = 0;
 tw_stime lsm_msg_offset = 0.0;
 
 /* holds statistics about disk traffic on each LP */
 typedef struct lsm_stats_s
 {
-    char category[CATEGORY_NAME_MAX];
+    int used;
     long read_count;
     long read_bytes;
     long read_seeks;
@@ -35,6 +33,38 @@ typedef struct lsm_stats_s
     tw_stime write_time;
 } lsm_stats_t;
 
+/*
+ * order in which the explicit queue serves pending requests
+ *   - FIFO: arrival order
+ *   - SSTF: closest (object, offset) to the current disk position first
+ *   - ELEVATOR: sweep (object, offset) upwards then downwards (LOOK)
+ *   - DEADLINE: elevator, but the oldest request goes first once it has
+ *     waited longer than its read/write deadline
+ */
+enum lsm_sched_policy
+{
+    LSM_SCHED_FIFO,
+    LSM_SCHED_SSTF,
+    LSM_SCHED_ELEVATOR,
+    LSM_SCHED_DEADLINE
+};
+
+/*
+ * one size bin of the prepared rate model: the parameters at the bin's
+ * request size and their change per byte up to the next bin (0 without
+ * interpolation)
+ */
+typedef struct lsm_bin_s
+{
+    uint64_t size;
+    double rate;
+    double seek;
+    double overhead;
+    double rate_slope;
+    double seek_slope;
+    double overhead_slope;
+} lsm_bin_t;
+
 /*
  * disk model parameters
  */
@@ -48,10 +78,27 @@ typedef struct disk_model_s
     double *write_seeks;
     double *read_seeks;
     unsigned int bins;
+    // the tables above prepared as bins, [0] for writes and [1] for reads
+    lsm_bin_t *table[2];
+    // interpolate linearly between bins instead of rounding down
+    int interpolate_bins;
     // sched params
     //   0  - no scheduling
     //  >0  - make scheduler with use_sched priority lanes
     int use_sched;
+    enum lsm_sched_policy sched_policy;
+    // serve adjacent/overlapping queued requests as one transfer
+    int merge_requests;
+    // deadlines in ns
+    double read_deadline;
+    double write_deadline;
+    // NVMe mode (nvme_channels > 0): requests are striped over channels
+    // running in parallel, each at the rates of the bins
+    int nvme_channels;
+    // submission queues and the number of requests each keeps in flight
+    int nvme_queues;
+    int nvme_queue_depth;
+    uint64_t nvme_stripe_size;
 } disk_model_t;
 
 /*
@@ -67,7 +114,7 @@ typedef struct lsm_message_data_s
     uint64_t    object;
     uint64_t    offset;
     uint64_t    size;
-    char category[CATEGORY_NAME_MAX]; /* category for traffic */
+    int category; /* category id for traffic */
     int prio; // for scheduling
 } lsm_message_data_t;
 
@@ -76,7 +123,12 @@ typedef struct lsm_message_data_s
  */
 typedef struct lsm_sched_op_s
 {
+    lsm_event_t event;
     lsm_message_data_t data;
+    struct codes_cb_params cb;
+    tw_stime arrival;
+    // arrival order, queues are kept sorted by it
+    uint64_t seq;
     struct qlist_head ql;
 } lsm_sched_op_t;
 
@@ -92,6 +144,11 @@ typedef struct lsm_sched_s
     // scheduler mallocs data per-request - hold onto and free later
     struct rc_stack *freelist;
     struct qlist_head *queues;
+    // requests served by the current (possibly merged) transfer
+    struct qlist_head in_service;
+    uint64_t next_seq;
+    // elevator sweep direction: 1 up, -1 down
+    int direction;
 } lsm_sched_t;
 
 /*
@@ -108,10 +165,16 @@ typedef struct lsm_state_s
     disk_model_t *model;
     int64_t  current_offset;
     uint64_t current_object;
+    /* per-category stats, indexed by codes-category id */
     lsm_stats_t lsm_stats_array[CATEGORY_MAX];
     /* scheduling state */
     int use_sched;
     lsm_sched_t sched;
+    /* NVMe state: time each channel and submission queue slot frees up */
+    tw_stime *channel_idle;
+    tw_stime *slot_free;
+    // channel times overwritten by each request, for rc
+    struct rc_stack *nvme_rc;
 } lsm_state_t;
 
 /*
@@ -125,11 +188,14 @@ typedef struct lsm_message_s
 {
     int magic; /* magic number */
     lsm_event_t event;
-    int prio; // op priority (user-set on request, used by LSM in rc for complete)
     tw_stime    prev_idle;
     lsm_stats_t prev_stat;
     int64_t     prev_offset;
     uint64_t    prev_object;
+    int         prev_direction;
+    int         num_done; // requests completed (scheduler)
+    int         nvme_slot;
+    tw_stime    prev_slot_free;
     lsm_message_data_t data;
     struct codes_cb_params cb;
 } lsm_message_t;
@@ -143,14 +209,16 @@ static void lsm_rev_event (lsm_state_t *ns, tw_bf *b, lsm_message_t *m, tw_lp *l
 static void lsm_finalize (lsm_state_t *ns, tw_lp *lp);
 static void handle_io_sched_new(lsm_state_t *ns, tw_bf *b, lsm_message_t *m_in, tw_lp *lp);
 static void handle_rev_io_sched_new(lsm_state_t *ns, tw_bf *b, lsm_message_t *m_in, tw_lp *lp);
-static void handle_io_request(lsm_state_t *ns, tw_bf *b, lsm_message_data_t *data, lsm_message_t *m_in, tw_lp *lp);
+static void handle_io_request(lsm_state_t *ns, tw_bf *b, lsm_message_data_t *data, int rw, lsm_message_t *m_in, tw_lp *lp);
 static void handle_rev_io_request(lsm_state_t *ns, tw_bf *b, lsm_message_data_t *data, lsm_message_t *m_in, tw_lp *lp);
+static void handle_io_nvme(lsm_state_t *ns, tw_bf *b, lsm_message_t *m_in, tw_lp *lp);
+static void handle_rev_io_nvme(lsm_state_t *ns, tw_bf *b, lsm_message_t *m_in, tw_lp *lp);
 static void handle_io_sched_compl(lsm_state_t *ns, tw_bf *b, lsm_message_t *m_in, tw_lp *lp);
 static void handle_rev_io_sched_compl(lsm_state_t *ns, tw_bf *b, lsm_message_t *m_in, tw_lp *lp);
 static void handle_io_completion (lsm_state_t *ns, tw_bf *b, lsm_message_t *m_in, tw_lp *lp);
 static void handle_rev_io_completion (lsm_state_t *ns, tw_bf *b, lsm_message_t *m_in, tw_lp *lp);
-static lsm_stats_t *find_stats(const char* category, lsm_state_t *ns);
-static void write_stats(tw_lp* lp, lsm_stats_t* stat);
+static lsm_stats_t *find_stats(int category, lsm_state_t *ns);
+static void write_stats(tw_lp* lp, lsm_stats_t* stat, const char *category);
 
 /*
  * Globals
@@ -181,6 +249,41 @@ tw_lptype lsm_lp =
     sizeof(lsm_state_t)
 };
 
+/* bin of the nearest request size rounded down */
+static lsm_bin_t const *find_bin(disk_model_t const *model, int rw,
+        uint64_t size)
+{
+    lsm_bin_t const *table = model->table[rw];
+    unsigned int lo = 0, hi = model->bins;
+
+    // first bin larger than size
+    while (lo < hi)
+    {
+        unsigned int mid = lo + (hi - lo) / 2;
+        if (table[mid].size > size)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return &table[lo > 0 ? lo - 1 : 0];
+}
+
+/* disk parameters for a request of the given size */
+static void bin_params(disk_model_t const *model,
+                       int rw,
+                       uint64_t size,
+                       double *rate,
+                       double *seek,
+                       double *overhead)
+{
+    lsm_bin_t const *bin = find_bin(model, rw, size);
+    double d = size > bin->size ? (double)(size - bin->size) : 0.0;
+
+    *rate = bin->rate + d * bin->rate_slope;
+    *seek = bin->seek + d * bin->seek_slope;
+    *overhead = bin->overhead + d * bin->overhead_slope;
+}
+
 static tw_stime transfer_time_table (lsm_state_t *ns,
                                      lsm_stats_t *stat,
                                      int rw,
@@ -193,33 +296,8 @@ static tw_stime transfer_time_table (lsm_state_t *ns,
     double disk_rate;
     double disk_seek;
     double disk_overhead;
-    unsigned int i;
-
-    /* find nearest size rounded down. */
-    for (i = 0; i < ns->model->bins; i++)
-    {
-        if (ns->model->request_sizes[i] > size)
-        {
-            break;
-        }
-    }
-    if (i > 0) i--;
-
-    if (rw)
-    {
-        /* read */
-        disk_rate = ns->model->read_rates[i];
-        disk_seek = ns->model->read_seeks[i];
-        disk_overhead = ns->model->read_overheads[i];
-    }
-    else
-    {
-        /* write */
-        disk_rate = ns->model->write_rates[i];
-        disk_seek = ns->model->write_seeks[i];
-        disk_overhead = ns->model->write_overheads[i];
 
-    }
+    bin_params(ns->model, rw, size, &disk_rate, &disk_seek, &disk_overhead);
 
     /* transfer time */
     mb = ((double)size) / (1024.0 * 1024.0);
@@ -284,6 +362,8 @@ void lsm_io_event(
     assert(strlen(lp_io_category) > 0);
     SANITY_CHECK_CB(cb, lsm_return_t);
 
+    int category = codes_category_id(lp_io_category);
+
     tw_lpid lsm_id = codes_mctx_to_lpid(map_ctx, LSM_NAME, sender->gid);
 
     tw_stime delta = delay + codes_local_latency(sender);
@@ -300,7 +380,7 @@ void lsm_io_event(
     m->data.object = io_object;
     m->data.offset = io_offset;
     m->data.size   = io_size_bytes;
-    strcpy(m->data.category, lp_io_category);
+    m->data.category = category;
 
     // get the priority count for checking
     int num_prios = lsm_get_num_priorities(map_ctx, sender->gid);
@@ -381,6 +461,21 @@ static void lsm_lp_init (lsm_state_t *ns, tw_lp *lp)
             malloc(ns->sched.num_prios * sizeof(*ns->sched.queues));
         for (int i = 0; i < ns->sched.num_prios; i++)
             INIT_QLIST_HEAD(&ns->sched.queues[i]);
+        INIT_QLIST_HEAD(&ns->sched.in_service);
+        ns->sched.direction = 1;
+    }
+
+    if (ns->model->nvme_channels > 0) {
+        int num_slots = ns->model->nvme_queues * ns->model->nvme_queue_depth;
+        ns->channel_idle =
+            malloc(ns->model->nvme_channels * sizeof(*ns->channel_idle));
+        ns->slot_free = malloc(num_slots * sizeof(*ns->slot_free));
+        assert(ns->channel_idle && ns->slot_free);
+        for (int i = 0; i < ns->model->nvme_channels; i++)
+            ns->channel_idle[i] = tw_now(lp);
+        for (int i = 0; i < num_slots; i++)
+            ns->slot_free[i] = tw_now(lp);
+        rc_stack_create(&ns->nvme_rc);
     }
 
     return;
@@ -407,10 +502,13 @@ static void lsm_event (lsm_state_t *ns, tw_bf *b, lsm_message_t *m, tw_lp *lp)
                     (unsigned long long)m->data.offset,
                     (unsigned long long)m->data.size);
             assert(ns->model);
-            if (ns->use_sched)
+            if (ns->channel_idle)
+                handle_io_nvme(ns, b, m, lp);
+            else if (ns->use_sched)
                 handle_io_sched_new(ns, b, m, lp);
             else
-                handle_io_request(ns, b, &m->data, m, lp);
+                handle_io_request(ns, b, &m->data,
+                        m->event == LSM_READ_REQUEST, m, lp);
             break;
         case LSM_WRITE_COMPLETION:
         case LSM_READ_COMPLETION:
@@ -450,7 +548,9 @@ static void lsm_rev_event(lsm_state_t *ns,
                     (unsigned long long)m->data.object,
                     (unsigned long long)m->data.offset,
                     (unsigned long long)m->data.size);
-            if (ns->use_sched)
+            if (ns->channel_idle)
+                handle_rev_io_nvme(ns, b, m, lp);
+            else if (ns->use_sched)
                 handle_rev_io_sched_new(ns, b, m, lp);
             else
                 handle_rev_io_request(ns, b, &m->data, m, lp);
@@ -483,11 +583,10 @@ static void lsm_finalize(lsm_state_t *ns,
     lsm_stats_t all;
 
     memset(&all, 0, sizeof(all));
-    sprintf(all.category, "all");
 
     for(i=0; i<CATEGORY_MAX; i++)
     {
-        if(strlen(ns->lsm_stats_array[i].category) > 0)
+        if(ns->lsm_stats_array[i].used)
         {
             all.write_count += ns->lsm_stats_array[i].write_count;
             all.write_bytes += ns->lsm_stats_array[i].write_bytes;
@@ -498,15 +597,214 @@ static void lsm_finalize(lsm_state_t *ns,
             all.read_seeks += ns->lsm_stats_array[i].read_seeks;
             all.read_time += ns->lsm_stats_array[i].read_time;
 
-            write_stats(lp, &ns->lsm_stats_array[i]);
+            write_stats(lp, &ns->lsm_stats_array[i], codes_category_name(i));
         }
     }
 
-    write_stats(lp, &all);
+    write_stats(lp, &all, "all");
 
     return;
 }
 
+static void send_io_callback(
+        struct codes_cb_params const *cb,
+        tw_lp *lp)
+{
+    SANITY_CHECK_CB(&cb->info, lsm_return_t);
+
+    tw_event * e = tw_event_new(cb->h.src, codes_local_latency(lp), lp);
+    void * m = tw_event_data(e);
+
+    GET_INIT_CB_PTRS(cb, m, lp->gid, h, tag, rc, lsm_return_t);
+
+    /* no failures to speak of yet */
+    rc->rc = 0;
+
+    tw_event_send(e);
+}
+
+/* compare request positions, ordered by (object, offset) */
+static int sched_pos_cmp(
+        uint64_t object_a,
+        uint64_t offset_a,
+        uint64_t object_b,
+        uint64_t offset_b)
+{
+    if (object_a != object_b)
+        return object_a < object_b ? -1 : 1;
+    if (offset_a != offset_b)
+        return offset_a < offset_b ? -1 : 1;
+    return 0;
+}
+
+static uint64_t sched_dist(uint64_t a, uint64_t b)
+{
+    return a > b ? a - b : b - a;
+}
+
+/* shortest seek: nearest object first, then nearest offset within it */
+static lsm_sched_op_t *sched_pick_sstf(
+        lsm_state_t *ns,
+        struct qlist_head *queue)
+{
+    lsm_sched_op_t *op, *best = NULL;
+    uint64_t best_obj = 0, best_off = 0;
+
+    qlist_for_each_entry(op, queue, ql) {
+        uint64_t d_obj = sched_dist(op->data.object, ns->current_object);
+        uint64_t d_off = d_obj ? op->data.offset :
+            sched_dist(op->data.offset, ns->current_offset);
+        if (best == NULL || d_obj < best_obj ||
+                (d_obj == best_obj && d_off < best_off)) {
+            best = op;
+            best_obj = d_obj;
+            best_off = d_off;
+        }
+    }
+    return best;
+}
+
+/* LOOK: nearest request in the sweep direction, turning around at the last
+ * one */
+static lsm_sched_op_t *sched_pick_elevator(
+        lsm_state_t *ns,
+        struct qlist_head *queue)
+{
+    lsm_sched_op_t *op, *best;
+
+    for (int turn = 0; turn < 2; turn++) {
+        int dir = ns->sched.direction;
+        best = NULL;
+        qlist_for_each_entry(op, queue, ql) {
+            int c = sched_pos_cmp(op->data.object, op->data.offset,
+                    ns->current_object, ns->current_offset);
+            if (c * dir < 0)
+                continue;
+            if (best == NULL || sched_pos_cmp(op->data.object,
+                        op->data.offset, best->data.object,
+                        best->data.offset) * dir < 0)
+                best = op;
+        }
+        if (best)
+            return best;
+        ns->sched.direction = -dir;
+    }
+    assert(0);
+    return NULL;
+}
+
+static lsm_sched_op_t *sched_pick(
+        lsm_state_t *ns,
+        struct qlist_head *queue,
+        tw_lp *lp)
+{
+    lsm_sched_op_t *oldest = qlist_entry(queue->next, lsm_sched_op_t, ql);
+
+    switch (ns->model->sched_policy) {
+        case LSM_SCHED_SSTF:
+            return sched_pick_sstf(ns, queue);
+        case LSM_SCHED_ELEVATOR:
+            return sched_pick_elevator(ns, queue);
+        case LSM_SCHED_DEADLINE:
+        {
+            double deadline = oldest->event == LSM_READ_REQUEST ?
+                ns->model->read_deadline : ns->model->write_deadline;
+            if (tw_now(lp) - oldest->arrival >= deadline)
+                return oldest;
+            return sched_pick_elevator(ns, queue);
+        }
+        default:
+            return oldest;
+    }
+}
+
+/* put a request back into its lane, in arrival order */
+static void sched_requeue(lsm_state_t *ns, lsm_sched_op_t *op)
+{
+    struct qlist_head *queue = &ns->sched.queues[op->data.prio];
+    struct qlist_head *pos;
+
+    qlist_for_each(pos, queue) {
+        if (qlist_entry(pos, lsm_sched_op_t, ql)->seq > op->seq)
+            break;
+    }
+    qlist_add_tail(&op->ql, pos);
+}
+
+/* start the next transfer if the disk is free. Returns 1 if one started */
+static int sched_dispatch(
+        lsm_state_t *ns,
+        tw_bf *b,
+        lsm_message_t *m_in,
+        tw_lp *lp)
+{
+    struct qlist_head *queue = NULL;
+    lsm_sched_op_t *op, *next;
+    lsm_message_data_t data;
+    uint64_t lo, hi;
+
+    if (!qlist_empty(&ns->sched.in_service))
+        return 0;
+    for (int i = 0; i < ns->sched.num_prios; i++) {
+        if (!qlist_empty(&ns->sched.queues[i])) {
+            queue = &ns->sched.queues[i];
+            break;
+        }
+    }
+    if (queue == NULL)
+        return 0;
+
+    m_in->prev_direction = ns->sched.direction;
+    op = sched_pick(ns, queue, lp);
+    qlist_del(&op->ql);
+    qlist_add_tail(&op->ql, &ns->sched.in_service);
+
+    data = op->data;
+    lo = data.offset;
+    hi = data.offset + data.size;
+    if (ns->model->merge_requests) {
+        // absorb queued requests touching the transfer until none is left
+        do {
+            qlist_for_each_entry(next, queue, ql) {
+                if (next->event == op->event &&
+                        next->data.object == data.object &&
+                        next->data.offset <= hi &&
+                        next->data.offset + next->data.size >= lo)
+                    break;
+            }
+            if (&next->ql == queue)
+                break;
+            qlist_del(&next->ql);
+            qlist_add_tail(&next->ql, &ns->sched.in_service);
+            if (next->data.offset < lo)
+                lo = next->data.offset;
+            if (next->data.offset + next->data.size > hi)
+                hi = next->data.offset + next->data.size;
+        } while (1);
+        data.offset = lo;
+        data.size = hi - lo;
+    }
+
+    handle_io_request(ns, b, &data, op->event == LSM_READ_REQUEST, m_in, lp);
+    return 1;
+}
+
+static void sched_dispatch_rc(
+        lsm_state_t *ns,
+        tw_bf *b,
+        lsm_message_t *m_in,
+        tw_lp *lp)
+{
+    struct qlist_head *ent;
+    lsm_sched_op_t *op;
+
+    op = qlist_entry(ns->sched.in_service.next, lsm_sched_op_t, ql);
+    handle_rev_io_request(ns, b, &op->data, m_in, lp);
+    ns->sched.direction = m_in->prev_direction;
+    while ((ent = qlist_pop(&ns->sched.in_service)) != NULL)
+        sched_requeue(ns, qlist_entry(ent, lsm_sched_op_t, ql));
+}
+
 static void handle_io_sched_new(
         lsm_state_t *ns,
         tw_bf *b,
@@ -515,15 +813,18 @@ static void handle_io_sched_new(
 {
     if (LSM_DEBUG)
         printf("handle_io_sched_new called\n");
-    // if nothing else is going on, then issue directly
-    if (!ns->sched.active_count)
-        handle_io_request(ns, b, &m_in->data, m_in, lp);
-    else {
-        lsm_sched_op_t *op = malloc(sizeof(*op));
-        op->data = m_in->data;
-        qlist_add_tail(&op->ql, &ns->sched.queues[m_in->prio]);
-    }
+    lsm_sched_op_t *op = malloc(sizeof(*op));
+    assert(op);
+    op->event = m_in->event;
+    op->data = m_in->data;
+    op->cb = m_in->cb;
+    op->arrival = tw_now(lp);
+    op->seq = ns->sched.next_seq++;
+    qlist_add_tail(&op->ql, &ns->sched.queues[op->data.prio]);
     ns->sched.active_count++;
+
+    // if nothing else is going on, then issue directly
+    b->c0 = sched_dispatch(ns, b, m_in, lp);
 }
 
 static void handle_rev_io_sched_new(
@@ -534,15 +835,16 @@ static void handle_rev_io_sched_new(
 {
     if (LSM_DEBUG)
         printf("handle_rev_io_sched_new called\n");
+    if (b->c0)
+        sched_dispatch_rc(ns, b, m_in, lp);
+    // the newest request is always last in its lane
+    struct qlist_head *ent = qlist_pop_back(&ns->sched.queues[m_in->data.prio]);
+    assert(ent);
+    lsm_sched_op_t *op = qlist_entry(ent, lsm_sched_op_t, ql);
+    assert(op->seq == ns->sched.next_seq - 1);
+    free(op);
+    ns->sched.next_seq--;
     ns->sched.active_count--;
-    if (!ns->sched.active_count)
-        handle_rev_io_request(ns, b, &m_in->data, m_in, lp);
-    else {
-        struct qlist_head *ent = qlist_pop_back(&ns->sched.queues[m_in->prio]);
-        assert(ent);
-        lsm_sched_op_t *op = qlist_entry(ent, lsm_sched_op_t, ql);
-        free(op);
-    }
 }
 
 static void handle_io_sched_compl(
@@ -551,25 +853,25 @@ static void handle_io_sched_compl(
         lsm_message_t *m_in,
         tw_lp *lp)
 {
+    struct qlist_head *ent;
+
     if (LSM_DEBUG)
         printf("handle_io_sched_compl called\n");
-    ns->sched.active_count--;
-    if (ns->sched.active_count) {
-        lsm_sched_op_t *next = NULL;
-        struct qlist_head *ent = NULL;
-        for (int i = 0; i < ns->sched.num_prios; i++) {
-            ent = qlist_pop(&ns->sched.queues[i]);
-            if (ent != NULL) {
-                next = qlist_entry(ent, lsm_sched_op_t, ql);
-                m_in->prio = i;
-                break;
-            }
-        }
-        assert(next);
-        handle_io_request(ns, b, &next->data, m_in, lp);
+    rc_stack_gc(lp, ns->sched.freelist);
+
+    // complete every request served by the transfer
+    m_in->num_done = 0;
+    while ((ent = qlist_pop(&ns->sched.in_service)) != NULL) {
+        lsm_sched_op_t *op = qlist_entry(ent, lsm_sched_op_t, ql);
+        send_io_callback(&op->cb, lp);
         // now done with this request metadata
-        rc_stack_push(lp, next, free, ns->sched.freelist);
+        rc_stack_push(lp, op, free, ns->sched.freelist);
+        m_in->num_done++;
+        ns->sched.active_count--;
     }
+    assert(m_in->num_done > 0);
+
+    b->c0 = sched_dispatch(ns, b, m_in, lp);
 }
 
 static void handle_rev_io_sched_compl(
@@ -580,15 +882,16 @@ static void handle_rev_io_sched_compl(
 {
     if (LSM_DEBUG)
         printf("handle_rev_io_sched_compl called\n");
-    if (ns->sched.active_count) {
-        lsm_sched_op_t *prev = rc_stack_pop(ns->sched.freelist);
-        handle_rev_io_request(ns, b, &prev->data, m_in, lp);
-        qlist_add_tail(&prev->ql, &ns->sched.queues[m_in->prio]);
+    if (b->c0)
+        sched_dispatch_rc(ns, b, m_in, lp);
+    for (int i = 0; i < m_in->num_done; i++) {
+        lsm_sched_op_t *op = rc_stack_pop(ns->sched.freelist);
+        qlist_add(&op->ql, &ns->sched.in_service);
+        codes_local_latency_reverse(lp);
+        ns->sched.active_count++;
     }
-    ns->sched.active_count++;
 }
 
-
 /*
  * handle_io_request
  *   - handles the IO request events
@@ -598,6 +901,7 @@ static void handle_rev_io_sched_compl(
 static void handle_io_request(lsm_state_t *ns,
                               tw_bf *b,
                               lsm_message_data_t *data,
+                              int rw,
                               lsm_message_t *m_in,
                               tw_lp *lp)
 {
@@ -606,7 +910,6 @@ static void handle_io_request(lsm_state_t *ns,
     tw_event *e;
     lsm_message_t *m_out;
     lsm_stats_t *stat;
-    int rw = (m_in->event == LSM_READ_REQUEST) ? 1 : 0;
 
     tw_stime (*transfer_time) (lsm_state_t *, lsm_stats_t *, int, uint64_t, int64_t, uint64_t);
 
@@ -619,6 +922,7 @@ static void handle_io_request(lsm_state_t *ns,
     m_in->prev_stat   = *stat;
     m_in->prev_object = ns->current_object;
     m_in->prev_offset = ns->current_offset;
+    stat->used = 1;
 
     if (ns->next_idle > tw_now(lp))
     {
@@ -645,17 +949,15 @@ static void handle_io_request(lsm_state_t *ns,
     m_out = (lsm_message_t*)tw_event_data(e);
 
     memcpy(m_out, m_in, sizeof(*m_in));
-    if (m_out->event == LSM_WRITE_REQUEST)
+    if (rw)
     {
-        m_out->event = LSM_WRITE_COMPLETION;
+        m_out->event = LSM_READ_COMPLETION;
     }
     else
     {
-        m_out->event = LSM_READ_COMPLETION;
+        m_out->event = LSM_WRITE_COMPLETION;
     }
 
-    m_out->prio = m_in->prio;
-
     tw_event_send(e);
 
     return;
@@ -686,6 +988,151 @@ static void handle_rev_io_request(lsm_state_t *ns,
     return;
 }
 
+/*
+ * nvme_layout
+ *   - the stripes of a request go round-robin over the channels, starting
+ *     at first_channel. Returns the number of channels touched and fills in
+ *     the bytes each of them transfers
+ */
+static int nvme_layout(disk_model_t const *model,
+                       lsm_message_data_t const *data,
+                       int *first_channel,
+                       uint64_t *bytes)
+{
+    uint64_t stripe = model->nvme_stripe_size;
+    uint64_t n = model->nvme_channels;
+    uint64_t end = data->offset + data->size;
+    uint64_t first = data->offset / stripe;
+    uint64_t num_stripes = data->size ? (end - 1) / stripe - first + 1 : 1;
+    int touched = num_stripes < n ? num_stripes : n;
+
+    *first_channel = (data->object + first) % n;
+    for (int j = 0; j < touched; j++)
+        bytes[j] = ((num_stripes - j + n - 1) / n) * stripe;
+    // partial first and last stripes
+    bytes[0] -= data->offset % stripe;
+    bytes[(num_stripes - 1) % n] -= (stripe - end % stripe) % stripe;
+    if (data->size == 0)
+        bytes[0] = 0;
+    return touched;
+}
+
+/*
+ * handle_io_nvme
+ *   - NVMe mode: the request waits for a slot of its submission queue, then
+ *     its stripes are transferred by their channels in parallel
+ */
+static void handle_io_nvme(lsm_state_t *ns,
+                           tw_bf *b,
+                           lsm_message_t *m_in,
+                           tw_lp *lp)
+{
+    (void)b;
+    disk_model_t const *model = ns->model;
+    lsm_message_data_t const *data = &m_in->data;
+    int rw = (m_in->event == LSM_READ_REQUEST) ? 1 : 0;
+    int depth = model->nvme_queue_depth;
+    tw_stime *slots;
+    tw_stime start, finish, service = 0.0, *prev;
+    uint64_t *bytes;
+    double rate, seek, overhead;
+    int first, touched, s = 0;
+    tw_event *e;
+    lsm_message_t *m_out;
+    lsm_stats_t *stat;
+
+    rc_stack_gc(lp, ns->nvme_rc);
+    stat = find_stats(data->category, ns);
+    m_in->prev_stat = *stat;
+    stat->used = 1;
+
+    // earliest free slot of the sender's submission queue
+    slots = &ns->slot_free[(m_in->cb.h.src % model->nvme_queues) * depth];
+    for (int i = 1; i < depth; i++)
+        if (slots[i] < slots[s])
+            s = i;
+    start = slots[s] > tw_now(lp) ? slots[s] : tw_now(lp);
+
+    bin_params(model, rw, data->size, &rate, &seek, &overhead);
+
+    bytes = malloc(model->nvme_channels * sizeof(*bytes));
+    prev = malloc(model->nvme_channels * sizeof(*prev));
+    assert(bytes && prev);
+    touched = nvme_layout(model, data, &first, bytes);
+    finish = start;
+    for (int j = 0; j < touched; j++) {
+        int c = (first + j) % model->nvme_channels;
+        tw_stime begin = ns->channel_idle[c] > start ? ns->channel_idle[c] : start;
+        tw_stime t = ((double)bytes[j] / (1024.0 * 1024.0)) / rate *
+            1000.0 * 1000.0 * 1000.0;
+        prev[j] = ns->channel_idle[c];
+        ns->channel_idle[c] = begin + t;
+        if (t > service)
+            service = t;
+        if (ns->channel_idle[c] > finish)
+            finish = ns->channel_idle[c];
+    }
+    free(bytes);
+    rc_stack_push(lp, prev, free, ns->nvme_rc);
+
+    /* request overhead */
+    finish += overhead * 1000.0;
+    service += overhead * 1000.0;
+
+    m_in->nvme_slot = s;
+    m_in->prev_slot_free = slots[s];
+    slots[s] = finish;
+
+    /* update statistics, the time not counting waits for busy channels */
+    if (rw)
+    {
+        stat->read_count += 1;
+        stat->read_bytes += data->size;
+        stat->read_time  += service;
+    }
+    else
+    {
+        stat->write_count += 1;
+        stat->write_bytes += data->size;
+        stat->write_time  += service;
+    }
+
+    e = tw_event_new(lp->gid, finish - tw_now(lp), lp);
+    m_out = (lsm_message_t*)tw_event_data(e);
+    memcpy(m_out, m_in, sizeof(*m_in));
+    m_out->event = rw ? LSM_READ_COMPLETION : LSM_WRITE_COMPLETION;
+    tw_event_send(e);
+}
+
+static void handle_rev_io_nvme(lsm_state_t *ns,
+                               tw_bf *b,
+                               lsm_message_t *m_in,
+                               tw_lp *lp)
+{
+    (void)b;
+    (void)lp;
+    disk_model_t const *model = ns->model;
+    tw_stime *slots;
+    tw_stime *prev;
+    uint64_t *bytes;
+    int first, touched;
+
+    *find_stats(m_in->data.category, ns) = m_in->prev_stat;
+
+    slots = &ns->slot_free[(m_in->cb.h.src % model->nvme_queues) *
+        model->nvme_queue_depth];
+    slots[m_in->nvme_slot] = m_in->prev_slot_free;
+
+    bytes = malloc(model->nvme_channels * sizeof(*bytes));
+    assert(bytes);
+    touched = nvme_layout(model, &m_in->data, &first, bytes);
+    free(bytes);
+    prev = rc_stack_pop(ns->nvme_rc);
+    for (int j = 0; j < touched; j++)
+        ns->channel_idle[(first + j) % model->nvme_channels] = prev[j];
+    free(prev);
+}
+
 /*
  * handle_io_completion
  *   - handle IO completion events
@@ -696,21 +1143,12 @@ static void handle_io_completion (lsm_state_t *ns,
                                   lsm_message_t *m_in,
                                   tw_lp *lp)
 {
-    SANITY_CHECK_CB(&m_in->cb.info, lsm_return_t);
-
-    tw_event * e = tw_event_new(m_in->cb.h.src, codes_local_latency(lp), lp);
-    void * m = tw_event_data(e);
-
-    GET_INIT_CB_PTRS(&m_in->cb, m, lp->gid, h, tag, rc, lsm_return_t);
-
-    /* no failures to speak of yet */
-    rc->rc = 0;
-
-    tw_event_send(e);
-
-    // continue the loop
+    // the scheduler completes all requests of the transfer and continues
+    // the loop
     if (ns->use_sched)
         handle_io_sched_compl(ns, b, m_in, lp);
+    else
+        send_io_callback(&m_in->cb, lp);
 
     return;
 }
@@ -718,7 +1156,6 @@ static void handle_io_completion (lsm_state_t *ns,
 /*
  * handle_rev_io_completion
  *   - reverse io completion event
- *   - currently nothing to do in this case
  */
 static void handle_rev_io_completion (lsm_state_t *ns,
                                       tw_bf *b,
@@ -727,49 +1164,27 @@ static void handle_rev_io_completion (lsm_state_t *ns,
 {
     if (ns->use_sched)
         handle_rev_io_sched_compl(ns, b, m_in, lp);
-
-    codes_local_latency_reverse(lp);
+    else
+        codes_local_latency_reverse(lp);
     return;
 }
 
-static lsm_stats_t *find_stats(const char* category, lsm_state_t *ns)
+/* stats of a category: the LP's table is indexed by the registered id. A
+ * category is marked used by the forward handlers, after the history is
+ * saved, so that rolling back its first request unmarks it */
+static lsm_stats_t *find_stats(int category, lsm_state_t *ns)
 {
-    int i;
-    int new_flag = 0;
-    int found_flag = 0;
-
-    for(i=0; i<CATEGORY_MAX; i++)
-    {
-        if(strlen(ns->lsm_stats_array[i].category) == 0)
-        {
-            found_flag = 1;
-            new_flag = 1;
-            break;
-        }
-        if(strcmp(category, ns->lsm_stats_array[i].category) == 0)
-        {
-            found_flag = 1;
-            new_flag = 0;
-            break;
-        }
-    }
-    assert(found_flag);
-
-    if(new_flag)
-    {
-        strcpy(ns->lsm_stats_array[i].category, category);
-    }
-    return(&ns->lsm_stats_array[i]);
-
+    assert(category >= 0 && category < CATEGORY_MAX);
+    return(&ns->lsm_stats_array[category]);
 }
 
-static void write_stats(tw_lp* lp, lsm_stats_t* stat)
+static void write_stats(tw_lp* lp, lsm_stats_t* stat, const char *category)
 {
     int ret;
     char id[32];
     char data[1024];
 
-    sprintf(id, "lsm-category-%s", stat->category);
+    sprintf(id, "lsm-category-%s", category);
     sprintf(data, "lp:%ld\twrite_count:%ld\twrite_bytes:%ld\twrite_seeks:%ld\twrite_time:%f\t"
         "read_count:%ld\tread_bytes:%ld\tread_seeks:%ld\tread_time:%f\n",
         (long)lp->gid,
@@ -799,12 +1214,52 @@ void lsm_register(void)
     lp_type_register(LSM_NAME, &lsm_lp);
 }
 
+// build the bins of the parsed tables, which must be sorted by size
+static void prepare_bins(disk_model_t *model)
+{
+    for (unsigned int i = 1; i < model->bins; i++)
+    {
+        if (model->request_sizes[i] <= model->request_sizes[i-1])
+            tw_error(TW_LOC, "LSM request_sizes must be increasing");
+    }
+
+    for (int rw = 0; rw < 2; rw++)
+    {
+        double const *rates = rw ? model->read_rates : model->write_rates;
+        double const *seeks = rw ? model->read_seeks : model->write_seeks;
+        double const *overheads =
+            rw ? model->read_overheads : model->write_overheads;
+        lsm_bin_t *table = calloc(model->bins, sizeof(*table));
+
+        assert(table);
+        for (unsigned int i = 0; i < model->bins; i++)
+        {
+            table[i].size = model->request_sizes[i];
+            table[i].rate = rates[i];
+            table[i].seek = seeks[i];
+            table[i].overhead = overheads[i];
+            if (model->interpolate_bins && i + 1 < model->bins)
+            {
+                double span = (double)(model->request_sizes[i+1] -
+                        model->request_sizes[i]);
+                table[i].rate_slope = (rates[i+1] - rates[i]) / span;
+                table[i].seek_slope = (seeks[i+1] - seeks[i]) / span;
+                table[i].overhead_slope =
+                    (overheads[i+1] - overheads[i]) / span;
+            }
+        }
+        model->table[rw] = table;
+    }
+}
+
 // read the configuration file for a given annotation
 static void read_config(ConfigHandle *ch, char const * anno, disk_model_t *model)
 {
     char       **values;
     size_t       length;
     int          rc;
+
+    memset(model, 0, sizeof(*model));
     // request sizes
     rc = configuration_get_multivalue(ch, LSM_NAME, "request_sizes", anno,
             &values,&length);
@@ -896,10 +1351,75 @@ static void read_config(ConfigHandle *ch, char const * anno, disk_model_t *model
     }
     free(values);
 
+    configuration_get_value_int(ch, LSM_NAME, "interpolate_bins", anno,
+            &model->interpolate_bins);
+    prepare_bins(model);
+
     // scheduling parameters (this can fail)
     configuration_get_value_int(ch, LSM_NAME, "enable_scheduler", anno,
             &model->use_sched);
     assert(model->use_sched >= 0);
+
+    char policy[32];
+    model->sched_policy = LSM_SCHED_FIFO;
+    rc = configuration_get_value(ch, LSM_NAME, "scheduler_policy", anno,
+            policy, sizeof(policy));
+    if (rc > 0) {
+        if (strcmp(policy, "fifo") == 0)
+            model->sched_policy = LSM_SCHED_FIFO;
+        else if (strcmp(policy, "sstf") == 0)
+            model->sched_policy = LSM_SCHED_SSTF;
+        else if (strcmp(policy, "elevator") == 0)
+            model->sched_policy = LSM_SCHED_ELEVATOR;
+        else if (strcmp(policy, "deadline") == 0)
+            model->sched_policy = LSM_SCHED_DEADLINE;
+        else
+            tw_error(TW_LOC, "unknown LSM scheduler_policy \"%s\" "
+                    "(expected fifo, sstf, elevator or deadline)", policy);
+    }
+
+    model->merge_requests = 0;
+    configuration_get_value_int(ch, LSM_NAME, "merge_requests", anno,
+            &model->merge_requests);
+
+    // deadlines in microseconds, defaults as in the Linux deadline scheduler
+    model->read_deadline = 500.0 * 1000.0;
+    model->write_deadline = 5000.0 * 1000.0;
+    configuration_get_value_double(ch, LSM_NAME, "read_deadline", anno,
+            &model->read_deadline);
+    configuration_get_value_double(ch, LSM_NAME, "write_deadline", anno,
+            &model->write_deadline);
+    model->read_deadline *= 1000.0;
+    model->write_deadline *= 1000.0;
+
+    // reordering and merging need the explicit queue
+    if (model->use_sched == 0 &&
+            (model->sched_policy != LSM_SCHED_FIFO || model->merge_requests))
+        model->use_sched = 1;
+
+    // NVMe mode
+    configuration_get_value_int(ch, LSM_NAME, "nvme_channels", anno,
+            &model->nvme_channels);
+    if (model->nvme_channels > 0) {
+        long int stripe = 128 * 1024;
+        if (model->use_sched)
+            tw_error(TW_LOC, "LSM nvme_channels can't be combined with the "
+                    "explicit scheduler (enable_scheduler, scheduler_policy, "
+                    "merge_requests)");
+        model->nvme_queues = 1;
+        model->nvme_queue_depth = 32;
+        configuration_get_value_int(ch, LSM_NAME, "nvme_queues", anno,
+                &model->nvme_queues);
+        configuration_get_value_int(ch, LSM_NAME, "nvme_queue_depth", anno,
+                &model->nvme_queue_depth);
+        configuration_get_value_longint(ch, LSM_NAME, "nvme_stripe_size", anno,
+                &stripe);
+        if (model->nvme_queues <= 0 || model->nvme_queue_depth <= 0 ||
+                stripe <= 0)
+            tw_error(TW_LOC, "LSM nvme_queues, nvme_queue_depth and "
+                    "nvme_stripe_size must be positive");
+        model->nvme_stripe_size = stripe;
+    }
 }
 
 void lsm_configure(void)
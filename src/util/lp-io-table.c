@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2013 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <codes/lp-io-table.h>
+
+struct table_header
+{
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t row_size;
+    uint32_t num_columns;
+    uint32_t reserved;
+};
+
+struct table_column
+{
+    char name[LP_IO_TABLE_NAME_MAX];
+    char type[8];
+    uint32_t offset;
+    uint32_t count;
+};
+
+static char const * const type_codes[] = {
+    "i4", "u4", "i8", "u8", "f8", "S"
+};
+
+int lp_io_table_header(
+        int row_size,
+        int num_columns,
+        struct lp_io_column const * columns,
+        void ** header)
+{
+    struct table_header *h;
+    struct table_column *c;
+    int size = sizeof(*h) + num_columns * sizeof(*c);
+    int i;
+
+    for(i = 0; i < num_columns; i++)
+    {
+        struct lp_io_column const *col = &columns[i];
+        if(strlen(col->name) >= LP_IO_TABLE_NAME_MAX || col->count < 1 ||
+                col->offset < 0 || col->offset +
+                col->count * LP_IO_COL_SIZE(col->type) > row_size)
+        {
+            fprintf(stderr, "Error: bad lp-io table column %s.\n", col->name);
+            return(-1);
+        }
+    }
+
+    h = (struct table_header*)calloc(1, size);
+    if(!h)
+        return(-1);
+    memcpy(h->magic, LP_IO_TABLE_MAGIC, sizeof(h->magic));
+    h->byte_order = LP_IO_TABLE_BYTE_ORDER;
+    h->version = LP_IO_TABLE_VERSION;
+    h->header_size = size;
+    h->row_size = row_size;
+    h->num_columns = num_columns;
+
+    c = (struct table_column*)(h+1);
+    for(i = 0; i < num_columns; i++)
+    {
+        strcpy(c[i].name, columns[i].name);
+        c[i].offset = columns[i].offset;
+        if(columns[i].type == LP_IO_COL_CHAR)
+        {
+            /* strings are a single element of the full length */
+            snprintf(c[i].type, sizeof(c[i].type), "S%d", columns[i].count);
+            c[i].count = 1;
+        }
+        else
+        {
+            strcpy(c[i].type, type_codes[columns[i].type]);
+            c[i].count = columns[i].count;
+        }
+    }
+
+    *header = h;
+    return(size);
+}
+
+int lp_io_table_define(
+        char * identifier,
+        int row_size,
+        int num_columns,
+        struct lp_io_column const * columns)
+{
+    void *header;
+    int ret;
+    int size = lp_io_table_header(row_size, num_columns, columns, &header);
+
+    if(size < 0)
+        return(-1);
+    ret = lp_io_write_header(identifier, size, header);
+    free(header);
+    return(ret);
+}
+
+int lp_io_table_fwrite_header(
+        FILE * fp,
+        int row_size,
+        int num_columns,
+        struct lp_io_column const * columns)
+{
+    void *header;
+    int size;
+    size_t written;
+
+    if(fseek(fp, 0, SEEK_END) != 0)
+        return(-1);
+    if(ftell(fp) != 0)
+        return(0);
+    size = lp_io_table_header(row_size, num_columns, columns, &header);
+    if(size < 0)
+        return(-1);
+    written = fwrite(header, size, 1, fp);
+    free(header);
+    return(written == 1 ? 0 : -1);
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ft=c ts=8 sts=4 sw=4 expandtab
+ */
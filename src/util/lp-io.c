@@ -10,156 +10,537 @@
 
 #include <codes/lp-io.h>
 #include <codes/codes.h>
+#include <codes/jenkins-hash.h>
 
-struct io_buffer
+/* Data written to an identifier is appended to a list of chunks: each record
+ * is a header followed by the payload, padded to 8 bytes. Reversed records
+ * are marked dead (or popped if they are the newest one) and skipped on
+ * output.
+ *
+ * Identifiers are interned in a hash table, and each identifier indexes the
+ * newest record of every LP writing to it; records link to the previous
+ * write of the same LP, so lp_io_write_rev() is O(1).
+ *
+ * In streaming mode (LP_IO_STREAM) the oldest records of an identifier are
+ * moved out of memory once they can no longer be rolled back (older than
+ * GVT in optimistic mode, always otherwise): their payloads are copied into
+ * one of two staging buffers and appended to a per-rank spill file with a
+ * nonblocking write while the other buffer is being filled. lp_io_flush()
+ * then writes the spilled segments followed by the in-memory records, so the
+ * output is the same as without streaming. */
+
+#define LP_IO_ID_MAX 64
+#define LP_IO_CHUNK_SIZE (64*1024)
+/* streaming: try to spill an identifier once it holds this much in memory */
+#define LP_IO_SPILL_SIZE (1024*1024)
+/* streaming: upper bound on a single spill write (unless a record is larger) */
+#define LP_IO_STAGE_SIZE (4*1024*1024)
+
+#define IO_RECORD_DEAD 1
+
+struct io_chunk;
+
+/* location of a record. pos is its position in the identifier's record
+ * stream, which never decreases: a location below the oldest record still
+ * in memory was spilled and its chunk may be gone */
+struct io_loc
+{
+    struct io_chunk *chunk;
+    uint64_t pos;
+};
+
+struct io_record
 {
     tw_lpid gid;
+    tw_stime ts; /* time of the write, streaming in optimistic mode only */
     int size;
-    void* buffer;
-    struct io_buffer *next;
+    int prev; /* offset of the previous record in the chunk, -1 if none */
+    int flags;
+    struct io_loc prev_write; /* previous record of the same LP */
+};
+
+struct io_chunk
+{
+    struct io_chunk *next, *prev;
+    uint64_t base; /* stream position of data[0] */
+    int cap;
+    int used;
+    int head; /* offset of the oldest record still in memory */
+    int last; /* offset of the newest record, -1 if none */
+    char *data;
+};
+
+/* newest record of an LP, chunk == NULL if it has none in memory */
+struct gid_slot
+{
+    tw_lpid gid;
+    int used;
+    struct io_loc last_write;
+};
+
+struct spill_seg
+{
+    MPI_Offset off;
+    int len;
 };
 
 struct identifier
 {
-    char identifier[64];
-    struct io_buffer *buffers;
+    char identifier[LP_IO_ID_MAX];
+    struct io_chunk *chunks, *tail;
+    /* live records and their payload bytes still in memory */
     int buffers_count;
-    int buffers_total_size;
+    long buffers_total_size;
+    /* streaming: data already in the spill file, in write order */
+    struct spill_seg *segs;
+    int segs_count, segs_cap;
+    long spilled_size;
+    tw_stime spill_gvt; /* GVT at the last spill attempt */
+    uint64_t next_base;
+    /* data put at the start of the file, see lp_io_write_header() */
+    char *header;
+    int header_size;
+    /* open-addressed gid -> newest record index */
+    struct gid_slot *gids;
+    int gids_cap, gids_count;
     struct identifier *next;
 };
 
-/* local list of identifiers */
+enum lp_io_stream_mode {
+    STREAM_OFF,
+    STREAM_ALL,       /* no rollback: every record can be spilled */
+    STREAM_GVT,       /* optimistic: records older than GVT */
+    STREAM_NEVER      /* optimistic debug: everything may be rolled back */
+};
+
+/* local list of identifiers, also interned in id_table (open addressing,
+ * power of two size, never more than half full) */
 static struct identifier* identifiers = NULL;
 int identifiers_count = 0;
+static struct identifier **id_table = NULL;
+static int id_table_cap = 0;
 
-/* array of all identifiers used across all procs */
-struct identifier global_identifiers[64];
-int global_identifiers_count = 0;
+static struct
+{
+    enum lp_io_stream_mode mode;
+    MPI_File fh;
+    MPI_Offset off;
+    /* outstanding write of stage[cur^1] */
+    MPI_Request req;
+    char *stage[2];
+    size_t stage_cap[2];
+    int cur;
+} stream = { STREAM_OFF, MPI_FILE_NULL, 0, MPI_REQUEST_NULL, {NULL, NULL},
+    {0, 0}, 0 };
 
 static int write_id(char* directory, char* identifier, MPI_Comm comm);
 
-int lp_io_write(tw_lpid gid, char* identifier, int size, void* buffer)
+#define RECORD_SPAN(_size) \
+    ((int)((sizeof(struct io_record) + (size_t)(_size) + 7) & ~(size_t)7))
+
+static inline struct io_record* chunk_record(struct io_chunk *c, int off)
 {
-    struct identifier* id;
-    struct io_buffer *buf;
+    return (struct io_record*)(c->data + off);
+}
 
-    if(strlen(identifier) >= 64)
-    {
-        fprintf(stderr, "Error: identifier %s too big.\n", identifier);
+static uint32_t name_hash(const char *name)
+{
+    uint32_t h1 = 0, h2 = 0;
+    bj_hashlittle2(name, strlen(name), &h1, &h2);
+    return(h1);
+}
+
+/* slot of name in id_table: its identifier or the empty slot to put it in */
+static struct identifier** id_slot(const char *identifier)
+{
+    uint32_t mask = id_table_cap - 1;
+    uint32_t i = name_hash(identifier) & mask;
+    while(id_table[i] && strcmp(identifier, id_table[i]->identifier) != 0)
+        i = (i + 1) & mask;
+    return(&id_table[i]);
+}
+
+static struct identifier* find_id(const char *identifier)
+{
+    if(!id_table)
+        return(NULL);
+    return(*id_slot(identifier));
+}
+
+static int id_table_grow(void)
+{
+    struct identifier **old = id_table;
+    int old_cap = id_table_cap;
+    int cap = id_table_cap ? 2*id_table_cap : 64;
+    struct identifier **t = (struct identifier**)calloc(cap, sizeof(*t));
+    if(!t)
         return(-1);
+    id_table = t;
+    id_table_cap = cap;
+    for(int i = 0; i < old_cap; i++)
+        if(old[i])
+            *id_slot(old[i]->identifier) = old[i];
+    free(old);
+    return(0);
+}
+
+static struct gid_slot* gid_slot(struct identifier *id, tw_lpid gid)
+{
+    uint32_t mask = id->gids_cap - 1;
+    uint32_t i = (uint32_t)((gid * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    while(id->gids[i].used && id->gids[i].gid != gid)
+        i = (i + 1) & mask;
+    return(&id->gids[i]);
+}
+
+/* index entry of gid, created if needed */
+static struct gid_slot* gid_insert(struct identifier *id, tw_lpid gid)
+{
+    struct gid_slot *s;
+
+    if(2*(id->gids_count + 1) > id->gids_cap)
+    {
+        struct gid_slot *old = id->gids;
+        int old_cap = id->gids_cap;
+        int cap = old_cap ? 2*old_cap : 16;
+        struct gid_slot *t = (struct gid_slot*)calloc(cap, sizeof(*t));
+        if(!t)
+            return(NULL);
+        id->gids = t;
+        id->gids_cap = cap;
+        for(int i = 0; i < old_cap; i++)
+            if(old[i].used)
+                *gid_slot(id, old[i].gid) = old[i];
+        free(old);
+    }
+    s = gid_slot(id, gid);
+    if(!s->used)
+    {
+        s->used = 1;
+        s->gid = gid;
+        s->last_write.chunk = NULL;
+        id->gids_count++;
     }
+    return(s);
+}
+
+/* the record at loc if it is still in memory */
+static struct io_record* loc_record(struct identifier *id, struct io_loc loc)
+{
+    struct io_chunk *first = id->chunks;
+    if(!loc.chunk || !first || loc.pos < first->base + first->head)
+        return(NULL);
+    return((struct io_record*)(loc.chunk->data + (loc.pos - loc.chunk->base)));
+}
+
+static struct io_chunk* chunk_new(struct identifier *id, int min_size)
+{
+    int cap = min_size > LP_IO_CHUNK_SIZE ? min_size : LP_IO_CHUNK_SIZE;
+    struct io_chunk *c = (struct io_chunk*)malloc(sizeof(*c) + cap);
+    if(!c)
+        return(NULL);
+    c->next = c->prev = NULL;
+    c->base = id->next_base;
+    id->next_base += cap;
+    c->cap = cap;
+    c->used = 0;
+    c->head = 0;
+    c->last = -1;
+    c->data = (char*)(c+1);
+    return(c);
+}
+
+static void chunk_unlink(struct identifier *id, struct io_chunk *c)
+{
+    if(c->prev)
+        c->prev->next = c->next;
+    else
+        id->chunks = c->next;
+    if(c->next)
+        c->next->prev = c->prev;
+    else
+        id->tail = c->prev;
+    free(c);
+}
 
-    buf = (struct io_buffer*)malloc(sizeof(*buf));
-    if(!buf)
+static void id_free(struct identifier *id)
+{
+    while(id->chunks)
+        chunk_unlink(id, id->chunks);
+    free(id->segs);
+    free(id->gids);
+    free(id->header);
+    free(id);
+}
+
+/* stage buffer i must hold at least size bytes */
+static int stage_reserve(int i, size_t size)
+{
+    if(stream.stage_cap[i] >= size)
+        return(0);
+    char *p = (char*)realloc(stream.stage[i], size);
+    if(!p)
         return(-1);
+    stream.stage[i] = p;
+    stream.stage_cap[i] = size;
+    return(0);
+}
+
+static int stream_wait(void)
+{
+    MPI_Status status;
+    if(stream.req == MPI_REQUEST_NULL)
+        return(0);
+    return(MPI_Wait(&stream.req, &status) == MPI_SUCCESS ? 0 : -1);
+}
+
+/* move the records of id that can't be rolled back anymore to the spill
+ * file */
+static int spill_id(struct identifier *id, tw_stime gvt)
+{
+    struct io_chunk *c = id->chunks;
 
-    buf->gid = gid;
-    buf->size = size;
-    /* allocate copy of data being written */
-    buf->buffer = malloc(size);
-    if(!buf->buffer)
+    while(c)
     {
-        free(buf);
-        return(-1);
+        size_t n = 0;
+        char *stage;
+
+        /* fill the free staging buffer while the other one is written */
+        stage = stream.stage[stream.cur];
+        while(c)
+        {
+            while(c->head < c->used)
+            {
+                struct io_record *r = chunk_record(c, c->head);
+                if(stream.mode == STREAM_GVT && r->ts >= gvt)
+                    goto write;
+                if(!(r->flags & IO_RECORD_DEAD))
+                {
+                    if(n > 0 && n + r->size > LP_IO_STAGE_SIZE)
+                        goto write;
+                    if(stage_reserve(stream.cur, n + r->size) < 0)
+                        return(-1);
+                    stage = stream.stage[stream.cur];
+                    memcpy(stage + n, r+1, r->size);
+                    n += r->size;
+                    id->buffers_count--;
+                    id->buffers_total_size -= r->size;
+                }
+                c->head += RECORD_SPAN(r->size);
+            }
+            /* fully spilled: drop the chunk, or recycle it if it's the
+             * one being appended to */
+            struct io_chunk *next = c->next;
+            if(c == id->tail)
+            {
+                c->used = c->head = 0;
+                c->last = -1;
+                c->base = id->next_base;
+                id->next_base += c->cap;
+            }
+            else
+                chunk_unlink(id, c);
+            c = next;
+        }
+write:
+        if(n == 0)
+            break;
+        if(id->segs_count == id->segs_cap)
+        {
+            int cap = id->segs_cap ? 2*id->segs_cap : 16;
+            struct spill_seg *segs = (struct spill_seg*)realloc(id->segs,
+                cap*sizeof(*segs));
+            if(!segs)
+                return(-1);
+            id->segs = segs;
+            id->segs_cap = cap;
+        }
+        id->segs[id->segs_count].off = stream.off;
+        id->segs[id->segs_count].len = n;
+        id->segs_count++;
+        id->spilled_size += n;
+
+        if(stream_wait() < 0)
+            return(-1);
+        if(MPI_File_iwrite_at(stream.fh, stream.off, stage, n, MPI_BYTE,
+                &stream.req) != MPI_SUCCESS)
+        {
+            fprintf(stderr, "Error: lp-io spill write failure.\n");
+            return(-1);
+        }
+        stream.off += n;
+        stream.cur ^= 1;
     }
-    memcpy(buf->buffer, buffer, size);
-    buf->next = NULL;
+    return(0);
+}
 
-    /* see if we have this identifier already */
-    id = identifiers;
-    while(id && (strcmp(identifier, id->identifier) != 0))
-        id = id->next;
+/* find or create an identifier */
+static struct identifier* id_get(const char *identifier)
+{
+    struct identifier* id;
+    struct identifier** slot;
 
-    if(id)
+    if(strlen(identifier) >= LP_IO_ID_MAX)
     {
-        /* add buffer to front of list */
-        buf->next = id->buffers;
-        id->buffers  = buf;
-        id->buffers_count++;
-        id->buffers_total_size += size;
+        fprintf(stderr, "Error: identifier %s too big.\n", identifier);
+        return(NULL);
     }
-    else
+
+    /* see if we have this identifier already */
+    if(2*(identifiers_count + 1) > id_table_cap && id_table_grow() < 0)
+        return(NULL);
+    slot = id_slot(identifier);
+    id = *slot;
+    if(!id)
     {
         /* new identifier */
-        id = (struct identifier*)malloc(sizeof(*id));
+        id = (struct identifier*)calloc(1, sizeof(*id));
         if(!id)
-        {
-            free(buf->buffer);
-            free(buf);
-            return(-1);
-        }
+            return(NULL);
         strcpy(id->identifier, identifier);
+        id->spill_gvt = -1;
         id->next = identifiers;
         identifiers = id;
-        id->buffers = buf;
-        id->buffers_count = 1;
-        id->buffers_total_size = size;
-        buf->next = NULL;
         identifiers_count++;
+        *slot = id;
+    }
+    return(id);
+}
+
+int lp_io_write_header(char* identifier, int size, void* buffer)
+{
+    struct identifier* id = id_get(identifier);
+
+    if(!id)
+        return(-1);
+    if(id->header)
+        return(0);
+    id->header = (char*)malloc(size);
+    if(!id->header)
+        return(-1);
+    memcpy(id->header, buffer, size);
+    id->header_size = size;
+    return(0);
+}
+
+int lp_io_write(tw_lpid gid, char* identifier, int size, void* buffer)
+{
+    struct identifier* id;
+    struct gid_slot* gs;
+    struct io_record *r;
+    struct io_chunk *c;
+    tw_lp *lp = NULL;
+    int span = RECORD_SPAN(size);
+
+    id = id_get(identifier);
+    if(!id)
+        return(-1);
+
+    gs = gid_insert(id, gid);
+    if(!gs)
+        return(-1);
+
+    c = id->tail;
+    if(!c || c->cap - c->used < span)
+    {
+        c = chunk_new(id, span);
+        if(!c)
+            return(-1);
+        c->prev = id->tail;
+        if(id->tail)
+            id->tail->next = c;
+        else
+            id->chunks = c;
+        id->tail = c;
+    }
+
+    r = chunk_record(c, c->used);
+    r->gid = gid;
+    r->ts = 0;
+    if(stream.mode == STREAM_GVT)
+    {
+        lp = tw_getlocal_lp(gid);
+        r->ts = tw_now(lp);
+    }
+    r->size = size;
+    r->prev = c->last;
+    r->flags = 0;
+    r->prev_write = gs->last_write;
+    memcpy(r+1, buffer, size);
+    gs->last_write.chunk = c;
+    gs->last_write.pos = c->base + c->used;
+    c->last = c->used;
+    c->used += span;
+    id->buffers_count++;
+    id->buffers_total_size += size;
+
+    /* streaming: try again whenever GVT moved */
+    if(stream.mode != STREAM_OFF && stream.mode != STREAM_NEVER &&
+            id->buffers_total_size >= LP_IO_SPILL_SIZE)
+    {
+        tw_stime gvt = lp ? lp->pe->GVT : 0;
+        if(stream.mode == STREAM_ALL || gvt != id->spill_gvt)
+        {
+            id->spill_gvt = gvt;
+            if(spill_id(id, gvt) < 0)
+                return(-1);
+        }
     }
 
     return(0);
 }
 
 int lp_io_write_rev(tw_lpid gid, char* identifier){
-    struct identifier* id, *id_prev;
-    struct io_buffer *buf, *buf_prev;
+    struct identifier* id;
+    struct gid_slot* gs = NULL;
+    struct io_chunk *c;
+    struct io_record *r = NULL;
+    int off;
 
     /* find given identifier */
-    if(strlen(identifier) >= 32)
+    if(strlen(identifier) >= LP_IO_ID_MAX)
     {
         fprintf(stderr, "Error: identifier %s too big.\n", identifier);
         return(-1);
     }
-    id = identifiers;
-    while (id && (strcmp(identifier, id->identifier) != 0)){
-        id_prev = id;
-        id = id->next;
-    }
+    id = find_id(identifier);
     if (!id){
         fprintf(stderr, "Error: identifier %s not found on reverse for LP %llu.",
                 identifier,LLU(gid));
         return(-1);
     }
 
-    /* attempt to find previous LP's write. This is made easier by the fact 
-     * that the list is stored newest-to-oldest */
-    buf = id->buffers; 
-    buf_prev = NULL;
-    while (buf){
-        if (buf->gid == gid){ break; }
-        buf_prev = buf;
-        buf = buf->next;
+    /* the LP's newest write, unless it was already spilled (which means it
+     * was older than GVT and can't be rolled back) */
+    if (id->gids_cap){
+        gs = gid_slot(id, gid);
+        if (gs->used)
+            r = loc_record(id, gs->last_write);
     }
-    if (!buf){
+    if (!r){
         fprintf(stderr, "Error: no lp-io write buffer found for LP %llu (reverse write)\n", LLU(gid));
         return(-1);
     }
+    assert(r->gid == gid && !(r->flags & IO_RECORD_DEAD));
+    c = gs->last_write.chunk;
+    off = (int)(gs->last_write.pos - c->base);
+    gs->last_write = r->prev_write;
 
     id->buffers_count--;
-    id->buffers_total_size -= buf->size;
-    if (id->buffers_count == 0){
-        /* seg faults caused with empty identifiers for some reason - remove
-         * this ID */
-        if (id == identifiers){
-            identifiers = id->next;
+    id->buffers_total_size -= r->size;
+    r->flags |= IO_RECORD_DEAD;
+    if (off == c->last){
+        /* newest record of the chunk: give its space back, along with that
+         * of dead records right before it */
+        while (c->last >= c->head &&
+                (chunk_record(c, c->last)->flags & IO_RECORD_DEAD)){
+            c->used = c->last;
+            c->last = chunk_record(c, c->last)->prev;
         }
-        else{
-            id_prev->next = id->next;
-        }
-        free(id);
-        identifiers_count--;
-    }
-    /* remove the buffer from the list 
-     * (NULLs for end-of-list are preserved) */
-    else if (buf == id->buffers) { /* buf is head of list */
-        id->buffers = buf->next;
+        if (c->used == c->head && c != id->chunks)
+            chunk_unlink(id, c);
     }
-    else { /* buf is in list, has a previous element */
-        buf_prev->next = buf->next; 
-    }
-    free(buf->buffer);
-    free(buf);
+
     return(0);
 }
 
@@ -206,112 +587,233 @@ int lp_io_prepare(char *directory, int flags, lp_io_handle* handle, MPI_Comm com
 
     MPI_Barrier(comm);
 
+    if(flags & LP_IO_STREAM)
+    {
+        char file[512];
+        char err_string[MPI_MAX_ERROR_STRING];
+        int err_len;
+
+        switch(g_tw_synchronization_protocol)
+        {
+            case OPTIMISTIC:
+            case OPTIMISTIC_REALTIME:
+                stream.mode = STREAM_GVT;
+                break;
+            case OPTIMISTIC_DEBUG:
+                stream.mode = STREAM_NEVER;
+                break;
+            default:
+                stream.mode = STREAM_ALL;
+        }
+        sprintf(file, "%s/.lp-io-spill.%d", *handle, rank);
+        ret = MPI_File_open(MPI_COMM_SELF, file,
+            MPI_MODE_CREATE|MPI_MODE_RDWR|MPI_MODE_EXCL|MPI_MODE_DELETE_ON_CLOSE,
+            MPI_INFO_NULL, &stream.fh);
+        if(ret != 0)
+        {
+            MPI_Error_string(ret, err_string, &err_len);
+            fprintf(stderr, "Error: MPI_File_open(%s) failure: %s\n", file, err_string);
+            stream.mode = STREAM_OFF;
+            return(-1);
+        }
+    }
+
     return(0);
 }
 
+static int cmp_names(const void *a, const void *b)
+{
+    return(strcmp(*(char* const*)a, *(char* const*)b));
+}
+
 int lp_io_flush(lp_io_handle handle, MPI_Comm comm)
 {
     int comm_size;
     int rank;
-    MPI_Status status;
     int ret;
-    int i;
+    int i, n;
     struct identifier *id;
-    int match = 0;
+    char *names, *all_names, *p;
+    char **global_identifiers;
+    int global_identifiers_count;
+    int my_len, all_len;
+    int *lens, *displs;
 
     char* directory  = handle;
 
-    memset(global_identifiers, 0, 64*sizeof(global_identifiers[0]));
-
     MPI_Comm_size(comm, &comm_size);
     MPI_Comm_rank(comm, &rank);
 
+    /* finish any spill still in flight before reading the file back */
+    if(stream_wait() < 0)
+        return(-1);
+
     /* The first thing we need to do is come up with a global list of
      * identifiers.  We can't really guarantee that every MPI proc had data
      * written to every identifier, but we want to collectively write each
      * ID.
      */
 
-    /* To do this, each rank will receive an initial set of ideas from
-     * rank+1 and add its own identifiers to the set before transmitting to
-     * rank-1.  Rank 0 will then broadcast the results to everyone.
-     */
-
-    /* get array so far from rank +1 */
-    if(rank != comm_size-1)
+    /* every rank contributes its identifiers as consecutive NUL-terminated
+     * strings; the union is then sorted so all ranks agree on the order.
+     * Identifiers whose writes were all reversed don't count unless they
+     * have a header */
+    my_len = 0;
+    for(id = identifiers; id; id = id->next)
+        if(id->buffers_count || id->spilled_size || id->header)
+            my_len += strlen(id->identifier) + 1;
+    names = (char*)malloc(my_len + 1);
+    assert(names);
+    p = names;
+    for(id = identifiers; id; id = id->next)
     {
-        ret = MPI_Recv(&global_identifiers_count, 1, MPI_INT, rank+1, 0, comm, &status);
-        assert(ret == 0);
-        ret = MPI_Recv(global_identifiers, 64*sizeof(global_identifiers[0]), MPI_BYTE,
-            rank+1, 0, comm, &status);
-        assert(ret == 0);
+        if(!id->buffers_count && !id->spilled_size && !id->header)
+            continue;
+        strcpy(p, id->identifier);
+        p += strlen(id->identifier) + 1;
     }
 
-    /* add our own entries to the array */
-    id = identifiers;
-    while(id)
+    lens = (int*)malloc(2 * comm_size * sizeof(int));
+    assert(lens);
+    displs = lens + comm_size;
+    ret = MPI_Allgather(&my_len, 1, MPI_INT, lens, 1, MPI_INT, comm);
+    assert(ret == 0);
+    all_len = 0;
+    for(i = 0; i < comm_size; i++)
     {
-        match = 0;
-        for(i = 0; i<global_identifiers_count; i++)
-        {
-            if(strcmp(id->identifier, global_identifiers[i].identifier) == 0)
-            {
-                match = 1;
-                break;
-            }
-        }
-        if(!match)
-        {
-            assert(global_identifiers_count < 64);
-            global_identifiers[global_identifiers_count] = *id;
-            global_identifiers_count++;
-        }
-
-        id = id->next;
+        displs[i] = all_len;
+        all_len += lens[i];
     }
-
-    /* send results to rank-1 */
-    if(rank != 0)
+    all_names = (char*)malloc(all_len + 1);
+    assert(all_names);
+    ret = MPI_Allgatherv(names, my_len, MPI_CHAR, all_names, lens, displs,
+        MPI_CHAR, comm);
+    assert(ret == 0);
+    free(names);
+    free(lens);
+
+    n = 0;
+    for(p = all_names; p < all_names + all_len; p += strlen(p) + 1)
+        n++;
+    global_identifiers = (char**)malloc((n + 1) * sizeof(char*));
+    assert(global_identifiers);
+    n = 0;
+    for(p = all_names; p < all_names + all_len; p += strlen(p) + 1)
+        global_identifiers[n++] = p;
+    qsort(global_identifiers, n, sizeof(char*), cmp_names);
+    global_identifiers_count = 0;
+    for(i = 0; i < n; i++)
     {
-        ret = MPI_Send(&global_identifiers_count, 1, MPI_INT, rank-1, 0, comm);
-        assert(ret == 0);
-        ret = MPI_Send(global_identifiers, 64*sizeof(global_identifiers[0]), MPI_BYTE,
-            rank-1, 0, comm);
-        assert(ret == 0);
-
+        if(global_identifiers_count == 0 || strcmp(global_identifiers[i],
+                global_identifiers[global_identifiers_count-1]) != 0)
+            global_identifiers[global_identifiers_count++] = global_identifiers[i];
     }
 
-    /* broadcast results to everyone */
-    ret = MPI_Bcast(&global_identifiers_count, 1, MPI_INT, 0, comm);
-    assert(ret == 0);
-    ret = MPI_Bcast(global_identifiers, 64*sizeof(global_identifiers[0]), MPI_BYTE, 0, comm);
-    assert(ret == 0);
-
     if(rank == 0)
     {
         printf("LP-IO: writing output to %s/\n", directory);
         printf("LP-IO: data files:\n");
     }
 
+    ret = 0;
     for(i=0; i<global_identifiers_count; i++)
     {
         if(rank == 0)
         {
-            printf("   %s/%s\n", directory, global_identifiers[i].identifier);
+            printf("   %s/%s\n", directory, global_identifiers[i]);
         }
 
-        ret = write_id(directory, global_identifiers[i].identifier, comm);
+        ret = write_id(directory, global_identifiers[i], comm);
         if(ret < 0)
         {
-            return(ret);
+            break;
         }
     }
+    free(global_identifiers);
+    free(all_names);
+    if(ret < 0)
+        return(ret);
+
+    /* everything is on disk now */
+    while(identifiers)
+    {
+        id = identifiers;
+        identifiers = id->next;
+        id_free(id);
+    }
+    identifiers_count = 0;
+    free(id_table);
+    id_table = NULL;
+    id_table_cap = 0;
+    if(stream.mode != STREAM_OFF)
+    {
+        MPI_File_close(&stream.fh);
+        free(stream.stage[0]);
+        free(stream.stage[1]);
+        stream.stage[0] = stream.stage[1] = NULL;
+        stream.stage_cap[0] = stream.stage_cap[1] = 0;
+        stream.off = 0;
+        stream.mode = STREAM_OFF;
+    }
 
     free(handle);
 
     return(0);
 }
 
+/* write the in-memory records of id at offset with one collective call */
+static int write_records(MPI_File fh, MPI_Offset offset, struct identifier *id)
+{
+    MPI_Datatype mtype;
+    int *lengths;
+    MPI_Aint *displacements;
+    MPI_Aint base = 0;
+    MPI_Status status;
+    struct io_chunk *c;
+    int i = 0, off, ret;
+
+    if(id == NULL || id->buffers_count == 0)
+    {
+        /* nothing to write, but participate in collective anyway */
+        return(MPI_File_write_at_all(fh, offset, NULL, 0, MPI_BYTE, &status));
+    }
+
+    lengths = (int*)malloc(id->buffers_count*sizeof(int));
+    assert(lengths);
+    displacements = (MPI_Aint*)malloc(id->buffers_count*sizeof(MPI_Aint));
+    assert(displacements);
+
+    /* NOTE: some versions of MPI-IO have a bug related to using
+     * MPI_BOTTOM with hindexed types. We therefore use first pointer as
+     * base and adjust the others accordingly.
+     */
+    for(c = id->chunks; c; c = c->next)
+    {
+        for(off = c->head; off < c->used; off += RECORD_SPAN(chunk_record(c, off)->size))
+        {
+            struct io_record *r = chunk_record(c, off);
+            if(r->flags & IO_RECORD_DEAD)
+                continue;
+            if(i == 0)
+                base = (MPI_Aint)(r+1);
+            displacements[i] = (MPI_Aint)(r+1) - base;
+            lengths[i] = r->size;
+            i++;
+        }
+    }
+    assert(i == id->buffers_count);
+    MPI_Type_create_hindexed(id->buffers_count, lengths, displacements,
+        MPI_BYTE, &mtype);
+    MPI_Type_commit(&mtype);
+    free(lengths);
+    free(displacements);
+
+    ret = MPI_File_write_at_all(fh, offset, (void*)base, 1, mtype, &status);
+
+    MPI_Type_free(&mtype);
+    return(ret);
+}
+
 static int write_id(char* directory, char* identifier, MPI_Comm comm)
 {
     char file[256];
@@ -320,16 +822,15 @@ static int write_id(char* directory, char* identifier, MPI_Comm comm)
     long my_size = 0;
     long my_offset = 0;
     struct identifier* id;
-    struct io_buffer *buf;
     char err_string[MPI_MAX_ERROR_STRING];
     int err_len;
-    MPI_Datatype mtype;
-    int *lengths;
-    MPI_Aint *displacements;
-    MPI_Aint base;
-    int i;
+    int i, my_rounds, rounds;
+    int rank, comm_size, hdr_root, hdr_size, hdr_err = 0, err = 0;
     MPI_Status status;
 
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &comm_size);
+
     sprintf(file, "%s/%s", directory, identifier);
     ret = MPI_File_open(comm, file, MPI_MODE_CREATE|MPI_MODE_WRONLY|MPI_MODE_EXCL, MPI_INFO_NULL, &fh);
     if(ret != 0)
@@ -340,62 +841,70 @@ static int write_id(char* directory, char* identifier, MPI_Comm comm)
     }
 
     /* see if we have any data for this id */
-    id = identifiers;
-    while(id && (strcmp(identifier, id->identifier) != 0))
-        id = id->next;
+    id = find_id(identifier);
+
+    /* the header comes first; the lowest rank that has one writes it */
+    hdr_root = (id && id->header) ? rank : comm_size;
+    MPI_Allreduce(MPI_IN_PLACE, &hdr_root, 1, MPI_INT, MPI_MIN, comm);
+    hdr_size = 0;
+    if(hdr_root < comm_size)
+    {
+        if(rank == hdr_root)
+        {
+            hdr_size = id->header_size;
+            if(MPI_File_write_at(fh, 0, id->header, hdr_size, MPI_BYTE,
+                    &status) != 0)
+            {
+                fprintf(stderr, "Error: MPI_File_write_at(%s) failure.\n", file);
+                hdr_err = 1;
+            }
+        }
+        MPI_Bcast(&hdr_size, 1, MPI_INT, hdr_root, comm);
+    }
 
     /* find my offset */
     if(id)
-        my_size = id->buffers_total_size;
+        my_size = id->spilled_size + id->buffers_total_size;
     MPI_Scan(&my_size, &my_offset, 1, MPI_LONG, MPI_SUM, comm);
-    my_offset -= my_size;
-
-    /* build datatype for our buffers */
-    if(id)
+    my_offset += hdr_size - my_size;
+
+    /* spilled segments first, one collective write each, then what is
+     * still in memory; ranks with less to write join with empty writes, and
+     * so does a rank after a failure, so that the others don't hang */
+    my_rounds = id ? id->segs_count + 1 : 1;
+    MPI_Allreduce(&my_rounds, &rounds, 1, MPI_INT, MPI_MAX, comm);
+    for(i = 0; i < rounds; i++)
     {
-        lengths = (int*)malloc(id->buffers_count*sizeof(int));
-        assert(lengths);
-        displacements = (MPI_Aint*)malloc(id->buffers_count*sizeof(MPI_Aint));
-        assert(displacements);
-
-        /* NOTE: some versions of MPI-IO have a bug related to using
-         * MPI_BOTTOM with hindexed types. We therefore use first pointer as
-         * base and adjust the others accordingly.
-         */
-        buf = id->buffers;
-        base = (MPI_Aint)buf->buffer;
-        /* NOTE: filling in datatype arrays backwards to get buffers in the
-         * order they were added on each process
-         */
-        i = id->buffers_count-1;
-        while(buf)
+        struct spill_seg *seg = NULL;
+        if(!err && id && i < id->segs_count)
         {
-            displacements[i] = (MPI_Aint)buf->buffer - (MPI_Aint)base;
-            lengths[i] = buf->size;
-            i--;
-            buf = buf->next;
+            seg = &id->segs[i];
+            if(stage_reserve(0, seg->len) < 0 ||
+                MPI_File_read_at(stream.fh, seg->off, stream.stage[0],
+                    seg->len, MPI_BYTE, &status) != 0)
+            {
+                fprintf(stderr, "Error: lp-io spill read failure.\n");
+                err = 1;
+                seg = NULL;
+            }
+        }
+        if(seg)
+        {
+            ret = MPI_File_write_at_all(fh, my_offset, stream.stage[0],
+                seg->len, MPI_BYTE, &status);
+            my_offset += seg->len;
+        }
+        else if(!err && i == my_rounds - 1)
+            ret = write_records(fh, my_offset, id);
+        else
+            ret = MPI_File_write_at_all(fh, my_offset, NULL, 0, MPI_BYTE, &status);
+        if(ret != 0 && !err)
+        {
+            fprintf(stderr, "Error: MPI_File_write_at(%s) failure.\n", file);
+            err = 1;
         }
-        MPI_Type_create_hindexed(id->buffers_count, lengths, displacements,
-            MPI_BYTE, &mtype);
-        MPI_Type_commit(&mtype);
-        free(lengths);
-        free(displacements);
-
-        ret = MPI_File_write_at_all(fh, my_offset, id->buffers->buffer, 1, mtype, &status);
-
-        MPI_Type_free(&mtype);
-    }
-    else
-    {
-        /* nothing to write, but participate in collective anyway */
-        ret = MPI_File_write_at_all(fh, my_offset, NULL, 0, MPI_BYTE, &status);
-    }
-    if(ret != 0)
-    {
-        fprintf(stderr, "Error: MPI_File_write_at(%s) failure.\n", file);
-        return(-1);
     }
-    
+
     ret = MPI_File_close(&fh);
     if(ret != 0)
     {
@@ -403,7 +912,7 @@ static int write_id(char* directory, char* identifier, MPI_Comm comm)
         return(-1);
     }
 
-    return(0);
+    return((hdr_err || err) ? -1 : 0);
 }
 
 /*
@@ -26,6 +26,11 @@ static int resource_magic; /* use this as sanity check on events */
 static uint64_t avail_unanno;
 static uint64_t *avail_per_anno;
 static const config_anno_map_t *anno_map;
+/* grant every waiter that fits within the freeing event instead of chaining
+ * one RESOURCE_DEQ event per grant */
+static int batch_grants;
+/* batched grant order: FIFO, or largest waiting request that fits first */
+static int best_fit;
 
 typedef struct resource_state resource_state;
 typedef struct resource_msg resource_msg;
@@ -50,6 +55,13 @@ struct resource_state {
      * pools. We take advantage of resource_token_t's status as a simple
      * array index to do the proper indexing */
     struct qlist_head pending[MAX_RESERVE+1];
+    /* unused pending ops, recycled instead of malloc/free per wait */
+    struct qlist_head free_ops;
+    /* ops granted by batched frees, oldest first, kept for RC until GVT
+     * passes them */
+    struct qlist_head granted;
+    /* arrival counter, orders the pending queues when rolling back */
+    uint64_t next_seq;
 };
 
 /* following struct exists because we want to basically cache a message within
@@ -73,10 +85,16 @@ struct resource_msg {
     // for RC (asides from the message itself): the previous minimum resource
     // value
     uint64_t min_avail_rc;
+    // for RC of a batched free: the number of waiters granted
+    int num_granted;
+    // for RC of a dequeue: the arrival number of the granted op
+    uint64_t seq_rc;
 };
 
 struct pending_op {
     struct resource_msg_internal m;
+    uint64_t seq;
+    tw_stime granted_at;
     struct qlist_head ql;
 };
 
@@ -140,6 +158,59 @@ void resource_lp_ind_init(
     for (i = 0; i < MAX_RESERVE+1; i++){
         INIT_QLIST_HEAD(&ns->pending[i]);
     }
+    INIT_QLIST_HEAD(&ns->free_ops);
+    INIT_QLIST_HEAD(&ns->granted);
+    ns->next_seq = 0;
+}
+
+static pending_op * pending_op_alloc(resource_state *ns){
+    struct qlist_head *ql = qlist_pop(&ns->free_ops);
+    if (ql != NULL)
+        return qlist_entry(ql, pending_op, ql);
+    pending_op *op = (pending_op*)malloc(sizeof(pending_op));
+    assert(op);
+    return op;
+}
+
+static void pending_op_release(resource_state *ns, pending_op *op){
+    qlist_add(&op->ql, &ns->free_ops);
+}
+
+/* put a rolled back op back into its queue, in arrival order */
+static void pending_requeue(resource_state *ns, pending_op *op){
+    struct qlist_head *queue = &ns->pending[op->m.tok];
+    struct qlist_head *pos;
+
+    qlist_for_each(pos, queue){
+        if (qlist_entry(pos, pending_op, ql)->seq > op->seq)
+            break;
+    }
+    qlist_add_tail(&op->ql, pos);
+}
+
+static int is_optimistic(void){
+    switch (g_tw_synchronization_protocol){
+        case OPTIMISTIC:
+        case OPTIMISTIC_DEBUG:
+        case OPTIMISTIC_REALTIME:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* return granted ops that can no longer be rolled back to the pool */
+static void reclaim_granted(resource_state *ns, tw_lp *lp){
+    // in optimistic debug mode everything gets rolled back
+    if (g_tw_synchronization_protocol == OPTIMISTIC_DEBUG)
+        return;
+    while (!qlist_empty(&ns->granted)){
+        pending_op *op = qlist_entry(ns->granted.next, pending_op, ql);
+        if (op->granted_at >= lp->pe->GVT)
+            break;
+        qlist_del(&op->ql);
+        pending_op_release(ns, op);
+    }
 }
 
 static void resource_response(
@@ -178,7 +249,8 @@ static void handle_resource_get(
     int send_ack = 1;
     // save the previous minimum for RC
     assert(!resource_get_min_avail(m->i.tok, &m->min_avail_rc, &ns->r));
-    if (!qlist_empty(&ns->pending[m->i.tok]) ||
+    /* best-fit ordering doesn't keep arrivals behind earlier waiters */
+    if ((!best_fit && !qlist_empty(&ns->pending[m->i.tok])) ||
             (ret = resource_get(m->i.req, m->i.tok, &ns->r))){
         /* failed to receive data */
         if (ret == 2)
@@ -195,8 +267,9 @@ static void handle_resource_get(
         if (m->i.block_on_unavail){
             /* queue up operation, save til later */
             b->c0 = 1;
-            pending_op *op = (pending_op*)malloc(sizeof(pending_op));
+            pending_op *op = pending_op_alloc(ns);
             op->m = m->i; /* no need to set rc msg here */
+            op->seq = ns->next_seq++;
             qlist_add_tail(&op->ql, &ns->pending[m->i.tok]);
             send_ack = 0;
         }
@@ -221,7 +294,8 @@ static void handle_resource_get_rc(
     if (b->c0){
         assert(!qlist_empty(&ns->pending[m->i.tok]));
         struct qlist_head *ql = qlist_pop_back(&ns->pending[m->i.tok]);
-        free(qlist_entry(ql, pending_op, ql));
+        pending_op_release(ns, qlist_entry(ql, pending_op, ql));
+        ns->next_seq--;
     }
     else if (b->c1){
         resource_response_rc(lp);
@@ -233,6 +307,47 @@ static void handle_resource_get_rc(
     }
 }
 
+/* next waiter to grant from the token's queue, NULL if none fits */
+static pending_op * pick_grant(resource_state *ns, resource_token_t tok){
+    struct qlist_head *queue = &ns->pending[tok];
+    pending_op *op, *best = NULL;
+    uint64_t avail;
+
+    if (qlist_empty(queue))
+        return NULL;
+    resource_get_avail(tok, &avail, &ns->r);
+    if (!best_fit){
+        op = qlist_entry(queue->next, pending_op, ql);
+        return op->m.req <= avail ? op : NULL;
+    }
+    qlist_for_each_entry(op, queue, ql){
+        if (op->m.req <= avail && (best == NULL || op->m.req > best->m.req))
+            best = op;
+    }
+    return best;
+}
+
+/* grant every waiter that fits, returns the number granted */
+static int grant_pending(resource_state *ns, resource_token_t tok, tw_lp *lp){
+    pending_op *op;
+    int num_granted = 0;
+
+    while ((op = pick_grant(ns, tok)) != NULL){
+        int ret = resource_get(op->m.req, tok, &ns->r);
+        assert(!ret);
+        qlist_del(&op->ql);
+        resource_response(&op->m.cb, lp, 0, TOKEN_DUMMY);
+        if (is_optimistic()){
+            op->granted_at = tw_now(lp);
+            qlist_add_tail(&op->ql, &ns->granted);
+        }
+        else
+            pending_op_release(ns, op);
+        num_granted++;
+    }
+    return num_granted;
+}
+
 static void handle_resource_free(
         resource_state * ns,
         tw_bf * b,
@@ -240,6 +355,12 @@ static void handle_resource_free(
         tw_lp * lp){
     (void)b;
     assert(!resource_free(m->i.req, m->i.tok, &ns->r));
+    if (batch_grants){
+        reclaim_granted(ns, lp);
+        assert(!resource_get_min_avail(m->i.tok, &m->min_avail_rc, &ns->r));
+        m->num_granted = grant_pending(ns, m->i.tok, lp);
+        return;
+    }
     /* create an event to pop the next queue item */
     tw_event *e = tw_event_new(lp->gid, codes_local_latency(lp), lp);
     resource_msg *m_deq = (resource_msg*)tw_event_data(e);
@@ -253,8 +374,21 @@ static void handle_resource_free_rc(
         resource_msg * m,
         tw_lp * lp){
     (void)b;
+    if (batch_grants){
+        /* most recent grants first */
+        for (int i = 0; i < m->num_granted; i++){
+            struct qlist_head *ql = qlist_pop_back(&ns->granted);
+            assert(ql != NULL);
+            pending_op *op = qlist_entry(ql, pending_op, ql);
+            resource_response_rc(lp);
+            resource_free(op->m.req, op->m.tok, &ns->r);
+            pending_requeue(ns, op);
+        }
+        assert(!resource_restore_min_avail(m->i.tok, m->min_avail_rc, &ns->r));
+    }
+    else
+        codes_local_latency_reverse(lp);
     assert(!resource_get(m->i.req, m->i.tok, &ns->r));
-    codes_local_latency_reverse(lp);
 }
 
 /* bitfield usage:
@@ -281,8 +415,9 @@ static void handle_resource_deq(
         /* success, dequeue (saving as rc) and send to client */
         qlist_del(front);
         m->i_rc = p->m;
+        m->seq_rc = p->seq;
         resource_response(&p->m.cb, lp, ret, TOKEN_DUMMY);
-        free(p);
+        pending_op_release(ns, p);
         /* additionally attempt to dequeue next one down */
         tw_event *e = tw_event_new(lp->gid, codes_local_latency(lp), lp);
         resource_msg *m_deq = (resource_msg*)tw_event_data(e);
@@ -307,8 +442,9 @@ static void handle_resource_deq_rc(
 
     if (b->c1){
         /* add operation back to the front of the queue */
-        pending_op *op = (pending_op*)malloc(sizeof(pending_op));
+        pending_op *op = pending_op_alloc(ns);
         op->m = m->i_rc;
+        op->seq = m->seq_rc;
         qlist_add(&op->ql, &ns->pending[m->i.tok]);
         resource_response_rc(lp);
         assert(!resource_restore_min_avail(m->i.tok, m->min_avail_rc, &ns->r));
@@ -469,6 +605,25 @@ void resource_lp_configure(){
         assert(avail > 0);
         avail_per_anno[i] = (uint64_t)avail;
     }
+
+    // grant mode (optional)
+    char order[MAX_NAME_LENGTH];
+    batch_grants = 0;
+    configuration_get_value_int(&config, RESOURCE_LP_NM, "batch_grants", NULL,
+            &batch_grants);
+    best_fit = 0;
+    ret = configuration_get_value(&config, RESOURCE_LP_NM, "grant_order", NULL,
+            order, sizeof(order));
+    if (ret > 0){
+        if (strcmp(order, "best_fit") == 0)
+            best_fit = 1;
+        else if (strcmp(order, "fifo") != 0)
+            tw_error(TW_LOC, "unknown resource grant_order \"%s\" "
+                    "(expected fifo or best_fit)", order);
+    }
+    if (best_fit && !batch_grants)
+        tw_error(TW_LOC, "resource grant_order \"best_fit\" requires "
+                "batch_grants");
 }
 
 static void resource_lp_issue_event_base(
@@ -39,6 +39,7 @@ extern struct codes_workload_method online_comm_workload_method;
 #endif
 extern struct codes_workload_method checkpoint_workload_method;
 extern struct codes_workload_method iomock_workload_method;
+extern struct codes_workload_method synthetic_workload_method;
 
 static struct codes_workload_method const * method_array_default[] =
 {
@@ -66,6 +67,7 @@ static struct codes_workload_method const * method_array_default[] =
 #endif
     &checkpoint_workload_method,
     &iomock_workload_method,
+    &synthetic_workload_method,
     NULL
 };
 
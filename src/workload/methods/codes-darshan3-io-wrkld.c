@@ -44,7 +44,28 @@ struct darshan_unified_record
 {
     struct darshan_posix_file psx_file_rec;
     struct darshan_mpiio_file mpiio_file_rec;
-    struct darshan_unified_record *next;
+};
+
+/* a file record that generates events, as listed in a rank's bucket */
+struct darshan_bucket_entry
+{
+    double open_time;
+    int64_t rec_ndx;
+};
+
+/* file records of a darshan log, read once and shared by all ranks loaded
+ * from it. Records generating events are bucketed by rank in order of open
+ * time: bucket 0 holds the shared records (rank -1), bucket r + 1 rank r */
+struct darshan_log_records
+{
+    char log_file_path[MAX_NAME_LENGTH_WKLD];
+    struct darshan_unified_record *recs;
+    int64_t rec_cnt;
+    int nprocs;
+    int64_t *bucket_start;
+    struct darshan_bucket_entry *buckets;
+    int ref_cnt;
+    struct darshan_log_records *next;
 };
 
 static void * darshan_io_workload_read_config(
@@ -58,13 +79,16 @@ static void darshan_psx_io_workload_get_next(int app_id, int rank, struct codes_
 static int darshan_psx_io_workload_get_rank_cnt(const char *params, int app_id);
 static int darshan_rank_hash_compare(void *key, struct qhash_head *link);
 
+/* Darshan log records shared among ranks */
+static struct darshan_log_records *darshan_get_log_records(const char *log_file_path);
+static void darshan_put_log_records(struct darshan_log_records *log);
+
 /* Darshan I/O op data structure access (insert, remove) abstraction */
-static void *darshan_init_io_op_dat(void);
+static void *darshan_init_io_op_dat(struct darshan_log_records *log,
+                                    struct rank_io_context *io_context);
 static void darshan_insert_next_io_op(void *io_op_dat, struct darshan_io_op *io_op);
 static void darshan_remove_next_io_op(void *io_op_dat, struct darshan_io_op *io_op,
                                       double last_op_time);
-static void darshan_finalize_io_op_dat(void *io_op_dat);
-static int darshan_io_op_compare(const void *p1, const void *p2);
 
 /* Helper functions for implementing the Darshan workload generator */
 static void generate_psx_file_events(struct darshan_posix_file *file,
@@ -182,196 +206,38 @@ static int darshan_psx_io_workload_get_time(const char *params, int app_id, int
 static int darshan_psx_io_workload_load(const char *params, int app_id, int rank)
 {
     darshan_params *d_params = (darshan_params *)params;
-    darshan_fd logfile_fd = NULL;
-    struct darshan_job job;
-    //struct darshan_file next_file;
-    /* open posix log file */
-    struct darshan_posix_file *psx_file_rec;
-    struct darshan_mpiio_file *mpiio_file_rec;
+    struct darshan_log_records *log;
     struct rank_io_context *my_ctx;
-    int ret;
-    struct darshan_unified_record *dur_new = NULL;
-    struct darshan_unified_record *dur_head = NULL;
-    struct darshan_unified_record *dur_cur = NULL;
-    struct darshan_unified_record *dur_tmp = NULL;
-
-    psx_file_rec = (struct darshan_posix_file *) calloc(1, sizeof(struct darshan_posix_file));
-    assert(psx_file_rec);
-    mpiio_file_rec = (struct darshan_mpiio_file *) calloc(1, sizeof(struct darshan_mpiio_file));
-    assert(mpiio_file_rec);
 
     APP_ID_UNSUPPORTED(app_id, "darshan")
 
     if (!d_params)
         return -1;
 
-    /* open the darshan log to begin reading in file i/o info */
-    //logfile_fd = darshan_log_open(d_params->log_file_path, "r");
-    logfile_fd = darshan_log_open(d_params->log_file_path);
-    if (!logfile_fd)
+    /* read the file records of the log, unless another rank already did */
+    log = darshan_get_log_records(d_params->log_file_path);
+    if (!log)
         return -1;
-
-    /* get the per-job stats from the log */
-    ret = darshan_log_get_job(logfile_fd, &job);
-    if (ret < 0)
-    {
-        darshan_log_close(logfile_fd);
-        return -1;
-    }
     if (!total_rank_cnt)
     {
-        total_rank_cnt = job.nprocs;
+        total_rank_cnt = log->nprocs;
     }
-    //printf("rank = %d, total_rank_cnt = %d\n", rank, total_rank_cnt);
-    //printf("job: (%ld, %ld, %ld, %ld, %s)\n", job.jobid, job.uid, job.start_time, job.end_time, job.metadata);
     assert(rank < total_rank_cnt);
 
     /* allocate the i/o context needed by this rank */
     my_ctx = malloc(sizeof(struct rank_io_context));
     if (!my_ctx)
     {
-        darshan_log_close(logfile_fd);
+        darshan_put_log_records(log);
         return -1;
     }
     my_ctx->my_rank = (int64_t)rank;
     my_ctx->last_op_time = 0.0;
-    my_ctx->io_op_dat = darshan_init_io_op_dat();
     my_ctx->next_off = 0;
+    /* i/o ops are generated from the rank's file records as they are
+     * retrieved (in order) */
+    my_ctx->io_op_dat = darshan_init_io_op_dat(log, my_ctx);
 
-    /* loop over all files contained in the log file */
-    /* build a linked list to preserve order, we will make another pass over
-     * mpiio records and combine them
-     */
-    while ((ret = psx_utils->log_get_record(logfile_fd, (void **)&psx_file_rec)) > 0)
-    {
-        dur_new = calloc(1, sizeof(*dur_new));
-        assert(dur_new);
-
-        dur_new->psx_file_rec = *psx_file_rec;
-
-        if(!dur_head)
-            dur_head = dur_new;
-        if(dur_cur)
-            dur_cur->next = dur_new;
-        dur_cur = dur_new;
-    }
-
-    /* now loop over mpiio records (if present) and match them up with the
-     * posix records
-     */
-    while ((ret = mpiio_utils->log_get_record(logfile_fd, (void **)&mpiio_file_rec)) > 0)
-    {
-        for(dur_cur = dur_head; dur_cur; dur_cur = dur_cur->next)
-        {
-            if((dur_cur->psx_file_rec.base_rec.rank ==
-                mpiio_file_rec->base_rec.rank) &&
-               (dur_cur->psx_file_rec.base_rec.id ==
-                mpiio_file_rec->base_rec.id))
-            {
-                dur_cur->mpiio_file_rec = *mpiio_file_rec;
-                break;
-            }
-
-            if((dur_cur->psx_file_rec.base_rec.id == mpiio_file_rec->base_rec.id)
-                && (dur_cur->psx_file_rec.base_rec.rank == -1)
-                && (mpiio_file_rec->base_rec.rank != -1))
-            {
-                fprintf(stderr, "WARNING: id %" PRIu64 " has non-shared MPI record and shared POSIX record.  Skipping POSIX record which may have been generated by stat() calls.\n", mpiio_file_rec->base_rec.id);
-
-                dur_cur->psx_file_rec.counters[POSIX_OPENS] = 0;
-            }
-                
-        }
-        
-        if(!dur_cur)
-        {
-            /* if we fall through to here, that means that an mpiio record is present
-             * for which there is no exact match in the posix records.  This
-             * could (for example) happen if mpiio was using deferred opens,
-             * producing a shared record in mpi and unique records in posix.  Or
-             * if mpiio is using a non-posix back end. Or if we skip the posix
-             * records because the app issued a stat() on every rank but only
-             * did I/O on a subset.
-             */
-            dur_new = calloc(1, sizeof(*dur_new));
-            assert(dur_new);
-
-            dur_new->mpiio_file_rec = *mpiio_file_rec;
-            dur_new->next = dur_head;
-            dur_head = dur_new;
-        }
-    }
-
-    /* file records have all been retrieved from darshan log.  Now we loop
-     * through them and generate workload events from each record
-     */
-    for(dur_cur = dur_head; dur_cur; dur_cur = dur_cur->next)
-    {
-        /* skip the file and emit a warning if it is RW */
-        if(dur_cur->psx_file_rec.counters[POSIX_BYTES_READ] &&
-            dur_cur->psx_file_rec.counters[POSIX_BYTES_WRITTEN])
-        {
-            if(rank == 0)
-            {
-                printf("WARNING: skipping R/W file record %lu with %ld bytes read and %ld bytes written\n", dur_cur->psx_file_rec.base_rec.id,
-                    dur_cur->psx_file_rec.counters[POSIX_BYTES_READ],
-                    dur_cur->psx_file_rec.counters[POSIX_BYTES_WRITTEN]);
-            }
-            continue;
-        }
-
-        /* MPI-IO */
-        if(dur_cur->mpiio_file_rec.counters[MPIIO_COLL_OPENS] ||
-            dur_cur->mpiio_file_rec.counters[MPIIO_INDEP_OPENS])
-        {
-            /* don't parse unless this file record belongs to this rank, or
-             * this is a globally shared file record.
-             */
-            if(dur_cur->mpiio_file_rec.base_rec.rank == rank ||
-                dur_cur->mpiio_file_rec.base_rec.rank == -1)
-            {
-                /* make sure the file i/o counters are valid */
-                file_sanity_check(&dur_cur->psx_file_rec, 
-                    &dur_cur->mpiio_file_rec, &job, logfile_fd);
-
-                /* generate i/o events and store them in this rank's 
-                 * workload context 
-                 */
-                generate_mpiio_file_events(&dur_cur->mpiio_file_rec, my_ctx);
-            }
-        }
-        /* POSIX */
-        else if(dur_cur->psx_file_rec.counters[POSIX_OPENS])
-        {
-            /* don't parse unless this file record belongs to this rank, or
-             * this is a globally shared file record.
-             */
-            if(dur_cur->psx_file_rec.base_rec.rank == rank ||
-                dur_cur->psx_file_rec.base_rec.rank == -1)
-            {
-                /* make sure the file i/o counters are valid */
-                file_sanity_check(&dur_cur->psx_file_rec, 
-                    &dur_cur->mpiio_file_rec, &job, logfile_fd);
-
-                /* generate i/o events and store them in this rank's 
-                 * workload context 
-                 */
-                generate_psx_file_events(&dur_cur->psx_file_rec, my_ctx);
-            }
-        }
-        else
-        {
-            /* no I/O here that we can generate events for; continue */
-            continue;
-        }
-    }
-    if (ret < 0)
-        return -1;
-
-    darshan_log_close(logfile_fd);
-
-    /* finalize the rank's i/o context so i/o ops may be retrieved later (in order) */
-    darshan_finalize_io_op_dat(my_ctx->io_op_dat);
     if (!rank_tbl)
     {
         rank_tbl = qhash_init(darshan_rank_hash_compare, quickhash_64bit_hash, RANK_HASH_TABLE_SIZE);
@@ -383,15 +249,6 @@ static int darshan_psx_io_workload_load(const char *params, int app_id, int rank
     qhash_add(rank_tbl, &(my_ctx->my_rank), &(my_ctx->hash_link));
     rank_tbl_pop++;
 
-    /* free linked list */
-    for(dur_cur = dur_head; dur_cur;)
-    {
-        dur_tmp = dur_cur;
-        dur_cur = dur_cur->next;
-        free(dur_tmp);
-    }
-    free(psx_file_rec);
-    free(mpiio_file_rec);
     return 0;
 }
 
@@ -490,61 +347,509 @@ static int darshan_rank_hash_compare(
     return 0;
 }
 
+/*****************************************/
+/*                                       */
+/*        Darshan log file records       */
+/*                                       */
+/*****************************************/
+
+#define DARSHAN_REC_INC_CNT 1024
+
+/* logs read by this process */
+static struct darshan_log_records *log_list = NULL;
+
+/* file id of a POSIX record, for matching MPI-IO records to it */
+struct darshan_rec_id
+{
+    darshan_record_id id;
+    int64_t rec_ndx;
+};
+
+static int darshan_rec_id_compare(const void *p1, const void *p2)
+{
+    const struct darshan_rec_id *a = p1;
+    const struct darshan_rec_id *b = p2;
+
+    if (a->id != b->id)
+        return a->id < b->id ? -1 : 1;
+    if (a->rec_ndx != b->rec_ndx)
+        return a->rec_ndx < b->rec_ndx ? -1 : 1;
+    return 0;
+}
+
+/* order bucketed records by open time, ties by position in the log */
+static int darshan_bucket_entry_compare(const void *p1, const void *p2)
+{
+    const struct darshan_bucket_entry *a = p1;
+    const struct darshan_bucket_entry *b = p2;
+
+    if (a->open_time != b->open_time)
+        return a->open_time < b->open_time ? -1 : 1;
+    if (a->rec_ndx != b->rec_ndx)
+        return a->rec_ndx < b->rec_ndx ? -1 : 1;
+    return 0;
+}
+
+/* append a record to a growable record array */
+static struct darshan_unified_record *darshan_append_rec(
+    struct darshan_unified_record **recs, int64_t *cnt, int64_t *max)
+{
+    if (*cnt == *max)
+    {
+        *max = *max ? 2 * *max : DARSHAN_REC_INC_CNT;
+        *recs = realloc(*recs, *max * sizeof(**recs));
+        assert(*recs);
+    }
+    memset(&(*recs)[*cnt], 0, sizeof(**recs));
+    return &(*recs)[(*cnt)++];
+}
+
+/* bucket of a file record (0 for shared records), or -1 if it generates no
+ * events. Also returns the time its first event starts at */
+static int darshan_rec_bucket(
+    struct darshan_unified_record *rec, int nprocs, double *open_time)
+{
+    int64_t rank;
+
+    /* skip the file and emit a warning if it is RW */
+    if(rec->psx_file_rec.counters[POSIX_BYTES_READ] &&
+        rec->psx_file_rec.counters[POSIX_BYTES_WRITTEN])
+    {
+        printf("WARNING: skipping R/W file record %lu with %ld bytes read and %ld bytes written\n", rec->psx_file_rec.base_rec.id,
+            rec->psx_file_rec.counters[POSIX_BYTES_READ],
+            rec->psx_file_rec.counters[POSIX_BYTES_WRITTEN]);
+        return -1;
+    }
+
+    /* MPI-IO */
+    if(rec->mpiio_file_rec.counters[MPIIO_COLL_OPENS] ||
+        rec->mpiio_file_rec.counters[MPIIO_INDEP_OPENS])
+    {
+        rank = rec->mpiio_file_rec.base_rec.rank;
+        *open_time = rec->mpiio_file_rec.fcounters[MPIIO_F_OPEN_TIMESTAMP];
+    }
+    /* POSIX */
+    else if(rec->psx_file_rec.counters[POSIX_OPENS])
+    {
+        rank = rec->psx_file_rec.base_rec.rank;
+        *open_time = rec->psx_file_rec.fcounters[POSIX_F_OPEN_START_TIMESTAMP];
+    }
+    else
+    {
+        /* no I/O here that we can generate events for */
+        return -1;
+    }
+
+    if (rank < -1 || rank >= nprocs)
+        return -1;
+    return rank + 1;
+}
+
+/* read all file records of a darshan log and bucket them by rank */
+static int darshan_read_log_records(struct darshan_log_records *log)
+{
+    darshan_fd logfile_fd = NULL;
+    struct darshan_job job;
+    struct darshan_posix_file *psx_file_rec;
+    struct darshan_mpiio_file *mpiio_file_rec;
+    struct darshan_unified_record *orphans = NULL;
+    int64_t rec_max = 0, orphan_cnt = 0, orphan_max = 0;
+    struct darshan_rec_id *ids;
+    int *rec_bucket;
+    double *open_times;
+    int64_t i, lo, hi;
+    int ret;
+
+    psx_file_rec = (struct darshan_posix_file *) calloc(1, sizeof(struct darshan_posix_file));
+    assert(psx_file_rec);
+    mpiio_file_rec = (struct darshan_mpiio_file *) calloc(1, sizeof(struct darshan_mpiio_file));
+    assert(mpiio_file_rec);
+
+    /* open the darshan log to begin reading in file i/o info */
+    logfile_fd = darshan_log_open(log->log_file_path);
+    if (!logfile_fd)
+        return -1;
+
+    /* get the per-job stats from the log */
+    ret = darshan_log_get_job(logfile_fd, &job);
+    if (ret < 0)
+    {
+        darshan_log_close(logfile_fd);
+        return -1;
+    }
+    log->nprocs = job.nprocs;
+
+    /* read the posix records, in log order */
+    while ((ret = psx_utils->log_get_record(logfile_fd, (void **)&psx_file_rec)) > 0)
+    {
+        darshan_append_rec(&log->recs, &log->rec_cnt, &rec_max)->psx_file_rec =
+            *psx_file_rec;
+    }
+
+    /* now loop over mpiio records (if present) and match them up with the
+     * posix records of the same file id
+     */
+    ids = malloc((log->rec_cnt + 1) * sizeof(*ids));
+    assert(ids);
+    for (i = 0; i < log->rec_cnt; i++)
+    {
+        ids[i].id = log->recs[i].psx_file_rec.base_rec.id;
+        ids[i].rec_ndx = i;
+    }
+    qsort(ids, log->rec_cnt, sizeof(*ids), darshan_rec_id_compare);
+    while ((ret = mpiio_utils->log_get_record(logfile_fd, (void **)&mpiio_file_rec)) > 0)
+    {
+        struct darshan_unified_record *dur = NULL;
+
+        /* first posix record with this id */
+        lo = 0;
+        hi = log->rec_cnt;
+        while (lo < hi)
+        {
+            int64_t mid = lo + (hi - lo) / 2;
+            if (ids[mid].id < mpiio_file_rec->base_rec.id)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        for (; lo < log->rec_cnt && ids[lo].id == mpiio_file_rec->base_rec.id; lo++)
+        {
+            struct darshan_unified_record *cur = &log->recs[ids[lo].rec_ndx];
+
+            if(cur->psx_file_rec.base_rec.rank == mpiio_file_rec->base_rec.rank)
+            {
+                cur->mpiio_file_rec = *mpiio_file_rec;
+                dur = cur;
+                break;
+            }
+
+            if((cur->psx_file_rec.base_rec.rank == -1)
+                && (mpiio_file_rec->base_rec.rank != -1))
+            {
+                fprintf(stderr, "WARNING: id %" PRIu64 " has non-shared MPI record and shared POSIX record.  Skipping POSIX record which may have been generated by stat() calls.\n", mpiio_file_rec->base_rec.id);
+
+                cur->psx_file_rec.counters[POSIX_OPENS] = 0;
+            }
+        }
+
+        if(!dur)
+        {
+            /* if we fall through to here, that means that an mpiio record is present
+             * for which there is no exact match in the posix records.  This
+             * could (for example) happen if mpiio was using deferred opens,
+             * producing a shared record in mpi and unique records in posix.  Or
+             * if mpiio is using a non-posix back end. Or if we skip the posix
+             * records because the app issued a stat() on every rank but only
+             * did I/O on a subset.
+             */
+            darshan_append_rec(&orphans, &orphan_cnt, &orphan_max)->mpiio_file_rec =
+                *mpiio_file_rec;
+        }
+    }
+    free(ids);
+    free(psx_file_rec);
+    free(mpiio_file_rec);
+    if (ret < 0)
+    {
+        darshan_log_close(logfile_fd);
+        free(orphans);
+        return -1;
+    }
+
+    /* unmatched mpiio records go first, latest first */
+    if (orphan_cnt)
+    {
+        log->recs = realloc(log->recs, (log->rec_cnt + orphan_cnt) * sizeof(*log->recs));
+        assert(log->recs);
+        memmove(&log->recs[orphan_cnt], log->recs, log->rec_cnt * sizeof(*log->recs));
+        for (i = 0; i < orphan_cnt; i++)
+            log->recs[i] = orphans[orphan_cnt - 1 - i];
+        log->rec_cnt += orphan_cnt;
+    }
+    free(orphans);
+
+    /* file records have all been retrieved from darshan log.  Now bucket
+     * the ones generating events by rank, in order of open time
+     */
+    rec_bucket = malloc((log->rec_cnt + 1) * sizeof(*rec_bucket));
+    open_times = malloc((log->rec_cnt + 1) * sizeof(*open_times));
+    log->bucket_start = calloc(log->nprocs + 2, sizeof(*log->bucket_start));
+    assert(rec_bucket && open_times && log->bucket_start);
+    for (i = 0; i < log->rec_cnt; i++)
+    {
+        struct darshan_unified_record *cur = &log->recs[i];
+
+        rec_bucket[i] = darshan_rec_bucket(cur, log->nprocs, &open_times[i]);
+        if (rec_bucket[i] < 0)
+            continue;
+
+        /* make sure the file i/o counters are valid */
+        file_sanity_check(&cur->psx_file_rec, &cur->mpiio_file_rec, &job, logfile_fd);
+        log->bucket_start[rec_bucket[i] + 1]++;
+    }
+    darshan_log_close(logfile_fd);
+
+    for (i = 0; i < log->nprocs + 1; i++)
+        log->bucket_start[i + 1] += log->bucket_start[i];
+    log->buckets = malloc((log->bucket_start[log->nprocs + 1] + 1) * sizeof(*log->buckets));
+    assert(log->buckets);
+    for (i = 0; i < log->rec_cnt; i++)
+    {
+        if (rec_bucket[i] < 0)
+            continue;
+        /* bucket_start[b] advances to the end of bucket b while filling */
+        struct darshan_bucket_entry *ent =
+            &log->buckets[log->bucket_start[rec_bucket[i]]++];
+        ent->open_time = open_times[i];
+        ent->rec_ndx = i;
+    }
+    for (i = log->nprocs + 1; i > 0; i--)
+        log->bucket_start[i] = log->bucket_start[i - 1];
+    log->bucket_start[0] = 0;
+    for (i = 0; i < log->nprocs + 1; i++)
+    {
+        qsort(&log->buckets[log->bucket_start[i]],
+              log->bucket_start[i + 1] - log->bucket_start[i],
+              sizeof(*log->buckets), darshan_bucket_entry_compare);
+    }
+    free(rec_bucket);
+    free(open_times);
+
+    return 0;
+}
+
+/* get the file records of a log, reading it if no rank has yet */
+static struct darshan_log_records *darshan_get_log_records(const char *log_file_path)
+{
+    struct darshan_log_records *log;
+
+    for (log = log_list; log; log = log->next)
+    {
+        if (strcmp(log->log_file_path, log_file_path) == 0)
+        {
+            log->ref_cnt++;
+            return log;
+        }
+    }
+
+    log = calloc(1, sizeof(*log));
+    assert(log);
+    strncpy(log->log_file_path, log_file_path, MAX_NAME_LENGTH_WKLD - 1);
+    if (darshan_read_log_records(log) < 0)
+    {
+        free(log->recs);
+        free(log->bucket_start);
+        free(log->buckets);
+        free(log);
+        return NULL;
+    }
+    log->ref_cnt = 1;
+    log->next = log_list;
+    log_list = log;
+
+    return log;
+}
+
+/* drop a rank's reference to the file records of a log */
+static void darshan_put_log_records(struct darshan_log_records *log)
+{
+    struct darshan_log_records **prev;
+
+    if (--log->ref_cnt > 0)
+        return;
+
+    for (prev = &log_list; *prev != log; prev = &(*prev)->next)
+        ;
+    *prev = log->next;
+    free(log->recs);
+    free(log->bucket_start);
+    free(log->buckets);
+    free(log);
+
+    return;
+}
+
 /*****************************************/
 /*                                       */
 /*   Darshan I/O op storage abstraction  */
 /*                                       */
 /*****************************************/
 
-#define DARSHAN_IO_OP_INC_CNT 100000
+#define DARSHAN_IO_OP_INC_CNT 16
 
-/* dynamically allocated array data structure for storing darshan i/o events */
-struct darshan_io_dat_array
+/* i/o events of one file record, generated when the file is opened */
+struct darshan_file_ops
 {
     struct darshan_io_op *op_array;
     int64_t op_arr_ndx;
     int64_t op_arr_cnt;
+    int64_t op_arr_max;
+    int64_t seq; /* order in which files were opened, breaks ties */
 };
 
-/* initialize the dynamic array data structure */
-static void *darshan_init_io_op_dat()
+/* i/o events of a rank, generated lazily: files are opened in order of open
+ * time once the earliest pending event doesn't precede them, and the events
+ * of open files are merged in order of start time through a heap */
+struct darshan_io_dat_heap
 {
-    struct darshan_io_dat_array *tmp;
+    struct darshan_log_records *log;
+    struct rank_io_context *io_context;
+    /* next file records to open, in the rank's own and the shared bucket */
+    int64_t own_ndx, own_end;
+    int64_t shared_ndx, shared_end;
+    /* file record whose events are being generated */
+    struct darshan_file_ops *filling;
+    struct darshan_file_ops **heap;
+    int heap_cnt;
+    int heap_max;
+    int64_t next_seq;
+};
 
-    /* initialize the array data structure */
-    tmp = malloc(sizeof(struct darshan_io_dat_array));
-    assert(tmp);
-    tmp->op_array = malloc(DARSHAN_IO_OP_INC_CNT * sizeof(struct darshan_io_op));
-    assert(tmp->op_array);
-    tmp->op_arr_ndx = 0;
-    tmp->op_arr_cnt = DARSHAN_IO_OP_INC_CNT;
+/* initialize the rank's event generator */
+static void *darshan_init_io_op_dat(
+    struct darshan_log_records *log, struct rank_io_context *io_context)
+{
+    struct darshan_io_dat_heap *tmp;
+    int64_t bucket = io_context->my_rank + 1;
 
-    /* return the array info for this rank's i/o context */
+    tmp = calloc(1, sizeof(struct darshan_io_dat_heap));
+    assert(tmp);
+    tmp->log = log;
+    tmp->io_context = io_context;
+    tmp->own_ndx = log->bucket_start[bucket];
+    tmp->own_end = log->bucket_start[bucket + 1];
+    tmp->shared_ndx = log->bucket_start[0];
+    tmp->shared_end = log->bucket_start[1];
+
+    /* return the generator for this rank's i/o context */
     return (void *)tmp;
 }
 
-/* store the i/o event in this rank's i/o context */
+/* store the i/o event with the file record being opened */
 static void darshan_insert_next_io_op(
     void *io_op_dat, struct darshan_io_op *io_op)
 {
-    struct darshan_io_dat_array *array = (struct darshan_io_dat_array *)io_op_dat;
-    struct darshan_io_op *tmp;
+    struct darshan_io_dat_heap *dat = (struct darshan_io_dat_heap *)io_op_dat;
+    struct darshan_file_ops *file = dat->filling;
 
     assert(io_op->start_time >= 0);
+    assert(file);
 
     /* realloc array if it is already full */
-    if (array->op_arr_ndx == array->op_arr_cnt)
+    if (file->op_arr_cnt == file->op_arr_max)
     {
-        tmp = malloc((array->op_arr_cnt + DARSHAN_IO_OP_INC_CNT) * sizeof(struct darshan_io_op));
-        assert(tmp);
-        memcpy(tmp, array->op_array, array->op_arr_cnt * sizeof(struct darshan_io_op));
-        free(array->op_array);
-        array->op_array = tmp;
-        array->op_arr_cnt += DARSHAN_IO_OP_INC_CNT;
+        file->op_arr_max = file->op_arr_max ? 2 * file->op_arr_max : DARSHAN_IO_OP_INC_CNT;
+        file->op_array = realloc(file->op_array, file->op_arr_max * sizeof(struct darshan_io_op));
+        assert(file->op_array);
     }
 
     /* add the darshan i/o op to the array */
-    array->op_array[array->op_arr_ndx++] = *io_op;
+    file->op_array[file->op_arr_cnt++] = *io_op;
+
+    return;
+}
+
+/* does the next event of file a precede that of file b? */
+static int darshan_file_ops_before(
+    struct darshan_file_ops *a, struct darshan_file_ops *b)
+{
+    double a_time = a->op_array[a->op_arr_ndx].start_time;
+    double b_time = b->op_array[b->op_arr_ndx].start_time;
+
+    if (a_time != b_time)
+        return a_time < b_time;
+    return a->seq < b->seq;
+}
+
+/* restore the heap order after the root's next event changed */
+static void darshan_heap_sift_down(struct darshan_io_dat_heap *dat)
+{
+    int i = 0, child;
+    struct darshan_file_ops *file = dat->heap[0];
+
+    while ((child = 2 * i + 1) < dat->heap_cnt)
+    {
+        if (child + 1 < dat->heap_cnt &&
+            darshan_file_ops_before(dat->heap[child + 1], dat->heap[child]))
+            child++;
+        if (!darshan_file_ops_before(dat->heap[child], file))
+            break;
+        dat->heap[i] = dat->heap[child];
+        i = child;
+    }
+    dat->heap[i] = file;
+
+    return;
+}
+
+static void darshan_heap_push(
+    struct darshan_io_dat_heap *dat, struct darshan_file_ops *file)
+{
+    int i, parent;
+
+    if (dat->heap_cnt == dat->heap_max)
+    {
+        dat->heap_max = dat->heap_max ? 2 * dat->heap_max : DARSHAN_IO_OP_INC_CNT;
+        dat->heap = realloc(dat->heap, dat->heap_max * sizeof(*dat->heap));
+        assert(dat->heap);
+    }
+    for (i = dat->heap_cnt++; i > 0; i = parent)
+    {
+        parent = (i - 1) / 2;
+        if (!darshan_file_ops_before(file, dat->heap[parent]))
+            break;
+        dat->heap[i] = dat->heap[parent];
+    }
+    dat->heap[i] = file;
+
+    return;
+}
+
+/* next file record of the rank to open, NULL if all are open already */
+static struct darshan_bucket_entry *darshan_next_file(
+    struct darshan_io_dat_heap *dat)
+{
+    struct darshan_bucket_entry *own = NULL, *shared = NULL;
+
+    if (dat->own_ndx < dat->own_end)
+        own = &dat->log->buckets[dat->own_ndx];
+    if (dat->shared_ndx < dat->shared_end)
+        shared = &dat->log->buckets[dat->shared_ndx];
+    if (!own)
+        return shared;
+    if (!shared)
+        return own;
+    return darshan_bucket_entry_compare(own, shared) < 0 ? own : shared;
+}
+
+/* generate the i/o events of the rank's next file record */
+static void darshan_open_next_file(
+    struct darshan_io_dat_heap *dat, struct darshan_bucket_entry *ent)
+{
+    /* event generation consumes the record's counters, so use a copy */
+    struct darshan_unified_record rec = dat->log->recs[ent->rec_ndx];
+    struct darshan_file_ops *file;
+
+    if (dat->own_ndx < dat->own_end && ent == &dat->log->buckets[dat->own_ndx])
+        dat->own_ndx++;
+    else
+        dat->shared_ndx++;
+
+    file = calloc(1, sizeof(*file));
+    assert(file);
+    file->seq = dat->next_seq++;
+    dat->filling = file;
+    if(rec.mpiio_file_rec.counters[MPIIO_COLL_OPENS] ||
+        rec.mpiio_file_rec.counters[MPIIO_INDEP_OPENS])
+        generate_mpiio_file_events(&rec.mpiio_file_rec, dat->io_context);
+    else
+        generate_psx_file_events(&rec.psx_file_rec, dat->io_context);
+    dat->filling = NULL;
+
+    if (file->op_arr_cnt)
+        darshan_heap_push(dat, file);
+    else
+        free(file);
 
     return;
 }
@@ -553,23 +858,42 @@ static void darshan_insert_next_io_op(
 static void darshan_remove_next_io_op(
     void *io_op_dat, struct darshan_io_op *io_op, double last_op_time)
 {
-    struct darshan_io_dat_array *array = (struct darshan_io_dat_array *)io_op_dat;
+    struct darshan_io_dat_heap *dat = (struct darshan_io_dat_heap *)io_op_dat;
+    struct darshan_bucket_entry *next;
+
+    /* open the files whose first event doesn't follow the earliest pending
+     * one (a file's first event starts at its open time) */
+    while ((next = darshan_next_file(dat)) != NULL &&
+           (dat->heap_cnt == 0 ||
+            next->open_time <= dat->heap[0]->op_array[dat->heap[0]->op_arr_ndx].start_time))
+    {
+        darshan_open_next_file(dat, next);
+    }
 
-    /* if the array has been scanned completely already */
-    if (array->op_arr_ndx == array->op_arr_cnt)
+    /* if all events have been retrieved already */
+    if (dat->heap_cnt == 0)
     {
         /* no more events just end the workload */
         io_op->codes_op.op_type = CODES_WK_END;
     }
     else
     {
-        struct darshan_io_op *tmp = &(array->op_array[array->op_arr_ndx]);
+        struct darshan_file_ops *file = dat->heap[0];
+        struct darshan_io_op *tmp = &(file->op_array[file->op_arr_ndx]);
 
         if ((tmp->start_time - last_op_time) <= DARSHAN_NEGLIGIBLE_DELAY)
         {
-            /* there is no delay, just return the next op in the array */
+            /* there is no delay, just return the next op of the file */
             *io_op = *tmp;
-            array->op_arr_ndx++;
+            if (++file->op_arr_ndx == file->op_arr_cnt)
+            {
+                /* all of the file's events are done */
+                free(file->op_array);
+                free(file);
+                dat->heap[0] = dat->heap[--dat->heap_cnt];
+            }
+            if (dat->heap_cnt)
+                darshan_heap_sift_down(dat);
         }
         else
         {
@@ -584,44 +908,14 @@ static void darshan_remove_next_io_op(
     /* if this is the end op, free data structures */
     if (io_op->codes_op.op_type == CODES_WK_END)
     {
-        free(array->op_array);
-        free(array);
+        darshan_put_log_records(dat->log);
+        free(dat->heap);
+        free(dat);
     }
 
     return;
 }
 
-/* sort the dynamic array in order of i/o op start time */
-static void darshan_finalize_io_op_dat(
-    void *io_op_dat)
-{
-    struct darshan_io_dat_array *array = (struct darshan_io_dat_array *)io_op_dat;
-
-    /* sort this rank's i/o op list */
-    qsort(array->op_array, array->op_arr_ndx, sizeof(struct darshan_io_op), darshan_io_op_compare);
-    array->op_arr_cnt = array->op_arr_ndx;
-    array->op_arr_ndx = 0;
-
-    return;
-}
-
-/* comparison function for sorting darshan_io_ops in order of start timestamps */
-static int darshan_io_op_compare(
-    const void *p1, const void *p2)
-{
-    struct darshan_io_op *a = (struct darshan_io_op *)p1;
-    struct darshan_io_op *b = (struct darshan_io_op *)p2;
-    
-    assert(a->start_time != b->start_time);
-
-    if (a->start_time < b->start_time)
-        return -1;
-    else if (a->start_time > b->start_time)
-        return 1;
-    else
-        return 0;
-}
-
 /*****************************************/
 /*                                       */
 /* Darshan workload generation functions */
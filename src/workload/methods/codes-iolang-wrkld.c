@@ -54,8 +54,7 @@ struct codes_workload_method iolang_workload_method =
 struct codes_iolang_wrkld_state_per_rank
 {
     int rank;
-    CodesIOKernelContext codes_context;
-    CodesIOKernel_pstate * codes_pstate;
+    codes_kernel_vm vm;
     codeslang_inst next_event;
     struct qhash_head hash_link;
     iolang_workload_info task_info;
@@ -89,7 +88,6 @@ static void * iolang_io_workload_read_config(
 /* loads the workload file for each simulated MPI rank/ compute node LP */
 int iolang_io_workload_load(const char* params, int app_id, int rank)
 {
-    int t = -1;
     iolang_params* i_param = (struct iolang_params*)params;
 
     APP_ID_UNSUPPORTED(app_id, "iolang")
@@ -113,20 +111,17 @@ int iolang_io_workload_load(const char* params, int app_id, int rank)
     if(!wrkld_per_rank)
 	    return -1;
 
-    wrkld_per_rank->codes_pstate = CodesIOKernel_pstate_new();
     wrkld_per_rank->rank = rank;
-    t = codes_kernel_helper_bootstrap(i_param->io_kernel_path, 
+    codes_kernel_helper_bootstrap(i_param->io_kernel_path,
 				      i_param->io_kernel_meta_path,
         			      rank, 
                           nranks,
                       i_param->use_relpath,
-				      &(wrkld_per_rank->codes_context), 
-				      &(wrkld_per_rank->codes_pstate), 
-				      &(wrkld_per_rank->task_info), 
-				      &(wrkld_per_rank->next_event));
+				      &(wrkld_per_rank->vm),
+				      &(wrkld_per_rank->task_info));
     qhash_add(rank_tbl, &(wrkld_per_rank->rank), &(wrkld_per_rank->hash_link));
     rank_tbl_pop++;
-    return t;
+    return 0;
 }
 
 /* Maps the enum types from I/O language to the CODES workload API */
@@ -175,7 +170,7 @@ void iolang_io_workload_get_next(int app_id, int rank, struct codes_workload_op
 	}
 	next_wrkld = qhash_entry(hash_link, struct codes_iolang_wrkld_state_per_rank, hash_link);
 
-	int type = codes_kernel_helper_parse_input(next_wrkld->codes_pstate, &(next_wrkld->codes_context),&(next_wrkld->next_event));
+	int type = codes_kernel_helper_parse_input(&(next_wrkld->vm), &(next_wrkld->next_event));
         op->op_type = (enum codes_workload_op_type) convertTypes(type);
         if (op->op_type == CODES_WK_IGNORE)
             return;
@@ -198,6 +193,7 @@ void iolang_io_workload_get_next(int app_id, int rank, struct codes_workload_op
 	    {
 		/* delete the hash entry*/
 		  qhash_del(hash_link); 
+		  free(next_wrkld);
 		  rank_tbl_pop--;
 
 		  /* if no more entries are there, delete the hash table */
@@ -12,6 +12,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <dirent.h>
 
@@ -24,6 +26,12 @@
 
 #define RANK_HASH_TABLE_SIZE 397
 
+/* identifies the binary op index kept next to each trace file */
+#define RECORDER_INDEX_MAGIC 0x5245434f52444958ULL
+#define RECORDER_INDEX_VERSION 2
+/* bytes at each end of the trace file that the index header checksums */
+#define RECORDER_INDEX_EDGE_SIZE 4096
+
 struct recorder_io_op
 {
     double start_time;
@@ -31,11 +39,11 @@ struct recorder_io_op
     struct codes_workload_op codes_op;
 };
 
+/* file id of an open trace fd */
 struct file_entry
 {
     uint64_t file_id;
-    int fd;
-    struct qhash_head hash_link;
+    int open;
 };
 
 /* structure for storing all context needed to retrieve traces for this rank */
@@ -44,7 +52,7 @@ struct rank_traces_context
     int rank;
     double last_op_time;
 
-    struct recorder_io_op trace_ops[2048]; /* TODO: this should be extendable */
+    struct recorder_io_op *trace_ops;
     int trace_list_ndx;
     int trace_list_max;
 
@@ -52,13 +60,44 @@ struct rank_traces_context
     struct qhash_head hash_link;
 };
 
+/* header of a rank's op index: the ops parsed from its trace file, valid as
+ * long as the trace file and the number of ranks are unchanged. Besides the
+ * file's identity, size and mtime, a hash of its first and last bytes
+ * catches a trace rewritten in place within the mtime resolution */
+struct recorder_index_header
+{
+    uint64_t magic;
+    int32_t version;
+    int32_t op_size;
+    int64_t nprocs;
+    uint64_t trace_ino;
+    int64_t trace_size;
+    int64_t trace_mtime;
+    int64_t trace_mtime_nsec;
+    uint64_t trace_edge_hash;
+    int64_t op_count;
+};
+
+/* one line of a mapped trace file, split into tokens the way strtok(3)
+ * would split it, without modifying the mapping */
+struct trace_line
+{
+    const char *pos;
+    const char *end;
+};
+
+struct trace_token
+{
+    const char *ptr;
+    size_t len;
+};
+
 /* CODES workload API functions for workloads generated from recorder traces*/
 static int recorder_io_workload_load(const char *params, int app_id, int rank);
 static void recorder_io_workload_get_next(int app_id, int rank, struct codes_workload_op *op);
 
 /* helper functions for recorder workload CODES API */
 static int hash_rank_compare(void *key, struct qhash_head *link);
-static int hash_file_compare(void *key, struct qhash_head *link);
 
 /* workload method name and function pointers for the CODES workload API */
 struct codes_workload_method recorder_io_workload_method =
@@ -72,78 +111,145 @@ struct codes_workload_method recorder_io_workload_method =
 static struct qhash_table *rank_tbl = NULL;
 static int rank_tbl_pop = 0;
 
-/* load the workload generator for this rank, given input params */
-static int recorder_io_workload_load(const char *params, int app_id, int rank)
+static int is_delim(char c, const char *delims)
 {
-    recorder_params *r_params = (recorder_params *) params;
-    struct rank_traces_context *newv = NULL;
-    struct qhash_table *file_id_tbl = NULL;
-    struct qhash_head *link = NULL;
-    struct file_entry *file;
+    return c != '\0' && strchr(delims, c) != NULL;
+}
 
-    APP_ID_UNSUPPORTED(app_id, "recorder")
+/* next token of the line (empty at the end of the line) */
+static struct trace_token next_token(struct trace_line *line, const char *delims)
+{
+    struct trace_token tok;
+
+    while (line->pos < line->end && is_delim(*line->pos, delims))
+        line->pos++;
+    tok.ptr = line->pos;
+    while (line->pos < line->end && !is_delim(*line->pos, delims))
+        line->pos++;
+    tok.len = line->pos - tok.ptr;
+    /* the delimiter ending the token is consumed with it */
+    if (line->pos < line->end)
+        line->pos++;
+
+    return tok;
+}
 
-    int64_t nprocs = r_params->nprocs;
-    char *trace_dir = r_params->trace_dir_path;
-    if(!trace_dir)
-        return -1;
+static int token_is(struct trace_token tok, const char *str)
+{
+    return tok.len == strlen(str) && memcmp(tok.ptr, str, tok.len) == 0;
+}
 
-    /* allocate a new trace context for this rank */
-    newv = (struct rank_traces_context*)malloc(sizeof(*newv));
-    if(!newv)
-        return -1;
+/* numbers are converted from a terminated copy, as the mapping isn't */
+static void token_str(struct trace_token tok, char *buf, size_t size)
+{
+    size_t len = tok.len < size - 1 ? tok.len : size - 1;
 
-    newv->rank = rank;
-    newv->trace_list_ndx = 0;
-    newv->trace_list_max = 0;
+    memcpy(buf, tok.ptr, len);
+    buf[len] = '\0';
+}
 
-#if 0
-    DIR *dirp;
-    struct dirent *entry;
-    dirp = opendir(trace_dir);
-    while((entry = readdir(dirp)) != NULL) {
-        if(entry->d_type == DT_REG)
-            nprocs++;
-    }
-    closedir(dirp);
-#endif
+static double token_double(struct trace_token tok)
+{
+    char buf[64];
 
-    char trace_file_name[1024] = {'\0'};
-    sprintf(trace_file_name, "%s/log.%d", trace_dir, rank);
+    token_str(tok, buf, sizeof(buf));
+    return atof(buf);
+}
 
-    FILE *trace_file = fopen(trace_file_name, "r");
-    if(trace_file == NULL)
-        return -1;
+static long token_long(struct trace_token tok)
+{
+    char buf[64];
 
-    char *line = NULL;
-    size_t len;
-    ssize_t ret_value;
-    char function_name[128] = {'\0'};
+    token_str(tok, buf, sizeof(buf));
+    return atol(buf);
+}
+
+/* file entry of a trace fd (fd -1, from a failed open, included) */
+static struct file_entry *file_lookup(
+    struct file_entry **files, int *files_cnt, int fd, int grow)
+{
+    int ndx = fd + 1;
+
+    if (ndx < 0)
+        return NULL;
+    if (ndx >= *files_cnt)
+    {
+        int cnt = *files_cnt ? *files_cnt : 16;
+
+        if (!grow)
+            return NULL;
+        while (cnt <= ndx)
+            cnt *= 2;
+        *files = realloc(*files, cnt * sizeof(**files));
+        assert(*files);
+        memset(*files + *files_cnt, 0, (cnt - *files_cnt) * sizeof(**files));
+        *files_cnt = cnt;
+    }
+    return *files + ndx;
+}
+
+static void add_op(struct rank_traces_context *ctx, int *ops_max,
+    struct recorder_io_op *r_op)
+{
+    if (ctx->trace_list_ndx == *ops_max)
+    {
+        *ops_max = *ops_max ? 2 * *ops_max : 2048;
+        ctx->trace_ops = realloc(ctx->trace_ops, *ops_max * sizeof(*ctx->trace_ops));
+        assert(ctx->trace_ops);
+    }
+    ctx->trace_ops[ctx->trace_list_ndx++] = *r_op;
+}
+
+/* parse the ops of a mapped trace file into the rank's context */
+static int parse_trace(struct rank_traces_context *newv, int64_t nprocs,
+    const char *trace, size_t size)
+{
+    const char *p = trace, *end = trace + size;
+    struct file_entry *files = NULL, *file;
+    int files_cnt = 0;
+    int ops_max = 0;
     double wkld_start_time = 0.0;
     double io_start_time = 0.0;
-    while((ret_value = getline(&line, &len, trace_file)) != -1) {
+
+    while (p < end) {
+        struct trace_line line = {p, end};
+        const char *nl = memchr(p, '\n', end - p);
         struct recorder_io_op r_op;
-        char *token = strtok(line, ", \n");
+        struct trace_token token, function_name;
         int fd;
 
-        if (strcmp(token, "BARRIER") && strcmp(token, "0"))
+        /* ops are saved to the index whole: no stale bytes in the fields
+         * an op type doesn't use */
+        memset(&r_op, 0, sizeof(r_op));
+
+        /* lines keep their newline, as with getline(3) */
+        if (nl)
+            line.end = nl + 1;
+        p = line.end;
+
+        token = next_token(&line, ", \n");
+        if (token.len == 0)
+            continue;
+
+        if (!token_is(token, "BARRIER") && !token_is(token, "0"))
         {
             if (wkld_start_time == 0.0)
-                wkld_start_time = atof(token);
+                wkld_start_time = token_double(token);
 
-            r_op.start_time = atof(token) - wkld_start_time;
-            token = strtok(NULL, ", ");
+            r_op.start_time = token_double(token) - wkld_start_time;
+            token = next_token(&line, ", ");
         }
-        strcpy(function_name, token);
+        function_name = token;
 
-        if(!strcmp(function_name, "open") || !strcmp(function_name, "open64")) {
-            char *filename = NULL;
-            char *open_flags = NULL;
+        if(token_is(function_name, "open") || token_is(function_name, "open64")) {
+            struct trace_token filename;
+            long open_flags;
+            uint32_t h1 = 0x00000000, h2 = 0xFFFFFFFF;
 
-            filename = strtok(NULL, ", (");
-            open_flags = strtok(NULL, ", )");
+            filename = next_token(&line, ", (");
+            open_flags = token_long(next_token(&line, ", )"));
 
-            if (!(atoi(open_flags) & O_CREAT))
+            if (!(open_flags & O_CREAT))
             {
                 r_op.codes_op.op_type = CODES_WK_BARRIER;
                 r_op.end_time = r_op.start_time;
@@ -151,169 +257,313 @@ static int recorder_io_workload_load(const char *params, int app_id, int rank)
                 r_op.codes_op.u.barrier.count = nprocs;
                 r_op.codes_op.u.barrier.root = 0;
 
-                newv->trace_ops[newv->trace_list_ndx++] = r_op;
-                if (newv->trace_list_ndx == 2048) break;
+                add_op(newv, &ops_max, &r_op);
             }
 
-            token = strtok(NULL, ", )");
-            token = strtok(NULL, ", ");
-            fd = atoi(token);
+            next_token(&line, ", )");
+            fd = token_long(next_token(&line, ", "));
 
-            token = strtok(NULL, ", \n");
-            r_op.end_time = r_op.start_time + atof(token);
+            token = next_token(&line, ", \n");
+            r_op.end_time = r_op.start_time + token_double(token);
 
-            if (!file_id_tbl)
-            {
-                file_id_tbl = qhash_init(hash_file_compare, quickhash_32bit_hash, 11);
-                if (!file_id_tbl)
-                {
-                    free(newv);
-                    return -1;
-                }
-            }
-
-            file = (struct file_entry*)malloc(sizeof(struct file_entry));
+            file = file_lookup(&files, &files_cnt, fd, 1);
             if (!file)
             {
-                free(newv);
+                free(files);
                 return -1;
             }
-            
-            uint32_t h1 = 0x00000000, h2 = 0xFFFFFFFF;
-            bj_hashlittle2(filename, strlen(filename), &h1, &h2);
+            bj_hashlittle2(filename.ptr, filename.len, &h1, &h2);
             file->file_id = h1 + (((uint64_t)h2)<<32);
-            file->fd = fd;
+            file->open = 1;
             r_op.codes_op.op_type = CODES_WK_OPEN;
             r_op.codes_op.u.open.file_id = file->file_id;
-            r_op.codes_op.u.open.create_flag = atoi(open_flags) & O_CREAT;
-
-            qhash_add(file_id_tbl, &fd, &(file->hash_link));
+            r_op.codes_op.u.open.create_flag = open_flags & O_CREAT;
         }
-        else if(!strcmp(function_name, "close")) {
+        else if(token_is(function_name, "close")) {
             r_op.codes_op.op_type = CODES_WK_CLOSE;
 
-            token = strtok(NULL, ", ()");
-            fd = atoi(token);
+            fd = token_long(next_token(&line, ", ()"));
 
-            token = strtok(NULL, ", ");
-            token = strtok(NULL, ", \n");
-            r_op.end_time = r_op.start_time + atof(token);
+            next_token(&line, ", ");
+            token = next_token(&line, ", \n");
+            r_op.end_time = r_op.start_time + token_double(token);
 
-            link = qhash_search(file_id_tbl, &fd);
-            if (!link)
+            file = file_lookup(&files, &files_cnt, fd, 0);
+            if (!file || !file->open)
             {
-                free(newv);
+                free(files);
                 return -1;
             }
-
-            file = qhash_entry(link, struct file_entry, hash_link);
             r_op.codes_op.u.close.file_id = file->file_id;
-
-            qhash_del(link);
-            free(file);
+            file->open = 0;
         }
-        else if(!strcmp(function_name, "read") || !strcmp(function_name, "read64")) {
+        else if(token_is(function_name, "read") || token_is(function_name, "read64")) {
             r_op.codes_op.op_type = CODES_WK_READ;
 
-            token = strtok(NULL, ", (");
-            fd = atoi(token);
+            fd = token_long(next_token(&line, ", ("));
 
             // Throw out the buffer
-            token = strtok(NULL, ", ");
-
-            token = strtok(NULL, ", )");
-            r_op.codes_op.u.read.size = atol(token);
+            next_token(&line, ", ");
 
-            token = strtok(NULL, ", )");
-            r_op.codes_op.u.read.offset = atol(token);
+            r_op.codes_op.u.read.size = token_long(next_token(&line, ", )"));
+            r_op.codes_op.u.read.offset = token_long(next_token(&line, ", )"));
 
-            token = strtok(NULL, ", ");
-            token = strtok(NULL, ", \n");
+            next_token(&line, ", ");
+            token = next_token(&line, ", \n");
 
             if (io_start_time == 0.0)
             {
-                r_op.end_time = r_op.start_time + atof(token);
+                r_op.end_time = r_op.start_time + token_double(token);
             }
             else
             {
                 r_op.start_time = r_op.end_time = io_start_time;
             }
 
-            link = qhash_search(file_id_tbl, &fd);
-            if (!link)
+            file = file_lookup(&files, &files_cnt, fd, 0);
+            if (!file || !file->open)
             {
-                free(newv);
+                free(files);
                 return -1;
             }
-
-            file = qhash_entry(link, struct file_entry, hash_link);
             r_op.codes_op.u.read.file_id = file->file_id;
         }
-        else if(!strcmp(function_name, "write") || !strcmp(function_name, "write64")) {
+        else if(token_is(function_name, "write") || token_is(function_name, "write64")) {
             r_op.codes_op.op_type = CODES_WK_WRITE;
 
-            token = strtok(NULL, ", (");
-            fd = atoi(token);
+            fd = token_long(next_token(&line, ", ("));
 
             // Throw out the buffer
-            token = strtok(NULL, ", ");
-
-            token = strtok(NULL, ", )");
-            r_op.codes_op.u.write.size = atol(token);
+            next_token(&line, ", ");
 
-            token = strtok(NULL, ", )");
-            r_op.codes_op.u.write.offset = atol(token);
+            r_op.codes_op.u.write.size = token_long(next_token(&line, ", )"));
+            r_op.codes_op.u.write.offset = token_long(next_token(&line, ", )"));
 
-            token = strtok(NULL, ", ");
-            token = strtok(NULL, ", \n");
+            next_token(&line, ", ");
+            token = next_token(&line, ", \n");
 
             if (io_start_time == 0.0)
             {
-                r_op.end_time = r_op.start_time + atof(token);
+                r_op.end_time = r_op.start_time + token_double(token);
             }
             else
             {
                 r_op.start_time = r_op.end_time = io_start_time;
             }
 
-            link = qhash_search(file_id_tbl, &fd);
-            if (!link)
+            file = file_lookup(&files, &files_cnt, fd, 0);
+            if (!file || !file->open)
             {
-                free(newv);
+                free(files);
                 return -1;
             }
-
-            file = qhash_entry(link, struct file_entry, hash_link);
             r_op.codes_op.u.write.file_id = file->file_id;
         }
-        else if(!strcmp(function_name, "BARRIER")) {
+        else if(token_is(function_name, "BARRIER")) {
             r_op.start_time = r_op.end_time = io_start_time;
-            
+
             r_op.codes_op.op_type = CODES_WK_BARRIER;
             r_op.codes_op.u.barrier.count = nprocs;
             r_op.codes_op.u.barrier.root = 0;
         }
-        else if(!strcmp(function_name, "0")) {
-            token = strtok (NULL, ", \n");
-            newv->trace_ops[newv->trace_list_ndx-1].end_time += atof(token);
+        else if(token_is(function_name, "0")) {
+            token = next_token(&line, ", \n");
+            if (newv->trace_list_ndx > 0)
+                newv->trace_ops[newv->trace_list_ndx-1].end_time += token_double(token);
 
             io_start_time = 0.0;
             continue;
         }
         else{
-            if (!strcmp(function_name, "MPI_File_write_at_all") ||
-                !strcmp(function_name, "MPI_File_read_at_all")) {
+            if (token_is(function_name, "MPI_File_write_at_all") ||
+                token_is(function_name, "MPI_File_read_at_all")) {
                 io_start_time = r_op.start_time;
             }
             continue;
         }
 
-        newv->trace_ops[newv->trace_list_ndx++] = r_op;
-        if (newv->trace_list_ndx == 2048) break;
+        add_op(newv, &ops_max, &r_op);
     }
 
-    fclose(trace_file);
-    qhash_finalize(file_id_tbl);
+    free(files);
+    return 0;
+}
+
+/* hash of the first and last RECORDER_INDEX_EDGE_SIZE bytes of the trace */
+static int trace_edge_hash(int trace_fd, int64_t size, uint64_t *hash)
+{
+    char buf[2 * RECORDER_INDEX_EDGE_SIZE];
+    int64_t head = size < RECORDER_INDEX_EDGE_SIZE ? size : RECORDER_INDEX_EDGE_SIZE;
+    int64_t tail = size - head < RECORDER_INDEX_EDGE_SIZE ?
+        size - head : RECORDER_INDEX_EDGE_SIZE;
+    uint32_t h1 = 0, h2 = 0;
+
+    if (pread(trace_fd, buf, head, 0) != head ||
+        pread(trace_fd, buf + head, tail, size - tail) != tail)
+        return -1;
+    bj_hashlittle2(buf, head + tail, &h1, &h2);
+    *hash = h1 + (((uint64_t)h2)<<32);
+    return 0;
+}
+
+/* read the rank's ops from its index, if the index matches the trace */
+static int read_index(struct rank_traces_context *newv, const char *index_file_name,
+    struct recorder_index_header const *expect)
+{
+    struct recorder_index_header h;
+    FILE *index_file = fopen(index_file_name, "rb");
+    int ret = -1;
+
+    if (!index_file)
+        return -1;
+    if (fread(&h, sizeof(h), 1, index_file) == 1 &&
+        h.magic == expect->magic && h.version == expect->version &&
+        h.op_size == expect->op_size && h.nprocs == expect->nprocs &&
+        h.trace_ino == expect->trace_ino &&
+        h.trace_size == expect->trace_size &&
+        h.trace_mtime == expect->trace_mtime &&
+        h.trace_mtime_nsec == expect->trace_mtime_nsec &&
+        h.trace_edge_hash == expect->trace_edge_hash &&
+        h.op_count >= 0 && h.op_count <= INT32_MAX)
+    {
+        newv->trace_ops = malloc((h.op_count + 1) * sizeof(*newv->trace_ops));
+        assert(newv->trace_ops);
+        if (fread(newv->trace_ops, sizeof(*newv->trace_ops), h.op_count,
+                index_file) == (size_t)h.op_count)
+        {
+            newv->trace_list_ndx = h.op_count;
+            ret = 0;
+        }
+        else
+        {
+            free(newv->trace_ops);
+            newv->trace_ops = NULL;
+        }
+    }
+    fclose(index_file);
+
+    return ret;
+}
+
+/* save the rank's ops for later loads. Failing to is harmless (e.g., in a
+ * read-only trace directory) */
+static void write_index(struct rank_traces_context *newv, const char *index_file_name,
+    struct recorder_index_header const *h)
+{
+    char tmp_file_name[1100];
+    struct recorder_index_header out = *h;
+    FILE *index_file;
+    int ok;
+
+    /* written aside and renamed, so that readers never see a partial index */
+    snprintf(tmp_file_name, sizeof(tmp_file_name), "%s.%d.tmp",
+             index_file_name, (int)getpid());
+    index_file = fopen(tmp_file_name, "wb");
+    if (!index_file)
+        return;
+    out.op_count = newv->trace_list_ndx;
+    ok = fwrite(&out, sizeof(out), 1, index_file) == 1 &&
+        fwrite(newv->trace_ops, sizeof(*newv->trace_ops), newv->trace_list_ndx,
+               index_file) == (size_t)newv->trace_list_ndx;
+    ok = (fclose(index_file) == 0) && ok;
+    if (!ok || rename(tmp_file_name, index_file_name))
+        unlink(tmp_file_name);
+}
+
+/* load the workload generator for this rank, given input params */
+static int recorder_io_workload_load(const char *params, int app_id, int rank)
+{
+    recorder_params *r_params = (recorder_params *) params;
+    struct rank_traces_context *newv = NULL;
+    struct recorder_index_header h;
+    struct stat st;
+
+    APP_ID_UNSUPPORTED(app_id, "recorder")
+
+    int64_t nprocs = r_params->nprocs;
+    char *trace_dir = r_params->trace_dir_path;
+    if(!trace_dir)
+        return -1;
+
+    /* allocate a new trace context for this rank */
+    newv = (struct rank_traces_context*)malloc(sizeof(*newv));
+    if(!newv)
+        return -1;
+
+    newv->rank = rank;
+    newv->trace_ops = NULL;
+    newv->trace_list_ndx = 0;
+    newv->trace_list_max = 0;
+
+#if 0
+    DIR *dirp;
+    struct dirent *entry;
+    dirp = opendir(trace_dir);
+    while((entry = readdir(dirp)) != NULL) {
+        if(entry->d_type == DT_REG)
+            nprocs++;
+    }
+    closedir(dirp);
+#endif
+
+    char trace_file_name[1024] = {'\0'};
+    char index_file_name[1024] = {'\0'};
+    snprintf(trace_file_name, sizeof(trace_file_name), "%s/log.%d", trace_dir, rank);
+    snprintf(index_file_name, sizeof(index_file_name), "%s.idx", trace_file_name);
+
+    int trace_fd = open(trace_file_name, O_RDONLY);
+    if(trace_fd < 0 || fstat(trace_fd, &st))
+    {
+        if (trace_fd >= 0)
+            close(trace_fd);
+        free(newv);
+        return -1;
+    }
+
+    memset(&h, 0, sizeof(h));
+    h.magic = RECORDER_INDEX_MAGIC;
+    h.version = RECORDER_INDEX_VERSION;
+    h.op_size = sizeof(struct recorder_io_op);
+    h.nprocs = nprocs;
+    h.trace_ino = st.st_ino;
+    h.trace_size = st.st_size;
+    h.trace_mtime = st.st_mtim.tv_sec;
+    h.trace_mtime_nsec = st.st_mtim.tv_nsec;
+    if (trace_edge_hash(trace_fd, st.st_size, &h.trace_edge_hash))
+    {
+        close(trace_fd);
+        free(newv);
+        return -1;
+    }
+
+    /* parse the trace only if no up-to-date index has been saved */
+    if (read_index(newv, index_file_name, &h))
+    {
+        const char *trace = NULL;
+        int ret = 0;
+
+        if (st.st_size > 0)
+        {
+            trace = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, trace_fd, 0);
+            if (trace == MAP_FAILED)
+            {
+                close(trace_fd);
+                free(newv);
+                return -1;
+            }
+            ret = parse_trace(newv, nprocs, trace, st.st_size);
+            munmap((void *)trace, st.st_size);
+        }
+        if (ret)
+        {
+            close(trace_fd);
+            free(newv->trace_ops);
+            free(newv);
+            return -1;
+        }
+        write_index(newv, index_file_name, &h);
+    }
+    close(trace_fd);
 
     /* reset ndx to 0 and set max to event count */
     /* now we can read all events by counting through array from 0 - max */
@@ -326,6 +576,7 @@ static int recorder_io_workload_load(const char *params, int app_id, int rank)
         rank_tbl = qhash_init(hash_rank_compare, quickhash_32bit_hash, RANK_HASH_TABLE_SIZE);
 
         if (!rank_tbl) {
+            free(newv->trace_ops);
             free(newv);
             return -1;
         }
@@ -362,6 +613,7 @@ static void recorder_io_workload_get_next(int app_id, int rank, struct codes_wor
         /* no more events -- just end the workload */
         op->op_type = CODES_WK_END;
         qhash_del(hash_link);
+        free(tmp->trace_ops);
         free(tmp);
 
         rank_tbl_pop--;
@@ -403,18 +655,6 @@ static int hash_rank_compare(void *key, struct qhash_head *link)
     return 0;
 }
 
-static int hash_file_compare(void *key, struct qhash_head *link)
-{
-    int *in_file = (int *)key;
-    struct file_entry *tmp;
-
-    tmp = qhash_entry(link, struct file_entry, hash_link);
-    if (tmp->fd == *in_file)
-        return 1;
-
-    return 0;
-}
-
 /*
  * Local variables:
  *  c-indent-level: 4
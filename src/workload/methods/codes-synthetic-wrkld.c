@@ -0,0 +1,480 @@
+/*
+ * Copyright (C) 2013 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+/* Synthetic network traffic: each rank sends num_messages messages of
+ * payload_size bytes to destinations picked by a traffic pattern, with gaps
+ * drawn from an arrival process. A rank's ops are a burst's delay followed
+ * by its sends, burst after burst, and every op is computed from its
+ * position in that sequence: random draws come from a counter-based
+ * generator keyed on (seed, rank, message), so nothing has to be saved to
+ * reverse an op. */
+
+#include <assert.h>
+#include <math.h>
+#include <ross.h>
+#include <codes/codes-workload.h>
+#include <codes/quicklist.h>
+#include <codes/codes.h>
+
+/* independent streams of random draws */
+enum synthetic_stream
+{
+    STREAM_DEST,
+    STREAM_HOTSPOT,
+    STREAM_ARRIVAL,
+    STREAM_PERM,
+};
+
+struct app_state
+{
+    int app_id;
+    synthetic_params params;
+    /* position of the next op of each rank */
+    int64_t *next_op;
+    struct qlist_head ql;
+};
+
+// hold the applications using this workload
+static struct qlist_head app_list = QLIST_HEAD_INIT(app_list);
+
+static uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t synthetic_rand(
+        synthetic_params const * p,
+        int stream,
+        int64_t a,
+        int64_t b)
+{
+    uint64_t x = mix64(p->seed + 0x9e3779b97f4a7c15ULL * (stream + 1));
+    x = mix64(x ^ (uint64_t)a);
+    return mix64(x ^ (uint64_t)b);
+}
+
+// uniform in (0, 1]
+static double synthetic_unif(
+        synthetic_params const * p,
+        int stream,
+        int64_t a,
+        int64_t b)
+{
+    return ((synthetic_rand(p, stream, a, b) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+// permutation of [0, n) keyed on the permutation epoch: a four-round
+// Feistel network on the smallest even number of bits covering n, walking
+// the cycle until it lands back in range
+static int64_t perm_apply(
+        synthetic_params const * p,
+        int64_t epoch,
+        int64_t x,
+        int inverse)
+{
+    int64_t n = p->nprocs;
+    int half = 1;
+    uint64_t mask;
+
+    while ((INT64_C(1) << (2 * half)) < n)
+        half++;
+    mask = (UINT64_C(1) << half) - 1;
+    do {
+        uint64_t l = (uint64_t)x >> half, r = (uint64_t)x & mask;
+        for (int i = 0; i < 4; i++) {
+            int round = inverse ? 3 - i : i;
+            uint64_t f = synthetic_rand(p, STREAM_PERM, epoch,
+                    (round << 24) | (inverse ? l : r)) & mask;
+            if (inverse) {
+                uint64_t t = r;
+                r = l;
+                l = t ^ f;
+            }
+            else {
+                uint64_t t = l;
+                l = r;
+                r = t ^ f;
+            }
+        }
+        x = (int64_t)((l << half) | r);
+    } while (x >= n);
+    return x;
+}
+
+int codes_workload_synthetic_dest(
+        synthetic_params const * p,
+        int rank,
+        int64_t msg)
+{
+    int n = p->nprocs;
+    int dest = rank;
+
+    switch (p->pattern) {
+        case SYNTHETIC_HOTSPOT:
+            if (rank != p->hotspot_rank &&
+                    synthetic_unif(p, STREAM_HOTSPOT, rank, msg) <=
+                    p->hotspot_fraction) {
+                dest = p->hotspot_rank;
+                break;
+            }
+            // otherwise uniform
+            // fall through
+        case SYNTHETIC_UNIFORM:
+            if (n > 1) {
+                dest = (int)((1.0 - synthetic_unif(p, STREAM_DEST, rank, msg))
+                        * (n - 1));
+                if (dest >= rank)
+                    dest++;
+            }
+            break;
+        case SYNTHETIC_PERMUTATION:
+        {
+            // successor in a random cycle through all ranks, so no rank
+            // sends to itself and each receives from exactly one
+            int64_t epoch = p->perm_switch ? msg / p->perm_switch : 0;
+            int64_t pos = perm_apply(p, epoch, rank, 0);
+            dest = (int)perm_apply(p, epoch, (pos + 1) % n, 1);
+            break;
+        }
+        case SYNTHETIC_BIT_COMPLEMENT:
+            dest = n - 1 - rank;
+            break;
+        case SYNTHETIC_TRANSPOSE:
+        {
+            int side = (int)lround(sqrt((double)n));
+            dest = (rank % side) * side + rank / side;
+            break;
+        }
+        case SYNTHETIC_TORNADO:
+            dest = (rank + (n + 1) / 2 - 1) % n;
+            break;
+        case SYNTHETIC_INCAST:
+            dest = p->hotspot_rank;
+            break;
+        case SYNTHETIC_STENCIL:
+        {
+            // +1 and -1 neighbours of each dimension in turn
+            int ndims = 0, stride = 1, coord, size;
+            int64_t k;
+
+            while (ndims < SYNTHETIC_MAX_DIMS && p->stencil_dims[ndims])
+                ndims++;
+            k = msg % (2 * ndims);
+            for (int d = 0; d < k / 2; d++)
+                stride *= p->stencil_dims[d];
+            size = p->stencil_dims[k / 2];
+            coord = (rank / stride) % size;
+            dest = rank + ((coord + (k % 2 ? size - 1 : 1)) % size - coord)
+                * stride;
+            break;
+        }
+        default:
+            tw_error(TW_LOC, "synthetic workload: unknown pattern %d",
+                    p->pattern);
+    }
+    return dest == rank ? -1 : dest;
+}
+
+static void * synthetic_workload_read_config(
+        ConfigHandle * handle,
+        char const * section_name,
+        char const * annotation,
+        int num_ranks)
+{
+    synthetic_params *p = malloc(sizeof(*p));
+    assert(p);
+
+    // defaults
+    memset(p, 0, sizeof(*p));
+    p->nprocs = num_ranks;
+    p->pattern = SYNTHETIC_UNIFORM;
+    p->arrival = SYNTHETIC_POISSON;
+    p->burst_length = 8;
+    p->hotspot_fraction = 0.25;
+
+    char val[CONFIGURATION_MAX_NAME] = "";
+    long int lval;
+    int rc;
+
+    // required
+    rc = configuration_get_value_longint(handle, section_name,
+            "synthetic_num_messages", annotation, &lval);
+    if (rc || lval < 0)
+        tw_error(TW_LOC,
+                "synthetic workload: expected non-negative integer for "
+                "\"synthetic_num_messages\"");
+    p->num_messages = lval;
+    rc = configuration_get_value_longint(handle, section_name,
+            "synthetic_payload_size", annotation, &lval);
+    if (rc || lval < 0)
+        tw_error(TW_LOC,
+                "synthetic workload: expected non-negative integer for "
+                "\"synthetic_payload_size\"");
+    p->payload_size = lval;
+    rc = configuration_get_value_double(handle, section_name,
+            "synthetic_interval", annotation, &p->interval);
+    if (rc || p->interval < 0)
+        tw_error(TW_LOC,
+                "synthetic workload: expected non-negative time (ns) for "
+                "\"synthetic_interval\"");
+
+    // optionals
+    rc = configuration_get_value(handle, section_name, "synthetic_pattern",
+            annotation, val, CONFIGURATION_MAX_NAME);
+    if (rc > 0) {
+        if (strcmp(val, "uniform") == 0)
+            p->pattern = SYNTHETIC_UNIFORM;
+        else if (strcmp(val, "permutation") == 0)
+            p->pattern = SYNTHETIC_PERMUTATION;
+        else if (strcmp(val, "bit_complement") == 0)
+            p->pattern = SYNTHETIC_BIT_COMPLEMENT;
+        else if (strcmp(val, "transpose") == 0)
+            p->pattern = SYNTHETIC_TRANSPOSE;
+        else if (strcmp(val, "tornado") == 0)
+            p->pattern = SYNTHETIC_TORNADO;
+        else if (strcmp(val, "hotspot") == 0)
+            p->pattern = SYNTHETIC_HOTSPOT;
+        else if (strcmp(val, "incast") == 0)
+            p->pattern = SYNTHETIC_INCAST;
+        else if (strcmp(val, "stencil") == 0)
+            p->pattern = SYNTHETIC_STENCIL;
+        else
+            tw_error(TW_LOC,
+                    "synthetic workload: unknown synthetic_pattern %s\n", val);
+    }
+
+    rc = configuration_get_value(handle, section_name, "synthetic_arrival",
+            annotation, val, CONFIGURATION_MAX_NAME);
+    if (rc > 0) {
+        if (strcmp(val, "poisson") == 0)
+            p->arrival = SYNTHETIC_POISSON;
+        else if (strcmp(val, "bursty") == 0)
+            p->arrival = SYNTHETIC_BURSTY;
+        else
+            tw_error(TW_LOC,
+                    "synthetic workload: expected \"poisson\" or \"bursty\" "
+                    "for synthetic_arrival, got %s\n", val);
+    }
+
+    configuration_get_value_int(handle, section_name,
+            "synthetic_burst_length", annotation, &p->burst_length);
+    configuration_get_value_int(handle, section_name,
+            "synthetic_hotspot_rank", annotation, &p->hotspot_rank);
+    configuration_get_value_double(handle, section_name,
+            "synthetic_hotspot_fraction", annotation, &p->hotspot_fraction);
+    rc = configuration_get_value_longint(handle, section_name,
+            "synthetic_perm_switch", annotation, &lval);
+    if (!rc)
+        p->perm_switch = lval;
+    rc = configuration_get_value_longint(handle, section_name,
+            "synthetic_seed", annotation, &lval);
+    if (!rc)
+        p->seed = lval;
+
+    // stencil grid, as a comma-separated list of dimension sizes
+    rc = configuration_get_value(handle, section_name, "synthetic_stencil_dims",
+            annotation, val, CONFIGURATION_MAX_NAME);
+    if (rc > 0) {
+        char *tok = strtok(val, ",");
+        for (int i = 0; tok; i++, tok = strtok(NULL, ",")) {
+            if (i == SYNTHETIC_MAX_DIMS)
+                tw_error(TW_LOC, "synthetic workload: at most %d stencil "
+                        "dimensions supported", SYNTHETIC_MAX_DIMS);
+            p->stencil_dims[i] = atoi(tok);
+        }
+    }
+
+    return p;
+}
+
+static void check_params(synthetic_params const * p)
+{
+    int64_t grid = 1;
+    int side;
+
+    if (p->nprocs <= 0)
+        tw_error(TW_LOC, "synthetic workload: expected a positive rank count");
+    if (p->arrival == SYNTHETIC_BURSTY && p->burst_length < 1)
+        tw_error(TW_LOC, "synthetic workload: synthetic_burst_length "
+                "expected to be positive");
+    if (p->perm_switch < 0)
+        tw_error(TW_LOC, "synthetic workload: synthetic_perm_switch "
+                "expected to be non-negative");
+    switch (p->pattern) {
+        case SYNTHETIC_HOTSPOT:
+        case SYNTHETIC_INCAST:
+            if (p->hotspot_rank < 0 || p->hotspot_rank >= p->nprocs)
+                tw_error(TW_LOC, "synthetic workload: synthetic_hotspot_rank "
+                        "%d out of range", p->hotspot_rank);
+            break;
+        case SYNTHETIC_TRANSPOSE:
+            side = (int)lround(sqrt((double)p->nprocs));
+            if (side * side != p->nprocs)
+                tw_error(TW_LOC, "synthetic workload: transpose needs a square "
+                        "rank count, got %d", p->nprocs);
+            break;
+        case SYNTHETIC_STENCIL:
+            if (!p->stencil_dims[0])
+                tw_error(TW_LOC, "synthetic workload: stencil needs "
+                        "synthetic_stencil_dims");
+            for (int i = 0; i < SYNTHETIC_MAX_DIMS && p->stencil_dims[i]; i++) {
+                if (p->stencil_dims[i] < 2)
+                    tw_error(TW_LOC, "synthetic workload: stencil dimensions "
+                            "expected to be at least 2");
+                grid *= p->stencil_dims[i];
+            }
+            if (grid != p->nprocs)
+                tw_error(TW_LOC, "synthetic workload: stencil grid of %lld "
+                        "ranks for %d ranks", LLD(grid), p->nprocs);
+            break;
+    }
+}
+
+// check parameter sets for equality
+static int params_eq(synthetic_params const * a, synthetic_params const * b)
+{
+    for (int i = 0; i < SYNTHETIC_MAX_DIMS; i++)
+        if (a->stencil_dims[i] != b->stencil_dims[i])
+            return 0;
+    return (a->nprocs == b->nprocs &&
+            a->pattern == b->pattern &&
+            a->arrival == b->arrival &&
+            a->num_messages == b->num_messages &&
+            a->payload_size == b->payload_size &&
+            a->interval == b->interval &&
+            a->burst_length == b->burst_length &&
+            a->hotspot_rank == b->hotspot_rank &&
+            a->hotspot_fraction == b->hotspot_fraction &&
+            a->perm_switch == b->perm_switch &&
+            a->seed == b->seed);
+}
+
+static int synthetic_workload_load(const char* params, int app_id, int rank)
+{
+    synthetic_params const * p = (synthetic_params const *) params;
+    struct qlist_head *ent;
+    struct app_state *as = NULL;
+
+    qlist_for_each(ent, &app_list) {
+        as = qlist_entry(ent, struct app_state, ql);
+        if (as->app_id == app_id) {
+            if (!params_eq(&as->params, p))
+                tw_error(TW_LOC, "app %d: rank %d passed in a different config",
+                        app_id, rank);
+            break;
+        }
+    }
+    if (ent == &app_list) {
+        check_params(p);
+        as = malloc(sizeof(*as));
+        assert(as);
+        as->app_id = app_id;
+        as->params = *p;
+        as->next_op = calloc(p->nprocs, sizeof(*as->next_op));
+        assert(as->next_op);
+        qlist_add_tail(&as->ql, &app_list);
+    }
+
+    if (rank < 0 || rank >= as->params.nprocs)
+        return -1;
+    as->next_op[rank] = 0;
+    return 0;
+}
+
+static struct app_state * find_app(int app_id, int rank)
+{
+    struct app_state *as;
+
+    qlist_for_each_entry(as, &app_list, ql) {
+        if (as->app_id == app_id && rank >= 0 && rank < as->params.nprocs)
+            return as;
+    }
+    tw_error(TW_LOC, "synthetic workload: unable to find app-rank context for "
+            "app %d, rank %d", app_id, rank);
+    return NULL;
+}
+
+static void synthetic_workload_get_next(
+        int app_id,
+        int rank,
+        struct codes_workload_op *op)
+{
+    struct app_state *as = find_app(app_id, rank);
+    synthetic_params const * p = &as->params;
+    int64_t burst = p->arrival == SYNTHETIC_BURSTY ? p->burst_length : 1;
+    int64_t pos = as->next_op[rank]++;
+    // each burst is a delay then its sends
+    int64_t pos_in_burst = pos % (burst + 1);
+    int64_t msg = (pos / (burst + 1)) * burst +
+        (pos_in_burst ? pos_in_burst - 1 : 0);
+    int dest;
+
+    op->sequence_id = pos;
+    if (msg >= p->num_messages ||
+            (dest = codes_workload_synthetic_dest(p, rank, msg)) < 0) {
+        // ranks given nothing to send (the incast target, fixed points of
+        // the pattern) have no messages at all
+        op->op_type = CODES_WK_END;
+    }
+    else if (pos_in_burst == 0) {
+        // gaps between bursts keep the mean interval between messages
+        double ns = -log(synthetic_unif(p, STREAM_ARRIVAL, rank, msg))
+            * p->interval * burst;
+        op->op_type = CODES_WK_DELAY;
+        op->u.delay.nsecs = ns;
+        op->u.delay.seconds = ns * 1e-9;
+    }
+    else {
+        // receivers post no receives, the messages are fire and forget
+        op->op_type = CODES_WK_ISEND;
+        op->u.send.source_rank = rank;
+        op->u.send.dest_rank = dest;
+        op->u.send.num_bytes = p->payload_size;
+        op->u.send.data_type = 0;
+        op->u.send.count = 1;
+        op->u.send.tag = 0;
+        op->u.send.req_id = msg;
+    }
+}
+
+static void synthetic_workload_get_next_rc2(int app_id, int rank)
+{
+    struct app_state *as = find_app(app_id, rank);
+
+    assert(as->next_op[rank] > 0);
+    as->next_op[rank]--;
+}
+
+static int synthetic_workload_get_rank_cnt(const char* params, int app_id)
+{
+    (void)app_id;
+    return ((synthetic_params const *) params)->nprocs;
+}
+
+struct codes_workload_method synthetic_workload_method =
+{
+    .method_name = "synthetic_workload",
+    .codes_workload_read_config = synthetic_workload_read_config,
+    .codes_workload_load = synthetic_workload_load,
+    .codes_workload_get_next = synthetic_workload_get_next,
+    .codes_workload_get_next_rc2 = synthetic_workload_get_next_rc2,
+    .codes_workload_get_rank_cnt = synthetic_workload_get_rank_cnt,
+};
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ *  indent-tabs-mode: nil
+ * End:
+ *
+ * vim: ft=c ts=8 sts=4 sw=4 expandtab
+ */
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2015 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+/* Corner cases of the checkpoint workload: empty checkpoints, non-positive
+ * checkpoint counts, ranks without a workload, and a checkpoint that doesn't
+ * divide into whole write buffers. */
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "codes/codes-workload.h"
+
+#define WR_BUF_SIZE (16 * 1024 * 1024)
+#define NPROCS 3
+
+static int wkld_id = -1;
+
+/* codes_workload_get_next refuses ranks that didn't load a workload, so the
+ * method is asked directly about those */
+extern struct codes_workload_method checkpoint_workload_method;
+
+/* fetches the next op of a rank. Every op is also reversed and fetched
+ * again, which has to give the same op */
+static void next_op(int rank, struct codes_workload_op *op)
+{
+    struct codes_workload_op redo;
+
+    memset(op, 0, sizeof(*op));
+    memset(&redo, 0, sizeof(redo));
+    codes_workload_get_next(wkld_id, 0, rank, op);
+    codes_workload_get_next_rc2(wkld_id, 0, rank);
+    codes_workload_get_next(wkld_id, 0, rank, &redo);
+    assert(memcmp(op, &redo, sizeof(redo)) == 0);
+}
+
+static void expect_delay(int rank, double seconds)
+{
+    struct codes_workload_op op;
+
+    next_op(rank, &op);
+    assert(op.op_type == CODES_WK_DELAY);
+    assert(fabs(op.u.delay.seconds - seconds) < 1e-9);
+}
+
+static void expect_open(int rank, uint64_t file_id)
+{
+    struct codes_workload_op op;
+
+    next_op(rank, &op);
+    assert(op.op_type == CODES_WK_OPEN);
+    assert(op.u.open.file_id == file_id);
+    assert(op.u.open.create_flag == 1);
+}
+
+static void expect_write(int rank, uint64_t file_id, int64_t offset,
+        int64_t size)
+{
+    struct codes_workload_op op;
+
+    next_op(rank, &op);
+    assert(op.op_type == CODES_WK_WRITE);
+    assert(op.u.write.file_id == file_id);
+    assert(op.u.write.offset == offset);
+    assert(op.u.write.size == size);
+}
+
+static void expect_close(int rank, uint64_t file_id)
+{
+    struct codes_workload_op op;
+
+    next_op(rank, &op);
+    assert(op.op_type == CODES_WK_CLOSE);
+    assert(op.u.close.file_id == file_id);
+}
+
+static void expect_end(int rank)
+{
+    struct codes_workload_op op;
+
+    next_op(rank, &op);
+    assert(op.op_type == CODES_WK_END);
+}
+
+static void load(int rank, double checkpoint_sz, int total_checkpoints)
+{
+    checkpoint_wrkld_params p;
+    int id;
+
+    memset(&p, 0, sizeof(p));
+    p.nprocs = NPROCS;
+    p.checkpoint_sz = checkpoint_sz; /* TiB */
+    p.checkpoint_wr_bw = 1.0; /* GiB/s */
+    p.total_checkpoints = total_checkpoints;
+    p.mtti = 1.0; /* hours */
+    id = codes_workload_load("checkpoint_io_workload", (char *)&p, 0, rank);
+    assert(id >= 0 && (wkld_id == -1 || id == wkld_id));
+    wkld_id = id;
+}
+
+int main(void)
+{
+    /* rank 0: nothing to write, which still takes one (empty) write per
+     * checkpoint, and no time to write it, so no compute time either */
+    load(0, 0.0, 2);
+    for (uint64_t c = 1; c <= 2; c++) {
+        expect_delay(0, 0.0);
+        expect_open(0, c);
+        expect_write(0, c, 0, 0);
+        expect_close(0, c);
+    }
+    expect_end(0);
+
+    /* ranks 1 and 2: a GiB written in one second, so Daly's interval for an
+     * hour between failures. The 21.33 buffers per rank make for a short
+     * last write. No checkpoint count (or a negative one) still takes a
+     * checkpoint */
+    double interval = sqrt(2 * 3600.0) - 1;
+    long long per_rank = (1LL << 30) / NPROCS;
+    long long last = per_rank % WR_BUF_SIZE;
+    int writes = per_rank / WR_BUF_SIZE + 1;
+    load(1, 1.0 / 1024, 0);
+    load(2, 1.0 / 1024, -3);
+    for (int r = 1; r <= 2; r++) {
+        expect_delay(r, interval);
+        expect_open(r, 1);
+        for (int w = 0; w < writes; w++)
+            expect_write(r, 1, (int64_t)w * WR_BUF_SIZE,
+                    w < writes - 1 ? WR_BUF_SIZE : last);
+        expect_close(r, 1);
+        expect_end(r);
+        /* the end repeats */
+        expect_end(r);
+    }
+
+    /* ranks that never loaded the workload, within the allocated states and
+     * past them, and other apps only see the end */
+    int unloaded[][2] = { {0, NPROCS}, {0, 1000}, {1, 0} };
+    for (int i = 0; i < 3; i++) {
+        struct codes_workload_op op;
+
+        memset(&op, 0, sizeof(op));
+        checkpoint_workload_method.codes_workload_get_next_rc2(
+                unloaded[i][0], unloaded[i][1]);
+        checkpoint_workload_method.codes_workload_get_next(
+                unloaded[i][0], unloaded[i][1], &op);
+        assert(op.op_type == CODES_WK_END);
+    }
+    return 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2014 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+/* Pushes the same samples sequentially and optimistically (with rollbacks
+ * and a lagging GVT) and checks that both produce the same aggregates.
+ * Runs as a single process. */
+
+#include <assert.h>
+#include <stdint.h>
+#include <ross.h>
+#include "codes/codes-sampling.h"
+#include "codes/lp-io.h"
+
+#define NUM_LPS 12
+#define NUM_GROUPS 3
+#define NUM_INTERVALS 50
+#define INTERVAL 10.0
+
+/* layout of the rows written by codes-sampling.c */
+struct row
+{
+    double time;
+    int32_t group;
+    int32_t pe;
+    char metric[CODES_SAMPLE_METRIC_MAX];
+    uint64_t count;
+    double sum, min, max, p50, p90, p99;
+};
+
+static tw_lp lps[NUM_LPS];
+static tw_kp kp;
+static tw_pe pe;
+
+static char const * const names[] = {"lp", "interval", "mixed"};
+
+/* the values can be undone from the metrics: two raw values per sample */
+static void reduce(double const *values, double *metrics, void *arg)
+{
+    (void)arg;
+    metrics[0] = values[0];
+    metrics[1] = values[1];
+    metrics[2] = values[0] * values[1];
+}
+
+static void sample_values(int lp, int k, double *v)
+{
+    v[0] = lp;
+    v[1] = k;
+}
+
+static void run(char const *name, int optimistic)
+{
+    struct codes_sampler *s;
+    struct codes_sample_ring *rings[NUM_LPS];
+    double v[2];
+
+    g_tw_synchronization_protocol = optimistic ? OPTIMISTIC : SEQUENTIAL;
+    s = codes_sampler_get(name, 2, 3, names, reduce, NULL, NUM_GROUPS, INTERVAL);
+    assert(s == codes_sampler_get(name, 2, 3, names, reduce, NULL, NUM_GROUPS,
+                INTERVAL));
+    /* tiny rings so they have to grow */
+    for(int i = 0; i < NUM_LPS; i++)
+        rings[i] = codes_sample_ring_create(s, i % NUM_GROUPS, 2);
+
+    pe.GVT = 0;
+    for(int k = 1; k <= NUM_INTERVALS; k++)
+    {
+        kp.last_time = k * INTERVAL;
+        for(int i = 0; i < NUM_LPS; i++)
+        {
+            sample_values(i, k, v);
+            codes_sample_push(rings[i], &lps[i], kp.last_time, v);
+            if(optimistic && (i + k) % 3 == 0)
+            {
+                /* roll back and redo */
+                double const *old = codes_sample_push_rc(rings[i]);
+                assert(old[0] == i && old[1] == k);
+                codes_sample_push(rings[i], &lps[i], kp.last_time, v);
+            }
+        }
+        /* GVT lags a few intervals behind */
+        if(optimistic && k % 4 == 0)
+            pe.GVT = (k - 3) * INTERVAL;
+    }
+    for(int i = 0; i < NUM_LPS; i++)
+        codes_sample_ring_destroy(rings[i], &lps[i]);
+    /* lps of a run without sampling have no ring */
+    codes_sample_ring_destroy(NULL, &lps[0]);
+}
+
+static void check(char const *dir, char const *name)
+{
+    char path[512];
+    struct row r;
+    uint32_t hdr[5];
+    int seen[NUM_INTERVALS + 1][NUM_GROUPS][3];
+
+    memset(seen, 0, sizeof(seen));
+    sprintf(path, "%s/%s-samples", dir, name);
+    FILE *f = fopen(path, "r");
+    assert(f);
+    /* magic, byte order, version, header size */
+    assert(fread(hdr, sizeof(uint32_t), 5, f) == 5);
+    fseek(f, hdr[4], SEEK_SET);
+    while(fread(&r, sizeof(r), 1, f) == 1)
+    {
+        int k = (int)(r.time / INTERVAL + 0.5);
+        int m = strcmp(r.metric, "lp") == 0 ? 0 :
+            strcmp(r.metric, "interval") == 0 ? 1 : 2;
+        assert(k >= 1 && k <= NUM_INTERVALS);
+        assert(r.group >= 0 && r.group < NUM_GROUPS);
+        assert(!seen[k][r.group][m]);
+        seen[k][r.group][m] = 1;
+
+        /* group g holds lps g, g + NUM_GROUPS, ... */
+        int n = NUM_LPS / NUM_GROUPS;
+        int g = r.group;
+        assert(r.count == (uint64_t)n);
+        double lp_sum = n * g + NUM_GROUPS * n * (n - 1) / 2.0;
+        double lo = g, hi = g + NUM_GROUPS * (n - 1);
+        if(m == 0)
+        {
+            assert(r.sum == lp_sum && r.min == lo && r.max == hi);
+            assert(r.p50 == g + NUM_GROUPS * ((n + 1) / 2 - 1));
+            assert(r.p99 == hi);
+        }
+        else if(m == 1)
+            assert(r.sum == n * k && r.min == k && r.max == k && r.p50 == k);
+        else
+            assert(r.sum == lp_sum * k && r.min == lo * k && r.max == hi * k);
+    }
+    fclose(f);
+    for(int k = 1; k <= NUM_INTERVALS; k++)
+        for(int g = 0; g < NUM_GROUPS; g++)
+            for(int m = 0; m < 3; m++)
+                assert(seen[k][g][m]);
+}
+
+int main(int argc, char **argv)
+{
+    lp_io_handle handle;
+
+    MPI_Init(&argc, &argv);
+    memset(lps, 0, sizeof(lps));
+    for(int i = 0; i < NUM_LPS; i++)
+    {
+        lps[i].gid = i;
+        lps[i].kp = &kp;
+        lps[i].pe = &pe;
+    }
+
+    assert(0 == lp_io_prepare("codes-sampling-test-results", LP_IO_UNIQ_SUFFIX,
+                &handle, MPI_COMM_WORLD));
+    char *dir = lp_io_handle_to_dir(handle);
+    run("sequential", 0);
+    run("optimistic", 1);
+    assert(0 == lp_io_flush(handle, MPI_COMM_WORLD));
+
+    check(dir, "sequential");
+    check(dir, "optimistic");
+    free(dir);
+
+    MPI_Finalize();
+    return 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
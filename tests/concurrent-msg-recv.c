@@ -471,6 +471,8 @@ int main(int argc, char *argv[])
         MPI_Finalize();
         return 1;
     }
+    codes_category_register("req");
+    codes_category_register("ack");
 
     /* currently restrict to simplenet, as other networks are trickier to
      * setup. TODO: handle other networks properly */
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2013 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+/* Checks that lookups through the configuration index, and on a
+ * configuration packed and unpacked as configuration_load broadcasts it,
+ * return the same as the lookups walking the original configuration
+ * tree. */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "codes/configuration.h"
+#include "codes/configfile.h"
+#include "modelconfig/configstoreadapter.h"
+
+struct query
+{
+    const char *section;
+    const char *key;
+    const char *anno;
+};
+
+static struct query queries[] = {
+    {"PARAMS", "packet_size", NULL},
+    {"PARAMS", "packet_size", "foo"},
+    {"PARAMS", "packet_size", "bar"},
+    {"PARAMS", "link_bandwidth", NULL},
+    {"PARAMS", "big", NULL},
+    {"PARAMS", "empty", NULL},
+    {"PARAMS", "list", NULL},
+    {"PARAMS", "dup", NULL},
+    {"PARAMS", "missing", NULL},
+    {"PARAMS", "NESTED", NULL},
+    {"NESTED", "a", NULL},
+    {"MISSING", "packet_size", NULL},
+    {"OTHER", "name", NULL},
+    {"OTHER", "packet_size", NULL},
+};
+#define NUM_QUERIES (sizeof(queries) / sizeof(queries[0]))
+
+struct result
+{
+    int rc_str, rc_short, rc_int, rc_uint, rc_long, rc_double;
+    char str[64], shortstr[4];
+    int i;
+    unsigned int u;
+    long int l;
+    double d;
+};
+
+static void lookup(ConfigHandle *h, struct query *q, struct result *r)
+{
+    memset(r, 0, sizeof(*r));
+    r->rc_str = configuration_get_value(h, q->section, q->key, q->anno,
+            r->str, sizeof(r->str));
+    r->rc_short = configuration_get_value(h, q->section, q->key, q->anno,
+            r->shortstr, sizeof(r->shortstr));
+    r->rc_int = configuration_get_value_int(h, q->section, q->key, q->anno,
+            &r->i);
+    r->rc_uint = configuration_get_value_uint(h, q->section, q->key, q->anno,
+            &r->u);
+    r->rc_long = configuration_get_value_longint(h, q->section, q->key,
+            q->anno, &r->l);
+    r->rc_double = configuration_get_value_double(h, q->section, q->key,
+            q->anno, &r->d);
+}
+
+static void add_key(ConfigHandle h, SectionHandle s, const char *key,
+        const char *value)
+{
+    assert(cf_createKey(h, s, key, &value, 1) >= 0);
+}
+
+int main(void)
+{
+    ConfigHandle h = cfsa_create_empty();
+    SectionHandle params, other, nested;
+    const char *list[] = {"1", "2", "3"};
+    struct result before[NUM_QUERIES], after[NUM_QUERIES];
+    ConfigHandle copy;
+    char *buf;
+    int size;
+
+    h->config_dir = strdup(".");
+    cf_createSection(h, ROOT_SECTION, "PARAMS", &params);
+    add_key(h, params, "packet_size", "512");
+    add_key(h, params, "packet_size@foo", "1024");
+    add_key(h, params, "link_bandwidth", "12.5");
+    add_key(h, params, "big", "99999999999999999999");
+    assert(cf_createKey(h, params, "empty", NULL, 0) >= 0);
+    assert(cf_createKey(h, params, "list", list, 3) >= 0);
+    add_key(h, params, "dup", "first");
+    add_key(h, params, "dup", "second");
+    cf_createSection(h, params, "NESTED", &nested);
+    add_key(h, nested, "a", "1");
+    cf_createSection(h, ROOT_SECTION, "OTHER", &other);
+    add_key(h, other, "name", "other");
+    cf_createSection(h, ROOT_SECTION, "OTHER", &other);
+    add_key(h, other, "packet_size", "1");
+
+    for (size_t i = 0; i < NUM_QUERIES; i++)
+        lookup(&h, &queries[i], &before[i]);
+
+    size = cfsa_pack(h, &buf);
+    assert(size > 0);
+    assert(cfsa_unpack(buf, size - 1) == NULL);
+    copy = cfsa_unpack(buf, size);
+    assert(copy);
+    free(buf);
+    for (size_t i = 0; i < NUM_QUERIES; i++) {
+        lookup(&copy, &queries[i], &after[i]);
+        assert(memcmp(&before[i], &after[i], sizeof(after[i])) == 0);
+    }
+    cf_free(copy);
+
+    assert(configuration_build_index(&h) == 0);
+    // twice, to use the cached typed values
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < NUM_QUERIES; i++) {
+            lookup(&h, &queries[i], &after[i]);
+            if (memcmp(&before[i], &after[i], sizeof(after[i]))) {
+                fprintf(stderr, "mismatch for %s/%s@%s\n", queries[i].section,
+                        queries[i].key, queries[i].anno ? queries[i].anno : "");
+                return 1;
+            }
+        }
+    }
+
+    assert(after[0].rc_str == 3 && strcmp(after[0].str, "512") == 0);
+    assert(after[1].i == 1024 && after[2].rc_int == 1);
+    assert(after[3].d == 12.5);
+    assert(after[4].rc_long != 0);
+    assert(strcmp(after[7].str, "first") == 0);
+    assert(after[8].rc_str == -1 && after[11].rc_str == 0);
+    assert(after[13].rc_str == -1);
+
+    // rebuilding picks up changes
+    add_key(h, params, "missing", "7");
+    assert(configuration_build_index(&h) == 0);
+    lookup(&h, &queries[8], &after[8]);
+    assert(after[8].rc_int == 0 && after[8].i == 7);
+
+    assert(configuration_free(&h) == 0 && h == NULL);
+    return 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
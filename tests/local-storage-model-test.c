@@ -16,6 +16,7 @@
 #include <codes/codes.h>
 #include <codes/codes_mapping.h>
 #include <codes/local-storage-model.h>
+#include <codes/codes-category.h>
 #include <codes/codes-mapping-context.h>
 #include <codes/codes-callback.h>
 
@@ -142,6 +143,7 @@ int main(
         fprintf(stderr, "Error opening config file: %s\n", conf_file_name);
         return(-1);
     }
+    codes_category_register("test");
 
     lp_type_register("nw-lp", &svr_lp);
     lsm_register();
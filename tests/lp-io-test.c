@@ -16,6 +16,7 @@
 #include <ross.h>
 
 #include "codes/lp-io.h"
+#include "codes/lp-io-table.h"
 #include "codes/codes.h"
 
 #define NUM_SERVERS 16  /* number of servers */
@@ -38,8 +39,17 @@ struct svr_msg
     tw_lpid src;          /* source of this request or ack */
 };
 
+#define BULK_RECORD_SIZE 4000
+
+static unsigned int stream = 0;
+static unsigned int bulk = 0;
+static char out_dir[256] = {'\0'};
+
 const tw_optdef app_opt[] = {
     TWOPT_GROUP("lp-io Test Model"),
+    TWOPT_UINT("stream", stream, "write data during the run (LP_IO_STREAM)"),
+    TWOPT_UINT("bulk", bulk, "bytes of extra data written by each LP, enough of them make a streamed run spill to disk"),
+    TWOPT_CHAR("lp-io-dir", out_dir, "output directory (default: lp-io-test-results with a unique suffix)"),
     TWOPT_END()
 };
 
@@ -120,7 +130,13 @@ int main(
 
     g_tw_lookahead = 100;
 
-    ret = lp_io_prepare("lp-io-test-results", LP_IO_UNIQ_SUFFIX, &handle, MPI_COMM_WORLD);
+    if(out_dir[0])
+        ret = lp_io_prepare(out_dir, stream ? LP_IO_STREAM : 0, &handle,
+                MPI_COMM_WORLD);
+    else
+        ret = lp_io_prepare("lp-io-test-results",
+                LP_IO_UNIQ_SUFFIX | (stream ? LP_IO_STREAM : 0), &handle,
+                MPI_COMM_WORLD);
     if(ret < 0)
     {
        return(-1);
@@ -196,6 +212,19 @@ static void svr_rev_event(
     return;
 }
 
+struct svr_row
+{
+    uint64_t gid;
+    char kind[4];
+    double now;
+};
+
+static const struct lp_io_column svr_columns[] = {
+    LP_IO_COLUMN(struct svr_row, gid, LP_IO_COL_UINT64),
+    LP_IO_COLUMN(struct svr_row, kind, LP_IO_COL_CHAR),
+    LP_IO_COLUMN(struct svr_row, now, LP_IO_COL_DOUBLE),
+};
+
 static void svr_finalize(
     svr_state * ns,
     tw_lp * lp)
@@ -203,6 +232,7 @@ static void svr_finalize(
     (void)ns;
     char buffer[256];
     int ret;
+    struct svr_row row;
 
     sprintf(buffer, "LP %llu finalize data\n", LLU(lp->gid));
 
@@ -225,6 +255,29 @@ static void svr_finalize(
         assert(ret == 0);
     }
 
+    /* test a binary table, one row per lp (read with scripts/codes-stats.py) */
+    ret = lp_io_table_define("table_example", sizeof(row),
+        sizeof(svr_columns) / sizeof(svr_columns[0]), svr_columns);
+    assert(ret == 0);
+    memset(&row, 0, sizeof(row));
+    row.gid = lp->gid;
+    strncpy(row.kind, "svr", sizeof(row.kind));
+    row.now = tw_now(lp);
+    ret = lp_io_write(lp->gid, "table_example", sizeof(row), &row);
+    assert(ret == 0);
+
+    /* test a large identifier, written in many records */
+    for(unsigned int off = 0; off < bulk; off += BULK_RECORD_SIZE)
+    {
+        char record[BULK_RECORD_SIZE];
+        unsigned int size = bulk - off < BULK_RECORD_SIZE ?
+            bulk - off : BULK_RECORD_SIZE;
+        for(unsigned int j = 0; j < size; j++)
+            record[j] = (char)(lp->gid * 31 + off + j);
+        ret = lp_io_write(lp->gid, "bulk_example", size, record);
+        assert(ret == 0);
+    }
+
     return;
 }
 
@@ -1,3 +1,33 @@
 #!/bin/bash
 
 tests/lp-io-test --sync=1
+err=$?
+if [[ $err -ne 0 ]]; then
+    exit $err
+fi
+
+tests/lp-io-test --sync=1 --stream=1
+err=$?
+if [[ $err -ne 0 ]]; then
+    exit $err
+fi
+
+# 4 MiB of records, well past the 1 MiB at which a streamed identifier is
+# spilled to disk: the output must not depend on the spilling
+rm -rf lp-io-test-bulk lp-io-test-bulk-stream
+tests/lp-io-test --sync=1 --bulk=262144 --lp-io-dir=lp-io-test-bulk
+err=$?
+if [[ $err -ne 0 ]]; then
+    exit $err
+fi
+
+tests/lp-io-test --sync=1 --stream=1 --bulk=262144 --lp-io-dir=lp-io-test-bulk-stream
+err=$?
+if [[ $err -ne 0 ]]; then
+    exit $err
+fi
+
+diff -r lp-io-test-bulk lp-io-test-bulk-stream
+err=$?
+rm -rf lp-io-test-bulk lp-io-test-bulk-stream
+exit $err
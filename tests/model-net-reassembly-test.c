@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2014 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+#include <assert.h>
+#include <ross.h>
+#include "codes/rc-stack.h"
+#include "codes/model-net-reassembly.h"
+
+#define NUM_SENDERS 1000
+#define MSGS_PER_SENDER 4
+
+int main()
+{
+    /* mock up a dummy lp for testing */
+    tw_lp lp;
+    tw_kp kp;
+    tw_pe pe;
+    memset(&lp, 0, sizeof(lp));
+    memset(&kp, 0, sizeof(kp));
+    memset(&pe, 0, sizeof(pe));
+
+    lp.pe = &pe;
+    lp.kp = &kp;
+
+    g_tw_synchronization_protocol = OPTIMISTIC;
+
+    struct rc_stack *st;
+    rc_stack_create(&st);
+
+    /* start small to exercise growth */
+    struct mn_reasm_table *t = mn_reasm_create(4);
+    assert(t != NULL);
+    assert(0 == mn_reasm_count(t));
+
+    char small[16], big[MN_REASM_INLINE_SIZE * 2];
+    memset(small, 'a', sizeof(small));
+    memset(big, 'b', sizeof(big));
+
+    /* incast: many senders, several messages each */
+    for (int m = 0; m < MSGS_PER_SENDER; m++) {
+        for (tw_lpid s = 0; s < NUM_SENDERS; s++) {
+            assert(NULL == mn_reasm_find(t, m, s));
+            struct mn_reasm_entry *e = mn_reasm_insert(t, m, s);
+            e->num_chunks++;
+            mn_reasm_set_remote_event(e, (s % 2) ? big : small,
+                    (s % 2) ? (int)sizeof(big) : (int)sizeof(small));
+        }
+    }
+    assert(NUM_SENDERS * MSGS_PER_SENDER == mn_reasm_count(t));
+
+    for (int m = 0; m < MSGS_PER_SENDER; m++) {
+        for (tw_lpid s = 0; s < NUM_SENDERS; s++) {
+            struct mn_reasm_entry *e = mn_reasm_find(t, m, s);
+            assert(e && e->message_id == (uint64_t)m && e->sender_id == s);
+            assert(1 == e->num_chunks);
+            if (s % 2) {
+                assert(e->remote_event_size == sizeof(big));
+                assert(0 == memcmp(e->remote_event_data, big, sizeof(big)));
+            }
+            else {
+                assert(e->remote_event_size == sizeof(small));
+                assert(e->remote_event_data == e->inline_data);
+            }
+            /* a second copy must not overwrite the first */
+            mn_reasm_set_remote_event(e, big, 8);
+            assert(e->remote_event_data[0] == ((s % 2) ? 'b' : 'a'));
+        }
+    }
+
+    /* complete every other sender's message 0, then roll back in reverse
+     * order */
+    kp.last_time = 1.0;
+    for (tw_lpid s = 0; s < NUM_SENDERS; s += 2) {
+        struct mn_reasm_entry *e = mn_reasm_find(t, 0, s);
+        mn_reasm_complete(t, e, &lp, st);
+        assert(NULL == mn_reasm_find(t, 0, s));
+    }
+    assert(NUM_SENDERS / 2 == rc_stack_count(st));
+    for (tw_lpid s = 0; s < NUM_SENDERS; s++)
+        assert((s % 2 == 0) == (NULL == mn_reasm_find(t, 0, s)));
+
+    for (tw_lpid s = NUM_SENDERS; s-- > 0;) {
+        if (s % 2)
+            continue;
+        struct mn_reasm_entry *e = mn_reasm_complete_rc(t, st);
+        assert(e->message_id == 0 && e->sender_id == s);
+        assert(e == mn_reasm_find(t, 0, s));
+        assert(e->remote_event_data[0] == 'a');
+    }
+    assert(0 == rc_stack_count(st));
+    assert(NUM_SENDERS * MSGS_PER_SENDER == mn_reasm_count(t));
+
+    /* discard everything from message 1, remaining lookups must still hit */
+    for (tw_lpid s = 0; s < NUM_SENDERS; s++)
+        mn_reasm_discard(t, mn_reasm_find(t, 1, s));
+    assert(NUM_SENDERS * (MSGS_PER_SENDER - 1) == mn_reasm_count(t));
+    for (tw_lpid s = 0; s < NUM_SENDERS; s++) {
+        assert(NULL == mn_reasm_find(t, 1, s));
+        assert(NULL != mn_reasm_find(t, 0, s));
+        assert(NULL != mn_reasm_find(t, MSGS_PER_SENDER - 1, s));
+    }
+
+    /* completed entries are reclaimed by GC, then reused from the pool */
+    for (tw_lpid s = 0; s < NUM_SENDERS; s++)
+        mn_reasm_complete(t, mn_reasm_find(t, 2, s), &lp, st);
+    pe.GVT = 2.0;
+    rc_stack_gc(&lp, st);
+    assert(0 == rc_stack_count(st));
+    for (tw_lpid s = 0; s < NUM_SENDERS; s++)
+        assert(NULL != mn_reasm_insert(t, 2, s));
+
+    /* leave some completed entries on the stack for destroy */
+    kp.last_time = 3.0;
+    mn_reasm_complete(t, mn_reasm_find(t, 0, 1), &lp, st);
+    rc_stack_destroy(st);
+    mn_reasm_destroy(t);
+
+    return 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
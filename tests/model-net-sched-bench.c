@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2014 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+/* Scheduler benchmark: drives the model-net send schedulers directly with a
+ * mock method and reports packets scheduled per second along with the
+ * fairness (Jain's index over weight-normalized bytes) of each scheduler
+ * while every class is backlogged. drr and weighted-priority must be fair,
+ * and every scheduler must deliver the queued events intact and roll back to
+ * the exact same schedule. */
+
+#include <assert.h>
+#include <time.h>
+#include <ross.h>
+#include "codes/model-net-sched.h"
+
+#define NUM_CLASSES 8
+#define PACKET_SIZE 512
+/* bytes queued per class */
+#define CLASS_BACKLOG (4ull << 20)
+#define NUM_RC_STEPS 5000
+/* remote event size per class: none, inline and heap-backed */
+#define EVENT_SIZE(c) ((c) % 3 == 0 ? 0 : (c) % 3 == 1 ? 24 : 300)
+
+/* mock method: log which class each packet belongs to */
+static uint64_t class_bytes[NUM_CLASSES];
+static uint64_t num_packets;
+static int log_cls[NUM_RC_STEPS];
+static uint64_t log_off[NUM_RC_STEPS];
+
+static tw_stime mock_packet_event(
+        model_net_request const * req,
+        uint64_t message_offset,
+        uint64_t packet_size,
+        tw_stime offset,
+        mn_sched_params const * sched_params,
+        void const * remote_event,
+        void const * self_event,
+        tw_lp *sender,
+        int is_last_pckt)
+{
+    (void)offset; (void)sched_params; (void)self_event;
+    (void)sender;
+    assert(req->remote_event_size == EVENT_SIZE(req->app_id));
+    if (is_last_pckt) {
+        for (int i = 0; i < req->remote_event_size; i++)
+            assert(((const char*)remote_event)[i] == (char)(req->app_id + i));
+    }
+    if (num_packets < NUM_RC_STEPS) {
+        log_cls[num_packets] = req->app_id;
+        log_off[num_packets] = message_offset;
+    }
+    class_bytes[req->app_id] += packet_size;
+    num_packets++;
+    return 0.0;
+}
+
+static void mock_packet_event_rc(tw_lp *sender)
+{
+    (void)sender;
+    num_packets--;
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* queue CLASS_BACKLOG bytes per class; message sizes differ per class and
+ * are not packet multiples so byte accounting matters */
+static int fill(model_net_sched *s, model_net_sched_rc *rc, tw_lp *lp)
+{
+    int n = 0;
+    for (int c = 0; c < NUM_CLASSES; c++) {
+        uint64_t msg_size = 1000 + 3777 * c;
+        for (uint64_t b = 0; b < CLASS_BACKLOG; b += msg_size) {
+            model_net_request req;
+            mn_sched_params sp;
+            char ev[EVENT_SIZE(2)];
+            memset(&req, 0, sizeof(req));
+            req.msg_size = msg_size;
+            req.packet_size = PACKET_SIZE;
+            req.app_id = c;
+            req.remote_event_size = EVENT_SIZE(c);
+            for (int i = 0; i < req.remote_event_size; i++)
+                ev[i] = c + i;
+            char category[CATEGORY_NAME_MAX];
+            snprintf(category, CATEGORY_NAME_MAX, "class%d", c);
+            req.category = codes_category_register(category);
+            model_net_sched_set_default_params(&sp);
+            sp.prio = c;
+            model_net_sched_add(&req, &sp, req.remote_event_size, ev, 0, NULL,
+                    s, rc, lp);
+            n++;
+        }
+    }
+    return n;
+}
+
+static double jain(const model_net_sched_cfg_params *p)
+{
+    double sum = 0, sq = 0;
+    for (int c = 0; c < NUM_CLASSES; c++) {
+        int w = (p->type == MN_SCHED_DRR || p->type == MN_SCHED_WPRIO) ?
+            p->u.cls.weights[c] : 1;
+        double x = (double)class_bytes[c] / w;
+        sum += x;
+        sq += x * x;
+    }
+    return sum * sum / (NUM_CLASSES * sq);
+}
+
+static double run(const model_net_sched_cfg_params *p, struct model_net_method *m,
+        tw_lp *lp)
+{
+    model_net_sched s;
+    model_net_sched_rc rc;
+    tw_stime poff;
+    char save[EVENT_SIZE(2)];
+
+    memset(class_bytes, 0, sizeof(class_bytes));
+    num_packets = 0;
+    model_net_sched_init(p, 0, m, &s);
+    fill(&s, &rc, lp);
+
+    /* no class can drain before CLASS_BACKLOG bytes went out in total */
+    uint64_t total = 0;
+    double start = now_sec();
+    while (total < CLASS_BACKLOG / 2) {
+        int ret = model_net_sched_next(&poff, &s, save, &rc, lp);
+        assert(ret != -1);
+        total = 0;
+        for (int c = 0; c < NUM_CLASSES; c++)
+            total += class_bytes[c];
+    }
+    double fair = jain(p);
+    while (model_net_sched_next(&poff, &s, save, &rc, lp) != -1)
+        ;
+    double elapsed = now_sec() - start;
+
+    for (int c = 0; c < NUM_CLASSES; c++)
+        assert(class_bytes[c] == CLASS_BACKLOG + (1000 + 3777 * c) -
+                1 - (CLASS_BACKLOG - 1) % (1000 + 3777 * c));
+    printf("%-18s %8.2f Mpkt/s   fairness %.4f\n", sched_names[p->type],
+            num_packets / elapsed * 1e-6, fair);
+    s.impl->destroy(s.dat);
+    return fair;
+}
+
+/* forward NUM_RC_STEPS nexts, roll them all back, replay and compare */
+static void check_rc(const model_net_sched_cfg_params *p,
+        struct model_net_method *m, tw_lp *lp)
+{
+    static model_net_sched_rc rcs[NUM_RC_STEPS];
+    static int cls0[NUM_RC_STEPS];
+    static uint64_t off0[NUM_RC_STEPS];
+    /* one rc event save area per step, as in the event structs */
+    static char save[NUM_RC_STEPS][EVENT_SIZE(2)];
+    model_net_sched s;
+    model_net_sched_rc add_rc;
+    tw_stime poff;
+
+    num_packets = 0;
+    model_net_sched_init(p, 0, m, &s);
+    int nreqs = fill(&s, &add_rc, lp);
+    for (int i = 0; i < NUM_RC_STEPS; i++)
+        assert(model_net_sched_next(&poff, &s, save[i], &rcs[i], lp) != -1);
+    memcpy(cls0, log_cls, sizeof(cls0));
+    memcpy(off0, log_off, sizeof(off0));
+    for (int i = NUM_RC_STEPS; i-- > 0;)
+        model_net_sched_next_rc(&s, save[i], &rcs[i], lp);
+    assert(num_packets == 0);
+    for (int i = 0; i < NUM_RC_STEPS; i++)
+        assert(model_net_sched_next(&poff, &s, save[i], &rcs[i], lp) != -1);
+    assert(0 == memcmp(cls0, log_cls, sizeof(cls0)));
+    assert(0 == memcmp(off0, log_off, sizeof(off0)));
+
+    /* undo everything, including the adds: the scheduler must end up idle */
+    for (int i = NUM_RC_STEPS; i-- > 0;)
+        model_net_sched_next_rc(&s, save[i], &rcs[i], lp);
+    for (int c = NUM_CLASSES; c-- > 0;) {
+        uint64_t msg_size = 1000 + 3777 * c;
+        for (uint64_t b = 0; b < CLASS_BACKLOG; b += msg_size) {
+            add_rc.prio = c;
+            model_net_sched_add_rc(&s, &add_rc, lp);
+            nreqs--;
+        }
+    }
+    assert(nreqs == 0);
+    assert(-1 == model_net_sched_next(&poff, &s, save[0], &add_rc, lp));
+    s.impl->destroy(s.dat);
+}
+
+int main()
+{
+    /* mock up a dummy lp for testing */
+    tw_lp lp;
+    tw_kp kp;
+    tw_pe pe;
+    memset(&lp, 0, sizeof(lp));
+    memset(&kp, 0, sizeof(kp));
+    memset(&pe, 0, sizeof(pe));
+    lp.pe = &pe;
+    lp.kp = &kp;
+
+    struct model_net_method m;
+    memset(&m, 0, sizeof(m));
+    m.packet_size = PACKET_SIZE;
+    m.model_net_method_packet_event = mock_packet_event;
+    m.model_net_method_packet_event_rc = mock_packet_event_rc;
+
+    model_net_sched_cfg_params p;
+    memset(&p, 0, sizeof(p));
+    p.train_len = 1;
+
+    p.type = MN_SCHED_FCFS;
+    run(&p, &m, &lp);
+    check_rc(&p, &m, &lp);
+    p.type = MN_SCHED_RR;
+    run(&p, &m, &lp);
+    check_rc(&p, &m, &lp);
+
+    p.u.cls.num_classes = NUM_CLASSES;
+    p.u.cls.quantum = PACKET_SIZE;
+    for (int c = 0; c < NUM_CLASSES; c++) {
+        p.u.cls.weights[c] = 1;
+        p.u.cls.categories[c] = -1;
+    }
+    p.type = MN_SCHED_DRR;
+    assert(run(&p, &m, &lp) > 0.999);
+    check_rc(&p, &m, &lp);
+
+    /* weighted: class c gets c+1 shares */
+    for (int c = 0; c < NUM_CLASSES; c++)
+        p.u.cls.weights[c] = c + 1;
+    assert(run(&p, &m, &lp) > 0.99);
+    check_rc(&p, &m, &lp);
+
+    p.u.cls.quantum = 4 * PACKET_SIZE;
+    p.type = MN_SCHED_WPRIO;
+    assert(run(&p, &m, &lp) > 0.99);
+    check_rc(&p, &m, &lp);
+
+    return 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
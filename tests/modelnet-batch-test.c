@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2013 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+/* Timing of model_net_event_batch against plain model_net_event calls.
+ *
+ * Server 0 sends NUM_MSGS messages to server 2 with model_net_event, server 1
+ * sends the same messages to server 3 as two batches. The NIC sequencing
+ * delay is longer than a message takes on the wire, so each message leaves
+ * the NIC when it has been sequenced: both receivers must see the i-th
+ * message the same time after the send, up to the random local latencies.
+ * The second batch finds the NIC still busy with the first. */
+
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <ross.h>
+
+#include "codes/model-net.h"
+#include "codes/codes.h"
+#include "codes/codes_mapping.h"
+#include "codes/configuration.h"
+#include "codes/lp-type-lookup.h"
+#include "codes/lp-msg.h"
+
+#define PAYLOAD_SZ 1024
+#define NUM_MSGS 8
+#define NUM_SENDERS 2
+
+static int net_id = 0;
+static int prog_rtn = 0;
+
+/* time from the send to the arrival of each message, per sender; filled in
+ * at finalize by the receivers and reduced over the ranks in main */
+static double elapsed[NUM_SENDERS][NUM_MSGS];
+
+typedef struct svr_msg svr_msg;
+typedef struct svr_state svr_state;
+
+enum svr_event
+{
+    KICKOFF,
+    RECV,
+};
+
+struct svr_state
+{
+    int server_idx;
+    int num_recv;
+    int order_errs;
+    double elapsed[NUM_MSGS];
+};
+
+struct svr_msg
+{
+    msg_header h;
+    int src_svr_idx;
+    int msg_idx;
+    tw_stime send_ts;
+    model_net_event_return ret[NUM_MSGS];
+};
+
+static void svr_init(
+    svr_state * ns,
+    tw_lp * lp);
+static void svr_event(
+    svr_state * ns,
+    tw_bf * b,
+    svr_msg * m,
+    tw_lp * lp);
+static void svr_rev_event(
+    svr_state * ns,
+    tw_bf * b,
+    svr_msg * m,
+    tw_lp * lp);
+static void svr_finalize(
+    svr_state * ns,
+    tw_lp * lp);
+
+tw_lptype svr_lp = {
+    (init_f) svr_init,
+    (pre_run_f) NULL,
+    (event_f) svr_event,
+    (revent_f) svr_rev_event,
+    (commit_f) NULL,
+    (final_f)  svr_finalize,
+    (map_f) codes_mapping,
+    sizeof(svr_state),
+};
+
+const tw_optdef app_opt [] =
+{
+	TWOPT_GROUP("Model net batch test" ),
+	TWOPT_END()
+};
+
+static int check_timing(void)
+{
+    int errs = 0;
+    for (int i = 0; i < NUM_MSGS; i++){
+        // one latency draw per message and hop may differ
+        double tol = (i + 10) * CODES_MAX_LATENCY;
+        if (elapsed[0][i] <= 0.0 || elapsed[1][i] <= 0.0 ||
+                fabs(elapsed[0][i] - elapsed[1][i]) > tol){
+            fprintf(stderr, "ERROR: message %d arrived %.3lf ns after the "
+                    "send when sent alone, %.3lf ns when batched\n", i,
+                    elapsed[0][i], elapsed[1][i]);
+            errs++;
+        }
+    }
+    return errs;
+}
+
+int main(
+    int argc,
+    char **argv)
+{
+    int num_nets;
+    int *net_ids;
+    int rank;
+
+    tw_opt_add(app_opt);
+    tw_init(&argc, &argv);
+
+    if(argc < 2)
+    {
+	    printf("\n Usage: mpirun <args> --sync=[1,3] -- mapping_file_name.conf (optional --nkp) ");
+	    MPI_Finalize();
+	    return 0;
+    }
+
+    configuration_load(argv[2], MPI_COMM_WORLD, &config);
+    codes_category_register("test");
+
+    model_net_register();
+    lp_type_register("nw-lp", &svr_lp);
+
+    codes_mapping_setup();
+
+    net_ids = model_net_configure(&num_nets);
+    assert(num_nets==1);
+    net_id = *net_ids;
+    free(net_ids);
+
+    assert(net_id == SIMPLENET);
+    assert(2*NUM_SENDERS == codes_mapping_get_lp_count("MODELNET_GRP", 0,
+                "nw-lp", NULL, 1));
+
+    tw_run();
+
+    MPI_Allreduce(MPI_IN_PLACE, elapsed, NUM_SENDERS*NUM_MSGS, MPI_DOUBLE,
+            MPI_MAX, MPI_COMM_CODES);
+    MPI_Comm_rank(MPI_COMM_CODES, &rank);
+    if (rank == 0 && check_timing() > 0)
+        prog_rtn = 1;
+
+    tw_end();
+    return prog_rtn;
+}
+
+static void svr_init(
+    svr_state * ns,
+    tw_lp * lp)
+{
+    ns->server_idx = lp->gid / 2;
+    ns->num_recv = 0;
+    ns->order_errs = 0;
+    if (ns->server_idx < NUM_SENDERS){
+        tw_event *e = tw_event_new(lp->gid, codes_local_latency(lp), lp);
+        svr_msg * m = tw_event_data(e);
+        msg_set_header(666, KICKOFF, lp->gid, &m->h);
+        tw_event_send(e);
+    }
+}
+
+static void handle_kickoff_event(
+    svr_state * ns,
+    svr_msg * m,
+    tw_lp * lp)
+{
+    tw_lpid dest = (ns->server_idx + NUM_SENDERS) * 2;
+    svr_msg m_remote[NUM_MSGS];
+    for (int i = 0; i < NUM_MSGS; i++){
+        msg_set_header(666, RECV, lp->gid, &m_remote[i].h);
+        m_remote[i].src_svr_idx = ns->server_idx;
+        m_remote[i].msg_idx = i;
+        m_remote[i].send_ts = tw_now(lp);
+    }
+
+    if (ns->server_idx == 0){
+        // keep the messages in order on their way to the NIC
+        MN_START_SEQ();
+        for (int i = 0; i < NUM_MSGS; i++){
+            m->ret[i] = model_net_event(net_id, "test", dest, PAYLOAD_SZ, 0.0,
+                    sizeof(svr_msg), &m_remote[i], 0, NULL, lp);
+        }
+        MN_END_SEQ();
+        return;
+    }
+
+    struct model_net_batch_entry ents[NUM_MSGS];
+    for (int i = 0; i < NUM_MSGS; i++){
+        ents[i].final_dest_lp = dest;
+        ents[i].message_size = PAYLOAD_SZ;
+        ents[i].remote_event_size = sizeof(svr_msg);
+        ents[i].remote_event = &m_remote[i];
+        ents[i].self_event_size = 0;
+        ents[i].self_event = NULL;
+        ents[i].sched_params = NULL;
+    }
+    m->ret[0] = model_net_event_batch(net_id, "test", NUM_MSGS/2, ents, 0.0,
+            lp);
+    m->ret[1] = model_net_event_batch(net_id, "test", NUM_MSGS/2,
+            ents + NUM_MSGS/2, 0.0, lp);
+}
+
+static void handle_kickoff_rev_event(
+    svr_state * ns,
+    svr_msg * m,
+    tw_lp * lp)
+{
+    int n = ns->server_idx == 0 ? NUM_MSGS : 2;
+    for (int i = n-1; i >= 0; i--)
+        model_net_event_rc2(lp, &m->ret[i]);
+}
+
+static void svr_event(
+    svr_state * ns,
+    tw_bf * b,
+    svr_msg * m,
+    tw_lp * lp)
+{
+    (void)b;
+    switch (m->h.event_type)
+    {
+        case KICKOFF:
+            handle_kickoff_event(ns, m, lp);
+            break;
+        case RECV:
+            assert(ns->server_idx >= NUM_SENDERS);
+            // messages of a sender leave its NIC in order
+            if (m->msg_idx != ns->num_recv)
+                ns->order_errs++;
+            ns->elapsed[m->msg_idx] = tw_now(lp) - m->send_ts;
+            ns->num_recv++;
+            break;
+        default:
+            assert(0);
+            break;
+    }
+}
+
+static void svr_rev_event(
+    svr_state * ns,
+    tw_bf * b,
+    svr_msg * m,
+    tw_lp * lp)
+{
+    (void)b;
+    switch (m->h.event_type)
+    {
+        case KICKOFF:
+            handle_kickoff_rev_event(ns, m, lp);
+            break;
+        case RECV:
+            ns->num_recv--;
+            if (m->msg_idx != ns->num_recv)
+                ns->order_errs--;
+            break;
+        default:
+            assert(0);
+            break;
+    }
+}
+
+static void svr_finalize(
+    svr_state * ns,
+    tw_lp * lp)
+{
+    (void)lp;
+    if (ns->server_idx < NUM_SENDERS)
+        return;
+
+    int s = ns->server_idx - NUM_SENDERS;
+    if (ns->num_recv != NUM_MSGS || ns->order_errs > 0){
+        fprintf(stderr, "ERROR: server %d received %d of %d messages, "
+                "%d out of order\n", ns->server_idx, ns->num_recv, NUM_MSGS,
+                ns->order_errs);
+        prog_rtn = 1;
+    }
+    memcpy(elapsed[s], ns->elapsed, sizeof(ns->elapsed));
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ft=c ts=8 sts=4 sw=4 expandtab
+ */
@@ -0,0 +1,14 @@
+#!/bin/bash
+
+tests/modelnet-batch-test --sync=1 -- tests/conf/modelnet-batch-test.conf
+err=$?
+if [[ $err -ne 0 ]]; then
+    exit $err
+fi
+
+mpirun -np 2 tests/modelnet-batch-test --sync=3 -- \
+    tests/conf/modelnet-batch-test.conf
+err=$?
+if [[ $err -ne 0 ]]; then
+    exit $err
+fi
@@ -146,6 +146,8 @@ int main(
     MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
 
     configuration_load(argv[2], MPI_COMM_WORLD, &config);
+    codes_category_register("ping");
+    codes_category_register("pong");
     svr_add_lp_type();
     model_net_register();
 
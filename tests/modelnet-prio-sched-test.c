@@ -19,7 +19,7 @@
 
 #define PAYLOAD_SZ 8192 /* size of simulated data payload, bytes  */
 #define NUM_PRIOS 10
-#define NUM_SERVERS 2
+#define NUM_SERVERS 3
 
 static int net_id = 0;
 static int prog_rtn = 0;
@@ -124,6 +124,7 @@ int main(
     }
 
     configuration_load(argv[2], MPI_COMM_WORLD, &config);
+    codes_category_register("test");
 
     model_net_register();
     svr_add_lp_type();
@@ -278,6 +279,29 @@ static void handle_kickoff_event(
     // dest LP is the same - the last server
     tw_lpid dest = (NUM_SERVERS-1) * 2;
 
+    // odd servers issue all of their messages as one batch
+    if (ns->server_idx % 2){
+        svr_msg m_remotes[NUM_PRIOS];
+        mn_sched_params prios[NUM_PRIOS];
+        struct model_net_batch_entry ents[NUM_PRIOS];
+        for (int i = 0; i < NUM_PRIOS; i++){
+            m_remotes[i] = m_remote;
+            m_remotes[i].msg_prio = ns->random_order[i];
+            model_net_sched_set_default_params(&prios[i]);
+            prios[i].prio = ns->random_order[i];
+            ents[i].final_dest_lp = dest;
+            ents[i].message_size = PAYLOAD_SZ;
+            ents[i].remote_event_size = sizeof(svr_msg);
+            ents[i].remote_event = &m_remotes[i];
+            ents[i].self_event_size = 0;
+            ents[i].self_event = NULL;
+            ents[i].sched_params = &prios[i];
+        }
+        m->ret[0] = model_net_event_batch(net_id, "test", NUM_PRIOS, ents,
+                0.0, lp);
+        return;
+    }
+
     MN_START_SEQ();
     for (int i = 0; i < NUM_PRIOS; i++){
         m_remote.msg_prio = ns->random_order[i];
@@ -296,6 +320,10 @@ static void handle_kickoff_rev_event(
         svr_msg *m,
         tw_lp *lp){
     assert(ns->server_idx < NUM_SERVERS-1);
+    if (ns->server_idx % 2){
+        model_net_event_rc2(lp, &m->ret[0]);
+        return;
+    }
     for (int i = 0; i < NUM_PRIOS; i++){
         model_net_event_rc2(lp, &m->ret[i]);
     }
@@ -150,6 +150,7 @@ int main(
     MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
 
     configuration_load(argv[2], MPI_COMM_WORLD, &config);
+    codes_category_register("test");
     svr_add_lp_type();
     model_net_register();
 
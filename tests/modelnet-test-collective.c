@@ -152,6 +152,7 @@ int main(
     MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
 
     configuration_load(argv[2], MPI_COMM_WORLD, &config);
+    codes_category_register("test");
     svr_add_lp_type();
 
     codes_mapping_setup();
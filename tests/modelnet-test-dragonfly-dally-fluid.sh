@@ -0,0 +1,22 @@
+#!/bin/bash
+
+# same network as the dally synthetic test, simulated with flows
+conf=$(mktemp)
+trap "rm -f $conf" EXIT
+sed -e 's/modelnet_scheduler="fcfs";/&\n   simulation_mode="fluid";/' \
+    src/network-workloads/conf/dragonfly-dally/modelnet-test-dragonfly-dally.conf > $conf
+
+src/network-workloads/model-net-synthetic-dally-dfly --sync=1 --num_messages=4 \
+    --payload_sz=20000 -- $conf
+err=$?
+if [[ $err -ne 0 ]]; then
+    exit $err
+fi
+
+sed -i -e 's/routing="minimal";/routing="prog-adaptive";/' $conf
+src/network-workloads/model-net-synthetic-dally-dfly --sync=1 --num_messages=4 \
+    --payload_sz=20000 -- $conf
+err=$?
+if [[ $err -ne 0 ]]; then
+    exit $err
+fi
@@ -1,9 +1,11 @@
 #!/bin/bash
 
 src/network-workloads/model-net-synthetic-dally-dfly --sync=1 --num_messages=1 -- src/network-workloads/conf/dragonfly-dally/modelnet-test-dragonfly-dally.conf
-
-
-
-
-
-
+err=$?
+if [[ $err -ne 0 ]]; then
+    exit $err
+fi
+
+# without sampling, the models' sampling finalize hooks have nothing to free
+src/network-workloads/model-net-synthetic-dally-dfly --sync=1 --num_messages=1 \
+    --sampling-interval=0 -- src/network-workloads/conf/dragonfly-dally/modelnet-test-dragonfly-dally.conf
@@ -0,0 +1,23 @@
+#!/bin/bash
+
+# same network as the dally synthetic test, with small packets sent as trains
+conf=$(mktemp)
+trap "rm -f $conf" EXIT
+sed -e 's/packet_size="4096"/packet_size="1024"/' \
+    -e 's/chunk_size="4096"/chunk_size="1024"/' \
+    -e 's/modelnet_scheduler="fcfs";/&\n   packet_train_length="8";/' \
+    src/network-workloads/conf/dragonfly-dally/modelnet-test-dragonfly-dally.conf > $conf
+
+src/network-workloads/model-net-synthetic-dally-dfly --sync=1 --num_messages=4 \
+    --payload_sz=20000 -- $conf
+err=$?
+if [[ $err -ne 0 ]]; then
+    exit $err
+fi
+
+mpirun -np 2 src/network-workloads/model-net-synthetic-dally-dfly --sync=3 \
+    --num_messages=4 --payload_sz=20000 -- $conf
+err=$?
+if [[ $err -ne 0 ]]; then
+    exit $err
+fi
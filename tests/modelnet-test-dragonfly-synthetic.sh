@@ -1,3 +1,10 @@
 #!/bin/bash
 
 src/network-workloads/model-net-synthetic --sync=1 --num_messages=1 -- $srcdir/src/network-workloads/conf/modelnet-synthetic-dragonfly.conf 
+err=$?
+if [[ $err -ne 0 ]]; then
+    exit $err
+fi
+
+# the same network driven by the synthetic_workload generator
+src/network-workloads/model-net-synthetic --sync=1 --traffic=4 -- $srcdir/src/network-workloads/conf/modelnet-synthetic-dragonfly.conf
@@ -0,0 +1,23 @@
+#!/bin/bash
+
+# simplep2p test network with two injection queues per NIC, once for every
+# rail striping mode. 4 KiB messages in 1 KiB packets are split in two
+conf=$(mktemp -p tests/conf)
+trap "rm -f $conf" EXIT
+
+for mode in round-robin adaptive split; do
+    sed -e "s/modelnet_scheduler=\"fcfs\";/&\n    num_injection_queues=\"2\";\n    rail_striping=\"$mode\";/" \
+        tests/conf/modelnet-test-simplep2p.conf > $conf
+
+    tests/modelnet-test --sync=1 -- $conf
+    err=$?
+    if [[ $err -ne 0 ]]; then
+        exit $err
+    fi
+
+    mpirun -np 2 tests/modelnet-test --sync=3 -- $conf
+    err=$?
+    if [[ $err -ne 0 ]]; then
+        exit $err
+    fi
+done
@@ -14,6 +14,10 @@
 #include <stdint.h>
 
 static int bsize = 1024;
+/* blocking mode: requests per server (resource-test.sh checks for it) */
+#define NUM_ROUNDS 8
+
+static unsigned int blocking = 0;
 
 static int s_magic = 12345;
 
@@ -23,12 +27,17 @@ enum s_type {
     S_KICKOFF,
     S_ALLOC_ACK,
     S_FREE,
+    S_BLOCK_ACK,
+    S_BLOCK_FREE,
 };
 
 typedef struct {
     int id;
     uint64_t mem, mem_max;
     struct codes_cb_info cb;
+    /* blocking mode: grants received, time of the last one */
+    int grants;
+    tw_stime last_grant;
 } s_state;
 
 typedef struct {
@@ -36,11 +45,14 @@ typedef struct {
     resource_return c;
     int tag;
     uint64_t mem_max_prev;
+    tw_stime last_grant_prev;
 } s_msg;
 
 static void s_init(s_state *ns, tw_lp *lp){
     ns->mem = 0;
     ns->mem_max = 0;
+    ns->grants = 0;
+    ns->last_grant = 0.0;
     INIT_CODES_CB_INFO(&ns->cb, s_msg, h, tag, c);
     ns->id = codes_mapping_get_lp_relative_id(lp->gid, 0, 0);
     tw_event *e = tw_event_new(lp->gid, codes_local_latency(lp), lp);
@@ -50,18 +62,54 @@ static void s_init(s_state *ns, tw_lp *lp){
 }
 static void s_finalize(s_state *ns, tw_lp *lp){
     (void)lp;
-    printf("Server %d got %llu memory before failing\n", ns->id, LLU(ns->mem_max));
+    if (blocking)
+        printf("Server %d granted %d times, last at %.3f\n", ns->id,
+                ns->grants, ns->last_grant);
+    else
+        printf("Server %d got %llu memory before failing\n", ns->id,
+                LLU(ns->mem_max));
+}
+
+/* blocking mode: servers compete for more than is available, each holding
+ * what it got for a while before asking again */
+static uint64_t block_size(s_state *ns){
+    return bsize * (2 + ns->id % 3);
 }
 
 static void s_event(s_state *ns, tw_bf *bf, s_msg *m, tw_lp *lp){
-    (void)bf;
     assert(m->h.magic == s_magic);
     msg_header h;
     switch(m->h.event_type){
         case S_KICKOFF: ;
+            if (blocking){
+                msg_set_header(s_magic, S_BLOCK_ACK, lp->gid, &h);
+                resource_lp_get(block_size(ns), 1, lp, CODES_MCTX_DEFAULT, 0,
+                        &h, &ns->cb);
+                break;
+            }
             msg_set_header(s_magic, S_ALLOC_ACK, lp->gid, &h);
             resource_lp_get(bsize, 0, lp, CODES_MCTX_DEFAULT, 0, &h, &ns->cb);
             break;
+        case S_BLOCK_ACK: ;
+            assert(m->c.ret == 0);
+            ns->grants++;
+            m->last_grant_prev = ns->last_grant;
+            ns->last_grant = tw_now(lp);
+            tw_event *e = tw_event_new(lp->gid,
+                    100.0 * (ns->id + 1) + codes_local_latency(lp), lp);
+            s_msg *sm = tw_event_data(e);
+            msg_set_header(s_magic, S_BLOCK_FREE, lp->gid, &sm->h);
+            tw_event_send(e);
+            break;
+        case S_BLOCK_FREE:
+            resource_lp_free(block_size(ns), lp, CODES_MCTX_DEFAULT);
+            if (ns->grants < NUM_ROUNDS){
+                bf->c0 = 1;
+                msg_set_header(s_magic, S_BLOCK_ACK, lp->gid, &h);
+                resource_lp_get(block_size(ns), 1, lp, CODES_MCTX_DEFAULT, 0,
+                        &h, &ns->cb);
+            }
+            break;
         case S_ALLOC_ACK:
             if (m->c.ret == 0){
                 ns->mem += bsize;
@@ -87,12 +135,21 @@ static void s_event(s_state *ns, tw_bf *bf, s_msg *m, tw_lp *lp){
     }
 }
 static void s_event_rc(s_state *ns, tw_bf * b, s_msg *m, tw_lp *lp){
-    (void)b;
     assert(m->h.magic == s_magic);
     switch(m->h.event_type){
         case S_KICKOFF:
             resource_lp_get_rc(lp);
             break;
+        case S_BLOCK_ACK:
+            codes_local_latency_reverse(lp);
+            ns->last_grant = m->last_grant_prev;
+            ns->grants--;
+            break;
+        case S_BLOCK_FREE:
+            if (b->c0)
+                resource_lp_get_rc(lp);
+            resource_lp_free_rc(lp);
+            break;
         case S_ALLOC_ACK:
             if (m->c.ret == 0){
                 ns->mem -= bsize;
@@ -127,6 +184,7 @@ static const tw_optdef app_opt [] =
 {
     TWOPT_GROUP("codes-mapping test case" ),
     TWOPT_CHAR("codes-config", conf_file_name, "name of codes configuration file"),
+    TWOPT_UINT("blocking", blocking, "request more than is available, blocking on it"),
     TWOPT_END()
 };
 int main(int argc, char *argv[])
@@ -6,3 +6,42 @@ if [[ -z $srcdir ]] ; then
 fi
 
 tests/resource-test --sync=1 --codes-config=$srcdir/tests/conf/buffer_test.conf
+err=$?
+if [[ $err -ne 0 ]]; then
+    exit $err
+fi
+
+# blocking requests, granted one at a time, in a batch, and in a batch by best
+# fit: an optimistic run has to grant the same as a sequential one
+seq_out=$(mktemp)
+opt_out=$(mktemp)
+trap "rm -f $seq_out $opt_out" EXIT
+
+for conf in buffer_test.conf resource-batch-test.conf resource-best-fit-test.conf; do
+    tests/resource-test --sync=1 --blocking=1 \
+        --codes-config=$srcdir/tests/conf/$conf > $seq_out
+    err=$?
+    if [[ $err -ne 0 ]]; then
+        exit $err
+    fi
+
+    mpirun -np 2 tests/resource-test --sync=3 --blocking=1 \
+        --codes-config=$srcdir/tests/conf/$conf > $opt_out
+    err=$?
+    if [[ $err -ne 0 ]]; then
+        exit $err
+    fi
+
+    # every server gets all of its requests granted
+    if ! grep -q "^Server" $seq_out ||
+            grep "^Server" $seq_out | grep -qv "granted 8 times"; then
+        echo "$conf: missing grants"
+        exit 1
+    fi
+
+    diff <(grep "^Server" $seq_out | sort) <(grep "^Server" $opt_out | sort)
+    err=$?
+    if [[ $err -ne 0 ]]; then
+        exit $err
+    fi
+done
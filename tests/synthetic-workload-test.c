@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2013 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+/* Checks the destinations of the synthetic workload patterns, and that the
+ * workload's op stream comes out the same after ops are reversed. */
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "codes/codes-workload.h"
+
+#define NUM_OPS 1000
+
+static synthetic_params make_params(int nprocs, int pattern)
+{
+    synthetic_params p;
+
+    memset(&p, 0, sizeof(p));
+    p.nprocs = nprocs;
+    p.pattern = pattern;
+    p.arrival = SYNTHETIC_POISSON;
+    p.num_messages = 64;
+    p.payload_size = 2048;
+    p.interval = 1000.0;
+    p.burst_length = 1;
+    p.hotspot_fraction = 0.25;
+    p.seed = 42;
+    return p;
+}
+
+static void check_permutation(int nprocs)
+{
+    synthetic_params p = make_params(nprocs, SYNTHETIC_PERMUTATION);
+    int *hits = malloc(nprocs * sizeof(*hits));
+    int changed = 0;
+
+    p.perm_switch = 4;
+    for (int64_t msg = 0; msg < 12; msg++) {
+        memset(hits, 0, nprocs * sizeof(*hits));
+        for (int r = 0; r < nprocs; r++) {
+            int d = codes_workload_synthetic_dest(&p, r, msg);
+            if (nprocs == 1) {
+                assert(d == -1);
+                continue;
+            }
+            assert(d >= 0 && d < nprocs && d != r);
+            hits[d]++;
+            // the same destination until the permutation switches
+            if (msg % p.perm_switch)
+                assert(d == codes_workload_synthetic_dest(&p, r, msg - 1));
+            else if (msg && d != codes_workload_synthetic_dest(&p, r, msg - 1))
+                changed = 1;
+        }
+        for (int r = 0; nprocs > 1 && r < nprocs; r++)
+            assert(hits[r] == 1);
+    }
+    assert(nprocs <= 3 || changed);
+    free(hits);
+}
+
+static void check_patterns(void)
+{
+    synthetic_params p;
+    int n = 16, hot = 0;
+
+    p = make_params(n, SYNTHETIC_BIT_COMPLEMENT);
+    for (int r = 0; r < n; r++)
+        assert(codes_workload_synthetic_dest(&p, r, 3) == (~r & (n - 1)));
+
+    p = make_params(n, SYNTHETIC_TRANSPOSE);
+    for (int r = 0; r < n; r++) {
+        int d = codes_workload_synthetic_dest(&p, r, 0);
+        assert(r % 4 == r / 4 ? d == -1 : d == (r % 4) * 4 + r / 4);
+    }
+
+    p = make_params(n, SYNTHETIC_TORNADO);
+    for (int r = 0; r < n; r++)
+        assert(codes_workload_synthetic_dest(&p, r, 0) == (r + 7) % n);
+
+    p = make_params(n, SYNTHETIC_INCAST);
+    p.hotspot_rank = 5;
+    for (int r = 0; r < n; r++)
+        assert(codes_workload_synthetic_dest(&p, r, 0) == (r == 5 ? -1 : 5));
+
+    // 4x2x2 grid, each rank visits its six neighbours in turn
+    p = make_params(n, SYNTHETIC_STENCIL);
+    p.stencil_dims[0] = 4;
+    p.stencil_dims[1] = 2;
+    p.stencil_dims[2] = 2;
+    assert(codes_workload_synthetic_dest(&p, 0, 0) == 1);
+    assert(codes_workload_synthetic_dest(&p, 0, 1) == 3);
+    assert(codes_workload_synthetic_dest(&p, 0, 2) == 4);
+    assert(codes_workload_synthetic_dest(&p, 0, 4) == 8);
+    assert(codes_workload_synthetic_dest(&p, 13, 0) == 14);
+    assert(codes_workload_synthetic_dest(&p, 13, 6) == 14);
+
+    p = make_params(n, SYNTHETIC_HOTSPOT);
+    p.hotspot_rank = 3;
+    for (int r = 0; r < n; r++) {
+        for (int64_t msg = 0; msg < 1000; msg++) {
+            int d = codes_workload_synthetic_dest(&p, r, msg);
+            assert(d >= 0 && d < n && d != r);
+            hot += (d == 3);
+        }
+    }
+    // a quarter directly, and a share of the uniform rest
+    assert(fabs(hot / 16000.0 - (0.25 + 0.75 / 15) * 15 / 16) < 0.02);
+}
+
+static void get_ops(int id, int app, int rank, struct codes_workload_op *ops,
+        int n)
+{
+    for (int i = 0; i < n; i++)
+        codes_workload_get_next(id, app, rank, &ops[i]);
+}
+
+static void check_ops(synthetic_params *p, int app, int rank)
+{
+    struct codes_workload_op ops[NUM_OPS], again[NUM_OPS];
+    int id, sends = 0, delays = 0, burst;
+    double total = 0;
+
+    // ops leave the fields they do not use alone
+    memset(ops, 0, sizeof(ops));
+    memset(again, 0, sizeof(again));
+    id = codes_workload_load("synthetic_workload", (char *)p, app, rank);
+    assert(id >= 0);
+    get_ops(id, app, rank, ops, NUM_OPS);
+    // reverse the last ops and issue them again
+    for (int i = 0; i < NUM_OPS / 2; i++)
+        codes_workload_get_next_rc2(id, app, rank);
+    get_ops(id, app, rank, again, NUM_OPS / 2);
+    assert(memcmp(ops + NUM_OPS / 2, again,
+                NUM_OPS / 2 * sizeof(*ops)) == 0);
+
+    burst = p->arrival == SYNTHETIC_BURSTY ? p->burst_length : 1;
+    for (int i = 0; i < NUM_OPS; i++) {
+        if (ops[i].op_type == CODES_WK_DELAY) {
+            assert(sends == delays * burst);
+            total += ops[i].u.delay.nsecs;
+            delays++;
+        }
+        else if (ops[i].op_type == CODES_WK_ISEND) {
+            assert(ops[i].u.send.source_rank == rank);
+            assert(ops[i].u.send.dest_rank ==
+                    codes_workload_synthetic_dest(p, rank, sends));
+            assert(ops[i].u.send.num_bytes == p->payload_size);
+            sends++;
+        }
+        else {
+            assert(ops[i].op_type == CODES_WK_END);
+        }
+    }
+    assert(sends == p->num_messages);
+    assert(delays == (p->num_messages + burst - 1) / burst);
+    // mean gap between messages within 25% of the interval
+    assert(fabs(total / delays / burst - p->interval) < 0.25 * p->interval);
+}
+
+int main(void)
+{
+    synthetic_params p;
+    int sizes[] = {1, 2, 3, 5, 16, 37, 64, 1000};
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        check_permutation(sizes[i]);
+    check_patterns();
+
+    p = make_params(64, SYNTHETIC_UNIFORM);
+    p.num_messages = 400;
+    check_ops(&p, 0, 7);
+    p.arrival = SYNTHETIC_BURSTY;
+    p.burst_length = 8;
+    p.num_messages = 800;
+    check_ops(&p, 1, 9);
+    return 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2013 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+/* Prints the op stream of an iolang kernel for each rank, stepping the ranks
+ * in turn and rolling back (then reissuing) some ops of every rank on the
+ * way, so the output matches a straight run only if the ranks' VMs are
+ * independent and reissued ops are identical. */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "codes/codes-workload.h"
+
+#define MAX_RANKS 16
+#define MAX_OPS 256
+/* ops fetched before the rollback, and how many of them are rolled back */
+#define ROLLBACK_AT 4
+#define ROLLBACK_OPS 3
+
+int main(int argc, char *argv[])
+{
+    static struct codes_workload_op ops[MAX_RANKS][MAX_OPS];
+    int nops[MAX_RANKS] = {0}, rolled_back[MAX_RANKS] = {0};
+    iolang_params p;
+    int id = -1, nranks, done = 0;
+
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <meta file> <number of ranks>\n", argv[0]);
+        return 1;
+    }
+    nranks = atoi(argv[2]);
+    assert(nranks > 0 && nranks <= MAX_RANKS);
+
+    memset(&p, 0, sizeof(p));
+    p.num_cns = nranks;
+    p.use_relpath = 1;
+    snprintf(p.io_kernel_meta_path, sizeof(p.io_kernel_meta_path), "%s",
+            argv[1]);
+
+    for (int r = 0; r < nranks; r++) {
+        id = codes_workload_load("iolang_workload", (char *)&p, 0, r);
+        assert(id >= 0);
+    }
+
+    while (done < nranks) {
+        for (int r = 0; r < nranks; r++) {
+            struct codes_workload_op *op;
+
+            if (nops[r] && ops[r][nops[r] - 1].op_type == CODES_WK_END)
+                continue;
+            assert(nops[r] < MAX_OPS);
+            op = &ops[r][nops[r]++];
+            codes_workload_get_next(id, 0, r, op);
+            if (op->op_type == CODES_WK_END) {
+                done++;
+                continue;
+            }
+            if (nops[r] == ROLLBACK_AT && !rolled_back[r]) {
+                rolled_back[r] = 1;
+                for (int i = 0; i < ROLLBACK_OPS; i++)
+                    codes_workload_get_next_rc(id, 0, r, &ops[r][--nops[r]]);
+            }
+        }
+    }
+
+    for (int r = 0; r < nranks; r++)
+        for (int i = 0; i < nops[r]; i++)
+            codes_workload_print_op(stdout, &ops[r][i], 0, r);
+    return 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
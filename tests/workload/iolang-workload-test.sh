@@ -0,0 +1,16 @@
+#!/bin/bash
+
+# the op stream of tests/workload/iolang-test-kernel.txt for three ranks:
+# loop bodies issue an op per iteration, getgrouprank/getgroupsize issue none,
+# the first op (open) isn't lost and the kernel ends without an exit
+tests/workload/iolang-workload-test \
+    $srcdir/tests/workload/iolang-test-meta.txt 3 > iolang-workload-test.tmp
+err=$?
+if [[ $err -ne 0 ]]; then
+    exit $err
+fi
+
+diff -u $srcdir/tests/workload/iolang-workload-test.out iolang-workload-test.tmp
+err=$?
+rm -f iolang-workload-test.tmp
+exit $err
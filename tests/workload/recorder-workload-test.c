@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2013 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+/* Loads a generated recorder trace, longer than the ops buffer the parser
+ * starts with, and checks when the saved op index (log.0.idx) is reused:
+ * with the trace unchanged, but not once the number of ranks, the trace's
+ * mtime or its size has changed. */
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "codes/codes-workload.h"
+
+#define NUM_WRITES 3000
+#define WRITE_SIZE 4096
+/* the write rewritten in place, away from both ends of the trace */
+#define EDITED_WRITE (NUM_WRITES / 2)
+#define MAX_OPS (2 * NUM_WRITES + 16)
+
+static char trace_dir[64];
+static char trace_path[128];
+static char index_path[128];
+
+/* rank 0 opens a file, writes NUM_WRITES blocks (plus extra ones) and closes
+ * it. The edited write is twice as big, with a size field of the same
+ * length */
+static void write_trace(int edited, int extra)
+{
+    FILE *f = fopen(trace_path, "w");
+    int n = NUM_WRITES + extra;
+
+    assert(f);
+    fprintf(f, "1.000000 open (%s/data, %d, 420) 3 0.000500\n", trace_dir,
+            O_CREAT | O_RDWR);
+    for (int i = 0; i < n; i++)
+        fprintf(f, "%.6f write (3, 0x1, %d, %lld) %d 0.000500\n",
+                1.001 + i * 0.001,
+                i == edited ? 2 * WRITE_SIZE : WRITE_SIZE,
+                (long long)i * WRITE_SIZE, WRITE_SIZE);
+    fprintf(f, "%.6f close (3) 0 0.000500\n", 1.001 + n * 0.001);
+    assert(fclose(f) == 0);
+}
+
+static void set_mtime(struct timespec mtime)
+{
+    struct timespec times[2] = {mtime, mtime};
+
+    assert(utimensat(AT_FDCWD, trace_path, times, 0) == 0);
+}
+
+static struct timespec get_mtime(void)
+{
+    struct stat st;
+
+    assert(stat(trace_path, &st) == 0);
+    return st.st_mtim;
+}
+
+/* all ops of rank 0, up to and including the end */
+static int load_ops(int64_t nprocs, struct codes_workload_op *ops)
+{
+    recorder_params p;
+    int id, n = 0;
+
+    memset(&p, 0, sizeof(p));
+    snprintf(p.trace_dir_path, sizeof(p.trace_dir_path), "%s", trace_dir);
+    p.nprocs = nprocs;
+    id = codes_workload_load("recorder_io_workload", (char *)&p, 0, 0);
+    assert(id >= 0);
+
+    memset(ops, 0, MAX_OPS * sizeof(*ops));
+    do {
+        assert(n < MAX_OPS);
+        codes_workload_get_next(id, 0, 0, &ops[n]);
+    } while (ops[n++].op_type != CODES_WK_END);
+    return n;
+}
+
+/* size of each write, in order, into sizes; returns the write count */
+static int write_sizes(struct codes_workload_op const *ops, int n,
+        int64_t *sizes)
+{
+    int w = 0;
+
+    assert(ops[0].op_type == CODES_WK_OPEN);
+    assert(ops[0].u.open.create_flag);
+    for (int i = 1; i < n - 2; i++) {
+        if (ops[i].op_type == CODES_WK_DELAY)
+            continue;
+        assert(ops[i].op_type == CODES_WK_WRITE);
+        assert(ops[i].u.write.file_id == ops[0].u.open.file_id);
+        assert(ops[i].u.write.offset == (int64_t)w * WRITE_SIZE);
+        sizes[w++] = ops[i].u.write.size;
+    }
+    assert(ops[n - 2].op_type == CODES_WK_CLOSE);
+    return w;
+}
+
+int main(void)
+{
+    static struct codes_workload_op ops[MAX_OPS], again[MAX_OPS];
+    static int64_t sizes[NUM_WRITES + 1];
+    struct timespec mtime;
+    struct stat st;
+    int n, m;
+
+    snprintf(trace_dir, sizeof(trace_dir), "recorder-test-XXXXXX");
+    assert(mkdtemp(trace_dir));
+    snprintf(trace_path, sizeof(trace_path), "%s/log.0", trace_dir);
+    snprintf(index_path, sizeof(index_path), "%s.idx", trace_path);
+
+    /* parsed from the trace, every write is there */
+    write_trace(-1, 0);
+    mtime = get_mtime();
+    n = load_ops(1, ops);
+    assert(write_sizes(ops, n, sizes) == NUM_WRITES);
+    for (int w = 0; w < NUM_WRITES; w++)
+        assert(sizes[w] == WRITE_SIZE);
+    assert(stat(index_path, &st) == 0);
+
+    /* a same-size edit in the middle of the trace that keeps its mtime goes
+     * unnoticed: the ops come from the index, identical */
+    write_trace(EDITED_WRITE, 0);
+    set_mtime(mtime);
+    m = load_ops(1, again);
+    assert(m == n && memcmp(ops, again, n * sizeof(*ops)) == 0);
+
+    /* another number of ranks: parsed again, the edit shows */
+    m = load_ops(2, again);
+    assert(write_sizes(again, m, sizes) == NUM_WRITES);
+    assert(sizes[EDITED_WRITE] == 2 * WRITE_SIZE);
+
+    /* the original trace back, only the mtime tells: parsed again */
+    write_trace(-1, 0);
+    mtime.tv_sec += 10;
+    set_mtime(mtime);
+    m = load_ops(2, again);
+    assert(m == n && memcmp(ops, again, n * sizeof(*ops)) == 0);
+
+    /* a longer trace with the same mtime: parsed again */
+    write_trace(-1, 1);
+    set_mtime(mtime);
+    m = load_ops(2, again);
+    assert(write_sizes(again, m, sizes) == NUM_WRITES + 1);
+
+    unlink(index_path);
+    unlink(trace_path);
+    rmdir(trace_dir);
+    return 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */